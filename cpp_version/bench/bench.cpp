@@ -0,0 +1,608 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+// Benchmarks of growing, prediction and permutation importance on synthetic data. Each case runs in its own process
+// (if fork() is available) and writes one JSON object per line and phase to the output.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#endif
+
+#include "globals.h"
+#include "version.h"
+#include "utility.h"
+#include "DataDouble.h"
+#include "ThreadPool.h"
+#include "ForestClassification.h"
+#include "ForestRegression.h"
+#include "ForestSurvival.h"
+#include "ForestProbability.h"
+
+using namespace ranger;
+
+namespace {
+
+// Number of distinct survival times, discretized to keep prediction memory at num_samples * 1000
+const size_t NUM_SURVIVAL_TIMEPOINTS = 1000;
+
+// Number of levels of unordered covariates
+const size_t NUM_UNORDERED_LEVELS = 8;
+
+enum Shape {
+  SHAPE_TALL, SHAPE_WIDE, SHAPE_UNORDERED, SHAPE_SNP, SHAPE_SMALL
+};
+
+struct BenchCase {
+  TreeType tree_type;
+  bool probability;
+  SplitRule splitrule;
+  Shape shape;
+  size_t num_classes;
+};
+
+struct Options {
+  Options() :
+      num_trees(20), scale(1), repeats(1), seed(1) {
+  }
+  size_t num_trees;
+  double scale;
+  size_t repeats;
+  uint seed;
+  std::vector<uint> num_threads;
+  std::string filter;
+  std::string output_file;
+};
+
+// Covariates and responses of a synthetic dataset. Covariates are generated from the raw 64 bit output of the random
+// number generator, so the data does not depend on the implementation of the standard library distributions.
+struct Dataset {
+  size_t num_rows;
+  size_t num_ordered;
+  size_t num_unordered;
+  size_t num_snps;
+
+  // Column major, ordered before unordered covariates
+  std::vector<double> x;
+
+  // Column major SNP genotypes in {0, 1, 2}
+  std::vector<unsigned char> snps;
+
+  // Column major responses, two columns (time, status) for survival
+  std::vector<double> y;
+  size_t num_y_cols;
+
+  std::vector<std::string> variable_names;
+  std::vector<std::string> unordered_variable_names;
+};
+
+const char* treeTypeName(const BenchCase& bench_case) {
+  switch (bench_case.tree_type) {
+  case TREE_CLASSIFICATION:
+    return bench_case.probability ? "probability" : "classification";
+  case TREE_REGRESSION:
+    return "regression";
+  case TREE_SURVIVAL:
+    return "survival";
+  case TREE_PROBABILITY:
+    return "probability";
+  }
+  return "";
+}
+
+const char* splitRuleName(const BenchCase& bench_case) {
+  switch (bench_case.splitrule) {
+  case LOGRANK:
+    if (bench_case.tree_type == TREE_SURVIVAL) {
+      return "logrank";
+    } else if (bench_case.tree_type == TREE_REGRESSION) {
+      return "variance";
+    } else {
+      return "gini";
+    }
+  case AUC:
+    return "auc";
+  case AUC_IGNORE_TIES:
+    return "auc_ignore_ties";
+  case MAXSTAT:
+    return "maxstat";
+  case EXTRATREES:
+    return "extratrees";
+  case BETA:
+    return "beta";
+  case HELLINGER:
+    return "hellinger";
+  }
+  return "";
+}
+
+const char* shapeName(Shape shape) {
+  switch (shape) {
+  case SHAPE_TALL:
+    return "tall";
+  case SHAPE_WIDE:
+    return "wide";
+  case SHAPE_UNORDERED:
+    return "unordered";
+  case SHAPE_SNP:
+    return "snp";
+  case SHAPE_SMALL:
+    return "small";
+  }
+  return "";
+}
+
+std::string caseName(const BenchCase& bench_case) {
+  return std::string(treeTypeName(bench_case)) + "/" + splitRuleName(bench_case) + "/" + shapeName(bench_case.shape);
+}
+
+// Default split rule of each tree type on all shapes, the other split rules on the tall shape. The beta and AUC split
+// rules are quadratic and cubic in the node size and run on the small shape.
+std::vector<BenchCase> allCases() {
+  std::vector<BenchCase> cases;
+  std::vector<Shape> shapes = { SHAPE_TALL, SHAPE_WIDE, SHAPE_UNORDERED, SHAPE_SNP };
+  for (bool probability : { false, true }) {
+    for (Shape shape : shapes) {
+      cases.push_back( { TREE_CLASSIFICATION, probability, LOGRANK, shape, 3 });
+    }
+    cases.push_back( { TREE_CLASSIFICATION, probability, EXTRATREES, SHAPE_TALL, 3 });
+    cases.push_back( { TREE_CLASSIFICATION, probability, HELLINGER, SHAPE_TALL, 2 });
+  }
+  for (Shape shape : shapes) {
+    cases.push_back( { TREE_REGRESSION, false, LOGRANK, shape, 0 });
+  }
+  for (SplitRule splitrule : { EXTRATREES, MAXSTAT }) {
+    cases.push_back( { TREE_REGRESSION, false, splitrule, SHAPE_TALL, 0 });
+  }
+  cases.push_back( { TREE_REGRESSION, false, BETA, SHAPE_SMALL, 0 });
+  for (Shape shape : shapes) {
+    cases.push_back( { TREE_SURVIVAL, false, LOGRANK, shape, 0 });
+  }
+  for (SplitRule splitrule : { AUC, AUC_IGNORE_TIES }) {
+    cases.push_back( { TREE_SURVIVAL, false, splitrule, SHAPE_SMALL, 0 });
+  }
+  for (SplitRule splitrule : { MAXSTAT, EXTRATREES }) {
+    cases.push_back( { TREE_SURVIVAL, false, splitrule, SHAPE_TALL, 0 });
+  }
+  return cases;
+}
+
+class BenchRandom {
+public:
+  explicit BenchRandom(uint64_t seed) :
+      state(seed) {
+  }
+
+  // splitmix64
+  uint64_t next() {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+  // Uniform in (0, 1)
+  double uniform() {
+    return ((next() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+  }
+
+  double normal() {
+    return sqrt(-2 * log(uniform())) * cos(2 * M_PI * uniform());
+  }
+
+private:
+  uint64_t state;
+};
+
+Dataset generateDataset(const BenchCase& bench_case, double scale, uint64_t seed) {
+  Dataset dataset;
+  size_t num_rows = 0;
+  dataset.num_ordered = 0;
+  dataset.num_unordered = 0;
+  dataset.num_snps = 0;
+  switch (bench_case.shape) {
+  case SHAPE_TALL:
+    num_rows = 20000;
+    dataset.num_ordered = 10;
+    break;
+  case SHAPE_WIDE:
+    num_rows = 1000;
+    dataset.num_ordered = 1000;
+    break;
+  case SHAPE_UNORDERED:
+    num_rows = 5000;
+    dataset.num_ordered = 10;
+    dataset.num_unordered = 10;
+    break;
+  case SHAPE_SNP:
+    num_rows = 5000;
+    dataset.num_ordered = 2;
+    dataset.num_snps = 500;
+    break;
+  case SHAPE_SMALL:
+    num_rows = 300;
+    dataset.num_ordered = 10;
+    break;
+  }
+  dataset.num_rows = std::max((size_t) 10, (size_t) (num_rows * scale));
+  num_rows = dataset.num_rows;
+
+  BenchRandom random(seed);
+  size_t num_x_cols = dataset.num_ordered + dataset.num_unordered;
+  dataset.x.resize(num_x_cols * num_rows);
+  for (size_t col = 0; col < num_x_cols; ++col) {
+    std::string prefix = col < dataset.num_ordered ? "x" : "u";
+    dataset.variable_names.push_back(prefix + std::to_string(col + 1));
+    if (col >= dataset.num_ordered) {
+      dataset.unordered_variable_names.push_back(dataset.variable_names.back());
+    }
+    for (size_t row = 0; row < num_rows; ++row) {
+      if (col < dataset.num_ordered) {
+        dataset.x[col * num_rows + row] = random.normal();
+      } else {
+        dataset.x[col * num_rows + row] = 1 + random.next() % NUM_UNORDERED_LEVELS;
+      }
+    }
+  }
+  dataset.snps.resize(dataset.num_snps * num_rows);
+  for (size_t col = 0; col < dataset.num_snps; ++col) {
+    dataset.variable_names.push_back("snp" + std::to_string(col + 1));
+    double minor_allele_frequency = 0.05 + 0.45 * random.uniform();
+    for (size_t row = 0; row < num_rows; ++row) {
+      dataset.snps[col * num_rows + row] = (random.uniform() < minor_allele_frequency)
+          + (random.uniform() < minor_allele_frequency);
+    }
+  }
+
+  // Linear predictor of the first two ordered covariates, the first unordered covariate and the first three SNPs
+  std::vector<double> eta(num_rows, 0);
+  for (size_t row = 0; row < num_rows; ++row) {
+    eta[row] = dataset.x[row];
+    if (dataset.num_ordered > 1) {
+      eta[row] += 0.5 * dataset.x[num_rows + row];
+    }
+    if (dataset.num_unordered > 0) {
+      double level = dataset.x[dataset.num_ordered * num_rows + row];
+      eta[row] += ((size_t) level % 3 == 0) ? 1 : -0.5;
+    }
+    for (size_t col = 0; col < std::min(dataset.num_snps, (size_t) 3); ++col) {
+      eta[row] += 0.5 * dataset.snps[col * num_rows + row];
+    }
+  }
+
+  dataset.num_y_cols = bench_case.tree_type == TREE_SURVIVAL ? 2 : 1;
+  dataset.y.resize(dataset.num_y_cols * num_rows);
+  for (size_t row = 0; row < num_rows; ++row) {
+    double value = eta[row] + random.normal();
+    if (bench_case.tree_type == TREE_SURVIVAL) {
+      double time = -log(random.uniform()) * exp(-eta[row]);
+      double censoring_time = -2 * log(random.uniform());
+      double observed_time = std::min(time, censoring_time);
+      dataset.y[row] = 1 + floor((1 - exp(-observed_time)) * NUM_SURVIVAL_TIMEPOINTS);
+      dataset.y[num_rows + row] = time <= censoring_time;
+    } else if (bench_case.tree_type == TREE_REGRESSION && bench_case.splitrule == BETA) {
+      dataset.y[row] = std::min(std::max(1 / (1 + exp(-value)), 1e-6), 1 - 1e-6);
+    } else if (bench_case.tree_type == TREE_REGRESSION) {
+      dataset.y[row] = value;
+    } else {
+      size_t classID = (size_t) (bench_case.num_classes / (1 + exp(-value)));
+      dataset.y[row] = std::min(classID, bench_case.num_classes - 1);
+    }
+  }
+  return dataset;
+}
+
+// Copy rows [start, end) of dataset to data, SNPs in 2 bit GenABEL coding in snp_data
+std::unique_ptr<Data> createData(const Dataset& dataset, size_t start, size_t end, bool with_response,
+    std::vector<unsigned char>& snp_data) {
+  size_t num_rows = end - start;
+  size_t num_x_cols = dataset.num_ordered + dataset.num_unordered;
+  std::vector<double> x(num_x_cols * num_rows);
+  for (size_t col = 0; col < num_x_cols; ++col) {
+    std::copy(dataset.x.begin() + col * dataset.num_rows + start, dataset.x.begin() + col * dataset.num_rows + end,
+        x.begin() + col * num_rows);
+  }
+  std::vector<double> y;
+  if (with_response) {
+    y.resize(dataset.num_y_cols * num_rows);
+    for (size_t col = 0; col < dataset.num_y_cols; ++col) {
+      std::copy(dataset.y.begin() + col * dataset.num_rows + start, dataset.y.begin() + col * dataset.num_rows + end,
+          y.begin() + col * num_rows);
+    }
+  }
+  auto data = make_unique<DataDouble>(std::move(x), std::move(y), dataset.variable_names, num_rows, num_x_cols);
+
+  if (dataset.num_snps > 0) {
+    size_t num_rows_rounded = roundToNextMultiple(num_rows, 4);
+    snp_data.assign(dataset.num_snps * num_rows_rounded / 4, 0);
+    for (size_t col = 0; col < dataset.num_snps; ++col) {
+      for (size_t row = 0; row < num_rows; ++row) {
+        size_t idx = col * num_rows_rounded + row;
+        unsigned char value = dataset.snps[col * dataset.num_rows + start + row] + 1;
+        snp_data[idx / 4] |= value << offset[idx % 4];
+      }
+    }
+    data->addSnpData(snp_data.data(), dataset.num_snps);
+  }
+  return std::move(data);
+}
+
+std::unique_ptr<Forest> createForest(const BenchCase& bench_case, const Dataset& dataset, uint num_trees,
+    uint seed, uint num_threads, ImportanceMode importance_mode, std::vector<unsigned char>& snp_data) {
+  std::unique_ptr<Forest> forest;
+  if (bench_case.tree_type == TREE_CLASSIFICATION && bench_case.probability) {
+    forest = make_unique<ForestProbability>();
+  } else if (bench_case.tree_type == TREE_CLASSIFICATION) {
+    forest = make_unique<ForestClassification>();
+  } else if (bench_case.tree_type == TREE_REGRESSION) {
+    forest = make_unique<ForestRegression>();
+  } else {
+    forest = make_unique<ForestSurvival>();
+  }
+
+  std::vector<std::vector<double>> split_select_weights;
+  std::vector<double> case_weights;
+  std::vector<std::vector<size_t>> manual_inbag;
+  std::vector<double> sample_fraction = { DEFAULT_SAMPLE_FRACTION_REPLACE };
+  forest->initR(createData(dataset, 0, dataset.num_rows, true, snp_data), 0, num_trees, 0, seed, num_threads,
+      importance_mode, 0, split_select_weights, std::vector<std::string>(), false, true,
+      dataset.unordered_variable_names, false, bench_case.splitrule, case_weights, manual_inbag, false, false,
+      sample_fraction, DEFAULT_ALPHA, DEFAULT_MINPROP, false, RESPONSE, DEFAULT_NUM_RANDOM_SPLITS, false,
+      DEFAULT_MAXDEPTH, std::vector<double>(), false);
+  return forest;
+}
+
+double elapsedSeconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Peak resident set size of this process in KiB, 0 if not available
+long peakRssKb() {
+#ifndef _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+  }
+#endif
+  return 0;
+}
+
+void writeResult(std::ostream& output, const BenchCase& bench_case, const Dataset& dataset, uint num_trees,
+    uint num_threads, const std::string& phase, size_t num_samples, double seconds) {
+  output << "{\"benchmark\":\"" << caseName(bench_case) << "\",\"tree_type\":\"" << treeTypeName(bench_case)
+      << "\",\"splitrule\":\"" << splitRuleName(bench_case) << "\",\"dataset\":\"" << shapeName(bench_case.shape)
+      << "\",\"num_samples\":" << num_samples << ",\"num_variables\":" << dataset.variable_names.size()
+      << ",\"num_trees\":" << num_trees << ",\"num_threads\":" << num_threads << ",\"phase\":\"" << phase
+      << "\",\"seconds\":" << seconds << ",\"samples_trees_per_second\":" << num_samples * num_trees / seconds
+      << ",\"peak_rss_kb\":" << peakRssKb() << ",\"version\":\"" << RANGER_VERSION << "\"}" << std::endl;
+}
+
+// Grow, predict new data split in num_threads parts with a workspace each, and grow with permutation importance.
+// The fastest of the repeats is reported for each phase.
+void runCase(const BenchCase& bench_case, const Options& options, uint num_threads, std::ostream& output) {
+  Dataset dataset = generateDataset(bench_case, options.scale, options.seed);
+  Dataset prediction_dataset = generateDataset(bench_case, options.scale, options.seed + 1);
+  uint num_trees = options.num_trees;
+  size_t num_samples = dataset.num_rows;
+  std::vector<unsigned char> snp_data;
+
+  double grow_seconds = 0;
+  double predict_seconds = 0;
+  double importance_seconds = 0;
+  for (size_t repeat = 0; repeat < options.repeats; ++repeat) {
+    auto forest = createForest(bench_case, dataset, num_trees, options.seed + repeat, num_threads, IMP_NONE,
+        snp_data);
+    auto start = std::chrono::steady_clock::now();
+    forest->run(false, false);
+    double seconds = elapsedSeconds(start);
+    grow_seconds = repeat == 0 ? seconds : std::min(grow_seconds, seconds);
+
+    // Data created before timing, one part per thread
+    std::vector<std::vector<unsigned char>> part_snp_data(num_threads);
+    std::vector<std::unique_ptr<Data>> parts;
+    std::vector<PredictionWorkspace> workspaces(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+      size_t part_start = prediction_dataset.num_rows * i / num_threads;
+      size_t part_end = prediction_dataset.num_rows * (i + 1) / num_threads;
+      parts.push_back(createData(prediction_dataset, part_start, part_end, false, part_snp_data[i]));
+      workspaces[i].random_number_generator.seed(options.seed + i);
+    }
+    const Forest& grown_forest = *forest;
+    start = std::chrono::steady_clock::now();
+#ifdef OLD_WIN_R_BUILD
+    for (size_t i = 0; i < num_threads; ++i) {
+      grown_forest.predict(*parts[i], workspaces[i]);
+    }
+#else
+    TaskGroup tasks(num_threads, [&](size_t i) {
+      grown_forest.predict(*parts[i], workspaces[i]);
+    });
+    tasks.wait();
+#endif
+    seconds = elapsedSeconds(start);
+    predict_seconds = repeat == 0 ? seconds : std::min(predict_seconds, seconds);
+    forest.reset();
+
+    forest = createForest(bench_case, dataset, num_trees, options.seed + repeat, num_threads, IMP_PERM_BREIMAN,
+        snp_data);
+    start = std::chrono::steady_clock::now();
+    forest->run(false, true);
+    seconds = elapsedSeconds(start);
+    importance_seconds = repeat == 0 ? seconds : std::min(importance_seconds, seconds);
+  }
+
+  writeResult(output, bench_case, dataset, num_trees, num_threads, "grow", num_samples, grow_seconds);
+  writeResult(output, bench_case, dataset, num_trees, num_threads, "predict", prediction_dataset.num_rows,
+      predict_seconds);
+  writeResult(output, bench_case, dataset, num_trees, num_threads, "importance", num_samples, importance_seconds);
+}
+
+// Run case in a child process, so that the peak RSS is that of the case. Returns false if the case failed.
+bool runCaseIsolated(const BenchCase& bench_case, const Options& options, uint num_threads, std::ostream& output) {
+#ifndef _WIN32
+  output.flush();
+  pid_t pid = fork();
+  if (pid == 0) {
+    int status = 0;
+    try {
+      runCase(bench_case, options, num_threads, output);
+    } catch (std::exception& e) {
+      std::cerr << "Error in " << caseName(bench_case) << ": " << e.what() << std::endl;
+      status = 1;
+    }
+    output.flush();
+    std::cerr.flush();
+    _exit(status);
+  } else if (pid > 0) {
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      std::cerr << "Benchmark " << caseName(bench_case) << " failed." << std::endl;
+      return false;
+    }
+    return true;
+  }
+#endif
+  try {
+    runCase(bench_case, options, num_threads, output);
+  } catch (std::exception& e) {
+    std::cerr << "Error in " << caseName(bench_case) << ": " << e.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void printHelp() {
+  std::cout << "Usage: ranger_bench [options]" << std::endl;
+  std::cout << std::endl;
+  std::cout << "Grow, predict and compute permutation importance on synthetic data for all tree types and split rules."
+      << std::endl;
+  std::cout << "Writes one JSON object per line for each benchmark, number of threads and phase." << std::endl;
+  std::cout << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "    " << "--ntree N                 Number of trees. Default: 20." << std::endl;
+  std::cout << "    " << "--scale F                 Multiply number of samples of all datasets by F. Default: 1."
+      << std::endl;
+  std::cout << "    " << "--nthreads N,N,...        Numbers of threads to run each benchmark with. Default: 1 and"
+      << " all cores." << std::endl;
+  std::cout << "    " << "--repeats N               Report fastest of N runs. Default: 1." << std::endl;
+  std::cout << "    " << "--seed N                  Seed of data generation and forests. Default: 1." << std::endl;
+  std::cout << "    " << "--filter STRING           Only run benchmarks with STRING in their name, e.g. survival/."
+      << std::endl;
+  std::cout << "    " << "--list                    List benchmark names and exit." << std::endl;
+  std::cout << "    " << "--out FILE                Append results to FILE instead of stdout." << std::endl;
+  std::cout << "    " << "--help                    Print this help." << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    Options options;
+    bool list = false;
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg == "--help") {
+        printHelp();
+        return 0;
+      } else if (arg == "--list") {
+        list = true;
+        continue;
+      }
+      if (i + 1 >= argc) {
+        throw std::runtime_error("Missing value of option " + arg + ".");
+      }
+      std::string value = argv[++i];
+      if (arg == "--ntree") {
+        options.num_trees = std::stoul(value);
+      } else if (arg == "--scale") {
+        options.scale = std::stod(value);
+      } else if (arg == "--nthreads") {
+        std::stringstream value_stream(value);
+        std::string token;
+        while (std::getline(value_stream, token, ',')) {
+          options.num_threads.push_back(std::stoul(token));
+        }
+      } else if (arg == "--repeats") {
+        options.repeats = std::stoul(value);
+      } else if (arg == "--seed") {
+        options.seed = std::stoul(value);
+      } else if (arg == "--filter") {
+        options.filter = value;
+      } else if (arg == "--out") {
+        options.output_file = value;
+      } else {
+        throw std::runtime_error("Unknown option " + arg + ".");
+      }
+    }
+    if (options.num_trees == 0 || options.repeats == 0 || options.scale <= 0) {
+      throw std::runtime_error("Number of trees, repeats and scale have to be positive.");
+    }
+    if (options.num_threads.empty()) {
+      options.num_threads.push_back(1);
+      uint num_cores = std::thread::hardware_concurrency();
+      if (num_cores > 1) {
+        options.num_threads.push_back(num_cores);
+      }
+    }
+    if (std::find(options.num_threads.begin(), options.num_threads.end(), 0) != options.num_threads.end()) {
+      throw std::runtime_error("Number of threads has to be positive.");
+    }
+
+    std::ofstream output_file;
+    if (!options.output_file.empty() && !list) {
+      output_file.open(options.output_file, std::ios::app);
+      if (!output_file.good()) {
+        throw std::runtime_error("Could not write to output file: " + options.output_file + ".");
+      }
+    }
+    std::ostream& output = options.output_file.empty() ? std::cout : output_file;
+
+    bool all_succeeded = true;
+    for (auto& bench_case : allCases()) {
+      std::string name = caseName(bench_case);
+      if (name.find(options.filter) == std::string::npos) {
+        continue;
+      }
+      if (list) {
+        std::cout << name << std::endl;
+        continue;
+      }
+      for (uint num_threads : options.num_threads) {
+        std::cerr << "Running " << name << " with " << num_threads << " threads .." << std::endl;
+        all_succeeded &= runCaseIsolated(bench_case, options, num_threads, output);
+      }
+    }
+    return all_succeeded ? 0 : 1;
+  } catch (std::exception& e) {
+    std::cerr << "Error: " << e.what() << " Ranger will EXIT now." << std::endl;
+    return -1;
+  }
+}
@@ -0,0 +1 @@
+../../../src/PredictionTensor.h
\ No newline at end of file
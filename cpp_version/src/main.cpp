@@ -9,6 +9,7 @@
  R package "ranger" under GPL3 license.
  #-------------------------------------------------------------------------------*/
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
@@ -49,6 +50,21 @@ void run_ranger(const ArgumentHandler& arg_handler, std::ostream& verbose_out) {
     break;
   }
 
+  // Read prediction batches from stdin or a named pipe if serving
+  std::ifstream serve_file;
+  std::istream* serve_input = 0;
+  if (arg_handler.serve) {
+    if (arg_handler.file == "-") {
+      serve_input = &std::cin;
+    } else {
+      serve_file.open(arg_handler.file, std::ios::binary);
+      if (!serve_file.good()) {
+        throw std::runtime_error("Could not open input file.");
+      }
+      serve_input = &serve_file;
+    }
+  }
+
   // Call Ranger
   forest->initCpp(arg_handler.depvarname, arg_handler.memmode, arg_handler.file, arg_handler.mtry,
       arg_handler.outprefix, arg_handler.ntree, &verbose_out, arg_handler.seed, arg_handler.nthreads,
@@ -56,13 +72,53 @@ void run_ranger(const ArgumentHandler& arg_handler, std::ostream& verbose_out) {
       arg_handler.alwayssplitvars, arg_handler.statusvarname, arg_handler.replace, arg_handler.catvars,
       arg_handler.savemem, arg_handler.splitrule, arg_handler.caseweights, arg_handler.predall, arg_handler.fraction,
       arg_handler.alpha, arg_handler.minprop, arg_handler.holdout, arg_handler.predictiontype,
-      arg_handler.randomsplits, arg_handler.maxdepth, arg_handler.regcoef, arg_handler.usedepth);
+      arg_handler.randomsplits, arg_handler.maxdepth, arg_handler.regcoef, arg_handler.usedepth,
+      arg_handler.maxbins, arg_handler.predchunk, serve_input, arg_handler.numa,
+      arg_handler.gathercolumns, arg_handler.sortlevels, arg_handler.levelwise, arg_handler.fusedoob,
+      arg_handler.oobstop, arg_handler.oobwindow, arg_handler.shard >= 0, std::max(arg_handler.shard, 0));
+
+  if (arg_handler.writedata) {
+    forest->saveDataToFile();
+    verbose_out << "Finished Ranger." << std::endl;
+    return;
+  }
+
+  if (arg_handler.serve) {
+    forest->serve(std::cout);
+    forest->writeOutput();
+    if (arg_handler.profile) {
+      forest->writeProfileFile();
+    }
+    verbose_out << "Finished Ranger." << std::endl;
+    return;
+  }
+
+  // Merge forest shards instead of growing, the merged forest is a shard, too
+  if (!arg_handler.merge.empty()) {
+    for (auto& prefix : arg_handler.merge) {
+      forest->loadShardFromFile(prefix);
+    }
+    forest->saveToFile();
+    forest->saveShardToFile();
+    forest->writeOutput();
+    verbose_out << "Finished Ranger." << std::endl;
+    return;
+  }
 
   forest->run(true, !arg_handler.skipoob);
-  if (arg_handler.write) {
+  if (arg_handler.shard >= 0) {
+    forest->saveShardToFile();
+  }
+  if (arg_handler.write || arg_handler.shard >= 0) {
     forest->saveToFile();
   }
+  if (arg_handler.writebinary) {
+    forest->saveToBinaryFile();
+  }
   forest->writeOutput();
+  if (arg_handler.profile) {
+    forest->writeProfileFile();
+  }
   verbose_out << "Finished Ranger." << std::endl;
 }
 
@@ -76,7 +132,10 @@ int main(int argc, char **argv) {
     }
     arg_handler.checkArguments();
 
-    if (arg_handler.verbose) {
+    if (arg_handler.verbose && arg_handler.serve) {
+      // Predictions are written to stdout
+      run_ranger(arg_handler, std::cerr);
+    } else if (arg_handler.verbose) {
       run_ranger(arg_handler, std::cout);
     } else {
       std::ofstream logfile { arg_handler.outprefix + ".log" };
@@ -0,0 +1 @@
+../../../src/AliasTable.cpp
\ No newline at end of file
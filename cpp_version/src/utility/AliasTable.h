@@ -0,0 +1 @@
+../../../src/AliasTable.h
\ No newline at end of file
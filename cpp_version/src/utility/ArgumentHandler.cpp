@@ -16,16 +16,17 @@
 #include "ArgumentHandler.h"
 #include "version.h"
 #include "utility.h"
+#include "MappedFile.h"
 
 namespace ranger {
 
 ArgumentHandler::ArgumentHandler(int argc, char **argv) :
-    caseweights(""), depvarname(""), fraction(0), holdout(false), memmode(MEM_DOUBLE), savemem(false), skipoob(false), predict(
-        ""), predictiontype(DEFAULT_PREDICTIONTYPE), randomsplits(DEFAULT_NUM_RANDOM_SPLITS), splitweights(""), nthreads(
-        DEFAULT_NUM_THREADS), predall(false), alpha(DEFAULT_ALPHA), minprop(DEFAULT_MINPROP), maxdepth(
-        DEFAULT_MAXDEPTH), file(""), impmeasure(DEFAULT_IMPORTANCE_MODE), targetpartitionsize(0), mtry(0), outprefix(
-        "ranger_out"), probability(false), splitrule(DEFAULT_SPLITRULE), statusvarname(""), ntree(DEFAULT_NUM_TREE), replace(
-        true), verbose(false), write(false), treetype(TREE_CLASSIFICATION), seed(0), usedepth(false) {
+    caseweights(""), depvarname(""), serve(false), fraction(0), gathercolumns(false), holdout(false), fusedoob(false), oobstop(-1), memmode(MEM_DOUBLE), savemem(false), skipoob(false), predict(
+        ""), predictiontype(DEFAULT_PREDICTIONTYPE), randomsplits(DEFAULT_NUM_RANDOM_SPLITS), splitweights(""), profile(false), nthreads(
+        DEFAULT_NUM_THREADS), oobwindow(0), predall(false), predchunk(0), sortlevels(false), alpha(DEFAULT_ALPHA), minprop(DEFAULT_MINPROP), maxdepth(
+        DEFAULT_MAXDEPTH), file(""), impmeasure(DEFAULT_IMPORTANCE_MODE), targetpartitionsize(0), levelwise(false), mtry(0), numa(false), outprefix(
+        "ranger_out"), probability(false), shard(-1), splitrule(DEFAULT_SPLITRULE), statusvarname(""), ntree(DEFAULT_NUM_TREE), replace(
+        true), verbose(false), write(false), writebinary(false), writedata(false), treetype(TREE_CLASSIFICATION), seed(0), usedepth(false), maxbins(0) {
   this->argc = argc;
   this->argv = argv;
 }
@@ -33,16 +34,23 @@ ArgumentHandler::ArgumentHandler(int argc, char **argv) :
 int ArgumentHandler::processArguments() {
 
   // short options
-  char const *short_options = "A:C:D:F:HM:NOP:Q:R:S:U:XZa:b:c:d:f:hi:j:kl:m:o:pr:s:t:uvwy:z:";
+  char const *short_options = "A:B:C:D:EF:GHIJ:K:LM:NOP:Q:R:S:TU:V:WXYZa:b:c:d:ef:g:hi:j:kl:m:no:pr:s:t:uvwx:y:z:";
 
 // long options: longname, no/optional/required argument?, flag(not used!), shortname
     const struct option long_options[] = {
 
       { "alwayssplitvars",      required_argument,  0, 'A'},
+      { "maxbins",              required_argument,  0, 'B'},
       { "caseweights",          required_argument,  0, 'C'},
       { "depvarname",           required_argument,  0, 'D'},
+      { "serve",                no_argument,        0, 'E'},
       { "fraction",             required_argument,  0, 'F'},
+      { "gathercolumns",        no_argument,        0, 'G'},
       { "holdout",              no_argument,        0, 'H'},
+      { "fusedoob",             no_argument,        0, 'I'},
+      { "oobstop",              required_argument,  0, 'J'},
+      { "predchunk",            required_argument,  0, 'K'},
+      { "sortlevels",           no_argument,        0, 'L'},
       { "memmode",              required_argument,  0, 'M'},
       { "savemem",              no_argument,        0, 'N'},
       { "skipoob",              no_argument,        0, 'O'},
@@ -50,7 +58,9 @@ int ArgumentHandler::processArguments() {
       { "predictiontype",       required_argument,  0, 'Q'},
       { "randomsplits",         required_argument,  0, 'R'},
       { "splitweights",         required_argument,  0, 'S'},
+      { "profile",              no_argument,        0, 'T'},
       { "nthreads",             required_argument,  0, 'U'},
+      { "oobwindow",            required_argument,  0, 'V'},
       { "predall",              no_argument,        0, 'X'},
       { "version",              no_argument,        0, 'Z'},
 
@@ -58,13 +68,16 @@ int ArgumentHandler::processArguments() {
       { "minprop",              required_argument,  0, 'b'},
       { "catvars",              required_argument,  0, 'c'},
       { "maxdepth",             required_argument,  0, 'd'},
+      { "levelwise",            no_argument,        0, 'e'},
       { "file",                 required_argument,  0, 'f'},
+      { "merge",                required_argument,  0, 'g'},
       { "help",                 no_argument,        0, 'h'},
       { "impmeasure",           required_argument,  0, 'i'},
       { "regcoef",              required_argument,  0, 'j'},
       { "usedepth",             no_argument,        0, 'k'},
       { "targetpartitionsize",  required_argument,  0, 'l'},
       { "mtry",                 required_argument,  0, 'm'},
+      { "numa",                 no_argument,        0, 'n'},
       { "outprefix",            required_argument,  0, 'o'},
       { "probability",          no_argument,        0, 'p'},
       { "splitrule",            required_argument,  0, 'r'},
@@ -73,6 +86,9 @@ int ArgumentHandler::processArguments() {
       { "noreplace",            no_argument,        0, 'u'},
       { "verbose",              no_argument,        0, 'v'},
       { "write",                no_argument,        0, 'w'},
+      { "shard",                required_argument,  0, 'x'},
+      { "writebinary",          no_argument,        0, 'Y'},
+      { "writedata",            no_argument,        0, 'W'},
       { "treetype",             required_argument,  0, 'y'},
       { "seed",                 required_argument,  0, 'z'},
 
@@ -95,6 +111,20 @@ int ArgumentHandler::processArguments() {
       splitString(alwayssplitvars, optarg, ',');
       break;
 
+    case 'B':
+      try {
+        int temp = std::stoi(optarg);
+        if (temp < 0 || temp > (int) MAX_NUM_BINS) {
+          throw std::runtime_error("");
+        } else {
+          maxbins = temp;
+        }
+      } catch (...) {
+        throw std::runtime_error(
+            "Illegal argument for option 'maxbins'. Please give an integer between 0 and 255. See '--help' for details.");
+      }
+      break;
+
     case 'C':
       caseweights = optarg;
       break;
@@ -103,6 +133,10 @@ int ArgumentHandler::processArguments() {
       depvarname = optarg;
       break;
 
+    case 'E':
+      serve = true;
+      break;
+
     case 'F':
       try {
         fraction = std::stod(optarg);
@@ -115,10 +149,48 @@ int ArgumentHandler::processArguments() {
       }
       break;
 
+    case 'G':
+      gathercolumns = true;
+      break;
+
     case 'H':
       holdout = true;
       break;
 
+    case 'I':
+      fusedoob = true;
+      break;
+
+    case 'J':
+      try {
+        oobstop = std::stod(optarg);
+        if (oobstop < 0) {
+          throw std::runtime_error("");
+        }
+      } catch (...) {
+        throw std::runtime_error(
+            "Illegal argument for option 'oobstop'. Please give a non-negative value. See '--help' for details.");
+      }
+      break;
+
+    case 'K':
+      try {
+        int temp = std::stoi(optarg);
+        if (temp < 1) {
+          throw std::runtime_error("");
+        } else {
+          predchunk = temp;
+        }
+      } catch (...) {
+        throw std::runtime_error(
+            "Illegal argument for option 'predchunk'. Please give a positive integer. See '--help' for details.");
+      }
+      break;
+
+    case 'L':
+      sortlevels = true;
+      break;
+
     case 'M':
       try {
         memmode = (MemoryMode) std::stoi(optarg);
@@ -179,6 +251,10 @@ int ArgumentHandler::processArguments() {
       splitweights = optarg;
       break;
 
+    case 'T':
+      profile = true;
+      break;
+
     case 'U':
       try {
         int temp = std::stoi(optarg);
@@ -193,6 +269,20 @@ int ArgumentHandler::processArguments() {
       }
       break;
 
+    case 'V':
+      try {
+        int temp = std::stoi(optarg);
+        if (temp < 1) {
+          throw std::runtime_error("");
+        } else {
+          oobwindow = temp;
+        }
+      } catch (...) {
+        throw std::runtime_error(
+            "Illegal argument for option 'oobwindow'. Please give a positive integer. See '--help' for details.");
+      }
+      break;
+
     case 'X':
       predall = true;
       break;
@@ -249,10 +339,18 @@ int ArgumentHandler::processArguments() {
       }
       break;
 
+    case 'e':
+      levelwise = true;
+      break;
+
     case 'f':
       file = optarg;
       break;
 
+    case 'g':
+      splitString(merge, optarg, ',');
+      break;
+
     case 'h':
       displayHelp();
       return -1;
@@ -306,6 +404,10 @@ int ArgumentHandler::processArguments() {
       }
       break;
 
+    case 'n':
+      numa = true;
+      break;
+
     case 'o':
       outprefix = optarg;
       break;
@@ -377,6 +479,28 @@ int ArgumentHandler::processArguments() {
       write = true;
       break;
 
+    case 'W':
+      writedata = true;
+      break;
+
+    case 'x':
+      try {
+        int temp = std::stoi(optarg);
+        if (temp < 0) {
+          throw std::runtime_error("");
+        } else {
+          shard = temp;
+        }
+      } catch (...) {
+        throw std::runtime_error(
+            "Illegal argument for option 'shard'. Please give a non-negative integer. See '--help' for details.");
+      }
+      break;
+
+    case 'Y':
+      writebinary = true;
+      break;
+
     case 'y':
       try {
         switch (std::stoi(optarg)) {
@@ -453,8 +577,14 @@ void ArgumentHandler::checkArguments() {
     throw std::runtime_error("Probability estimation is only applicable to classification forests.");
   }
 
-  // Get treetype for prediction
-  if (!predict.empty()) {
+  // Get treetype for prediction, from the header of binary forest files
+  if (!predict.empty() && MappedFile::hasMagic(predict, BINARY_FOREST_MAGIC, BINARY_FOREST_MAGIC_LENGTH)) {
+    MappedFile infile;
+    infile.map(predict);
+    infile.nextBlock(BINARY_FOREST_MAGIC_LENGTH);
+    infile.nextUint64();
+    treetype = (TreeType) infile.nextUint64();
+  } else if (!predict.empty()) {
     std::ifstream infile;
     infile.open(predict, std::ios::binary);
     if (!infile.good()) {
@@ -490,6 +620,18 @@ void ArgumentHandler::checkArguments() {
     throw std::runtime_error("Option '--predall' only available in prediction mode.");
   }
 
+  if (predict.empty() && predchunk > 0) {
+    throw std::runtime_error("Option '--predchunk' only available in prediction mode.");
+  }
+
+  if (predict.empty() && serve) {
+    throw std::runtime_error("Option '--serve' only available in prediction mode.");
+  }
+
+  if (serve && predchunk > 0) {
+    throw std::runtime_error("Please use only one option of predchunk and serve.");
+  }
+
   if (!alwayssplitvars.empty() && !splitweights.empty()) {
     throw std::runtime_error("Please use only one option of splitweights and alwayssplitvars.");
   }
@@ -512,6 +654,36 @@ void ArgumentHandler::checkArguments() {
     throw std::runtime_error("Unordered splitting in survival trees only available for LOGRANK splitrule.");
   }
 
+  // OOB stopping needs the OOB error, window only with OOB stopping
+  if (oobstop >= 0 && skipoob) {
+    throw std::runtime_error("OOB stopping not possible with --skipoob.");
+  }
+  if (oobwindow > 0 && oobstop < 0) {
+    throw std::runtime_error("Option --oobwindow only available with --oobstop.");
+  }
+  if (oobstop >= 0 && oobwindow == 0) {
+    oobwindow = DEFAULT_OOB_STOP_WINDOW;
+  }
+
+  // Shards need fixed tree seeds and exactly ntree trees to be merged
+  if (shard >= 0 && seed == 0) {
+    throw std::runtime_error("Please specify a seed with '--seed' to grow a forest shard.");
+  }
+  if (shard >= 0 && oobstop >= 0) {
+    throw std::runtime_error("OOB stopping not possible for forest shards.");
+  }
+  if (shard >= 0 && !predict.empty()) {
+    throw std::runtime_error("Option '--shard' not available in prediction mode.");
+  }
+  if (!merge.empty() && (!predict.empty() || shard >= 0)) {
+    throw std::runtime_error("Option '--merge' can not be combined with '--predict' or '--shard'.");
+  }
+
+  // Level-wise growing only streams histograms
+  if (levelwise && maxbins == 0) {
+    throw std::runtime_error("Level-wise growing only available with histogram splitting, see --maxbins.");
+  }
+
   // Memory save option not allowed in unordered extratrees mode
   if (splitrule == EXTRATREES && !catvars.empty() && savemem) {
     throw std::runtime_error("savemem option not possible in extraTrees mode with unordered predictors.");
@@ -551,6 +723,8 @@ void ArgumentHandler::displayHelp() {
   std::cout << "    " << "--verbose                     Turn on verbose mode." << std::endl;
   std::cout << "    " << "--file FILE                   Filename of input data. Only numerical values are supported."
       << std::endl;
+  std::cout << "    " << "                              Binary data files written with --writedata are mapped into memory."
+      << std::endl;
   std::cout << "    " << "--treetype TYPE               Set tree type to:" << std::endl;
   std::cout << "    " << "                              TYPE = 1: Classification." << std::endl;
   std::cout << "    " << "                              TYPE = 3: Regression." << std::endl;
@@ -594,7 +768,15 @@ void ArgumentHandler::displayHelp() {
       << std::endl;
   std::cout << "    "
       << "                              Categorical variables must contain only positive integer values." << std::endl;
+  std::cout << "    " << "--sortlevels                  Split categorical variables by ordering their levels by the response"
+      << std::endl;
+  std::cout << "    " << "                              instead of trying all 2-partitions, for many levels." << std::endl;
   std::cout << "    " << "--write                       Save forest to file <outprefix>.forest." << std::endl;
+  std::cout << "    " << "--writebinary                 Save forest in binary format to <outprefix>.forest.bin. Binary forest files"
+      << std::endl;
+  std::cout << "    " << "                              are mapped into memory with --predict and load without parsing."
+      << std::endl;
+  std::cout << "    " << "--writedata                   Save input data in binary format to <outprefix>.data and exit." << std::endl;
   std::cout << "    "
       << "--predict FILE                Load forest from FILE and predict with new data. The new data is expected in the exact same "
       << std::endl;
@@ -606,6 +788,19 @@ void ArgumentHandler::displayHelp() {
       << std::endl;
   std::cout << "    " << "                              predictions for all trees (classification and regression only)."
       << std::endl;
+  std::cout << "    "
+      << "--predchunk N                 Read the new data in chunks of N rows and append the predictions of each chunk to the "
+      << std::endl;
+  std::cout << "    " << "                              prediction file. Memory usage depends on N, not on the sample size."
+      << std::endl;
+  std::cout << "    "
+      << "--serve                       Keep the forest loaded and predict batches of new data read from --file, a named pipe"
+      << std::endl;
+  std::cout << "    " << "                              or - for stdin. The first line is the header, batches are seperated by"
+      << std::endl;
+  std::cout << "    " << "                              empty lines. The predictions of each batch are written to stdout,"
+      << std::endl;
+  std::cout << "    " << "                              followed by an empty line." << std::endl;
   std::cout << "    " << "--predictiontype TYPE         Set type of prediction to:" << std::endl;
   std::cout << "    " << "                              TYPE = 1: Return predicted classes or values." << std::endl;
   std::cout << "    "
@@ -669,17 +864,58 @@ void ArgumentHandler::displayHelp() {
       << std::endl;
   std::cout << "    " << "--usedepth                    Use node depth for regularization." << std::endl;
   std::cout << "    " << "--skipoob                     Skip computation of OOB error." << std::endl;
+  std::cout << "    " << "--fusedoob                    Find the terminal nodes of the OOB samples while growing the trees"
+      << std::endl;
+  std::cout << "    " << "                              instead of predicting them afterwards." << std::endl;
+  std::cout << "    " << "--oobstop TOL                 Grow trees in windows and stop when the OOB error decreases by at most"
+      << std::endl;
+  std::cout << "    " << "                              TOL times the error of the previous window, ntree is the maximum."
+      << std::endl;
+  std::cout << "    " << "--oobwindow N                 Number of trees per window for --oobstop." << std::endl;
+  std::cout << "    " << "                              (Default: 50)" << std::endl;
+  std::cout << "    " << "--shard OFFSET                Grow trees OFFSET to OFFSET+ntree-1 of a forest grown in shards with --seed"
+      << std::endl;
+  std::cout << "    " << "                              and save them to OUTPREFIX.forest and their OOB predictions, importance"
+      << std::endl;
+  std::cout << "    " << "                              and inbag counts to OUTPREFIX.shard." << std::endl;
+  std::cout << "    " << "--merge P1,P2,..              Merge the forest shards saved under the prefixes P1,P2,.. in the order of"
+      << std::endl;
+  std::cout << "    " << "                              their offsets. The OOB error and importance are computed from the shards."
+      << std::endl;
+  std::cout << "    " << "                              The merged forest is saved to OUTPREFIX.forest and OUTPREFIX.shard."
+      << std::endl;
+  std::cout << "    " << "--profile                     Write times of the phases and trees, idle time of the threads and"
+      << std::endl;
+  std::cout << "    " << "                              split search counters to OUTPREFIX.profile (JSON)." << std::endl;
   std::cout << "    " << "--nthreads N                  Set number of parallel threads to N." << std::endl;
   std::cout << "    " << "                              (Default: Number of CPUs available)" << std::endl;
+  std::cout << "    " << "--numa                        Run threads on the CPUs of the NUMA nodes in turn, interleave the data"
+      << std::endl;
+  std::cout << "    " << "                              over the nodes and use each tree on the node it was grown on (Linux only)."
+      << std::endl;
   std::cout << "    " << "--seed SEED                   Set random seed to SEED." << std::endl;
   std::cout << "    " << "                              (Default: No seed)" << std::endl;
   std::cout << "    " << "--outprefix PREFIX            Prefix for output files." << std::endl;
   std::cout << "    " << "--memmode MODE                Set memory mode to:" << std::endl;
   std::cout << "    " << "                              MODE = 0: double." << std::endl;
-  std::cout << "    " << "                              MODE = 1: float." << std::endl;
+  std::cout << "    " << "                              MODE = 1: float (trees predict with float32 nodes)." << std::endl;
   std::cout << "    " << "                              MODE = 2: char." << std::endl;
+  std::cout << "    " << "                              MODE = 3: compact index (raw data freed after sorting)." << std::endl;
+  std::cout << "    " << "                              MODE = 4: sparse (only nonzero values stored)." << std::endl;
   std::cout << "    " << "                              (Default: 0)" << std::endl;
   std::cout << "    " << "--savemem                     Use memory saving (but slower) splitting mode." << std::endl;
+  std::cout << "    " << "--gathercolumns               Copy the variables to each tree in the order of its node samples, for"
+      << std::endl;
+  std::cout << "    " << "                              faster split search on large data (4 bytes per sample and variable)."
+      << std::endl;
+  std::cout << "    "
+      << "--maxbins N                   Use histogram splitting with at most N (<= 255) bins per variable (Gini, Hellinger"
+      << std::endl;
+  std::cout << "    " << "                              and variance splitrules only)." << std::endl;
+  std::cout << "    " << "                              (Default: 0, exact splitting)" << std::endl;
+  std::cout << "    " << "--levelwise                   Grow trees level by level and compute the histograms of all nodes in a"
+      << std::endl;
+  std::cout << "    " << "                              level in one pass over each variable (with --maxbins only)." << std::endl;
   std::cout << std::endl;
 
   std::cout << "See README file for details and examples." << std::endl;
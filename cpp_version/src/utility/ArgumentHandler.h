@@ -51,8 +51,12 @@ public:
   std::vector<std::string> alwayssplitvars;
   std::string caseweights;
   std::string depvarname;
+  bool serve;
   double fraction;
+  bool gathercolumns;
   bool holdout;
+  bool fusedoob;
+  double oobstop;
   MemoryMode memmode;
   bool savemem;
   bool skipoob;
@@ -60,8 +64,12 @@ public:
   PredictionType predictiontype;
   uint randomsplits;
   std::string splitweights;
+  bool profile;
   uint nthreads;
+  uint oobwindow;
   bool predall;
+  uint predchunk;
+  bool sortlevels;
 
   // All command line arguments as member: Small letters
   double alpha;
@@ -69,21 +77,28 @@ public:
   std::vector<std::string> catvars;
   uint maxdepth;
   std::string file;
+  std::vector<std::string> merge;
   ImportanceMode impmeasure;
   uint targetpartitionsize;
+  bool levelwise;
   uint mtry;
+  bool numa;
   std::string outprefix;
   bool probability;
+  int shard;
   SplitRule splitrule;
   std::string statusvarname;
   uint ntree;
   bool replace;
   bool verbose;
   bool write;
+  bool writebinary;
+  bool writedata;
   TreeType treetype;
   uint seed;
   std::vector<double> regcoef;
   bool usedepth;
+  uint maxbins;
 
 private:
   // Display messages
@@ -0,0 +1 @@
+../../../src/DataIndex.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../src/DataMapped.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../../src/DataMapped.h
\ No newline at end of file
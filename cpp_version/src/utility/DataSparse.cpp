@@ -0,0 +1 @@
+../../../src/DataSparse.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../../src/DataSparse.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../src/MappedFile.cpp
\ No newline at end of file
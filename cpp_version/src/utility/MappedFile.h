@@ -0,0 +1 @@
+../../../src/MappedFile.h
\ No newline at end of file
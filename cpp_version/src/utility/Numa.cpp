@@ -0,0 +1 @@
+../../../src/Numa.cpp
\ No newline at end of file
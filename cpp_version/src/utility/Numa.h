@@ -0,0 +1 @@
+../../../src/Numa.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../src/Profile.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../../src/Profile.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../src/ThreadPool.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../../src/ThreadPool.h
\ No newline at end of file
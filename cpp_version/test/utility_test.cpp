@@ -1,9 +1,19 @@
 #include <map>
+#include <set>
 #include <unordered_set>
 #include <fstream>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <thread>
 
 #include "gtest/gtest.h"
 #include "utility.h"
+#include "ThreadPool.h"
+#include "DataDouble.h"
+#include "ForestRegression.h"
 
 using namespace ranger;
 
@@ -109,6 +119,27 @@ TEST(readWrite1D, int1) {
   EXPECT_EQ(expect, test);
 }
 
+// Tokens not read by the stream operator: whitespace separated rows are too short, separated fields are 0
+TEST(loadFromFile, nonDecimalTokens) {
+  std::vector<std::string> tokens = { "nan", "inf", "-inf", "0x10", "1e400" };
+  for (auto& token : tokens) {
+    std::ofstream outfile("testfileload");
+    outfile << "y x" << std::endl << "1 2.5" << std::endl << "0 " << token << std::endl;
+    outfile.close();
+    DataDouble data;
+    std::vector<std::string> dependent_variable_names = { "y" };
+    EXPECT_THROW(data.loadFromFile("testfileload", dependent_variable_names, 1), std::runtime_error);
+
+    outfile.open("testfileload");
+    outfile << "y,x" << std::endl << "1,2.5" << std::endl << "0," << token << std::endl;
+    outfile.close();
+    DataDouble separated_data;
+    separated_data.loadFromFile("testfileload", dependent_variable_names, 1);
+    EXPECT_EQ(2.5, separated_data.get_x(0, 0));
+    EXPECT_EQ(0, separated_data.get_x(1, 0));
+  }
+}
+
 TEST(readWrite1D, double1) {
   std::ofstream outfile = std::ofstream();
   outfile.open("testfile1d", std::ios::binary);
@@ -381,6 +412,19 @@ TEST(mostFrequentClass, equal2) {
   EXPECT_GE(2, mostFrequentClass(class_count, random_number_generator));
 }
 
+TEST(mostFrequentClass, array1) {
+  std::mt19937_64 random_number_generator;
+  std::random_device random_device;
+  random_number_generator.seed(random_device());
+
+  // Counts of 3 classes for 3 samples
+  std::vector<uint> class_counts = std::vector<uint>( { 1, 7, 2, 0, 0, 0, 3, 3, 1 });
+
+  EXPECT_EQ(1, mostFrequentClass(class_counts.data(), 3, random_number_generator));
+  EXPECT_EQ(3, mostFrequentClass(class_counts.data() + 3, 3, random_number_generator));
+  EXPECT_GE(1, mostFrequentClass(class_counts.data() + 6, 3, random_number_generator));
+}
+
 TEST(mostFrequentValue, notEqual1) {
 
   std::mt19937_64 random_number_generator;
@@ -562,6 +606,53 @@ TEST(splitString, test4) {
   EXPECT_EQ(expect, splitted_string);
 }
 
+TEST(AliasTable, draw_frequencies) {
+
+  std::mt19937_64 random_number_generator;
+  std::random_device random_device;
+  random_number_generator.seed(random_device());
+  std::map<size_t, uint> counts;
+
+  std::vector<double> weights = { 0.1, 0, 0.4, 0.2, 0.3 };
+  AliasTable alias_table(weights);
+  size_t num_replicates = 100000;
+
+  for (size_t i = 0; i < num_replicates; ++i) {
+    ++counts[alias_table.draw(random_number_generator)];
+  }
+
+  // Check if counts are expected +- 5%, zero weights never drawn
+  for (size_t i = 0; i < weights.size(); ++i) {
+    double expected_count = weights[i] * num_replicates;
+    EXPECT_NEAR(expected_count, counts[i], expected_count * 0.05);
+  }
+}
+
+TEST(drawWithoutReplacementWeighted, unique_draws) {
+
+  std::vector<size_t> result;
+  std::mt19937_64 random_number_generator;
+  std::random_device random_device;
+  random_number_generator.seed(random_device());
+
+  std::vector<double> weights = { 0.5, 0.1, 0, 1, 0.2, 0.7, 0, 0.3 };
+  AliasTable alias_table(weights);
+  std::vector<bool> drawn(weights.size(), false);
+  size_t num_samples = 5;
+
+  for (size_t i = 0; i < 1000; ++i) {
+    result.clear();
+    drawWithoutReplacementWeighted(result, random_number_generator, alias_table, drawn, num_samples);
+    std::set<size_t> unique_result(result.begin(), result.end());
+    EXPECT_EQ(num_samples, unique_result.size());
+    EXPECT_EQ(0, unique_result.count(2));
+    EXPECT_EQ(0, unique_result.count(6));
+  }
+
+  // Marks are reset
+  EXPECT_EQ(0, std::count(drawn.begin(), drawn.end(), true));
+}
+
 TEST(shuffleAndSplit, test1) {
 
   std::mt19937_64 random_number_generator;
@@ -815,6 +906,58 @@ TEST(order, test1) {
   }
 }
 
+TEST(orderRadix, few_keys) {
+  std::vector<size_t> keys( { 3, 1, 4, 1, 5, 9, 2, 6, 5, 3 });
+  std::vector<size_t> expect( { 1, 3, 6, 0, 9, 2, 4, 8, 7, 5 });
+  EXPECT_EQ(expect, orderRadix(keys, 10));
+}
+
+TEST(orderRadix, many_keys) {
+  std::mt19937_64 random_number_generator(10);
+  std::uniform_int_distribution<size_t> unif_dist(0, 99999);
+  std::vector<size_t> keys(1000);
+  for (auto& key : keys) {
+    key = unif_dist(random_number_generator);
+  }
+
+  // Compare with stable comparison sort
+  std::vector<size_t> expect(keys.size());
+  std::iota(expect.begin(), expect.end(), 0);
+  std::stable_sort(expect.begin(), expect.end(), [&](size_t i1, size_t i2) {return keys[i1] < keys[i2];});
+  EXPECT_EQ(expect, orderRadix(keys, 100000));
+}
+
+TEST(principalComponentScores, line) {
+  // Rows on the line (1, 2) * t, component is the direction of the line
+  std::vector<double> x( { 1, 2, 3, 6, -1, -2, 2, 4 });
+  std::vector<double> weights( { 1, 1, 1, 1 });
+  std::vector<double> scores = principalComponentScores(x, weights, 2);
+
+  // Mean is (1.25, 2.5), scores are signed distances along the line
+  double sign = scores[1] > 0 ? 1 : -1;
+  std::vector<double> expect( { -0.25, 1.75, -2.25, 0.75 });
+  for (size_t i = 0; i < expect.size(); ++i) {
+    EXPECT_NEAR(sign * expect[i] * sqrt(5), scores[i], 1e-9);
+  }
+}
+
+TEST(principalComponentScores, weighted) {
+  // Class proportions of three levels, third level with high weight
+  std::vector<double> x( { 0.8, 0.1, 0.1, 0.1, 0.8, 0.1, 0.4, 0.5, 0.1 });
+  std::vector<double> weights( { 1, 1, 10 });
+  std::vector<double> scores = principalComponentScores(x, weights, 3);
+
+  // Weighted scores are centered and order the levels along the first two classes
+  EXPECT_NEAR(0, scores[0] * 1 + scores[1] * 1 + scores[2] * 10, 1e-9);
+  EXPECT_TRUE((scores[0] < scores[2] && scores[2] < scores[1]) || (scores[1] < scores[2] && scores[2] < scores[0]));
+}
+
+TEST(principalComponentScores, equal_rows) {
+  std::vector<double> x( { 0.5, 0.5, 0.5, 0.5 });
+  std::vector<double> weights( { 3, 1 });
+  EXPECT_EQ(std::vector<double>( { 0, 0 }), principalComponentScores(x, weights, 2));
+}
+
 TEST(rank, test1) {
 
   std::vector<double> x = std::vector<double>( { 1, 3, 2 });
@@ -1328,3 +1471,207 @@ TEST(numSamplesLeftOfCutpoint, test1) {
   }
 }
 
+TEST(roundDownToFloat, exact) {
+  EXPECT_EQ(0.5f, roundDownToFloat(0.5));
+  EXPECT_EQ(-3.0f, roundDownToFloat(-3.0));
+  EXPECT_EQ(0.0f, roundDownToFloat(0.0));
+}
+
+TEST(roundDownToFloat, between_floats) {
+  // 0.1 and -0.1 are not floats, x <= value is kept for all floats x near the value
+  std::vector<double> values = { 0.1, -0.1, 1.0 / 3, 12345.678901, -1e-30 };
+  for (double value : values) {
+    float result = roundDownToFloat(value);
+    EXPECT_LE(result, value);
+    EXPECT_GT(std::nextafter(result, std::numeric_limits<float>::infinity()), value);
+  }
+}
+
+TEST(roundDownToFloat, range) {
+  const float max_float = std::numeric_limits<float>::max();
+  const double inf = std::numeric_limits<double>::infinity();
+  EXPECT_EQ(max_float, roundDownToFloat(max_float));
+  EXPECT_EQ(-max_float, roundDownToFloat(-max_float));
+  EXPECT_EQ(max_float, roundDownToFloat(1e300));
+  EXPECT_EQ(-std::numeric_limits<float>::infinity(), roundDownToFloat(-1e300));
+  EXPECT_EQ(std::numeric_limits<float>::infinity(), roundDownToFloat(inf));
+  EXPECT_EQ(-std::numeric_limits<float>::infinity(), roundDownToFloat(-inf));
+  EXPECT_TRUE(std::isnan(roundDownToFloat(NAN)));
+}
+
+// All pairs reference: comparable if the earlier time is an event or times are equal with different status
+static double concordanceIndexAllPairs(const std::vector<double>& time, const std::vector<double>& status,
+    const std::vector<double>& sum_chf, std::vector<double>& prediction_error_casewise) {
+  size_t n = time.size();
+  double concordance = 0;
+  double permissible = 0;
+  std::vector<double> concordance_casewise(n, 0);
+  std::vector<double> permissible_casewise(n, 0);
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = i + 1; j < n; ++j) {
+      size_t first = time[i] < time[j] ? i : j;
+      size_t second = first == i ? j : i;
+      if (time[i] == time[j] ? status[i] == status[j] : status[first] == 0) {
+        continue;
+      }
+      double co;
+      if (time[i] != time[j] && sum_chf[first] > sum_chf[second]) {
+        co = 1;
+      } else if (sum_chf[i] == sum_chf[j]) {
+        co = 0.5;
+      } else {
+        co = 0;
+      }
+      concordance += co;
+      permissible += 1;
+      concordance_casewise[i] += co;
+      concordance_casewise[j] += co;
+      permissible_casewise[i] += 1;
+      permissible_casewise[j] += 1;
+    }
+  }
+  prediction_error_casewise.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    prediction_error_casewise[i] = 1 - concordance_casewise[i] / permissible_casewise[i];
+  }
+  return concordance / permissible;
+}
+
+// Tied times, tied sum_chf and censoring, for all samples and for a subset of the samples as for OOB samples
+TEST(computeConcordanceIndex, allPairs) {
+  std::mt19937_64 random_number_generator(1);
+  std::uniform_int_distribution<int> time_dist(1, 8);
+  std::uniform_int_distribution<int> status_dist(0, 1);
+  std::uniform_int_distribution<int> chf_dist(0, 5);
+  size_t num_rows = 80;
+
+  for (size_t replicate = 0; replicate < 20; ++replicate) {
+    std::vector<double> y(2 * num_rows);
+    for (size_t i = 0; i < num_rows; ++i) {
+      y[i] = time_dist(random_number_generator);
+      y[num_rows + i] = status_dist(random_number_generator);
+    }
+    DataDouble data(std::vector<double>(num_rows, 0), y, { "x", "time", "status" }, num_rows, 1);
+
+    std::vector<size_t> sample_IDs;
+    if (replicate % 2 == 1) {
+      for (size_t i = 0; i < num_rows; i += 1 + replicate % 3) {
+        sample_IDs.push_back(i);
+      }
+    }
+    size_t num_samples = sample_IDs.empty() ? num_rows : sample_IDs.size();
+    std::vector<double> time(num_samples);
+    std::vector<double> status(num_samples);
+    std::vector<double> sum_chf(num_samples);
+    for (size_t i = 0; i < num_samples; ++i) {
+      size_t row = sample_IDs.empty() ? i : sample_IDs[i];
+      time[i] = y[row];
+      status[i] = y[num_rows + row];
+      sum_chf[i] = 0.5 * chf_dist(random_number_generator);
+    }
+
+    std::vector<double> expect_casewise;
+    double expect = concordanceIndexAllPairs(time, status, sum_chf, expect_casewise);
+    std::vector<double> casewise(num_samples, 0);
+    EXPECT_NEAR(expect, computeConcordanceIndex(data, sum_chf, sample_IDs, 0), 1e-12);
+    EXPECT_NEAR(expect, computeConcordanceIndex(data, sum_chf, sample_IDs, &casewise), 1e-12);
+    for (size_t i = 0; i < num_samples; ++i) {
+      if (std::isnan(expect_casewise[i])) {
+        EXPECT_TRUE(std::isnan(casewise[i]));
+      } else {
+        EXPECT_NEAR(expect_casewise[i], casewise[i], 1e-12);
+      }
+    }
+  }
+}
+
+// Waited for as in Forest::showProgress(), the failed task never reports progress
+TEST(TaskGroup, failed_task_stops_progress) {
+
+  std::atomic<size_t> progress(0);
+  size_t max_progress = 4;
+  TaskGroup tasks(2, [&progress](size_t i) {
+    if (i == 0) {
+      throw std::runtime_error("task failed");
+    }
+    progress += 2;
+  });
+
+  while (!tasks.waitFor(std::chrono::milliseconds(100))) {
+  }
+  EXPECT_LT(progress.load(), max_progress);
+  EXPECT_THROW(tasks.wait(), std::runtime_error);
+}
+
+// Woken by the last task, not after the full timeout
+TEST(TaskGroup, wait_for_wakes_when_done) {
+
+  TaskGroup tasks(2, [](size_t i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  });
+
+  auto start_time = std::chrono::steady_clock::now();
+  EXPECT_TRUE(tasks.waitFor(std::chrono::seconds(10)));
+  EXPECT_LT(std::chrono::steady_clock::now() - start_time, std::chrono::seconds(5));
+  tasks.wait();
+}
+
+// Shard of the trees tree_offset..tree_offset+num_trees-1 of the forest grown on testfilemerge with seed 1
+static std::unique_ptr<Forest> growForestShard(uint num_trees, size_t tree_offset,
+    const std::vector<std::string>& unordered_variable_names) {
+  std::unique_ptr<Forest> forest = make_unique<ForestRegression>();
+  forest->initCpp("y", MEM_DOUBLE, "testfilemerge", 0, "testfilemerge", num_trees, 0, 1, 1, "", IMP_PERM_BREIMAN, 0,
+      "", { }, "", true, unordered_variable_names, false, DEFAULT_SPLITRULE, "", false, 0, DEFAULT_ALPHA,
+      DEFAULT_MINPROP, false, DEFAULT_PREDICTIONTYPE, DEFAULT_NUM_RANDOM_SPLITS, DEFAULT_MAXDEPTH, { }, false, 0, 0, 0,
+      false, false, false, false, false, -1, 0, true, tree_offset);
+  if (num_trees > 0) {
+    forest->run(false, true);
+  }
+  return forest;
+}
+
+// Two shards merged into an empty forest equal the forest grown at once, x3 unordered in the shards only
+TEST(Forest, mergeShards) {
+  std::mt19937_64 random_number_generator(1);
+  std::uniform_real_distribution<double> unif_dist(0, 1);
+  std::ofstream outfile("testfilemerge");
+  std::ofstream prediction_outfile("testfilemergex");
+  outfile << "y x1 x2 x3" << std::endl;
+  prediction_outfile << "x1 x2 x3" << std::endl;
+  for (size_t i = 0; i < 100; ++i) {
+    double x1 = unif_dist(random_number_generator);
+    double x2 = unif_dist(random_number_generator);
+    size_t x3 = 1 + i % 4;
+    double y = x1 + (x3 % 2) + 0.1 * unif_dist(random_number_generator);
+    outfile << y << " " << x1 << " " << x2 << " " << x3 << std::endl;
+    prediction_outfile << x1 << " " << x2 << " " << x3 << std::endl;
+  }
+  outfile.close();
+  prediction_outfile.close();
+
+  std::vector<std::string> unordered_variable_names = { "x3" };
+  std::unique_ptr<Forest> full_forest = growForestShard(10, 0, unordered_variable_names);
+  std::unique_ptr<Forest> first_shard = growForestShard(6, 0, unordered_variable_names);
+  std::unique_ptr<Forest> second_shard = growForestShard(4, 6, unordered_variable_names);
+  std::unique_ptr<Forest> merged_forest = growForestShard(0, 0, { });
+  merged_forest->merge(*first_shard);
+  merged_forest->merge(*second_shard);
+
+  EXPECT_EQ(full_forest->getNumTrees(), merged_forest->getNumTrees());
+  EXPECT_DOUBLE_EQ(full_forest->getOverallPredictionError(), merged_forest->getOverallPredictionError());
+  for (size_t i = 0; i < full_forest->getVariableImportance().size(); ++i) {
+    EXPECT_NEAR(full_forest->getVariableImportance()[i], merged_forest->getVariableImportance()[i], 1e-12);
+  }
+
+  DataDouble prediction_data;
+  std::vector<std::string> dependent_variable_names;
+  prediction_data.loadFromFile("testfilemergex", dependent_variable_names, 1);
+  PredictionWorkspace full_workspace;
+  PredictionWorkspace merged_workspace;
+  full_forest->predict(prediction_data, full_workspace);
+  merged_forest->predict(prediction_data, merged_workspace);
+  ASSERT_EQ(full_workspace.predictions.size(), merged_workspace.predictions.size());
+  for (size_t i = 0; i < full_workspace.predictions.size(); ++i) {
+    EXPECT_DOUBLE_EQ(full_workspace.predictions.data()[i], merged_workspace.predictions.data()[i]);
+  }
+}
@@ -1,2 +1,10 @@
 #include "../../src/globals.h"
+
+// Prediction with a const forest: Forest::predict(const Data&, PredictionWorkspace&) does not change the forest, so
+// several threads can predict with one forest and a workspace each
+#include "../../src/Forest.h"
+#include "../../src/ForestClassification.h"
+#include "../../src/ForestRegression.h"
+#include "../../src/ForestSurvival.h"
+#include "../../src/ForestProbability.h"
 using namespace ranger;
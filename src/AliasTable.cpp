@@ -0,0 +1,62 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+#include <numeric>
+
+#include "AliasTable.h"
+
+namespace ranger {
+
+AliasTable::AliasTable(const std::vector<double>& weights) :
+    probabilities(weights.size()), aliases(weights.size()) {
+
+  size_t n = weights.size();
+  double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+  size_t max_weight_idx = std::max_element(weights.begin(), weights.end()) - weights.begin();
+
+  // Scale weights to mean 1, slots below 1 are filled up by slots above 1
+  std::vector<size_t> small;
+  std::vector<size_t> large;
+  for (size_t i = 0; i < n; ++i) {
+    probabilities[i] = weights[i] * n / sum;
+    aliases[i] = i;
+    if (probabilities[i] < 1) {
+      small.push_back(i);
+    } else {
+      large.push_back(i);
+    }
+  }
+  while (!small.empty() && !large.empty()) {
+    size_t small_idx = small.back();
+    small.pop_back();
+    size_t large_idx = large.back();
+    aliases[small_idx] = large_idx;
+    probabilities[large_idx] -= 1 - probabilities[small_idx];
+    if (probabilities[large_idx] < 1) {
+      large.pop_back();
+      small.push_back(large_idx);
+    }
+  }
+
+  // Slots left over by rounding are full, zero weights are never drawn
+  for (auto& idx : large) {
+    probabilities[idx] = 1;
+  }
+  for (auto& idx : small) {
+    if (weights[idx] > 0) {
+      probabilities[idx] = 1;
+    } else {
+      aliases[idx] = max_weight_idx;
+    }
+  }
+}
+
+} // namespace ranger
@@ -0,0 +1,55 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+#ifndef ALIASTABLE_H_
+#define ALIASTABLE_H_
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstddef>
+
+#include "globals.h"
+
+namespace ranger {
+
+// Draw from 0..n-1 with probabilities proportional to n weights in constant time (Vose's alias method). Built once,
+// can be used by several threads at the same time with their own random number generators.
+class AliasTable {
+public:
+  AliasTable() = default;
+
+  // Weights must be non-negative and at least one positive
+  explicit AliasTable(const std::vector<double>& weights);
+
+  bool empty() const {
+    return probabilities.empty();
+  }
+  size_t size() const {
+    return probabilities.size();
+  }
+
+  // One uniform draw picks a slot, which is kept with its probability and replaced by its alias otherwise
+  size_t draw(std::mt19937_64& random_number_generator) const {
+    std::uniform_real_distribution<double> distribution(0.0, (double) probabilities.size());
+    double u = distribution(random_number_generator);
+    size_t slot = std::min((size_t) u, probabilities.size() - 1);
+    return u - slot < probabilities[slot] ? slot : aliases[slot];
+  }
+
+private:
+  std::vector<double> probabilities;
+  std::vector<size_t> aliases;
+};
+
+} // namespace ranger
+
+#endif /* ALIASTABLE_H_ */
@@ -14,15 +14,22 @@
 #include <stdexcept>
 #include <algorithm>
 #include <iterator>
+#include <utility>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <exception>
 
 #include "Data.h"
 #include "utility.h"
+#include "ThreadPool.h"
 
 namespace ranger {
 
 Data::Data() :
-    num_rows(0), num_rows_rounded(0), num_cols(0), snp_data(0), num_cols_no_snp(0), externalData(true), index_data(0), max_num_unique_values(
-        0), order_snps(false) {
+    num_rows(0), num_rows_rounded(0), num_cols(0), snp_data(0), num_cols_no_snp(0), externalData(true), max_num_unique_values(
+        0), max_num_bins(0), order_snps(false), chunk_input(0), chunk_seperator(0), chunk_num_y_cols(0) {
 }
 
 size_t Data::getVariableID(const std::string& variable_name) const {
@@ -42,174 +49,318 @@ void Data::addSnpData(unsigned char* snp_data, size_t num_cols_snp) {
 // #nocov end
 
 // #nocov start
-bool Data::loadFromFile(std::string filename, std::vector<std::string>& dependent_variable_names) {
-
-  bool result;
+bool Data::loadFromFile(std::string filename, std::vector<std::string>& dependent_variable_names, uint num_threads) {
 
   // Open input file
   std::ifstream input_file;
-  input_file.open(filename);
+  input_file.open(filename, std::ios::binary);
   if (!input_file.good()) {
     throw std::runtime_error("Could not open input file.");
   }
 
   // Count number of rows
+  std::vector<char> buffer(TEXT_BLOCK_SIZE + 1);
   size_t line_count = 0;
-  std::string line;
-  while (getline(input_file, line)) {
+  char last_char = '\n';
+  while (input_file.read(buffer.data(), TEXT_BLOCK_SIZE) || input_file.gcount() > 0) {
+    size_t size = input_file.gcount();
+    line_count += std::count(buffer.begin(), buffer.begin() + size, '\n');
+    last_char = buffer[size - 1];
+  }
+  if (last_char != '\n') {
     ++line_count;
   }
   num_rows = line_count - 1;
-  input_file.close();
-  input_file.open(filename);
+  input_file.clear();
+  input_file.seekg(0);
 
-  // Check if comma, semicolon or whitespace seperated
-  std::string header_line;
-  getline(input_file, header_line);
+  std::vector<size_t> column_targets;
+  char seperator = loadHeader(input_file, dependent_variable_names, column_targets);
 
-  // Find out if comma, semicolon or whitespace seperated and call appropriate method
-  if (header_line.find(",") != std::string::npos) {
-    result = loadFromFileOther(input_file, header_line, dependent_variable_names, ',');
-  } else if (header_line.find(";") != std::string::npos) {
-    result = loadFromFileOther(input_file, header_line, dependent_variable_names, ';');
-  } else {
-    result = loadFromFileWhitespace(input_file, header_line, dependent_variable_names);
+  // Read body in blocks of complete lines, parse each block in parallel
+  reserveMemory(dependent_variable_names.size());
+  bool error = false;
+  size_t row = 0;
+  size_t carry = 0;
+  bool end_of_file = false;
+  while (!end_of_file) {
+    buffer.resize(carry + TEXT_BLOCK_SIZE + 1);
+    input_file.read(buffer.data() + carry, TEXT_BLOCK_SIZE);
+    size_t size = carry + input_file.gcount();
+    end_of_file = !input_file;
+    buffer[size] = '\0';
+
+    size_t block_size = size;
+    if (!end_of_file) {
+      auto last_newline = std::find(buffer.rbegin() + (buffer.size() - size), buffer.rend(), '\n');
+      if (last_newline == buffer.rend()) {
+        // Line longer than block
+        carry = size;
+        continue;
+      }
+      block_size = buffer.rend() - last_newline;
+    }
+    error = loadFromTextInParallel(buffer.data(), buffer.data() + block_size, row, seperator, column_targets,
+        num_threads) || error;
+    carry = size - block_size;
+    std::copy(buffer.begin() + block_size, buffer.begin() + size, buffer.begin());
   }
+  num_rows = row;
+  finishLoading();
 
   externalData = false;
   input_file.close();
-  return result;
+  return error;
+}
+
+void Data::openFileChunked(std::string filename, std::vector<std::string>& dependent_variable_names) {
+  chunk_input_file.open(filename, std::ios::binary);
+  if (!chunk_input_file.good()) {
+    throw std::runtime_error("Could not open input file.");
+  }
+  openStreamChunked(chunk_input_file, dependent_variable_names);
+}
+
+void Data::openStreamChunked(std::istream& input, std::vector<std::string>& dependent_variable_names) {
+  chunk_input = &input;
+  chunk_seperator = loadHeader(*chunk_input, dependent_variable_names, chunk_column_targets);
+  chunk_num_y_cols = dependent_variable_names.size();
+}
+
+bool Data::loadNextChunk(size_t max_rows, uint num_threads, bool& error) {
+
+  // Read up to max_rows lines, memory of previous chunk is reused
+  chunk_text.clear();
+  size_t rows = 0;
+  while (rows < max_rows && getline(*chunk_input, chunk_line)) {
+    chunk_text.append(chunk_line);
+    chunk_text.push_back('\n');
+    ++rows;
+  }
+  if (rows == 0) {
+    return false;
+  }
+
+  loadChunkText(rows, num_threads, error);
+  return true;
 }
 
-bool Data::loadFromFileWhitespace(std::ifstream& input_file, std::string header_line,
-    std::vector<std::string>& dependent_variable_names) {
+bool Data::loadNextBatch(uint num_threads, bool& error) {
 
-  size_t num_dependent_variables = dependent_variable_names.size();
-  std::vector<size_t> dependent_varIDs;
-  dependent_varIDs.resize(num_dependent_variables);
+  // Read lines up to an empty one, memory of previous batch is reused
+  chunk_text.clear();
+  size_t rows = 0;
+  bool found_line = false;
+  while (getline(*chunk_input, chunk_line)) {
+    found_line = true;
+    if (chunk_line.empty() || chunk_line == "\r") {
+      break;
+    }
+    chunk_text.append(chunk_line);
+    chunk_text.push_back('\n');
+    ++rows;
+  }
+  if (!found_line) {
+    return false;
+  }
+
+  loadChunkText(rows, num_threads, error);
+  return true;
+}
+
+void Data::loadChunkText(size_t rows, uint num_threads, bool& error) {
+  num_rows = rows;
+  reserveMemory(chunk_num_y_cols);
+  size_t row = 0;
+  error = loadFromTextInParallel(chunk_text.data(), chunk_text.data() + chunk_text.size(), row, chunk_seperator,
+      chunk_column_targets, num_threads) || error;
+  finishLoading();
+  externalData = false;
+}
+
+char Data::loadHeader(std::istream& input_file, std::vector<std::string>& dependent_variable_names,
+    std::vector<size_t>& column_targets) {
+
+  // Find out if comma, semicolon or whitespace seperated
+  std::string header_line;
+  getline(input_file, header_line);
+  char seperator = 0;
+  if (header_line.find(",") != std::string::npos) {
+    seperator = ',';
+  } else if (header_line.find(";") != std::string::npos) {
+    seperator = ';';
+  }
 
   // Read header
+  std::vector<std::string> header;
   std::string header_token;
   std::stringstream header_line_stream(header_line);
-  size_t col = 0;
-  while (header_line_stream >> header_token) {
-    bool is_dependent_var = false;
-    for (size_t i = 0; i < dependent_variable_names.size(); ++i) {
-      if (header_token == dependent_variable_names[i]) {
-        dependent_varIDs[i] = col;
-        is_dependent_var = true;
-      }
+  if (seperator == 0) {
+    while (header_line_stream >> header_token) {
+      header.push_back(header_token);
     }
-    if (!is_dependent_var) {
-      variable_names.push_back(header_token);
+  } else {
+    while (getline(header_line_stream, header_token, seperator)) {
+      header.push_back(header_token);
     }
-    ++col;
   }
 
+  // Target of each column: x column or num_cols + y column
+  column_targets.assign(header.size(), 0);
+  std::vector<size_t> dependent_columns;
+  for (size_t col = 0; col < header.size(); ++col) {
+    auto it = std::find(dependent_variable_names.cbegin(), dependent_variable_names.cend(), header[col]);
+    if (it == dependent_variable_names.cend()) {
+      column_targets[col] = variable_names.size();
+      variable_names.push_back(header[col]);
+    } else {
+      column_targets[col] = std::distance(dependent_variable_names.cbegin(), it);
+      dependent_columns.push_back(col);
+    }
+  }
   num_cols = variable_names.size();
   num_cols_no_snp = num_cols;
+  for (auto& col : dependent_columns) {
+    column_targets[col] += num_cols;
+  }
+  return seperator;
+}
 
-  // Read body
-  reserveMemory(num_dependent_variables);
+bool Data::loadFromTextInParallel(const char* block, const char* block_end, size_t& row, char seperator,
+    const std::vector<size_t>& column_targets, uint num_threads) {
+
+  size_t block_size = block_end - block;
   bool error = false;
-  std::string line;
-  size_t row = 0;
-  while (getline(input_file, line)) {
-    double token;
-    std::stringstream line_stream(line);
-    size_t column = 0;
-    while (readFromStream(line_stream, token)) {
-      size_t column_x = column;
-      bool is_dependent_var = false;
-      for (size_t i = 0; i < dependent_varIDs.size(); ++i) {
-        if (column == dependent_varIDs[i]) {
-          set_y(i, row, token, error);
-          is_dependent_var = true;
-          break;
-        } else if (column > dependent_varIDs[i]) {
-          --column_x;
-        }
-      }
-      if (!is_dependent_var) {
-        set_x(column_x, row, token, error);
+
+  // Split block at line boundaries
+  size_t num_parts = std::max((uint) 1, std::min(num_threads, (uint) (block_size / (1024 * 1024) + 1)));
+  std::vector<const char*> part_begin(num_parts + 1);
+  std::vector<size_t> part_row(num_parts + 1);
+  part_begin[0] = block;
+  part_row[0] = row;
+  for (size_t part = 1; part <= num_parts; ++part) {
+    const char* split = block + block_size * part / num_parts;
+    if (part == num_parts) {
+      split = block + block_size;
+    } else if (split < part_begin[part - 1]) {
+      split = part_begin[part - 1];
+    } else {
+      split = std::find(split, block + block_size, '\n');
+      if (split < block + block_size) {
+        ++split;
       }
-      ++column;
     }
-    if (column > (num_cols + num_dependent_variables)) {
-      throw std::runtime_error(
-          std::string("Could not open input file. Too many columns in row ") + std::to_string(row) + std::string("."));
-    } else if (column < (num_cols + num_dependent_variables)) {
-      throw std::runtime_error(
-          std::string("Could not open input file. Too few columns in row ") + std::to_string(row)
-              + std::string(". Are all values numeric?"));
+    part_begin[part] = split;
+    size_t num_lines = std::count(part_begin[part - 1], split, '\n');
+    if (split > part_begin[part - 1] && *(split - 1) != '\n') {
+      ++num_lines;
     }
-    ++row;
+    part_row[part] = part_row[part - 1] + num_lines;
   }
-  num_rows = row;
-  return error;
-}
 
-bool Data::loadFromFileOther(std::ifstream& input_file, std::string header_line,
-    std::vector<std::string>& dependent_variable_names, char seperator) {
+#ifdef OLD_WIN_R_BUILD
+  error = loadFromText(part_begin[0], part_begin[1], part_row[0], seperator, column_targets) || error;
+#else
+  std::vector<char> part_errors(num_parts, false);
+  TaskGroup tasks(num_parts, [&](size_t part) {
+    part_errors[part] = loadFromText(part_begin[part], part_begin[part + 1], part_row[part], seperator,
+        column_targets);
+  });
+  tasks.wait();
+  for (size_t part = 0; part < num_parts; ++part) {
+    error = error || part_errors[part];
+  }
+#endif
 
-  size_t num_dependent_variables = dependent_variable_names.size();
-  std::vector<size_t> dependent_varIDs;
-  dependent_varIDs.resize(num_dependent_variables);
+  row = part_row[num_parts];
+  return error;
+}
 
-  // Read header
-  std::string header_token;
-  std::stringstream header_line_stream(header_line);
-  size_t col = 0;
-  while (getline(header_line_stream, header_token, seperator)) {
-    bool is_dependent_var = false;
-    for (size_t i = 0; i < dependent_variable_names.size(); ++i) {
-      if (header_token == dependent_variable_names[i]) {
-        dependent_varIDs[i] = col;
-        is_dependent_var = true;
-      }
-    }
-    if (!is_dependent_var) {
-      variable_names.push_back(header_token);
-    }
-    ++col;
+// Parse a decimal number starting at pos as std::strtod(), token_end == pos if none. Hexadecimal numbers, inf, nan
+// and values out of range are not parsed, as with the stream operator.
+static double parseNumber(const char* pos, char** token_end) {
+  errno = 0;
+  double token = std::strtod(pos, token_end);
+  if (*token_end != pos
+      && (!std::isfinite(token) || errno == ERANGE || std::find_if(pos, (const char*) *token_end, [](char c) {
+        return c == 'x' || c == 'X';
+      }) != *token_end)) {
+    *token_end = const_cast<char*>(pos);
+    return 0;
   }
+  return token;
+}
 
-  num_cols = variable_names.size();
-  num_cols_no_snp = num_cols;
+bool Data::loadFromText(const char* begin, const char* end, size_t row, char seperator,
+    const std::vector<size_t>& column_targets) {
 
-  // Read body
-  reserveMemory(num_dependent_variables);
   bool error = false;
-  std::string line;
-  size_t row = 0;
-  while (getline(input_file, line)) {
-    std::string token_string;
-    double token;
-    std::stringstream line_stream(line);
+  size_t num_file_cols = column_targets.size();
+  const char* pos = begin;
+  while (pos < end) {
+    const char* line_end = std::find(pos, end, '\n');
     size_t column = 0;
-    while (getline(line_stream, token_string, seperator)) {
-      std::stringstream token_stream(token_string);
-      readFromStream(token_stream, token);
-
-      size_t column_x = column;
-      bool is_dependent_var = false;
-      for (size_t i = 0; i < dependent_varIDs.size(); ++i) {
-        if (column == dependent_varIDs[i]) {
-          set_y(i, row, token, error);
-          is_dependent_var = true;
+    if (seperator == 0) {
+      // Read numbers until end of line or first non-numeric token
+      while (true) {
+        while (pos < line_end && std::isspace((unsigned char) *pos)) {
+          ++pos;
+        }
+        if (pos == line_end) {
+          break;
+        }
+        char* token_end;
+        double token = parseNumber(pos, &token_end);
+        if (token_end == pos) {
           break;
-        } else if (column > dependent_varIDs[i]) {
-          --column_x;
         }
+        if (column < num_file_cols) {
+          size_t target = column_targets[column];
+          if (target < num_cols) {
+            set_x(target, row, token, error);
+          } else {
+            set_y(target - num_cols, row, token, error);
+          }
+        }
+        pos = token_end;
+        ++column;
+      }
+      if (column > num_file_cols) {
+        throw std::runtime_error(
+            std::string("Could not open input file. Too many columns in row ") + std::to_string(row)
+                + std::string("."));
+      } else if (column < num_file_cols) {
+        throw std::runtime_error(
+            std::string("Could not open input file. Too few columns in row ") + std::to_string(row)
+                + std::string(". Are all values numeric?"));
       }
-      if (!is_dependent_var) {
-        set_x(column_x, row, token, error);
+    } else {
+      // Non-numeric fields are read as 0
+      while (true) {
+        const char* field_end = std::find(pos, line_end, seperator);
+        char* token_end;
+        double token = parseNumber(pos, &token_end);
+        if (token_end == pos || token_end > field_end) {
+          token = 0;
+        }
+        if (column < num_file_cols) {
+          size_t target = column_targets[column];
+          if (target < num_cols) {
+            set_x(target, row, token, error);
+          } else {
+            set_y(target - num_cols, row, token, error);
+          }
+        }
+        ++column;
+        if (field_end == line_end) {
+          break;
+        }
+        pos = field_end + 1;
       }
-      ++column;
     }
+    pos = line_end + 1;
     ++row;
   }
-  num_rows = row;
   return error;
 }
 // #nocov end
@@ -219,7 +370,8 @@ void Data::getAllValues(std::vector<double>& all_values, std::vector<size_t>& sa
 
   // All values for varID (no duplicates) for given sampleIDs
   if (getUnpermutedVarID(varID) < num_cols_no_snp) {
-    
+
+    all_values.clear();
     all_values.reserve(end - start);
     for (size_t pos = start; pos < end; ++pos) {
       all_values.push_back(get_x(sampleIDs[pos], varID));
@@ -232,6 +384,38 @@ void Data::getAllValues(std::vector<double>& all_values, std::vector<size_t>& sa
   }
 }
 
+void Data::getAllValues(std::vector<double>& all_values, std::vector<size_t>& value_indices,
+    std::vector<size_t>& sampleIDs, size_t varID, size_t start, size_t end) const {
+
+  size_t num_values = end - start;
+  value_indices.resize(num_values);
+  if (getUnpermutedVarID(varID) < num_cols_no_snp && isSorted()) {
+    // Sort ranks of presorted data instead of values
+    std::vector<size_t> ranks(num_values);
+    forEachIndex(varID, sampleIDs, start, end, [&](size_t pos, size_t index) {
+      ranks[pos - start] = index;
+    });
+    std::vector<size_t> indices = orderRadix(ranks, getNumUniqueDataValues(varID));
+
+    // Unique values in rank order
+    all_values.clear();
+    all_values.reserve(num_values);
+    for (size_t i = 0; i < num_values; ++i) {
+      size_t rank = ranks[indices[i]];
+      if (i == 0 || rank != ranks[indices[i - 1]]) {
+        all_values.push_back(getUniqueDataValue(varID, rank));
+      }
+      value_indices[indices[i]] = all_values.size() - 1;
+    }
+  } else {
+    getAllValues(all_values, sampleIDs, varID, start, end);
+    for (size_t i = 0; i < num_values; ++i) {
+      value_indices[i] = std::lower_bound(all_values.begin(), all_values.end(), get_x(sampleIDs[start + i], varID))
+          - all_values.begin();
+    }
+  }
+}
+
 void Data::getMinMaxValues(double& min, double&max, std::vector<size_t>& sampleIDs, size_t varID, size_t start,
     size_t end) const {
   if (sampleIDs.size() > 0) {
@@ -249,33 +433,160 @@ void Data::getMinMaxValues(double& min, double&max, std::vector<size_t>& sampleI
   }
 }
 
-void Data::sort() {
+void Data::sort(uint num_threads) {
 
   // Reserve memory
-  index_data.resize(num_cols_no_snp * num_rows);
+  index_widths.resize(num_cols_no_snp);
+  index_data_8bit.resize(num_cols_no_snp);
+  index_data_16bit.resize(num_cols_no_snp);
+  index_data_32bit.resize(num_cols_no_snp);
+  unique_data_values.resize(num_cols_no_snp);
+
+  // Sort columns in parallel
+#ifdef OLD_WIN_R_BUILD
+  sortColumns(0, num_cols_no_snp);
+#else
+  num_threads = std::max((uint) 1, std::min(num_threads, (uint) num_cols_no_snp));
+  if (num_threads == 1) {
+    sortColumns(0, num_cols_no_snp);
+  } else {
+    std::vector<uint> thread_ranges;
+    equalSplit(thread_ranges, 0, num_cols_no_snp - 1, num_threads);
+    TaskGroup tasks(num_threads, [this, &thread_ranges](size_t i) {
+      sortColumns(thread_ranges[i], thread_ranges[i + 1]);
+    });
+    tasks.wait();
+  }
+#endif
 
-  // For all columns, get unique values and save index for each observation
+  // Point to stored index and unique values
+  index_columns.resize(num_cols_no_snp);
+  unique_value_columns.resize(num_cols_no_snp);
+  num_unique_data_values.resize(num_cols_no_snp);
   for (size_t col = 0; col < num_cols_no_snp; ++col) {
+    switch (index_widths[col]) {
+    case 1:
+      index_columns[col] = index_data_8bit[col].data();
+      break;
+    case 2:
+      index_columns[col] = index_data_16bit[col].data();
+      break;
+    default:
+      index_columns[col] = index_data_32bit[col].data();
+      break;
+    }
+    unique_value_columns[col] = unique_data_values[col].data();
+    num_unique_data_values[col] = unique_data_values[col].size();
+    if (num_unique_data_values[col] > max_num_unique_values) {
+      max_num_unique_values = num_unique_data_values[col];
+    }
+  }
+}
 
-    // Get all unique values
-    std::vector<double> unique_values(num_rows);
+void Data::interleave(const std::vector<NumaNode>& nodes) {
+  for (auto& column : index_data_8bit) {
+    interleavePages(column, nodes);
+  }
+  for (auto& column : index_data_16bit) {
+    interleavePages(column, nodes);
+  }
+  for (auto& column : index_data_32bit) {
+    interleavePages(column, nodes);
+  }
+  interleavePages(bin_data, nodes);
+}
+
+// Set index of each row to the rank of its value in sorted_values
+template<typename T>
+void assignRanks(std::vector<T>& index, const std::vector<std::pair<double, size_t>>& sorted_values) {
+  index.resize(sorted_values.size());
+  T rank = 0;
+  for (size_t i = 0; i < sorted_values.size(); ++i) {
+    if (i > 0 && sorted_values[i].first != sorted_values[i - 1].first) {
+      ++rank;
+    }
+    index[sorted_values[i].second] = rank;
+  }
+}
+
+void Data::sortColumns(size_t start, size_t end) {
+
+  std::vector<std::pair<double, size_t>> sorted_values(num_rows);
+  for (size_t col = start; col < end; ++col) {
+
+    // Sort values with their rows
     for (size_t row = 0; row < num_rows; ++row) {
-      unique_values[row] = get_x(row, col);
+      sorted_values[row] = std::make_pair(get_x(row, col), row);
+    }
+    std::sort(sorted_values.begin(), sorted_values.end());
+
+    // Get all unique values
+    std::vector<double>& unique_values = unique_data_values[col];
+    unique_values.clear();
+    for (auto& value : sorted_values) {
+      if (unique_values.empty() || value.first != unique_values.back()) {
+        unique_values.push_back(value.first);
+      }
     }
-    std::sort(unique_values.begin(), unique_values.end());
-    unique_values.erase(unique(unique_values.begin(), unique_values.end()), unique_values.end());
+    unique_values.shrink_to_fit();
+
+    // Index of each row is the rank of its value, with smallest type holding all indices
+    if (unique_values.size() <= UINT8_MAX + 1) {
+      index_widths[col] = 1;
+      assignRanks(index_data_8bit[col], sorted_values);
+    } else if (unique_values.size() <= UINT16_MAX + 1) {
+      index_widths[col] = 2;
+      assignRanks(index_data_16bit[col], sorted_values);
+    } else if (unique_values.size() <= (size_t) UINT32_MAX + 1) {
+      index_widths[col] = 4;
+      assignRanks(index_data_32bit[col], sorted_values);
+    } else {
+      throw std::runtime_error("Too many unique values in variable " + variable_names[col] + ".");
+    }
+  }
+}
+
+void Data::binData(uint max_bins) {
+
+  // Reserve memory
+  bin_data.resize(num_cols_no_snp * num_rows);
+  bin_min_values.resize(num_cols_no_snp);
+  bin_max_values.resize(num_cols_no_snp);
+  max_num_bins = 0;
+
+  for (size_t col = 0; col < num_cols_no_snp; ++col) {
 
-    // Get index of unique value
+    // Sort values with rows
+    std::vector<std::pair<double, size_t>> values(num_rows);
     for (size_t row = 0; row < num_rows; ++row) {
-      size_t idx = std::lower_bound(unique_values.begin(), unique_values.end(), get_x(row, col))
-          - unique_values.begin();
-      index_data[col * num_rows + row] = idx;
+      values[row] = std::make_pair(get_x(row, col), row);
+    }
+    std::sort(values.begin(), values.end());
+    size_t num_unique = 0;
+    for (size_t i = 0; i < num_rows; ++i) {
+      if (i == 0 || values[i].first != values[i - 1].first) {
+        ++num_unique;
+      }
     }
 
-    // Save unique values
-    unique_data_values.push_back(unique_values);
-    if (unique_values.size() > max_num_unique_values) {
-      max_num_unique_values = unique_values.size();
+    // One bin per value if few values, else start new value in new bin if bin full
+    std::vector<double>& min_values = bin_min_values[col];
+    std::vector<double>& max_values = bin_max_values[col];
+    min_values.clear();
+    max_values.clear();
+    for (size_t i = 0; i < num_rows; ++i) {
+      double value = values[i].first;
+      if (i == 0
+          || (value != values[i - 1].first && (num_unique <= max_bins || i * max_bins >= min_values.size() * num_rows))) {
+        min_values.push_back(value);
+        max_values.push_back(value);
+      }
+      max_values.back() = value;
+      bin_data[col * num_rows + values[i].second] = min_values.size() - 1;
+    }
+
+    if (min_values.size() > max_num_bins) {
+      max_num_bins = min_values.size();
     }
   }
 }
@@ -338,5 +649,101 @@ void Data::orderSnpLevels(bool corrected_importance) {
 }
 // #nocov end
 
+// Low bits of the 2 bit fields of a SNP word
+const uint64_t SNP_LOW_BITS = 0x5555555555555555ULL;
+
+// Number of SNP words whose byte sums are added up before summing the bytes, at most 12 per word to stay below 256
+const size_t SNP_BLOCK_WORDS = 16;
+
+// Sums of the 2 bit fields of x in each byte
+inline uint64_t sumFieldsPerByte(uint64_t x) {
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  return (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+}
+
+// Sum of the bytes of x
+inline uint64_t sumBytes(uint64_t x) {
+  x = (x & 0x00FF00FF00FF00FFULL) + ((x >> 8) & 0x00FF00FF00FF00FFULL);
+  return (x * 0x0001000100010001ULL) >> 48;
+}
+
+// Position of the lowest set bit of x != 0
+inline size_t lowestBit(uint64_t x) {
+#if defined(__GNUC__)
+  return __builtin_ctzll(x);
+#else
+  size_t bit = 0;
+  for (; (x & 1) == 0; x >>= 1) {
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+// #nocov start (cannot be tested anymore because GenABEL not on CRAN)
+void Data::countSnpGenotypes(size_t col, const uint64_t* bitsets, size_t num_sets, size_t num_planes,
+    size_t* counts) const {
+  size_t stride = num_sets * num_planes;
+  std::vector<uint64_t> byte_sums(2 * stride, 0);
+  size_t num_words = getNumSnpWords();
+  size_t num_block_words = 0;
+  for (size_t word = 0; word < num_words; ++word) {
+    // GenABEL codes 2 and 3 are genotypes 1 and 2, missing values (code 0) count as genotype 0
+    uint64_t codes = getSnpWord(col, word);
+    uint64_t high = (codes >> 1) & SNP_LOW_BITS;
+    if (high != 0) {
+      uint64_t genotype1 = high & ~codes;
+      uint64_t genotype2 = high & codes;
+      genotype1 |= genotype1 << 1;
+      genotype2 |= genotype2 << 1;
+
+      // Masked digits of the sample counts, summed per byte
+      const uint64_t* digits = bitsets + word * stride;
+      for (size_t i = 0; i < stride; ++i) {
+        byte_sums[2 * i] += sumFieldsPerByte(genotype1 & digits[i]);
+        byte_sums[2 * i + 1] += sumFieldsPerByte(genotype2 & digits[i]);
+      }
+      ++num_block_words;
+    }
+
+    // Add up the bytes with the weight of their digit
+    if (num_block_words == SNP_BLOCK_WORDS || (word == num_words - 1 && num_block_words > 0)) {
+      for (size_t i = 0; i < stride; ++i) {
+        size_t set = i / num_planes;
+        size_t plane = i % num_planes;
+        counts[2 * set] += sumBytes(byte_sums[2 * i]) << (2 * plane);
+        counts[2 * set + 1] += sumBytes(byte_sums[2 * i + 1]) << (2 * plane);
+      }
+      std::fill(byte_sums.begin(), byte_sums.end(), 0);
+      num_block_words = 0;
+    }
+  }
+}
+
+void Data::sumSnpGenotypes(size_t col, const uint64_t* bitsets, size_t num_planes, const uint* sample_counts,
+    const double* values, size_t* counts, double* sums) const {
+  size_t num_words = getNumSnpWords();
+  for (size_t word = 0; word < num_words; ++word) {
+    uint64_t digits = 0;
+    for (size_t plane = 0; plane < num_planes; ++plane) {
+      digits |= bitsets[word * num_planes + plane];
+    }
+    uint64_t members = (digits | (digits >> 1)) & SNP_LOW_BITS;
+
+    // Visit the samples with genotype 1 or 2 only
+    uint64_t codes = getSnpWord(col, word);
+    uint64_t minor = (codes >> 1) & members;
+    while (minor != 0) {
+      size_t bit = lowestBit(minor);
+      size_t row = 32 * word + 4 * (bit / 8) + (6 - bit % 8) / 2;
+      size_t genotype = (codes >> bit) & 1;
+      counts[genotype] += sample_counts[row];
+      sums[genotype] += sample_counts[row] * values[row];
+      minor &= minor - 1;
+    }
+  }
+}
+// #nocov end
+
 } // namespace ranger
 
@@ -13,12 +13,16 @@
 #define DATA_H_
 
 #include <vector>
+#include <cstdint>
 #include <iostream>
+#include <fstream>
+#include <string>
 #include <numeric>
 #include <random>
 #include <algorithm>
 
 #include "globals.h"
+#include "Numa.h"
 
 namespace ranger {
 
@@ -34,6 +38,29 @@ public:
   virtual double get_x(size_t row, size_t col) const = 0;
   virtual double get_y(size_t row, size_t col) const = 0;
 
+  // Column major double matrix of all x values (stride num_rows) or NULL if not stored as such
+  virtual const double* getRawX() const {
+    return 0;
+  }
+
+  // Column major float matrix of all x values (stride num_rows) or NULL if not stored as such
+  virtual const float* getRawXFloat() const {
+    return 0;
+  }
+
+  // Column major double matrix of all y values (stride num_rows)
+  virtual const double* getRawY() const = 0;
+
+  // Only nonzero values stored, see getNonzeros()
+  virtual bool isSparse() const {
+    return false;
+  }
+
+  // Rows in increasing order and values of the nonzeros of col, false if col is not stored sparse
+  virtual bool getNonzeros(size_t col, const size_t*& rows, const double*& values, size_t& num_nonzeros) const {
+    return false;
+  }
+
   size_t getVariableID(const std::string& variable_name) const;
 
   virtual void reserveMemory(size_t y_cols) = 0;
@@ -41,17 +68,35 @@ public:
   virtual void set_x(size_t col, size_t row, double value, bool& error) = 0;
   virtual void set_y(size_t col, size_t row, double value, bool& error) = 0;
 
+  // Called after all values of the loaded rows are set
+  virtual void finishLoading() {
+  }
+
   void addSnpData(unsigned char* snp_data, size_t num_cols_snp);
 
-  bool loadFromFile(std::string filename, std::vector<std::string>& dependent_variable_names);
-  bool loadFromFileWhitespace(std::ifstream& input_file, std::string header_line,
-      std::vector<std::string>& dependent_variable_names);
-  bool loadFromFileOther(std::ifstream& input_file, std::string header_line,
-      std::vector<std::string>& dependent_variable_names, char seperator);
+  bool loadFromFile(std::string filename, std::vector<std::string>& dependent_variable_names, uint num_threads);
+
+  // Read text file in chunks of rows: open reads the header, each chunk replaces the rows of the previous one.
+  // loadNextChunk() returns false if no rows are left.
+  void openFileChunked(std::string filename, std::vector<std::string>& dependent_variable_names);
+  void openStreamChunked(std::istream& input, std::vector<std::string>& dependent_variable_names);
+  bool loadNextChunk(size_t max_rows, uint num_threads, bool& error);
+
+  // Read the rows up to the next empty line, the batch may be empty. Returns false if the input is exhausted.
+  bool loadNextBatch(uint num_threads, bool& error);
+
+  // Parse whitespace (seperator 0) or otherwise seperated lines in [begin, end), the first one is given row.
+  // column_targets has the x column or num_cols + y column for each column in the file.
+  bool loadFromText(const char* begin, const char* end, size_t row, char seperator,
+      const std::vector<size_t>& column_targets);
 
   void getAllValues(std::vector<double>& all_values, std::vector<size_t>& sampleIDs, size_t varID, size_t start,
       size_t end) const;
 
+  // Also get for each sample in start..end the index of its value in all_values. Uses the ranks of sort() if available.
+  void getAllValues(std::vector<double>& all_values, std::vector<size_t>& value_indices,
+      std::vector<size_t>& sampleIDs, size_t varID, size_t start, size_t end) const;
+
   void getMinMaxValues(double& min, double&max, std::vector<size_t>& sampleIDs, size_t varID, size_t start,
       size_t end) const;
 
@@ -64,12 +109,46 @@ public:
     }
 
     if (col < num_cols_no_snp) {
-      return index_data[col * num_rows + row];
+      switch (index_widths[col]) {
+      case 1:
+        return static_cast<const uint8_t*>(index_columns[col])[row];
+      case 2:
+        return static_cast<const uint16_t*>(index_columns[col])[row];
+      default:
+        return static_cast<const uint32_t*>(index_columns[col])[row];
+      }
     } else {
       return getSnp(row, col, col_permuted);
     }
   }
 
+  // Call f(pos, index) with the index of row sampleIDs[pos] in column col for all pos in [start, end). Index width and
+  // permutation are resolved once per call, the loop is specialized for each case.
+  template<typename Function>
+  void forEachIndex(size_t col, const std::vector<size_t>& sampleIDs, size_t start, size_t end, Function f) const {
+    bool permuted = col >= num_cols;
+    size_t unpermuted_col = permuted ? getUnpermutedVarID(col) : col;
+    if (unpermuted_col >= num_cols_no_snp) {
+      forEachSnpIndex(col, unpermuted_col, permuted, sampleIDs, start, end, f);
+      return;
+    }
+
+    switch (index_widths[unpermuted_col]) {
+    case 1:
+      forEachIndexInColumn(static_cast<const uint8_t*>(index_columns[unpermuted_col]), permuted, sampleIDs, start,
+          end, f);
+      break;
+    case 2:
+      forEachIndexInColumn(static_cast<const uint16_t*>(index_columns[unpermuted_col]), permuted, sampleIDs, start,
+          end, f);
+      break;
+    default:
+      forEachIndexInColumn(static_cast<const uint32_t*>(index_columns[unpermuted_col]), permuted, sampleIDs, start,
+          end, f);
+      break;
+    }
+  }
+
   // #nocov start (cannot be tested anymore because GenABEL not on CRAN)
   size_t getSnp(size_t row, size_t col, size_t col_permuted) const {
     // Get data out of snp storage. -1 because of GenABEL coding.
@@ -91,6 +170,41 @@ public:
     }
     return result;
   }
+
+  // SNP column, not permuted
+  bool isSnpColumn(size_t col) const {
+    return col >= num_cols_no_snp && col < num_cols;
+  }
+
+  // SNP columns are read in words of 32 samples by the bitset kernel, see countSnpGenotypes()
+  size_t getNumSnpWords() const {
+    return (num_rows + 31) / 32;
+  }
+
+  // Position of row in its SNP word, the low bit of its 2 bit genotype code
+  static size_t getSnpWordBit(size_t row) {
+    return 8 * ((row % 32) / 4) + offset[row % 4];
+  }
+
+  // Index of genotype 0, 1 or 2 of SNP column col, as returned by getIndex()
+  size_t getSnpIndex(size_t col, size_t genotype) const {
+    if (order_snps) {
+      return snp_order[col - num_cols_no_snp][genotype];
+    }
+    return genotype;
+  }
+
+  // Bitset kernel for SNP column col. For each SNP word, bitsets has num_planes words for each of num_sets sets of
+  // samples, with base 4 digit b of the count of each sample in the bits of its genotype in plane b, 0 if not in the
+  // set. Adds the counts of the samples of each set with genotype g = 1, 2 to counts[2 * set + g - 1], 32 samples at
+  // once with bit parallel popcounts.
+  void countSnpGenotypes(size_t col, const uint64_t* bitsets, size_t num_sets, size_t num_planes,
+      size_t* counts) const;
+
+  // Bitset kernel for SNP column col and one set of samples, see countSnpGenotypes(). Adds the sum of counts and of
+  // counts times values of the samples with genotype g = 1, 2 to counts[g - 1] and sums[g - 1], visiting only these.
+  void sumSnpGenotypes(size_t col, const uint64_t* bitsets, size_t num_planes, const uint* sample_counts,
+      const double* values, size_t* counts, double* sums) const;
   // #nocov end
 
   double getUniqueDataValue(size_t varID, size_t index) const {
@@ -100,7 +214,7 @@ public:
     }
 
     if (varID < num_cols_no_snp) {
-      return unique_data_values[varID][index];
+      return unique_value_columns[varID][index];
     } else {
       // For GWAS data the index is the value
       return (index);
@@ -114,14 +228,55 @@ public:
     }
 
     if (varID < num_cols_no_snp) {
-      return unique_data_values[varID].size();
+      return num_unique_data_values[varID];
     } else {
       // For GWAS data 0,1,2
       return (3);
     }
   }
 
-  void sort();
+  virtual void sort(uint num_threads);
+
+  // Interleave the data over NUMA nodes, so threads on all nodes read it with the same memory bandwidth
+  virtual void interleave(const std::vector<NumaNode>& nodes);
+
+  bool isSorted() const {
+    return !index_columns.empty();
+  }
+
+  // Quantize columns to at most max_bins bins of about equal size for histogram splitting
+  void binData(uint max_bins);
+
+  size_t getBin(size_t row, size_t col) const {
+    // Use permuted data for corrected impurity importance
+    if (col >= num_cols) {
+      col = getUnpermutedVarID(col);
+      row = getPermutedSampleID(row);
+    }
+    return bin_data[col * num_rows + row];
+  }
+
+  // Number of bins of varID, 0 if not binned (GWA data)
+  size_t getNumBins(size_t varID) const {
+    varID = getUnpermutedVarID(varID);
+    if (varID < bin_min_values.size()) {
+      return bin_min_values[varID].size();
+    } else {
+      return 0;
+    }
+  }
+
+  double getBinMinValue(size_t varID, size_t bin) const {
+    return bin_min_values[getUnpermutedVarID(varID)][bin];
+  }
+
+  double getBinMaxValue(size_t varID, size_t bin) const {
+    return bin_max_values[getUnpermutedVarID(varID)][bin];
+  }
+
+  size_t getMaxNumBins() const {
+    return max_num_bins;
+  }
 
   void orderSnpLevels(bool corrected_importance);
 
@@ -131,6 +286,10 @@ public:
   size_t getNumCols() const {
     return num_cols;
   }
+  // Number of columns without GWA data, with index columns after sort()
+  size_t getNumColsNoSnp() const {
+    return num_cols_no_snp;
+  }
   size_t getNumRows() const {
     return num_rows;
   }
@@ -198,6 +357,74 @@ public:
   // #nocov end
 
 protected:
+  // Compute unique values and index for columns start..end-1
+  void sortColumns(size_t start, size_t end);
+
+  template<typename T, typename Function>
+  void forEachIndexInColumn(const T* index, bool permuted, const std::vector<size_t>& sampleIDs, size_t start,
+      size_t end, Function f) const {
+    if (permuted) {
+      for (size_t pos = start; pos < end; ++pos) {
+        f(pos, index[permuted_sampleIDs[sampleIDs[pos]]]);
+      }
+    } else {
+      for (size_t pos = start; pos < end; ++pos) {
+        f(pos, index[sampleIDs[pos]]);
+      }
+    }
+  }
+
+  // Bytes 8 * word to 8 * word + 7 of SNP column col, first byte lowest on all platforms
+  uint64_t getSnpWord(size_t col, size_t word) const { // #nocov start
+    size_t num_bytes = num_rows_rounded / 4;
+    const unsigned char* bytes = snp_data + (col - num_cols_no_snp) * num_bytes + 8 * word;
+    if (8 * word + 8 <= num_bytes) {
+      return (uint64_t) bytes[0] | (uint64_t) bytes[1] << 8 | (uint64_t) bytes[2] << 16 | (uint64_t) bytes[3] << 24
+          | (uint64_t) bytes[4] << 32 | (uint64_t) bytes[5] << 40 | (uint64_t) bytes[6] << 48
+          | (uint64_t) bytes[7] << 56;
+    }
+    uint64_t result = 0;
+    for (size_t i = 0; 8 * word + i < num_bytes; ++i) {
+      result |= (uint64_t) bytes[i] << (8 * i);
+    }
+    return result;
+  } // #nocov end
+
+  // SNP column: index of each 2 bit code from a table, with GenABEL coding, missing values and order resolved once
+  template<typename Function>
+  void forEachSnpIndex(size_t col, size_t unpermuted_col, bool permuted, const std::vector<size_t>& sampleIDs,
+      size_t start, size_t end, Function f) const { // #nocov start
+    size_t code_indices[4] = { 0, 0, 1, 2 };
+    if (order_snps) {
+      const std::vector<size_t>& order = snp_order[permuted ? col - 2 * num_cols_no_snp : col - num_cols_no_snp];
+      for (auto& index : code_indices) {
+        index = order[index];
+      }
+    }
+
+    const unsigned char* column = snp_data + (unpermuted_col - num_cols_no_snp) * (num_rows_rounded / 4);
+    if (permuted) {
+      for (size_t pos = start; pos < end; ++pos) {
+        size_t row = permuted_sampleIDs[sampleIDs[pos]];
+        f(pos, code_indices[(column[row / 4] >> offset[row % 4]) & 3]);
+      }
+    } else {
+      for (size_t pos = start; pos < end; ++pos) {
+        size_t row = sampleIDs[pos];
+        f(pos, code_indices[(column[row / 4] >> offset[row % 4]) & 3]);
+      }
+    }
+  } // #nocov end
+
+  // Read header line, set variable names and return seperator (0 for whitespace)
+  char loadHeader(std::istream& input_file, std::vector<std::string>& dependent_variable_names,
+      std::vector<size_t>& column_targets);
+
+  // Parse the lines in [block, block_end) in parallel parts, row is advanced by the number of lines
+  void loadChunkText(size_t rows, uint num_threads, bool& error);
+  bool loadFromTextInParallel(const char* block, const char* block_end, size_t& row, char seperator,
+      const std::vector<size_t>& column_targets, uint num_threads);
+
   std::vector<std::string> variable_names;
   size_t num_rows;
   size_t num_rows_rounded;
@@ -208,10 +435,25 @@ protected:
 
   bool externalData;
 
-  std::vector<size_t> index_data;
+  // Index of each value in the unique values of its column, stored with 1, 2 or 4 bytes as needed
+  std::vector<std::vector<uint8_t>> index_data_8bit;
+  std::vector<std::vector<uint16_t>> index_data_16bit;
+  std::vector<std::vector<uint32_t>> index_data_32bit;
   std::vector<std::vector<double>> unique_data_values;
+
+  // Per column index width, index and unique values. Point to the vectors above or to external memory.
+  std::vector<unsigned char> index_widths;
+  std::vector<const void*> index_columns;
+  std::vector<const double*> unique_value_columns;
+  std::vector<size_t> num_unique_data_values;
   size_t max_num_unique_values;
 
+  // Bin of each value and smallest and largest value in each bin for histogram splitting
+  std::vector<unsigned char> bin_data;
+  std::vector<std::vector<double>> bin_min_values;
+  std::vector<std::vector<double>> bin_max_values;
+  size_t max_num_bins;
+
   // For each varID true if ordered
   std::vector<bool> is_ordered_variable;
 
@@ -221,6 +463,15 @@ protected:
   // Order of 0/1/2 for ordered splitting
   std::vector<std::vector<size_t>> snp_order;
   bool order_snps;
+
+  // Input file and format for loading in chunks
+  std::ifstream chunk_input_file;
+  std::istream* chunk_input;
+  char chunk_seperator;
+  std::vector<size_t> chunk_column_targets;
+  size_t chunk_num_y_cols;
+  std::string chunk_text;
+  std::string chunk_line;
 };
 
 } // namespace ranger
@@ -51,6 +51,10 @@ public:
     return y[col * num_rows + row];
   }
 
+  const double* getRawY() const override {
+    return y.data();
+  }
+
   void reserveMemory(size_t y_cols) override {
     x.resize(num_cols * num_rows);
     y.resize(y_cols * num_rows);
@@ -61,12 +65,19 @@ public:
   }
 
   void set_y(size_t col, size_t row, double value, bool& error) override {
-    y[col * num_rows + row] = value;
+    y[col * num_rows + row] = (char) value;
+  }
+
+  void interleave(const std::vector<NumaNode>& nodes) override {
+    Data::interleave(nodes);
+    interleavePages(x, nodes);
+    interleavePages(y, nodes);
   }
 
 private:
   std::vector<char> x;
-  std::vector<char> y;
+  // Stored as double for getRawY(), values are converted to char first
+  std::vector<double> y;
 };
 
 } // namespace ranger
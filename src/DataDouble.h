@@ -26,7 +26,15 @@ namespace ranger {
 class DataDouble: public Data {
 public:
   DataDouble() = default;
-  
+  DataDouble(std::vector<double> x, std::vector<double> y, std::vector<std::string> variable_names, size_t num_rows,
+      size_t num_cols) :
+      x(std::move(x)), y(std::move(y)) {
+    this->variable_names = variable_names;
+    this->num_rows = num_rows;
+    this->num_cols = num_cols;
+    this->num_cols_no_snp = num_cols;
+  }
+
   DataDouble(const DataDouble&) = delete;
   DataDouble& operator=(const DataDouble&) = delete;
 
@@ -51,6 +59,18 @@ public:
     return y[col * num_rows + row];
   }
 
+  const double* getRawY() const override {
+    return y.data();
+  }
+
+  const double* getRawX() const override {
+    if (snp_data == 0) {
+      return x.data();
+    } else {
+      return 0;
+    }
+  }
+
   void reserveMemory(size_t y_cols) override {
     x.resize(num_cols * num_rows);
     y.resize(y_cols * num_rows);
@@ -64,6 +84,12 @@ public:
     y[col * num_rows + row] = value;
   }
 
+  void interleave(const std::vector<NumaNode>& nodes) override {
+    Data::interleave(nodes);
+    interleavePages(x, nodes);
+    interleavePages(y, nodes);
+  }
+
 private:
   std::vector<double> x;
   std::vector<double> y;
@@ -51,6 +51,18 @@ public:
     return y[col * num_rows + row];
   }
 
+  const double* getRawY() const override {
+    return y.data();
+  }
+
+  const float* getRawXFloat() const override {
+    if (snp_data == 0) {
+      return x.data();
+    } else {
+      return 0;
+    }
+  }
+
   void reserveMemory(size_t y_cols) override {
     x.resize(num_cols * num_rows);
     y.resize(y_cols * num_rows);
@@ -61,12 +73,19 @@ public:
   }
 
   void set_y(size_t col, size_t row, double value, bool& error) override {
-    y[col * num_rows + row] = value;
+    y[col * num_rows + row] = (float) value;
+  }
+
+  void interleave(const std::vector<NumaNode>& nodes) override {
+    Data::interleave(nodes);
+    interleavePages(x, nodes);
+    interleavePages(y, nodes);
   }
 
 private:
   std::vector<float> x;
-  std::vector<float> y;
+  // Stored as double for getRawY(), values are converted to float first
+  std::vector<double> y;
 };
 
 } // namespace ranger
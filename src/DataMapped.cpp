@@ -0,0 +1,164 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+// Ignore in coverage report (not used in R package)
+// #nocov start
+#include <cstring>
+#include <cstdint>
+
+#include "DataMapped.h"
+#include "utility.h"
+
+namespace ranger {
+
+const char BINARY_DATA_MAGIC[] = "RNGRDAT1";
+const size_t BINARY_DATA_MAGIC_LENGTH = 8;
+
+DataMapped::DataMapped() :
+    x(0), y(0) {
+}
+
+void DataMapped::loadFromBinaryFile(const std::string& filename,
+    const std::vector<std::string>& dependent_variable_names) {
+
+  // Map file
+  mapped_file.map(filename);
+
+  if (std::memcmp(mapped_file.nextBlock(BINARY_DATA_MAGIC_LENGTH), BINARY_DATA_MAGIC, BINARY_DATA_MAGIC_LENGTH) != 0) {
+    throw std::runtime_error("Not a binary data file.");
+  }
+  num_rows = mapped_file.nextUint64();
+  num_cols = mapped_file.nextUint64();
+  num_cols_no_snp = num_cols;
+  size_t num_y_cols = mapped_file.nextUint64();
+
+  // Variable names
+  std::vector<std::string> y_names;
+  for (size_t col = 0; col < num_cols + num_y_cols; ++col) {
+    size_t length = mapped_file.nextUint64();
+    std::string name(mapped_file.nextBlock(length), length);
+    if (col < num_cols) {
+      variable_names.push_back(name);
+    } else {
+      y_names.push_back(name);
+    }
+  }
+  if (y_names != dependent_variable_names) {
+    throw std::runtime_error("Dependent variables in binary data file do not match.");
+  }
+
+  // Data
+  x = reinterpret_cast<const double*>(mapped_file.nextBlock(num_cols * num_rows * sizeof(double)));
+  y = reinterpret_cast<const double*>(mapped_file.nextBlock(num_y_cols * num_rows * sizeof(double)));
+
+  // Index and unique values
+  index_widths.resize(num_cols);
+  index_columns.resize(num_cols);
+  unique_value_columns.resize(num_cols);
+  num_unique_data_values.resize(num_cols);
+  for (size_t col = 0; col < num_cols; ++col) {
+    size_t width = mapped_file.nextUint64();
+    if (width != 1 && width != 2 && width != 4) {
+      throw std::runtime_error("Invalid index width in binary data file.");
+    }
+    index_widths[col] = width;
+    num_unique_data_values[col] = mapped_file.nextUint64();
+    unique_value_columns[col] = reinterpret_cast<const double*>(mapped_file.nextBlock(
+        num_unique_data_values[col] * sizeof(double)));
+    index_columns[col] = mapped_file.nextBlock(num_rows * width);
+    if (num_unique_data_values[col] > max_num_unique_values) {
+      max_num_unique_values = num_unique_data_values[col];
+    }
+  }
+
+  externalData = false;
+}
+
+void DataMapped::saveToBinaryFile(const Data& data, const std::string& filename,
+    const std::vector<std::string>& dependent_variable_names) {
+
+  BlockFileWriter writer(filename);
+  size_t num_rows = data.getNumRows();
+  size_t num_cols = data.getNumCols();
+  size_t num_y_cols = dependent_variable_names.size();
+  writer.writeBlock(BINARY_DATA_MAGIC, BINARY_DATA_MAGIC_LENGTH);
+  writer.writeUint64(num_rows);
+  writer.writeUint64(num_cols);
+  writer.writeUint64(num_y_cols);
+
+  // Variable names
+  for (auto& name : data.getVariableNames()) {
+    writer.writeUint64(name.size());
+    writer.writeBlock(name.c_str(), name.size());
+  }
+  for (auto& name : dependent_variable_names) {
+    writer.writeUint64(name.size());
+    writer.writeBlock(name.c_str(), name.size());
+  }
+
+  // Data
+  std::vector<double> column(num_rows);
+  for (size_t col = 0; col < num_cols; ++col) {
+    for (size_t row = 0; row < num_rows; ++row) {
+      column[row] = data.get_x(row, col);
+    }
+    writer.writeArray(column.data(), num_rows);
+  }
+  for (size_t col = 0; col < num_y_cols; ++col) {
+    for (size_t row = 0; row < num_rows; ++row) {
+      column[row] = data.get_y(row, col);
+    }
+    writer.writeArray(column.data(), num_rows);
+  }
+
+  // Index and unique values
+  std::vector<unsigned char> index;
+  for (size_t col = 0; col < num_cols; ++col) {
+    size_t num_unique = data.getNumUniqueDataValues(col);
+    size_t width = 4;
+    if (num_unique <= UINT8_MAX + 1) {
+      width = 1;
+    } else if (num_unique <= UINT16_MAX + 1) {
+      width = 2;
+    }
+    writer.writeUint64(width);
+    writer.writeUint64(num_unique);
+    std::vector<double> unique_values(num_unique);
+    for (size_t i = 0; i < num_unique; ++i) {
+      unique_values[i] = data.getUniqueDataValue(col, i);
+    }
+    writer.writeArray(unique_values.data(), num_unique);
+
+    index.resize(num_rows * width);
+    for (size_t row = 0; row < num_rows; ++row) {
+      size_t idx = data.getIndex(row, col);
+      if (width == 1) {
+        index[row] = idx;
+      } else if (width == 2) {
+        uint16_t value = idx;
+        std::memcpy(&index[row * width], &value, width);
+      } else {
+        uint32_t value = idx;
+        std::memcpy(&index[row * width], &value, width);
+      }
+    }
+    writer.writeBlock(index.data(), index.size());
+  }
+
+  writer.close();
+}
+
+bool DataMapped::isBinaryFile(const std::string& filename) {
+  return MappedFile::hasMagic(filename, BINARY_DATA_MAGIC, BINARY_DATA_MAGIC_LENGTH);
+}
+
+} // namespace ranger
+// #nocov end
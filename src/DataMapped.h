@@ -0,0 +1,108 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+// Ignore in coverage report (not used in R package)
+// #nocov start
+#ifndef DATAMAPPED_H_
+#define DATAMAPPED_H_
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+#include "globals.h"
+#include "Data.h"
+#include "MappedFile.h"
+
+namespace ranger {
+
+// Binary data file, mapped into memory read-only. Holds the x and y matrices and the sorted index, so no
+// parsing or sorting is needed. All values are in native byte order, blocks are aligned to 8 bytes:
+//   "RNGRDAT1", num_rows, num_cols, num_y_cols (uint64)
+//   for each x and then y column: name length (uint64), name
+//   x (column major double), y (column major double)
+//   for each x column: index width in bytes (uint64), number of unique values (uint64), unique values (double),
+//   index (uint8, uint16 or uint32)
+class DataMapped: public Data {
+public:
+  DataMapped();
+
+  DataMapped(const DataMapped&) = delete;
+  DataMapped& operator=(const DataMapped&) = delete;
+
+  virtual ~DataMapped() override = default;
+
+  double get_x(size_t row, size_t col) const override {
+    // Use permuted data for corrected impurity importance
+    size_t col_permuted = col;
+    if (col >= num_cols) {
+      col = getUnpermutedVarID(col);
+      row = getPermutedSampleID(row);
+    }
+
+    if (col < num_cols_no_snp) {
+      return x[col * num_rows + row];
+    } else {
+      return getSnp(row, col, col_permuted);
+    }
+  }
+
+  double get_y(size_t row, size_t col) const override {
+    return y[col * num_rows + row];
+  }
+
+  const double* getRawY() const override {
+    return y;
+  }
+
+  const double* getRawX() const override {
+    if (snp_data == 0) {
+      return x;
+    } else {
+      return 0;
+    }
+  }
+
+  void reserveMemory(size_t y_cols) override {
+    throw std::runtime_error("Binary data file is read-only.");
+  }
+
+  void set_x(size_t col, size_t row, double value, bool& error) override {
+    throw std::runtime_error("Binary data file is read-only.");
+  }
+
+  void set_y(size_t col, size_t row, double value, bool& error) override {
+    throw std::runtime_error("Binary data file is read-only.");
+  }
+
+  // Index is read from file
+  void sort(uint num_threads) override {
+  }
+
+  void loadFromBinaryFile(const std::string& filename, const std::vector<std::string>& dependent_variable_names);
+
+  // Write sorted data to binary file
+  static void saveToBinaryFile(const Data& data, const std::string& filename,
+      const std::vector<std::string>& dependent_variable_names);
+
+  static bool isBinaryFile(const std::string& filename);
+
+private:
+  const double* x;
+  const double* y;
+
+  MappedFile mapped_file;
+};
+
+} // namespace ranger
+
+#endif /* DATAMAPPED_H_ */
+// #nocov end
@@ -71,6 +71,18 @@ public:
   double get_y(size_t row, size_t col) const override {
     return y(row, col);
   }
+
+  const double* getRawY() const override {
+    return y.begin();
+  }
+
+  const double* getRawX() const override {
+    if (snp_data == 0) {
+      return x.begin();
+    } else {
+      return 0;
+    }
+  }
   
   // #nocov start 
   void reserveMemory(size_t y_cols) override {
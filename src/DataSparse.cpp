@@ -30,15 +30,60 @@
 
 namespace ranger {
 
+#ifdef R_BUILD
 DataSparse::DataSparse(Eigen::SparseMatrix<double>& x, Rcpp::NumericMatrix& y, std::vector<std::string> variable_names, size_t num_rows,
-    size_t num_cols) :
-    x { }{
-  this->x.swap(x);
-  this->y = y;
+    size_t num_cols) {
+  col_starts.resize(num_cols + 1, 0);
+  row_indices.reserve(x.nonZeros());
+  values.reserve(x.nonZeros());
+  for (size_t col = 0; col < num_cols; ++col) {
+    // Explicit zeros are not stored
+    for (Eigen::SparseMatrix<double>::InnerIterator it(x, col); it; ++it) {
+      if (it.value() != 0) {
+        row_indices.push_back(it.row());
+        values.push_back(it.value());
+      }
+    }
+    col_starts[col + 1] = row_indices.size();
+  }
+  Eigen::SparseMatrix<double>().swap(x);
+
+  this->y.assign(y.begin(), y.end());
   this->variable_names = variable_names;
   this->num_rows = num_rows;
   this->num_cols = num_cols;
   this->num_cols_no_snp = num_cols;
 }
+#endif
+
+// #nocov start (not used in R package)
+void DataSparse::finishLoading() {
+  // Count nonzeros per column
+  col_starts.assign(num_cols + 1, 0);
+  for (auto& row_nonzeros : loading_rows) {
+    for (auto& nonzero : row_nonzeros) {
+      ++col_starts[nonzero.first + 1];
+    }
+  }
+  for (size_t col = 0; col < num_cols; ++col) {
+    col_starts[col + 1] += col_starts[col];
+  }
+
+  // Fill columns in increasing row order
+  row_indices.resize(col_starts[num_cols]);
+  values.resize(col_starts[num_cols]);
+  std::vector<size_t> next(col_starts.begin(), col_starts.end() - 1);
+  for (size_t row = 0; row < loading_rows.size(); ++row) {
+    for (auto& nonzero : loading_rows[row]) {
+      size_t idx = next[nonzero.first]++;
+      row_indices[idx] = row;
+      values[idx] = nonzero.second;
+    }
+  }
+
+  loading_rows.clear();
+  loading_rows.shrink_to_fit();
+}
+// #nocov end
 
 } // namespace ranger
@@ -28,7 +28,13 @@
 #ifndef DATASPARSE_H_
 #define DATASPARSE_H_
 
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#ifdef R_BUILD
 #include <RcppEigen.h>
+#endif
 
 #include "globals.h"
 #include "utility.h"
@@ -36,12 +42,17 @@
 
 namespace ranger {
 
+// Only nonzero values are stored, in compressed sparse columns. Split search walks the nonzeros of a column with
+// getNonzeros() instead of looking up the values of the node samples.
 class DataSparse: public Data {
 public:
   DataSparse() = default;
-  
+
+#ifdef R_BUILD
+  // Nonzeros of x are copied and x is freed
   DataSparse(Eigen::SparseMatrix<double>& x, Rcpp::NumericMatrix& y, std::vector<std::string> variable_names, size_t num_rows,
       size_t num_cols);
+#endif
 
   DataSparse(const DataSparse&) = delete;
   DataSparse& operator=(const DataSparse&) = delete;
@@ -54,30 +65,69 @@ public:
       col = getUnpermutedVarID(col);
       row = getPermutedSampleID(row);
     }
-    return x.coeff(row, col);
+
+    auto begin = row_indices.cbegin() + col_starts[col];
+    auto end = row_indices.cbegin() + col_starts[col + 1];
+    auto it = std::lower_bound(begin, end, row);
+    if (it != end && *it == row) {
+      return values[it - row_indices.cbegin()];
+    } else {
+      return 0;
+    }
   }
-  
+
   double get_y(size_t row, size_t col) const override {
     return y[col * num_rows + row];
   }
 
-  // #nocov start 
+  const double* getRawY() const override {
+    return y.data();
+  }
+
+  bool isSparse() const override {
+    return true;
+  }
+
+  bool getNonzeros(size_t col, const size_t*& rows, const double*& values, size_t& num_nonzeros) const override {
+    // Permuted columns for corrected impurity importance are not stored
+    if (col >= num_cols) {
+      return false;
+    }
+    rows = row_indices.data() + col_starts[col];
+    values = this->values.data() + col_starts[col];
+    num_nonzeros = col_starts[col + 1] - col_starts[col];
+    return true;
+  }
+
+  // #nocov start (not used in R package)
   void reserveMemory(size_t y_cols) override {
-    // Not needed
+    y.resize(y_cols * num_rows);
+    loading_rows.clear();
+    loading_rows.resize(num_rows);
   }
 
   void set_x(size_t col, size_t row, double value, bool& error) override {
-    x.coeffRef(row, col) = value;
+    if (value != 0) {
+      loading_rows[row].emplace_back(col, value);
+    }
   }
-  
+
   void set_y(size_t col, size_t row, double value, bool& error) override {
     y[col * num_rows + row] = value;
   }
-  // #nocov end 
+
+  void finishLoading() override;
+  // #nocov end
 
 private:
-  Eigen::SparseMatrix<double> x;
-  Rcpp::NumericMatrix y;
+  // Nonzeros of column col at col_starts[col], ..., col_starts[col + 1] - 1, rows in increasing order
+  std::vector<size_t> col_starts;
+  std::vector<size_t> row_indices;
+  std::vector<double> values;
+  std::vector<double> y;
+
+  // Nonzeros of each row while loading from text, each row is set by one thread only
+  std::vector<std::vector<std::pair<size_t, double>>> loading_rows;
 };
 
 } // namespace ranger
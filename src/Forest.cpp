@@ -14,6 +14,8 @@
 #include <stdexcept>
 #include <string>
 #include <ctime>
+#include <cstdio>
+#include <fstream>
 #include <functional>
 #ifndef OLD_WIN_R_BUILD
 #include <thread>
@@ -25,6 +27,10 @@
 #include "DataChar.h"
 #include "DataDouble.h"
 #include "DataFloat.h"
+#include "DataIndex.h"
+#include "DataSparse.h"
+#include "DataMapped.h"
+#include "ThreadPool.h"
 
 namespace ranger {
 
@@ -33,8 +39,9 @@ Forest::Forest() :
         0), prediction_mode(false), memory_mode(MEM_DOUBLE), sample_with_replacement(true), memory_saving_splitting(
         false), splitrule(DEFAULT_SPLITRULE), predict_all(false), keep_inbag(false), sample_fraction( { 1 }), holdout(
         false), prediction_type(DEFAULT_PREDICTIONTYPE), num_random_splits(DEFAULT_NUM_RANDOM_SPLITS), max_depth(
-        DEFAULT_MAXDEPTH), alpha(DEFAULT_ALPHA), minprop(DEFAULT_MINPROP), num_threads(DEFAULT_NUM_THREADS), data { }, overall_prediction_error(
-    NAN), importance_mode(DEFAULT_IMPORTANCE_MODE), regularization_usedepth(false), progress(0) {
+        DEFAULT_MAXDEPTH), alpha(DEFAULT_ALPHA), minprop(DEFAULT_MINPROP), num_threads(DEFAULT_NUM_THREADS), data { }, tree_offset(0), overall_prediction_error(
+    NAN), importance_mode(DEFAULT_IMPORTANCE_MODE), regularization_usedepth(false), max_bins(0), gather_columns(false), sort_levels(false), level_wise(false), fused_oob(false), oob_stop_tolerance(0), oob_stop_window(0), window_oob_error(NAN), prediction_chunk_size(0), serve_input(0), progress(
+        0) {
 }
 
 // #nocov start
@@ -46,7 +53,10 @@ void Forest::initCpp(std::string dependent_variable_name, MemoryMode memory_mode
     const std::vector<std::string>& unordered_variable_names, bool memory_saving_splitting, SplitRule splitrule,
     std::string case_weights_file, bool predict_all, double sample_fraction, double alpha, double minprop, bool holdout,
     PredictionType prediction_type, uint num_random_splits, uint max_depth,
-    const std::vector<double>& regularization_factor, bool regularization_usedepth) {
+    const std::vector<double>& regularization_factor, bool regularization_usedepth, uint max_bins,
+    uint prediction_chunk_size, std::istream* serve_input, bool numa, bool gather_columns, bool sort_levels,
+    bool level_wise, bool fused_oob, double oob_stop_tolerance, uint oob_stop_window, bool keep_inbag,
+    size_t tree_offset) {
 
   this->memory_mode = memory_mode;
   this->verbose_out = verbose_out;
@@ -77,16 +87,55 @@ void Forest::initCpp(std::string dependent_variable_name, MemoryMode memory_mode
 
   if (prediction_mode) {
     loadDependentVariableNamesFromFile(load_forest_filename);
+    this->prediction_chunk_size = prediction_chunk_size;
+    this->serve_input = serve_input;
   }
 
+  // Set number of threads, also used for loading data
+  if (num_threads == DEFAULT_NUM_THREADS) {
+#ifdef OLD_WIN_R_BUILD
+    num_threads = 1;
+#else
+    num_threads = std::thread::hardware_concurrency();
+#endif
+  }
+  this->num_threads = num_threads;
+  this->gather_columns = gather_columns;
+  this->sort_levels = sort_levels;
+  this->level_wise = level_wise;
+  this->fused_oob = fused_oob;
+  this->oob_stop_tolerance = oob_stop_tolerance;
+  this->oob_stop_window = oob_stop_window;
+  this->keep_inbag = keep_inbag;
+  this->tree_offset = tree_offset;
+
+  // Get NUMA nodes before loading the data, which is interleaved over the nodes in init()
+#ifndef OLD_WIN_R_BUILD
+  if (numa) {
+    numa_nodes = getNumaNodes();
+    if (verbose_out) {
+      if (numa_nodes.empty()) {
+        *verbose_out << "Warning: NUMA topology not available, NUMA mode deactivated." << std::endl;
+      } else {
+        *verbose_out << "Number of NUMA nodes: " << numa_nodes.size() << "." << std::endl;
+      }
+    }
+  }
+#endif
+
   // Call other init function
   init(loadDataFromFile(input_file), mtry, output_prefix, num_trees, seed, num_threads, importance_mode,
       min_node_size, prediction_mode, sample_with_replacement, unordered_variable_names, memory_saving_splitting,
       splitrule, predict_all, sample_fraction_vector, alpha, minprop, holdout, prediction_type, num_random_splits,
-      false, max_depth, regularization_factor, regularization_usedepth);
+      false, max_depth, regularization_factor, regularization_usedepth, max_bins);
 
   if (prediction_mode) {
-    loadFromFile(load_forest_filename);
+    PhaseTimer timer(profile, "load");
+    if (isBinaryForestFile(load_forest_filename)) {
+      loadFromBinaryFile(load_forest_filename);
+    } else {
+      loadFromFile(load_forest_filename);
+    }
   }
   // Set variables to be always considered for splitting
   if (!always_split_variable_names.empty()) {
@@ -150,7 +199,7 @@ void Forest::initR(std::unique_ptr<Data> input_data, uint mtry, uint num_trees,
   init(std::move(input_data), mtry, "", num_trees, seed, num_threads, importance_mode, min_node_size,
       prediction_mode, sample_with_replacement, unordered_variable_names, memory_saving_splitting, splitrule,
       predict_all, sample_fraction, alpha, minprop, holdout, prediction_type, num_random_splits, order_snps, max_depth,
-      regularization_factor, regularization_usedepth);
+      regularization_factor, regularization_usedepth, 0);
 
   // Set variables to be always considered for splitting
   if (!always_split_variable_names.empty()) {
@@ -184,7 +233,7 @@ void Forest::init(std::unique_ptr<Data> input_data, uint mtry, std::string outpu
     bool prediction_mode, bool sample_with_replacement, const std::vector<std::string>& unordered_variable_names,
     bool memory_saving_splitting, SplitRule splitrule, bool predict_all, std::vector<double>& sample_fraction,
     double alpha, double minprop, bool holdout, PredictionType prediction_type, uint num_random_splits, bool order_snps,
-    uint max_depth, const std::vector<double>& regularization_factor, bool regularization_usedepth) {
+    uint max_depth, const std::vector<double>& regularization_factor, bool regularization_usedepth, uint max_bins) {
 
   // Initialize data with memmode
   this->data = std::move(input_data);
@@ -229,6 +278,7 @@ void Forest::init(std::unique_ptr<Data> input_data, uint mtry, std::string outpu
   this->max_depth = max_depth;
   this->regularization_factor = regularization_factor;
   this->regularization_usedepth = regularization_usedepth;
+  this->max_bins = max_bins;
 
   // Set number of samples and variables
   num_samples = data->getNumRows();
@@ -262,6 +312,21 @@ void Forest::init(std::unique_ptr<Data> input_data, uint mtry, std::string outpu
     data->permuteSampleIDs(random_number_generator);
   }
 
+  // Quantize data for histogram splitting
+  if (max_bins > MAX_NUM_BINS) {
+    throw std::runtime_error("Maximum number of bins can not be larger than 255.");
+  }
+  if (!prediction_mode && max_bins > 0) {
+    data->binData(max_bins);
+  }
+
+  // Spread data over NUMA nodes, otherwise it is on the node of the loading thread
+#ifndef OLD_WIN_R_BUILD
+  if (!numa_nodes.empty()) {
+    data->interleave(numa_nodes);
+  }
+#endif
+
   // Order SNP levels if in "order" splitting
   if (!prediction_mode && order_snps) {
     data->orderSnpLevels((importance_mode == IMP_GINI_CORRECTED));
@@ -287,19 +352,28 @@ void Forest::run(bool verbose, bool compute_oob_error) {
     if (verbose && verbose_out) {
       *verbose_out << "Predicting .." << std::endl;
     }
-    predict();
+    PhaseTimer timer(profile, "predict");
+    if (prediction_chunk_size > 0) {
+      predictInChunks();
+    } else {
+      predict();
+    }
   } else {
     if (verbose && verbose_out) {
       *verbose_out << "Growing trees .." << std::endl;
     }
 
-    grow();
+    {
+      PhaseTimer timer(profile, "grow");
+      grow();
+    }
 
     if (verbose && verbose_out) {
       *verbose_out << "Computing prediction error .." << std::endl;
     }
 
     if (compute_oob_error) {
+      PhaseTimer timer(profile, "oob");
       computePredictionError();
     }
 
@@ -308,6 +382,7 @@ void Forest::run(bool verbose, bool compute_oob_error) {
       if (verbose && verbose_out) {
         *verbose_out << "Computing permutation variable importance .." << std::endl;
       }
+      PhaseTimer timer(profile, "importance");
       computePermutationImportance();
     }
   }
@@ -336,7 +411,10 @@ void Forest::writeOutput() {
   }
 
   if (prediction_mode) {
-    writePredictionFile();
+    // Already written while predicting in chunks or serving
+    if (prediction_chunk_size == 0 && serve_input == 0) {
+      writePredictionFile();
+    }
   } else {
     if (verbose_out) {
       *verbose_out << "Overall OOB prediction error:      " << overall_prediction_error << std::endl;
@@ -359,6 +437,19 @@ void Forest::writeOutput() {
   }
 }
 
+void Forest::writeProfileFile() {
+  std::string filename = output_prefix + ".profile";
+  std::ofstream profile_file;
+  profile_file.open(filename, std::ios::out);
+  if (!profile_file.good()) {
+    throw std::runtime_error("Could not write to profile file: " + filename + ".");
+  }
+  profile.writeJson(profile_file);
+  profile_file.close();
+  if (verbose_out)
+    *verbose_out << "Saved profile to file " << filename << "." << std::endl;
+}
+
 void Forest::writeImportanceFile() {
 
   // Open importance file for writing
@@ -399,6 +490,32 @@ void Forest::writeImportanceFile() {
     *verbose_out << "Saved variable importance to file " << filename << "." << std::endl;
 }
 
+void Forest::writePredictionFile() {
+
+  // Open prediction file for writing
+  std::string filename = output_prefix + ".prediction";
+  std::ofstream outfile;
+  outfile.open(filename, std::ios::out);
+  if (!outfile.good()) {
+    throw std::runtime_error("Could not write to prediction file: " + filename + ".");
+  }
+
+  // Write
+  writePredictionHeader(outfile);
+  if (predict_all) {
+    for (size_t k = 0; k < num_trees; ++k) {
+      outfile << "Tree " << k << ":" << std::endl;
+      writePredictionSamples(outfile, k);
+      outfile << std::endl;
+    }
+  } else {
+    writePredictionSamples(outfile, 0);
+  }
+
+  if (verbose_out)
+    *verbose_out << "Saved predictions to file " << filename << "." << std::endl;
+}
+
 void Forest::saveToFile() {
 
   // Open file for writing
@@ -440,16 +557,179 @@ void Forest::saveToFile() {
   if (verbose_out)
     *verbose_out << "Saved forest to file " << filename << "." << std::endl;
 }
+
+// Binary forest file, all values in native byte order, blocks aligned to 8 bytes (uint64 unless noted):
+//   "RNGRFOR1", size of Tree::PredictionNode, treetype, number of independent variables
+//   number of dependent variables, for each: name length, name
+//   num_trees, number of variables, is_ordered_variable (uint8)
+//   forest type section: number of values, class values or unique timepoints (double), empty for regression
+//   for each tree: number of nodes, all split variables ordered, nodes (Tree::PredictionNode)
+//     probability: offset of each node in class counts, number of class counts, class counts (double)
+//     survival: CHF steps begin for each node and end, step timepointIDs (uint32), step values (double)
+void Forest::saveToBinaryFile() {
+
+  std::string filename = output_prefix + ".forest.bin";
+  BlockFileWriter file(filename);
+  file.writeBlock(BINARY_FOREST_MAGIC, BINARY_FOREST_MAGIC_LENGTH);
+  file.writeUint64(sizeof(Tree::PredictionNode));
+  file.writeUint64(getTreeType());
+  file.writeUint64(num_independent_variables);
+
+  file.writeUint64(dependent_variable_names.size());
+  for (auto& var_name : dependent_variable_names) {
+    file.writeUint64(var_name.size());
+    file.writeBlock(var_name.c_str(), var_name.size());
+  }
+
+  file.writeUint64(num_trees);
+  const std::vector<bool>& is_ordered_variable = data->getIsOrderedVariable();
+  std::vector<uint8_t> is_ordered(is_ordered_variable.begin(), is_ordered_variable.end());
+  file.writeUint64(is_ordered.size());
+  file.writeArray(is_ordered.data(), is_ordered.size());
+
+  saveToBinaryFileInternal(file);
+  for (auto& tree : trees) {
+    tree->appendToBinaryFile(file);
+  }
+  file.close();
+
+  if (verbose_out)
+    *verbose_out << "Saved forest to file " << filename << "." << std::endl;
+}
+
+// Shard file, all values in native byte order, vectors with their length:
+//   tree_offset, num_trees, seed, num_samples, importance_mode
+//   oob_sums, oob_counts, both empty if the OOB error was not computed
+//   importance_sums, importance_variance_sums, variable_importance_casewise
+//   inbag counts of each tree, empty if not kept
+void Forest::saveShardToFile() {
+
+  std::string filename = output_prefix + ".shard";
+  std::ofstream outfile;
+  outfile.open(filename, std::ios::binary);
+  if (!outfile.good()) {
+    throw std::runtime_error("Could not write to output file: " + filename + ".");
+  }
+
+  outfile.write((char*) &tree_offset, sizeof(tree_offset));
+  outfile.write((char*) &num_trees, sizeof(num_trees));
+  outfile.write((char*) &seed, sizeof(seed));
+  outfile.write((char*) &num_samples, sizeof(num_samples));
+  outfile.write((char*) &importance_mode, sizeof(importance_mode));
+
+  saveVector1D(oob_sums, outfile);
+  saveVector1D(oob_counts, outfile);
+  saveVector1D(importance_sums, outfile);
+  saveVector1D(importance_variance_sums, outfile);
+  saveVector1D(variable_importance_casewise, outfile);
+  saveVector2D(getInbagCounts(), outfile);
+
+  outfile.close();
+  if (verbose_out)
+    *verbose_out << "Saved forest shard to file " << filename << "." << std::endl;
+}
+
+void Forest::loadShardFromFile(const std::string& prefix) {
+
+  std::string filename = prefix + ".shard";
+  std::ifstream infile;
+  infile.open(filename, std::ios::binary);
+  if (!infile.good()) {
+    throw std::runtime_error("Could not read from input file: " + filename + ".");
+  }
+
+  size_t shard_tree_offset;
+  size_t shard_num_trees;
+  uint shard_seed;
+  size_t shard_num_samples;
+  ImportanceMode shard_importance_mode;
+  infile.read((char*) &shard_tree_offset, sizeof(shard_tree_offset));
+  infile.read((char*) &shard_num_trees, sizeof(shard_num_trees));
+  infile.read((char*) &shard_seed, sizeof(shard_seed));
+  infile.read((char*) &shard_num_samples, sizeof(shard_num_samples));
+  infile.read((char*) &shard_importance_mode, sizeof(shard_importance_mode));
+
+  std::vector<double> shard_oob_sums;
+  std::vector<size_t> shard_oob_counts;
+  std::vector<double> shard_importance_sums;
+  std::vector<double> shard_importance_variance_sums;
+  std::vector<double> shard_importance_casewise;
+  std::vector<std::vector<size_t>> shard_inbag_counts;
+  readVector1D(shard_oob_sums, infile);
+  readVector1D(shard_oob_counts, infile);
+  readVector1D(shard_importance_sums, infile);
+  readVector1D(shard_importance_variance_sums, infile);
+  readVector1D(shard_importance_casewise, infile);
+  readVector2D(shard_inbag_counts, infile);
+  infile.close();
+
+  checkShard(shard_num_samples, shard_seed, shard_tree_offset, shard_importance_mode);
+
+  // Trees of the shard are appended, the unordered variables must match those of the shards merged before
+  size_t num_trees_before = trees.size();
+  size_t num_trees_merged = num_trees;
+  std::vector<bool> is_ordered_variable;
+  is_ordered_variable.swap(data->getIsOrderedVariable());
+  loadFromFile(prefix + ".forest");
+  if (num_trees_before > 0 && data->getIsOrderedVariable() != is_ordered_variable) {
+    throw std::runtime_error("Forest shards with different unordered variables can not be merged.");
+  }
+  if (num_trees != shard_num_trees || shard_inbag_counts.size() != shard_num_trees) {
+    throw std::runtime_error("Forest file does not match shard file: " + filename + ".");
+  }
+  num_trees = num_trees_merged;
+
+  for (size_t i = 0; i < shard_num_trees; ++i) {
+    trees[num_trees_before + i]->setInbagCounts(shard_inbag_counts[i]);
+  }
+
+  addShardSums(shard_oob_sums, shard_oob_counts, shard_importance_sums, shard_importance_variance_sums,
+      shard_importance_casewise, shard_num_trees);
+}
+
+bool Forest::isBinaryForestFile(const std::string& filename) {
+  return MappedFile::hasMagic(filename, BINARY_FOREST_MAGIC, BINARY_FOREST_MAGIC_LENGTH);
+}
+
+void Forest::saveDataToFile() {
+
+  // Data is not sorted in memory saving mode
+  if (!data->isSorted()) {
+    sortData();
+  }
+
+  std::string filename = output_prefix + ".data";
+  DataMapped::saveToBinaryFile(*data, filename, dependent_variable_names);
+  if (verbose_out)
+    *verbose_out << "Saved data to file " << filename << "." << std::endl;
+}
 // #nocov end
 
-void Forest::grow() {
+void Forest::sortData() {
+  PhaseTimer timer(profile, "sort");
+  data->sort(num_threads);
+}
 
-  // Create thread ranges
-  equalSplit(thread_ranges, 0, num_trees - 1, num_threads);
+void Forest::grow() {
 
   // Call special grow functions of subclasses. There trees must be created.
   growInternal();
 
+  // Share threads between trees and split search within trees if there are fewer trees than threads
+#ifdef OLD_WIN_R_BUILD
+  uint num_split_threads = 1;
+#else
+  uint num_tree_threads = std::max((size_t) 1, std::min((size_t) num_threads, num_trees));
+  uint num_split_threads = num_threads / num_tree_threads;
+#endif
+
+  // Alias tables for weighted sampling, empty if not weighted
+  split_select_alias_tables.clear();
+  for (auto& weights : split_select_weights) {
+    split_select_alias_tables.push_back(weights.empty() ? AliasTable() : AliasTable(weights));
+  }
+  case_weights_alias_table = case_weights.empty() ? AliasTable() : AliasTable(case_weights);
+
   // Init trees, create a seed for each tree, based on main seed
   std::uniform_int_distribution<uint> udist;
   for (size_t i = 0; i < num_trees; ++i) {
@@ -457,15 +737,15 @@ void Forest::grow() {
     if (seed == 0) {
       tree_seed = udist(random_number_generator);
     } else {
-      tree_seed = (i + 1) * seed;
+      tree_seed = (tree_offset + i + 1) * seed;
     }
 
     // Get split select weights for tree
-    std::vector<double>* tree_split_select_weights;
-    if (split_select_weights.size() > 1) {
-      tree_split_select_weights = &split_select_weights[i];
+    const AliasTable* tree_split_select_alias_table;
+    if (split_select_alias_tables.size() > 1) {
+      tree_split_select_alias_table = &split_select_alias_tables[i];
     } else {
-      tree_split_select_weights = &split_select_weights[0];
+      tree_split_select_alias_table = &split_select_alias_tables[0];
     }
 
     // Get inbag counts for tree
@@ -476,14 +756,16 @@ void Forest::grow() {
       tree_manual_inbag = &manual_inbag[0];
     }
 
-    trees[i]->init(data.get(), mtry, num_samples, tree_seed, &deterministic_varIDs, tree_split_select_weights,
+    trees[i]->init(data.get(), mtry, num_samples, tree_seed, &deterministic_varIDs, tree_split_select_alias_table,
         importance_mode, min_node_size, sample_with_replacement, memory_saving_splitting, splitrule, &case_weights,
-        tree_manual_inbag, keep_inbag, &sample_fraction, alpha, minprop, holdout, num_random_splits, max_depth,
-        &regularization_factor, regularization_usedepth, &split_varIDs_used);
+        &case_weights_alias_table, tree_manual_inbag, keep_inbag, &sample_fraction, alpha, minprop, holdout,
+        num_random_splits, max_depth, &regularization_factor, regularization_usedepth, &split_varIDs_used,
+        num_split_threads, max_bins > 0, gather_columns, sort_levels, level_wise, fused_oob);
   }
 
   // Init variable importance
   variable_importance.resize(num_independent_variables, 0);
+  importance_sums.assign(num_independent_variables, 0);
 
   // Grow trees in multiple threads
 #ifdef OLD_WIN_R_BUILD
@@ -491,8 +773,11 @@ void Forest::grow() {
   progress = 0;
   clock_t start_time = clock();
   clock_t lap_time = clock();
+  profile.tree_grow_seconds.assign(num_trees, 0);
   for (size_t i = 0; i < num_trees; ++i) {
-    trees[i]->grow(&variable_importance);
+    auto tree_start = std::chrono::steady_clock::now();
+    trees[i]->grow(&importance_sums);
+    profile.tree_grow_seconds[i] = secondsSince(tree_start);
     progress++;
     showProgress("Growing trees..", start_time, lap_time);
   }
@@ -504,35 +789,77 @@ void Forest::grow() {
   aborted_threads = 0;
 #endif
 
-  std::vector<std::thread> threads;
-  threads.reserve(num_threads);
-
   // Initialize importance per thread
-  std::vector<std::vector<double>> variable_importance_threads(num_threads);
-
-  for (uint i = 0; i < num_threads; ++i) {
-    if (importance_mode == IMP_GINI || importance_mode == IMP_GINI_CORRECTED) {
-      variable_importance_threads[i].resize(num_independent_variables, 0);
+  std::vector<std::vector<double>> variable_importance_threads(num_tree_threads);
+  if (importance_mode == IMP_GINI || importance_mode == IMP_GINI_CORRECTED) {
+    for (auto& importance : variable_importance_threads) {
+      importance.resize(num_independent_variables, 0);
     }
-    threads.emplace_back(&Forest::growTreesInThread, this, i, &(variable_importance_threads[i]));
   }
-  showProgress("Growing trees..", num_trees);
-  for (auto &thread : threads) {
-    thread.join();
+
+  // In NUMA mode trees are queued for the nodes in turn
+  if (!numa_nodes.empty()) {
+    tree_numa_nodes.resize(num_trees);
+    for (size_t i = 0; i < num_trees; ++i) {
+      tree_numa_nodes[i] = i % numa_nodes.size();
+    }
   }
+  profile.tree_grow_seconds.assign(num_trees, 0);
+  std::vector<double> busy_seconds(num_tree_threads, 0);
+  auto start_time = std::chrono::steady_clock::now();
+
+  // Grow all trees at once or window by window until the OOB error converges
+  size_t window_size = oob_stop_window > 0 ? oob_stop_window : num_trees;
+  size_t num_grown_trees = 0;
+  window_oob_error = NAN;
+  while (num_grown_trees < num_trees) {
+    size_t window_end = std::min(num_trees, num_grown_trees + window_size);
+    queueTrees(tree_numa_nodes, num_grown_trees, window_end);
+    TaskGroup tasks(num_tree_threads, [this, &variable_importance_threads, &busy_seconds](size_t i) {
+      NumaAffinity affinity(numa_nodes, i);
+      growTreesInThread(&(variable_importance_threads[i]), affinity.getNode(), busy_seconds[i]);
+    });
+    showProgress("Growing trees..", tasks, window_end);
+    tasks.wait();
 
 #ifdef R_BUILD
-  if (aborted_threads > 0) {
-    throw std::runtime_error("User interrupt.");
-  }
+    if (aborted_threads > 0) {
+      throw std::runtime_error("User interrupt.");
+    }
 #endif
 
+    bool converged = oob_stop_window > 0 && oobErrorConverged(num_grown_trees, window_end);
+    num_grown_trees = window_end;
+    if (converged) {
+      break;
+    }
+  }
+
+  // Drop the trees not grown
+  if (num_grown_trees < num_trees) {
+    if (verbose_out) {
+      *verbose_out << "OOB error converged, stopped after " << num_grown_trees << " trees." << std::endl;
+    }
+    num_trees = num_grown_trees;
+    trees.resize(num_trees);
+    profile.tree_grow_seconds.resize(num_trees);
+    if (!tree_numa_nodes.empty()) {
+      tree_numa_nodes.resize(num_trees);
+    }
+  }
+
+  // Threads wait for their first tree and for the slowest thread
+  double grow_seconds = secondsSince(start_time);
+  profile.thread_idle_seconds.resize(num_tree_threads);
+  for (size_t i = 0; i < num_tree_threads; ++i) {
+    profile.thread_idle_seconds[i] = std::max(0.0, grow_seconds - busy_seconds[i]);
+  }
+
   // Sum thread importances
   if (importance_mode == IMP_GINI || importance_mode == IMP_GINI_CORRECTED) {
-    variable_importance.resize(num_independent_variables, 0);
     for (size_t i = 0; i < num_independent_variables; ++i) {
-      for (uint j = 0; j < num_threads; ++j) {
-        variable_importance[i] += variable_importance_threads[j][i];
+      for (uint j = 0; j < num_tree_threads; ++j) {
+        importance_sums[i] += variable_importance_threads[j][i];
       }
     }
     variable_importance_threads.clear();
@@ -542,8 +869,15 @@ void Forest::grow() {
 
   // Divide importance by number of trees
   if (importance_mode == IMP_GINI || importance_mode == IMP_GINI_CORRECTED) {
-    for (auto& v : variable_importance) {
-      v /= num_trees;
+    computeImportanceFromSums();
+  }
+
+  profile.num_nodes = 0;
+  profile.num_split_candidates.assign(NUM_SPLIT_METHODS, 0);
+  for (auto& tree : trees) {
+    profile.num_nodes += tree->getNumNodes();
+    for (uint method = 0; method < NUM_SPLIT_METHODS; ++method) {
+      profile.num_split_candidates[method] += tree->getNumSplitCandidates((SplitMethod) method);
     }
   }
 }
@@ -556,17 +890,16 @@ void Forest::predict() {
   progress = 0;
   clock_t start_time = clock();
   clock_t lap_time = clock();
+  std::vector<size_t> terminal_nodeIDs(num_trees * num_samples);
   for (size_t i = 0; i < num_trees; ++i) {
-    trees[i]->predict(data.get(), false);
+    trees[i]->predictSamples(data.get(), 0, num_samples, terminal_nodeIDs.data() + i * num_samples);
     progress++;
     showProgress("Predicting..", start_time, lap_time);
   }
 
   // For all samples get tree predictions
-  allocatePredictMemory();
-  for (size_t sample_idx = 0; sample_idx < data->getNumRows(); ++sample_idx) {
-    predictInternal(sample_idx);
-  }
+  allocatePredictMemory(predictions, num_samples);
+  predictBlockInternal(0, num_samples, terminal_nodeIDs.data(), predictions, random_number_generator);
   // #nocov end
 #else
   progress = 0;
@@ -575,29 +908,24 @@ void Forest::predict() {
   aborted_threads = 0;
 #endif
 
-  // Predict
-  std::vector<std::thread> threads;
-  threads.reserve(num_threads);
-  for (uint i = 0; i < num_threads; ++i) {
-    threads.emplace_back(&Forest::predictTreesInThread, this, i, data.get(), false);
-  }
-  showProgress("Predicting..", num_trees);
-  for (auto &thread : threads) {
-    thread.join();
+  // Predict small batches in this thread, starting threads and polling progress takes longer than predicting
+  allocatePredictMemory(predictions, num_samples);
+  if (num_samples <= PREDICTION_INLINE_MAX_SAMPLES) {
+    inline_terminal_nodeIDs.resize(num_trees * PREDICTION_INLINE_MAX_SAMPLES);
+    predictSamples(*data, 0, num_samples, inline_terminal_nodeIDs.data(), predictions, random_number_generator);
+    return;
   }
 
-  // Aggregate predictions
-  allocatePredictMemory();
-  threads.clear();
-  threads.reserve(num_threads);
-  progress = 0;
-  for (uint i = 0; i < num_threads; ++i) {
-    threads.emplace_back(&Forest::predictInternalInThread, this, i);
-  }
-  showProgress("Aggregating predictions..", num_samples);
-  for (auto &thread : threads) {
-    thread.join();
-  }
+  // Predict in blocks of samples which fit in cache, for each block all trees and aggregation
+  size_t block_size = getPredictionBlockSize(num_samples, num_threads);
+
+  next_task = 0;
+  TaskGroup tasks(num_threads, [this, block_size](size_t i) {
+    NumaAffinity affinity(numa_nodes, i);
+    predictBlocksInThread(block_size);
+  });
+  showProgress("Predicting..", tasks, num_samples);
+  tasks.wait();
 
 #ifdef R_BUILD
   if (aborted_threads > 0) {
@@ -607,43 +935,240 @@ void Forest::predict() {
 #endif
 }
 
-void Forest::computePredictionError() {
+void Forest::predict(const Data& prediction_data, PredictionWorkspace& workspace) const {
+  if (prediction_data.getNumCols() != num_independent_variables) {
+    throw std::runtime_error("Number of independent variables in data does not match with the loaded forest.");
+  }
 
-  // Predict trees in multiple threads
-#ifdef OLD_WIN_R_BUILD
-  // #nocov start
-  progress = 0;
-  clock_t start_time = clock();
-  clock_t lap_time = clock();
+  size_t num_prediction_samples = prediction_data.getNumRows();
+  allocatePredictMemory(workspace.predictions, num_prediction_samples);
+  size_t block_size = getPredictionBlockSize(num_prediction_samples, 1);
+  workspace.terminal_nodeIDs.resize(num_trees * block_size);
+  for (size_t start = 0; start < num_prediction_samples; start += block_size) {
+    size_t end = std::min(start + block_size, num_prediction_samples);
+    predictSamples(prediction_data, start, end, workspace.terminal_nodeIDs.data(), workspace.predictions,
+        workspace.random_number_generator);
+  }
+}
+
+void Forest::predictSamples(const Data& prediction_data, size_t start, size_t end, size_t* terminal_nodeIDs,
+    PredictionTensor& predictions, std::mt19937_64& random_number_generator) const {
+
+  // Drop block through all trees while in cache, then aggregate
+  size_t num_block_samples = end - start;
   for (size_t i = 0; i < num_trees; ++i) {
-    trees[i]->predict(data.get(), true);
-    progress++;
-    showProgress("Predicting..", start_time, lap_time);
+    trees[i]->predictSamples(&prediction_data, start, end, terminal_nodeIDs + i * num_block_samples);
   }
-  // #nocov end
-#else
-  std::vector<std::thread> threads;
-  threads.reserve(num_threads);
-  progress = 0;
-  for (uint i = 0; i < num_threads; ++i) {
-    threads.emplace_back(&Forest::predictTreesInThread, this, i, data.get(), true);
+  predictBlockInternal(start, end, terminal_nodeIDs, predictions, random_number_generator);
+}
+
+void Forest::predictBlockInternal(size_t start, size_t end, const size_t* terminal_nodeIDs,
+    PredictionTensor& predictions, std::mt19937_64& random_number_generator) const {
+  size_t num_block_samples = end - start;
+  for (size_t sample_idx = start; sample_idx < end; ++sample_idx) {
+    predictInternal(sample_idx, terminal_nodeIDs + (sample_idx - start), num_block_samples, predictions,
+        random_number_generator);
   }
-  showProgress("Computing prediction error..", num_trees);
-  for (auto &thread : threads) {
-    thread.join();
+}
+
+size_t Forest::getPredictionBlockSize(size_t num_prediction_samples, size_t num_blocks_min) const {
+  size_t block_size = PREDICTION_BLOCK_BYTES / (sizeof(double) * num_independent_variables);
+  return std::max((size_t) 1,
+      std::min(block_size, (num_prediction_samples + num_blocks_min - 1) / num_blocks_min));
+}
+
+// #nocov start
+void Forest::predictInChunks() {
+
+  // Open prediction file for writing
+  std::string filename = output_prefix + ".prediction";
+  std::ofstream outfile;
+  outfile.open(filename, std::ios::out);
+  if (!outfile.good()) {
+    throw std::runtime_error("Could not write to prediction file: " + filename + ".");
+  }
+  writePredictionHeader(outfile);
+
+  // The file is ordered by tree if predict_all, keep the text of each chunk and tree in a temporary file
+  std::string chunks_filename = filename + ".tmp";
+  std::fstream chunks_file;
+  std::vector<std::streamoff> chunk_offsets;
+  if (predict_all) {
+    chunks_file.open(chunks_filename, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!chunks_file.good()) {
+      throw std::runtime_error("Could not write to temporary prediction file: " + chunks_filename + ".");
+    }
   }
 
-#ifdef R_BUILD
-  if (aborted_threads > 0) {
-    throw std::runtime_error("User interrupt.");
+  // Predict chunk, write and load next chunk into the same memory
+  size_t num_chunks = 0;
+  size_t num_samples_total = 0;
+  bool found_rounding_error = false;
+  while (true) {
+    predict();
+    if (predict_all) {
+      for (size_t k = 0; k < num_trees; ++k) {
+        chunk_offsets.push_back(chunks_file.tellp());
+        writePredictionSamples(chunks_file, k);
+      }
+    } else {
+      writePredictionSamples(outfile, 0);
+    }
+    ++num_chunks;
+    num_samples_total += num_samples;
+
+    if (!data->loadNextChunk(prediction_chunk_size, num_threads, found_rounding_error)) {
+      break;
+    }
+    num_samples = data->getNumRows();
+  }
+
+  // Copy predictions of each tree from all chunks
+  if (predict_all) {
+    chunk_offsets.push_back(chunks_file.tellp());
+    std::vector<char> buffer;
+    for (size_t k = 0; k < num_trees; ++k) {
+      outfile << "Tree " << k << ":" << std::endl;
+      for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        size_t idx = chunk * num_trees + k;
+        buffer.resize(chunk_offsets[idx + 1] - chunk_offsets[idx]);
+        chunks_file.seekg(chunk_offsets[idx]);
+        chunks_file.read(buffer.data(), buffer.size());
+        outfile.write(buffer.data(), buffer.size());
+      }
+      outfile << std::endl;
+    }
+    chunks_file.close();
+    std::remove(chunks_filename.c_str());
+  }
+  num_samples = num_samples_total;
+
+  if (found_rounding_error && verbose_out) {
+    *verbose_out << "Warning: Rounding or Integer overflow occurred. Use FLOAT or DOUBLE precision to avoid this."
+        << std::endl;
+  }
+  if (verbose_out)
+    *verbose_out << "Saved predictions to file " << filename << "." << std::endl;
+}
+
+void Forest::serve(std::ostream& output) {
+
+  if (verbose_out) {
+    *verbose_out << "Serving predictions .." << std::endl;
+  }
+
+  // Includes waiting for input
+  PhaseTimer timer(profile, "serve");
+
+  // Predict batch, write and load next batch into the same memory. Empty batches get empty responses.
+  size_t num_samples_total = 0;
+  bool found_rounding_error = false;
+  while (true) {
+    if (num_samples > 0) {
+      predict();
+      if (predict_all) {
+        for (size_t k = 0; k < num_trees; ++k) {
+          output << "Tree " << k << ":" << std::endl;
+          writePredictionSamples(output, k);
+        }
+      } else {
+        writePredictionSamples(output, 0);
+      }
+    }
+    output << std::endl;
+    num_samples_total += num_samples;
+
+    if (!data->loadNextBatch(num_threads, found_rounding_error)) {
+      break;
+    }
+    num_samples = data->getNumRows();
+  }
+  num_samples = num_samples_total;
+
+  if (found_rounding_error && verbose_out) {
+    *verbose_out << "Warning: Rounding or Integer overflow occurred. Use FLOAT or DOUBLE precision to avoid this."
+        << std::endl;
   }
+}
+// #nocov end
+
+void Forest::computePredictionError() {
+
+  // Terminal nodes of the OOB samples already recorded while growing or for the OOB stopping checks
+  if (!fused_oob && oob_stop_window == 0) {
+    // Predict trees in multiple threads
+#ifdef OLD_WIN_R_BUILD
+    // #nocov start
+    progress = 0;
+    clock_t start_time = clock();
+    clock_t lap_time = clock();
+    for (size_t i = 0; i < num_trees; ++i) {
+      trees[i]->predict(data.get(), true);
+      progress++;
+      showProgress("Predicting..", start_time, lap_time);
+    }
+    // #nocov end
+#else
+    progress = 0;
+    queueTrees(tree_numa_nodes, 0, num_trees);
+    TaskGroup tasks(num_threads, [this](size_t i) {
+      NumaAffinity affinity(numa_nodes, i);
+      predictTreesInThread(data.get(), true, affinity.getNode());
+    });
+    showProgress("Computing prediction error..", tasks, num_trees);
+    tasks.wait();
+
+#ifdef R_BUILD
+    if (aborted_threads > 0) {
+      throw std::runtime_error("User interrupt.");
+    }
 #endif
 #endif
+  }
+
+  // OOB predictions of all trees, already added window by window when stopping on the OOB error
+  if (oob_stop_window == 0) {
+    oob_sums.clear();
+    oob_counts.clear();
+    addOobSumsInternal(0, num_trees);
+  }
 
   // Call special function for subclasses
   computePredictionErrorInternal();
 }
 
+#ifndef OLD_WIN_R_BUILD
+bool Forest::oobErrorConverged(size_t tree_start, size_t tree_end) {
+
+  // Terminal nodes of the OOB samples of the window, if not recorded while growing
+  if (!fused_oob) {
+    queueTrees(tree_numa_nodes, tree_start, tree_end);
+    TaskGroup tasks(num_threads, [this](size_t i) {
+      NumaAffinity affinity(numa_nodes, i);
+      predictTreesInThread(data.get(), true, affinity.getNode());
+    });
+    tasks.wait();
+    progress = tree_end;
+  }
+
+  if (tree_start == 0) {
+    oob_sums.clear();
+    oob_counts.clear();
+  }
+  addOobSumsInternal(tree_start, tree_end);
+  computePredictionErrorInternal();
+  double oob_error = overall_prediction_error;
+  if (verbose_out) {
+    *verbose_out << "OOB prediction error after " << tree_end << " trees: " << oob_error << std::endl;
+  }
+
+  bool converged = !std::isnan(window_oob_error)
+      && window_oob_error - oob_error <= oob_stop_tolerance * window_oob_error;
+  window_oob_error = oob_error;
+  return converged;
+}
+#endif
+
 void Forest::computePermutationImportance() {
 
   // Compute tree permutation importance in multiple threads
@@ -654,10 +1179,10 @@ void Forest::computePermutationImportance() {
   clock_t lap_time = clock();
 
   // Initialize importance and variance
-  variable_importance.resize(num_independent_variables, 0);
-  std::vector<double> variance;
+  importance_sums.assign(num_independent_variables, 0);
+  importance_variance_sums.clear();
   if (importance_mode == IMP_PERM_BREIMAN || importance_mode == IMP_PERM_LIAW) {
-    variance.resize(num_independent_variables, 0);
+    importance_variance_sums.resize(num_independent_variables, 0);
   }
   if (importance_mode == IMP_PERM_CASEWISE) {
     variable_importance_casewise.resize(num_independent_variables * num_samples, 0);
@@ -665,7 +1190,7 @@ void Forest::computePermutationImportance() {
 
   // Compute importance
   for (size_t i = 0; i < num_trees; ++i) {
-    trees[i]->computePermutationImportance(variable_importance, variance, variable_importance_casewise);
+    trees[i]->computePermutationImportance(importance_sums, importance_variance_sums, variable_importance_casewise);
     progress++;
     showProgress("Computing permutation importance..", start_time, lap_time);
   }
@@ -677,13 +1202,17 @@ void Forest::computePermutationImportance() {
   aborted_threads = 0;
 #endif
 
-  std::vector<std::thread> threads;
-  threads.reserve(num_threads);
-
   // Initialize importance and variance
   std::vector<std::vector<double>> variable_importance_threads(num_threads);
   std::vector<std::vector<double>> variance_threads(num_threads);
-  std::vector<std::vector<double>> variable_importance_casewise_threads(num_threads);
+
+  // Casewise importance is shared by all threads, locked per variable by striped mutexes
+  size_t num_casewise_mutexes = 0;
+  if (importance_mode == IMP_PERM_CASEWISE) {
+    variable_importance_casewise.resize(num_independent_variables * num_samples, 0);
+    num_casewise_mutexes = std::max((size_t) 1, std::min(num_independent_variables, (size_t) 4 * num_threads));
+  }
+  std::vector<std::mutex> casewise_mutexes(num_casewise_mutexes);
 
   // Compute importance
   for (uint i = 0; i < num_threads; ++i) {
@@ -691,17 +1220,15 @@ void Forest::computePermutationImportance() {
     if (importance_mode == IMP_PERM_BREIMAN || importance_mode == IMP_PERM_LIAW) {
       variance_threads[i].resize(num_independent_variables, 0);
     }
-    if (importance_mode == IMP_PERM_CASEWISE) {
-      variable_importance_casewise_threads[i].resize(num_independent_variables * num_samples, 0);
-    }
-    threads.emplace_back(&Forest::computeTreePermutationImportanceInThread, this, i,
-        std::ref(variable_importance_threads[i]), std::ref(variance_threads[i]),
-        std::ref(variable_importance_casewise_threads[i]));
-  }
-  showProgress("Computing permutation importance..", num_trees);
-  for (auto &thread : threads) {
-    thread.join();
   }
+  queueTrees(tree_numa_nodes, 0, num_trees);
+  TaskGroup tasks(num_threads, [&](size_t i) {
+    NumaAffinity affinity(numa_nodes, i);
+    computeTreePermutationImportanceInThread(variable_importance_threads[i], variance_threads[i],
+        variable_importance_casewise, casewise_mutexes, affinity.getNode());
+  });
+  showProgress("Computing permutation importance..", tasks, num_trees);
+  tasks.wait();
 
 #ifdef R_BUILD
   if (aborted_threads > 0) {
@@ -710,152 +1237,270 @@ void Forest::computePermutationImportance() {
 #endif
 
   // Sum thread importances
-  variable_importance.resize(num_independent_variables, 0);
+  importance_sums.assign(num_independent_variables, 0);
   for (size_t i = 0; i < num_independent_variables; ++i) {
     for (uint j = 0; j < num_threads; ++j) {
-      variable_importance[i] += variable_importance_threads[j][i];
+      importance_sums[i] += variable_importance_threads[j][i];
     }
   }
   variable_importance_threads.clear();
 
   // Sum thread variances
-  std::vector<double> variance(num_independent_variables, 0);
+  importance_variance_sums.clear();
   if (importance_mode == IMP_PERM_BREIMAN || importance_mode == IMP_PERM_LIAW) {
+    importance_variance_sums.resize(num_independent_variables, 0);
     for (size_t i = 0; i < num_independent_variables; ++i) {
       for (uint j = 0; j < num_threads; ++j) {
-        variance[i] += variance_threads[j][i];
+        importance_variance_sums[i] += variance_threads[j][i];
       }
     }
     variance_threads.clear();
   }
+#endif
+
+  computeImportanceFromSums();
 
-  // Sum thread casewise importances
   if (importance_mode == IMP_PERM_CASEWISE) {
-    variable_importance_casewise.resize(num_independent_variables * num_samples, 0);
     for (size_t i = 0; i < variable_importance_casewise.size(); ++i) {
-      for (uint j = 0; j < num_threads; ++j) {
-        variable_importance_casewise[i] += variable_importance_casewise_threads[j][i];
-      }
+      variable_importance_casewise[i] /= num_trees;
     }
-    variable_importance_casewise_threads.clear();
   }
-#endif
+}
 
-  for (size_t i = 0; i < variable_importance.size(); ++i) {
-    variable_importance[i] /= num_trees;
+void Forest::computeImportanceFromSums() {
+  variable_importance.assign(importance_sums.size(), 0);
+  for (size_t i = 0; i < importance_sums.size(); ++i) {
+    variable_importance[i] = importance_sums[i] / num_trees;
 
     // Normalize by variance for scaled permutation importance
     if (importance_mode == IMP_PERM_BREIMAN || importance_mode == IMP_PERM_LIAW) {
-      if (variance[i] != 0) {
-        variance[i] = variance[i] / num_trees - variable_importance[i] * variable_importance[i];
-        variable_importance[i] /= sqrt(variance[i] / num_trees);
+      if (importance_variance_sums[i] != 0) {
+        double variance = importance_variance_sums[i] / num_trees - variable_importance[i] * variable_importance[i];
+        variable_importance[i] /= sqrt(variance / num_trees);
       }
     }
   }
+}
 
-  if (importance_mode == IMP_PERM_CASEWISE) {
+void Forest::merge(const Forest& other) {
+  if (other.getTreeType() != getTreeType()) {
+    throw std::runtime_error("Forests of different tree types can not be merged.");
+  }
+  if (!trees.empty() && other.data->getIsOrderedVariable() != data->getIsOrderedVariable()) {
+    throw std::runtime_error("Forests with different unordered variables can not be merged.");
+  }
+  for (auto& tree : other.trees) {
+    if (tree->getNumNodes() == 0) {
+      throw std::runtime_error("Forests mapped from binary files or loaded for float prediction can not be merged.");
+    }
+  }
+  checkShard(other.num_samples, other.seed, other.tree_offset, other.importance_mode);
+
+  // Copy trees with their inbag counts, prediction nodes use the unordered variables of the merged forests
+  size_t num_trees_before = trees.size();
+  if (num_trees_before == 0) {
+    data->getIsOrderedVariable() = other.data->getIsOrderedVariable();
+  }
+  mergeTreesInternal(other);
+  for (size_t i = 0; i < other.trees.size(); ++i) {
+    trees[num_trees_before + i]->setInbagCounts(other.trees[i]->getInbagCounts());
+    trees[num_trees_before + i]->compilePredictionNodes(data.get());
+  }
+
+  addShardSums(other.oob_sums, other.oob_counts, other.importance_sums, other.importance_variance_sums,
+      other.variable_importance_casewise, other.num_trees);
+}
+
+void Forest::checkShard(size_t shard_num_samples, uint shard_seed, size_t shard_tree_offset,
+    ImportanceMode shard_importance_mode) {
+  if (shard_num_samples != num_samples) {
+    throw std::runtime_error("Number of samples of the forest shard does not match the data.");
+  }
+
+  // First shard, take over its settings
+  if (trees.empty()) {
+    num_trees = 0;
+    seed = shard_seed;
+    tree_offset = shard_tree_offset;
+    importance_mode = shard_importance_mode;
+    return;
+  }
+
+  if (shard_seed != seed) {
+    throw std::runtime_error("Forest shards grown with different seeds can not be merged.");
+  }
+  if (shard_importance_mode != importance_mode) {
+    throw std::runtime_error("Forest shards with different importance modes can not be merged.");
+  }
+  if (shard_tree_offset != tree_offset + num_trees) {
+    throw std::runtime_error(
+        "Forest shards must be merged in the order of their tree offsets, the next shard starts at tree "
+            + std::to_string(tree_offset + num_trees) + ".");
+  }
+}
+
+void Forest::addShardSums(const std::vector<double>& shard_oob_sums, const std::vector<size_t>& shard_oob_counts,
+    const std::vector<double>& shard_importance_sums, const std::vector<double>& shard_importance_variance_sums,
+    const std::vector<double>& shard_importance_casewise, size_t shard_num_trees) {
+
+  // OOB sums, only if computed for all shards
+  bool first_shard = num_trees == 0;
+  if (first_shard) {
+    oob_sums = shard_oob_sums;
+    oob_counts = shard_oob_counts;
+  } else if (shard_oob_counts.empty() || shard_oob_sums.size() != oob_sums.size()) {
+    oob_sums.clear();
+    oob_counts.clear();
+  } else {
+    for (size_t i = 0; i < oob_sums.size(); ++i) {
+      oob_sums[i] += shard_oob_sums[i];
+    }
+    for (size_t i = 0; i < oob_counts.size(); ++i) {
+      oob_counts[i] += shard_oob_counts[i];
+    }
+  }
+
+  // Importance sums
+  importance_sums.resize(std::max(importance_sums.size(), shard_importance_sums.size()), 0);
+  for (size_t i = 0; i < shard_importance_sums.size(); ++i) {
+    importance_sums[i] += shard_importance_sums[i];
+  }
+  importance_variance_sums.resize(std::max(importance_variance_sums.size(), shard_importance_variance_sums.size()), 0);
+  for (size_t i = 0; i < shard_importance_variance_sums.size(); ++i) {
+    importance_variance_sums[i] += shard_importance_variance_sums[i];
+  }
+
+  // Casewise importance is kept as mean over the trees, weighted by the number of trees
+  size_t num_trees_merged = num_trees + shard_num_trees;
+  if (first_shard) {
+    variable_importance_casewise = shard_importance_casewise;
+  } else if (shard_importance_casewise.size() == variable_importance_casewise.size()) {
     for (size_t i = 0; i < variable_importance_casewise.size(); ++i) {
-      variable_importance_casewise[i] /= num_trees;
+      variable_importance_casewise[i] = (variable_importance_casewise[i] * num_trees
+          + shard_importance_casewise[i] * shard_num_trees) / num_trees_merged;
     }
   }
+  num_trees = num_trees_merged;
+
+  if (oob_counts.empty()) {
+    overall_prediction_error = NAN;
+  } else {
+    computePredictionErrorInternal();
+  }
+  computeImportanceFromSums();
 }
 
 #ifndef OLD_WIN_R_BUILD
-void Forest::growTreesInThread(uint thread_idx, std::vector<double>* variable_importance) {
-  if (thread_ranges.size() > thread_idx + 1) {
-    for (size_t i = thread_ranges[thread_idx]; i < thread_ranges[thread_idx + 1]; ++i) {
-      trees[i]->grow(variable_importance);
+void Forest::growTreesInThread(std::vector<double>* variable_importance, uint numa_node, double& busy_seconds) {
+  for (size_t i = nextTree(numa_node); i < queued_trees_end; i = nextTree(numa_node)) {
+    auto start_time = std::chrono::steady_clock::now();
+    trees[i]->grow(variable_importance);
+    profile.tree_grow_seconds[i] = secondsSince(start_time);
+    busy_seconds += profile.tree_grow_seconds[i];
+    if (!numa_nodes.empty()) {
+      tree_numa_nodes[i] = numa_node;
+    }
 
-      // Check for user interrupt
+    // Check for user interrupt
 #ifdef R_BUILD
-      if (aborted) {
-        std::unique_lock<std::mutex> lock(mutex);
-        ++aborted_threads;
-        condition_variable.notify_one();
-        return;
-      }
+    if (aborted) {
+      ++aborted_threads;
+      return;
+    }
 #endif
 
-      // Increase progress by 1 tree
-      std::unique_lock<std::mutex> lock(mutex);
-      ++progress;
-      condition_variable.notify_one();
-    }
+    // Increase progress by 1 tree
+    ++progress;
   }
 }
 
-void Forest::predictTreesInThread(uint thread_idx, const Data* prediction_data, bool oob_prediction) {
-  if (thread_ranges.size() > thread_idx + 1) {
-    for (size_t i = thread_ranges[thread_idx]; i < thread_ranges[thread_idx + 1]; ++i) {
-      trees[i]->predict(prediction_data, oob_prediction);
+void Forest::predictTreesInThread(const Data* prediction_data, bool oob_prediction, uint numa_node) {
+  for (size_t i = nextTree(numa_node); i < queued_trees_end; i = nextTree(numa_node)) {
+    trees[i]->predict(prediction_data, oob_prediction);
 
-      // Check for user interrupt
+    // Check for user interrupt
 #ifdef R_BUILD
-      if (aborted) {
-        std::unique_lock<std::mutex> lock(mutex);
-        ++aborted_threads;
-        condition_variable.notify_one();
-        return;
-      }
+    if (aborted) {
+      ++aborted_threads;
+      return;
+    }
 #endif
 
-      // Increase progress by 1 tree
-      std::unique_lock<std::mutex> lock(mutex);
-      ++progress;
-      condition_variable.notify_one();
-    }
+    // Increase progress by 1 tree
+    ++progress;
   }
 }
 
-void Forest::predictInternalInThread(uint thread_idx) {
-  // Create thread ranges
-  std::vector<uint> predict_ranges;
-  equalSplit(predict_ranges, 0, num_samples - 1, num_threads);
+void Forest::predictBlocksInThread(size_t block_size) {
+  size_t num_blocks = (num_samples + block_size - 1) / block_size;
+  std::vector<size_t> terminal_nodeIDs(num_trees * block_size);
+  for (size_t i = next_task++; i < num_blocks; i = next_task++) {
+    size_t start = i * block_size;
+    size_t end = std::min(start + block_size, num_samples);
+    predictSamples(*data, start, end, terminal_nodeIDs.data(), predictions, random_number_generator);
 
-  if (predict_ranges.size() > thread_idx + 1) {
-    for (size_t i = predict_ranges[thread_idx]; i < predict_ranges[thread_idx + 1]; ++i) {
-      predictInternal(i);
-
-      // Check for user interrupt
+    // Check for user interrupt
 #ifdef R_BUILD
-      if (aborted) {
-        std::unique_lock<std::mutex> lock(mutex);
-        ++aborted_threads;
-        condition_variable.notify_one();
-        return;
-      }
+    if (aborted) {
+      ++aborted_threads;
+      return;
+    }
 #endif
 
-      // Increase progress by 1 tree
-      std::unique_lock<std::mutex> lock(mutex);
-      ++progress;
-      condition_variable.notify_one();
-    }
+    // Increase progress by number of samples in block
+    progress += end - start;
   }
 }
 
-void Forest::computeTreePermutationImportanceInThread(uint thread_idx, std::vector<double>& importance,
-    std::vector<double>& variance, std::vector<double>& importance_casewise) {
-  if (thread_ranges.size() > thread_idx + 1) {
-    for (size_t i = thread_ranges[thread_idx]; i < thread_ranges[thread_idx + 1]; ++i) {
-      trees[i]->computePermutationImportance(importance, variance, importance_casewise);
+void Forest::computeTreePermutationImportanceInThread(std::vector<double>& importance, std::vector<double>& variance,
+    std::vector<double>& importance_casewise, std::vector<std::mutex>& casewise_mutexes, uint numa_node) {
+  for (size_t i = nextTree(numa_node); i < queued_trees_end; i = nextTree(numa_node)) {
+    trees[i]->computePermutationImportance(importance, variance, importance_casewise, casewise_mutexes);
 
-      // Check for user interrupt
+    // Check for user interrupt
 #ifdef R_BUILD
-      if (aborted) {
-        std::unique_lock<std::mutex> lock(mutex);
-        ++aborted_threads;
-        condition_variable.notify_one();
-        return;
-      }
+    if (aborted) {
+      ++aborted_threads;
+      return;
+    }
 #endif
 
-      // Increase progress by 1 tree
-      std::unique_lock<std::mutex> lock(mutex);
-      ++progress;
-      condition_variable.notify_one();
+    // Increase progress by 1 tree
+    ++progress;
+  }
+}
+
+void Forest::queueTrees(const std::vector<uint>& tree_nodes, size_t tree_start, size_t tree_end) {
+  next_task = tree_start;
+  queued_trees_end = tree_end;
+  if (numa_nodes.empty()) {
+    return;
+  }
+  numa_node_trees.assign(numa_nodes.size(), std::vector<size_t>());
+  for (size_t i = tree_start; i < tree_end; ++i) {
+    numa_node_trees[tree_nodes[i]].push_back(i);
+  }
+  std::vector<std::atomic<size_t>> next_trees(numa_nodes.size());
+  for (auto& next_tree : next_trees) {
+    next_tree = 0;
+  }
+  numa_next_trees.swap(next_trees);
+}
+
+size_t Forest::nextTree(uint numa_node) {
+  if (numa_nodes.empty()) {
+    return next_task++;
+  }
+  for (size_t i = 0; i < numa_nodes.size(); ++i) {
+    size_t node = (numa_node + i) % numa_nodes.size();
+    if (numa_next_trees[node] < numa_node_trees[node].size()) {
+      size_t next_tree = numa_next_trees[node]++;
+      if (next_tree < numa_node_trees[node].size()) {
+        return numa_node_trees[node][next_tree];
+      }
     }
   }
+  return queued_trees_end;
 }
 #endif
 
@@ -891,8 +1536,51 @@ void Forest::loadFromFile(std::string filename) {
 
   infile.close();
 
-  // Create thread ranges
-  equalSplit(thread_ranges, 0, num_trees - 1, num_threads);
+  // Build prediction nodes, float data is predicted with the float32 nodes only
+  for (auto& tree : trees) {
+    tree->compilePredictionNodes(data.get());
+    if (prediction_mode && data->getRawXFloat()) {
+      tree->releaseDoublePredictionNodes();
+    }
+  }
+}
+
+void Forest::loadFromBinaryFile(const std::string& filename) {
+  if (verbose_out)
+    *verbose_out << "Mapping forest file " << filename << "." << std::endl;
+
+  mapped_forest_file.map(filename);
+  mapped_forest_file.nextBlock(BINARY_FOREST_MAGIC_LENGTH);
+  if (mapped_forest_file.nextUint64() != sizeof(Tree::PredictionNode)) {
+    throw std::runtime_error("Binary forest file was written on an incompatible platform.");
+  }
+  if (mapped_forest_file.nextUint64() != (size_t) getTreeType()) {
+    throw std::runtime_error("Wrong treetype in binary forest file.");
+  }
+  if (mapped_forest_file.nextUint64() != num_independent_variables) {
+    throw std::runtime_error("Number of independent variables in data does not match with the loaded forest.");
+  }
+
+  // Skip dependent variable names (already read)
+  size_t num_dependent_variables = mapped_forest_file.nextUint64();
+  for (size_t i = 0; i < num_dependent_variables; ++i) {
+    mapped_forest_file.nextBlock(mapped_forest_file.nextUint64());
+  }
+
+  num_trees = mapped_forest_file.nextUint64();
+  size_t num_variables = mapped_forest_file.nextUint64();
+  const uint8_t* is_ordered = mapped_forest_file.nextArray<uint8_t>(num_variables);
+  data->getIsOrderedVariable().assign(is_ordered, is_ordered + num_variables);
+
+  // Create trees, they point to the nodes in the file
+  loadFromBinaryFileInternal(mapped_forest_file);
+
+  // Float32 nodes for float data are built in memory
+  if (data->getRawXFloat()) {
+    for (auto& tree : trees) {
+      tree->compileFloatPredictionNodes();
+    }
+  }
 }
 
 void Forest::loadDependentVariableNamesFromFile(std::string filename) {
@@ -906,6 +1594,20 @@ void Forest::loadDependentVariableNamesFromFile(std::string filename) {
 
   // Read dependent variable names
   dependent_variable_names.clear();
+  if (isBinaryForestFile(filename)) {
+    MappedFile file;
+    file.map(filename);
+    file.nextBlock(BINARY_FOREST_MAGIC_LENGTH);
+    file.nextUint64();
+    file.nextUint64();
+    file.nextUint64();
+    size_t num_dependent_variables = file.nextUint64();
+    for (size_t i = 0; i < num_dependent_variables; ++i) {
+      size_t length = file.nextUint64();
+      dependent_variable_names.push_back(std::string(file.nextBlock(length), length));
+    }
+    return;
+  }
   uint num_dependent_variables = 0;
   infile.read((char*) &num_dependent_variables, sizeof(num_dependent_variables));
   for (size_t i = 0; i < num_dependent_variables; ++i) {
@@ -922,7 +1624,22 @@ void Forest::loadDependentVariableNamesFromFile(std::string filename) {
 }
 
 std::unique_ptr<Data> Forest::loadDataFromFile(const std::string& data_path) {
+  PhaseTimer timer(profile, "load");
   std::unique_ptr<Data> result { };
+
+  // Map binary data files, memory mode does not apply. Not checked for the serving input, which can only be read once.
+  if (serve_input == 0 && DataMapped::isBinaryFile(data_path)) {
+    if (verbose_out)
+      *verbose_out << "Mapping binary input file: " << data_path << "." << std::endl;
+    std::unique_ptr<DataMapped> mapped_data = make_unique<DataMapped>();
+    if (prediction_chunk_size > 0) {
+      throw std::runtime_error("Prediction in chunks requires a text input file.");
+    }
+    mapped_data->loadFromBinaryFile(data_path, dependent_variable_names);
+    result = std::move(mapped_data);
+    return result;
+  }
+
   switch (memory_mode) {
   case MEM_DOUBLE:
     result = make_unique<DataDouble>();
@@ -933,11 +1650,30 @@ std::unique_ptr<Data> Forest::loadDataFromFile(const std::string& data_path) {
   case MEM_CHAR:
     result = make_unique<DataChar>();
     break;
+  case MEM_INDEX:
+    result = make_unique<DataIndex>();
+    break;
+  case MEM_SPARSE:
+    result = make_unique<DataSparse>();
+    break;
   }
 
   if (verbose_out)
     *verbose_out << "Loading input file: " << data_path << "." << std::endl;
-  bool found_rounding_error = result->loadFromFile(data_path, dependent_variable_names);
+  bool found_rounding_error = false;
+  if (serve_input != 0) {
+    // Load first batch only, the others are loaded while serving
+    result->openStreamChunked(*serve_input, dependent_variable_names);
+    if (!result->loadNextBatch(num_threads, found_rounding_error) || result->getNumRows() == 0) {
+      throw std::runtime_error("First batch of prediction data is empty.");
+    }
+  } else if (prediction_chunk_size > 0) {
+    // Load first chunk only, the others are loaded while predicting
+    result->openFileChunked(data_path, dependent_variable_names);
+    result->loadNextChunk(prediction_chunk_size, num_threads, found_rounding_error);
+  } else {
+    found_rounding_error = result->loadFromFile(data_path, dependent_variable_names, num_threads);
+  }
   if (found_rounding_error && verbose_out) {
     *verbose_out << "Warning: Rounding or Integer overflow occurred. Use FLOAT or DOUBLE precision to avoid this."
         << std::endl;
@@ -1044,26 +1780,26 @@ void Forest::showProgress(std::string operation, clock_t start_time, clock_t& la
 }
 // #nocov end
 #else
-void Forest::showProgress(std::string operation, size_t max_progress) {
+void Forest::showProgress(std::string operation, TaskGroup& tasks, size_t max_progress) {
   using std::chrono::steady_clock;
   using std::chrono::duration_cast;
   using std::chrono::seconds;
+  using std::chrono::milliseconds;
 
   steady_clock::time_point start_time = steady_clock::now();
   steady_clock::time_point last_time = steady_clock::now();
-  std::unique_lock<std::mutex> lock(mutex);
 
-  // Wait for message from threads and show output if enough time elapsed
-  while (progress < max_progress) {
-    condition_variable.wait(lock);
+  // Wait for the tasks and show output if enough time elapsed, wake up every 100ms to check for user interrupts.
+  // Returns as soon as the last task finished or a task failed, wait() then rethrows.
+  while (!tasks.waitFor(milliseconds(100))) {
     seconds elapsed_time = duration_cast<seconds>(steady_clock::now() - last_time);
 
-    // Check for user interrupt
+    // Check for user interrupt, threads stop after their current tree
 #ifdef R_BUILD
     if (!aborted && checkInterrupt()) {
       aborted = true;
     }
-    if (aborted && aborted_threads >= num_threads) {
+    if (aborted) {
       return;
     }
 #endif
@@ -19,17 +19,31 @@
 #include <memory>
 #ifndef OLD_WIN_R_BUILD
 #include <thread>
-#include <chrono>
 #include <mutex>
-#include <condition_variable>
+#include <chrono>
+#include <atomic>
 #endif
 
 #include "globals.h"
 #include "Tree.h"
 #include "Data.h"
+#include "PredictionTensor.h"
+#include "Profile.h"
 
 namespace ranger {
 
+// Caller-owned memory for prediction with a const forest. Use one workspace per thread, memory is reused between calls.
+struct PredictionWorkspace {
+  // Predictions in the same layout as Forest::getPredictions()
+  PredictionTensor predictions;
+
+  // Terminal nodes of a block of samples, tree after tree
+  std::vector<size_t> terminal_nodeIDs;
+
+  // Used to break ties in majority votes
+  std::mt19937_64 random_number_generator;
+};
+
 class Forest {
 public:
   Forest();
@@ -48,7 +62,10 @@ public:
       const std::vector<std::string>& unordered_variable_names, bool memory_saving_splitting, SplitRule splitrule,
       std::string case_weights_file, bool predict_all, double sample_fraction, double alpha, double minprop,
       bool holdout, PredictionType prediction_type, uint num_random_splits, uint max_depth,
-      const std::vector<double>& regularization_factor, bool regularization_usedepth);
+      const std::vector<double>& regularization_factor, bool regularization_usedepth, uint max_bins,
+      uint prediction_chunk_size, std::istream* serve_input, bool numa, bool gather_columns,
+      bool sort_levels, bool level_wise, bool fused_oob, double oob_stop_tolerance, uint oob_stop_window,
+      bool keep_inbag, size_t tree_offset);
   void initR(std::unique_ptr<Data> input_data, uint mtry, uint num_trees, std::ostream* verbose_out, uint seed,
       uint num_threads, ImportanceMode importance_mode, uint min_node_size,
       std::vector<std::vector<double>>& split_select_weights,
@@ -63,21 +80,54 @@ public:
       bool prediction_mode, bool sample_with_replacement, const std::vector<std::string>& unordered_variable_names,
       bool memory_saving_splitting, SplitRule splitrule, bool predict_all, std::vector<double>& sample_fraction,
       double alpha, double minprop, bool holdout, PredictionType prediction_type, uint num_random_splits,
-      bool order_snps, uint max_depth, const std::vector<double>& regularization_factor, bool regularization_usedepth);
+      bool order_snps, uint max_depth, const std::vector<double>& regularization_factor, bool regularization_usedepth,
+      uint max_bins);
   virtual void initInternal() = 0;
 
   // Grow or predict
   void run(bool verbose, bool compute_oob_error);
 
+  // Predict all rows of prediction_data without changing the forest, in the calling thread. Can be called from several
+  // threads at the same time with a workspace for each. The columns of prediction_data are the independent variables.
+  void predict(const Data& prediction_data, PredictionWorkspace& workspace) const;
+
+  // Predict batches of rows from the serving input until it is exhausted. The predictions of each batch are written to
+  // output, followed by an empty line.
+  void serve(std::ostream& output);
+
   // Write results to output files
   void writeOutput();
   virtual void writeOutputInternal() = 0;
   virtual void writeConfusionFile() = 0;
-  virtual void writePredictionFile() = 0;
+  void writePredictionFile();
   void writeImportanceFile();
 
+  // Write times and counters of this run to <output_prefix>.profile as JSON
+  void writeProfileFile();
+
   // Save forest to file
   void saveToFile();
+
+  // Merge another forest grown on the same data with the same seed, see tree_offset. Its trees start at tree
+  // tree_offset + num_trees of this forest. The trees are copied with their inbag counts, the OOB prediction error and
+  // variable importance are computed from the combined partial sums of both forests. Forests mapped from binary files
+  // or with released prediction nodes have no node vectors and can not be merged.
+  void merge(const Forest& other);
+
+  // Save the partial sums and inbag counts of this forest to <output_prefix>.shard, load the forest shard saved under
+  // prefix from <prefix>.forest and <prefix>.shard and merge it
+  void saveShardToFile();
+  void loadShardFromFile(const std::string& prefix);
+
+  // Save forest to binary file with packed prediction nodes, which is mapped into memory for prediction
+  void saveToBinaryFile();
+  virtual void saveToBinaryFileInternal(BlockFileWriter& file) = 0;
+  virtual TreeType getTreeType() const = 0;
+
+  static bool isBinaryForestFile(const std::string& filename);
+
+  // Save sorted input data to binary file
+  void saveDataToFile();
   virtual void saveToFileInternal(std::ofstream& outfile) = 0;
 
   std::vector<std::vector<std::vector<size_t>>> getChildNodeIDs() {
@@ -110,9 +160,14 @@ public:
   double getOverallPredictionError() const {
     return overall_prediction_error;
   }
-  const std::vector<std::vector<std::vector<double>>>& getPredictions() const {
+  const PredictionTensor& getPredictions() const {
     return predictions;
   }
+
+  // Allocate predictions with allocator instead of own memory
+  void setPredictionAllocator(PredictionTensor::Allocator allocator) {
+    predictions.setAllocator(allocator);
+  }
   size_t getNumTrees() const {
     return num_trees;
   }
@@ -142,35 +197,100 @@ public:
     return data->getSnpOrder();
   }
 
+  const Profile& getProfile() const {
+    return profile;
+  }
+
 protected:
   void grow();
   virtual void growInternal() = 0;
 
   // Predict using existing tree from file and data as prediction data
   void predict();
-  virtual void allocatePredictMemory() = 0;
-  virtual void predictInternal(size_t sample_idx) = 0;
+  virtual void allocatePredictMemory(PredictionTensor& predictions, size_t num_prediction_samples) const = 0;
+
+  // Predict samples start..end-1, with memory for num_trees * (end - start) terminal nodes
+  void predictSamples(const Data& prediction_data, size_t start, size_t end, size_t* terminal_nodeIDs,
+      PredictionTensor& predictions, std::mt19937_64& random_number_generator) const;
+  size_t getPredictionBlockSize(size_t num_prediction_samples, size_t num_blocks_min) const;
+
+  // Aggregate over trees for one sample, terminal_nodeIDs[k * stride] is the terminal node in tree k
+  virtual void predictInternal(size_t sample_idx, const size_t* terminal_nodeIDs, size_t stride,
+      PredictionTensor& predictions, std::mt19937_64& random_number_generator) const = 0;
+
+  // Aggregate over trees for samples start..end-1, terminal_nodeIDs[k * (end - start) + i] is the terminal node of
+  // sample start + i in tree k. Calls predictInternal() for each sample if not overridden.
+  virtual void predictBlockInternal(size_t start, size_t end, const size_t* terminal_nodeIDs,
+      PredictionTensor& predictions, std::mt19937_64& random_number_generator) const;
+
+  // Predict prediction data read in chunks of rows and append to prediction file after each chunk
+  void predictInChunks();
+
+  // Write header of prediction file and predictions of current prediction data, of one tree if predict_all
+  virtual void writePredictionHeader(std::ostream& outfile) = 0;
+  virtual void writePredictionSamples(std::ostream& outfile, size_t tree_idx) = 0;
 
   void computePredictionError();
+
+  // Compute predictions and overall_prediction_error from oob_sums and oob_counts
   virtual void computePredictionErrorInternal() = 0;
 
+  // Add the OOB predictions of trees tree_start..tree_end-1 to oob_sums and oob_counts. Terminal nodes of the OOB
+  // samples must be computed.
+  virtual void addOobSumsInternal(size_t tree_start, size_t tree_end) = 0;
+
   void computePermutationImportance();
 
+  // Divide importance_sums by the number of trees, scaled for IMP_PERM_BREIMAN and IMP_PERM_LIAW
+  void computeImportanceFromSums();
+
+  // Check that a shard fits to the trees merged so far and take over its settings if there are none
+  void checkShard(size_t shard_num_samples, uint shard_seed, size_t shard_tree_offset,
+      ImportanceMode shard_importance_mode);
+
+  // Add the partial sums of a shard with shard_num_trees trees and update the OOB prediction error and importance
+  void addShardSums(const std::vector<double>& shard_oob_sums, const std::vector<size_t>& shard_oob_counts,
+      const std::vector<double>& shard_importance_sums, const std::vector<double>& shard_importance_variance_sums,
+      const std::vector<double>& shard_importance_casewise, size_t shard_num_trees);
+
+  // Append copies of the trees of other to trees, pointing to the members of this forest
+  virtual void mergeTreesInternal(const Forest& other) = 0;
+
   // Multithreading methods for growing/prediction/importance, called by each thread
-  void growTreesInThread(uint thread_idx, std::vector<double>* variable_importance);
-  void predictTreesInThread(uint thread_idx, const Data* prediction_data, bool oob_prediction);
-  void predictInternalInThread(uint thread_idx);
-  void computeTreePermutationImportanceInThread(uint thread_idx, std::vector<double>& importance,
-      std::vector<double>& variance, std::vector<double>& importance_casewise);
+  // Threads take the next tree (or block) from the shared counter next_task until all are done. In NUMA mode threads
+  // take the next tree queued for their node numa_node first, see nextTree().
+  void growTreesInThread(std::vector<double>* variable_importance, uint numa_node, double& busy_seconds);
+  void predictTreesInThread(const Data* prediction_data, bool oob_prediction, uint numa_node);
+  void predictBlocksInThread(size_t block_size);
+#ifndef OLD_WIN_R_BUILD
+  void computeTreePermutationImportanceInThread(std::vector<double>& importance, std::vector<double>& variance,
+      std::vector<double>& importance_casewise, std::vector<std::mutex>& casewise_mutexes, uint numa_node);
+
+  // Update the OOB error with the window of trees tree_start..tree_end-1, true if it decreased by at most
+  // oob_stop_tolerance relative to the previous window
+  bool oobErrorConverged(size_t tree_start, size_t tree_end);
+
+  // Queue trees tree_start..tree_end-1, tree i for threads on NUMA node tree_nodes[i], and reset next_task
+  void queueTrees(const std::vector<uint>& tree_nodes, size_t tree_start, size_t tree_end);
+
+  // Next tree for a thread on numa_node, from the queues of the other nodes if none is left in its own queue.
+  // next_task++ if not in NUMA mode, queued_trees_end if no tree is left.
+  size_t nextTree(uint numa_node);
+#endif
 
   // Load forest from file
   void loadFromFile(std::string filename);
   virtual void loadFromFileInternal(std::ifstream& infile) = 0;
   void loadDependentVariableNamesFromFile(std::string filename);
+  void loadFromBinaryFile(const std::string& filename);
+  virtual void loadFromBinaryFileInternal(MappedFile& file) = 0;
 
   // Load data from file
   std::unique_ptr<Data> loadDataFromFile(const std::string& data_path);
 
+  // Sort data for split search, timed as phase "sort"
+  void sortData();
+
   // Set split select weights and variables to be always considered for splitting
   void setSplitWeightVector(std::vector<std::vector<double>>& split_select_weights);
   void setAlwaysSplitVariables(const std::vector<std::string>& always_split_variable_names);
@@ -179,7 +299,8 @@ protected:
 #ifdef OLD_WIN_R_BUILD
   void showProgress(std::string operation, clock_t start_time, clock_t& lap_time);
 #else
-  void showProgress(std::string operation, size_t max_progress);
+  // Until all tasks are done or one has thrown, progress is relative to max_progress
+  void showProgress(std::string operation, TaskGroup& tasks, size_t max_progress);
 #endif
 
   // Verbose output stream, cout if verbose==true, logfile if not
@@ -211,18 +332,34 @@ protected:
 
   // Multithreading
   uint num_threads;
-  std::vector<uint> thread_ranges;
 #ifndef OLD_WIN_R_BUILD
-  std::mutex mutex;
-  std::condition_variable condition_variable;
+  std::atomic<size_t> next_task;
+  size_t queued_trees_end;
+
+  // NUMA mode: threads run on the nodes in turn and use the trees grown on their node. Empty if not in NUMA mode.
+  std::vector<NumaNode> numa_nodes;
+  std::vector<uint> tree_numa_nodes;
+  std::vector<std::vector<size_t>> numa_node_trees;
+  std::vector<std::atomic<size_t>> numa_next_trees;
 #endif
 
+  // Binary forest file, trees loaded from it point into the mapped memory
+  MappedFile mapped_forest_file;
+
   std::vector<std::unique_ptr<Tree>> trees;
   std::unique_ptr<Data> data;
 
-  std::vector<std::vector<std::vector<double>>> predictions;
+  // Index of the first tree of this forest in a forest grown in shards, tree i has seed (tree_offset + i + 1) * seed
+  size_t tree_offset;
+
+  PredictionTensor predictions;
   double overall_prediction_error;
 
+  // Sums of the OOB predictions of each sample in the layout of the subclass and number of trees each sample is OOB
+  // in, empty if not computed. Partial sums of forest shards are added for merging.
+  std::vector<double> oob_sums;
+  std::vector<size_t> oob_counts;
+
   // Weight vector for selecting possible split variables, one weight between 0 (never select) and 1 (always select) for each variable
   // Deterministic variables are always selected
   std::vector<size_t> deterministic_varIDs;
@@ -231,6 +368,10 @@ protected:
   // Bootstrap weights
   std::vector<double> case_weights;
 
+  // Alias tables of split_select_weights and case_weights, built in grow() and shared by the trees
+  std::vector<AliasTable> split_select_alias_tables;
+  AliasTable case_weights_alias_table;
+
   // Pre-selected bootstrap samples (per tree)
   std::vector<std::vector<size_t>> manual_inbag;
 
@@ -244,18 +385,59 @@ protected:
   std::vector<double> regularization_factor;
   bool regularization_usedepth;
   std::vector<bool> split_varIDs_used;
+
+  // Maximum number of bins per variable for histogram splitting, 0 for exact splitting
+  uint max_bins;
+
+  // Copy index columns to each tree in the order of its samples, see Tree::gather_columns
+  bool gather_columns;
+
+  // Split unordered variables by ordering their levels, see Tree::sort_levels
+  bool sort_levels;
+
+  // Grow trees level by level, streaming the histograms of each level, see Tree::level_wise
+  bool level_wise;
+
+  // Record the terminal nodes of the OOB samples while growing instead of predicting them again, see Tree::fused_oob
+  bool fused_oob;
+
+  // Grow trees in windows of oob_stop_window trees (0 for all at once) until the OOB error decreases by at most
+  // oob_stop_tolerance relative to the previous window, num_trees is the maximum. OOB error of the last window.
+  double oob_stop_tolerance;
+  uint oob_stop_window;
+  double window_oob_error;
+
+  // Number of rows per chunk for prediction in chunks, 0 to load all prediction data
+  size_t prediction_chunk_size;
+
+  // Input of prediction batches seperated by empty lines, 0 if not serving
+  std::istream* serve_input;
+
+  // Terminal nodes for prediction of small batches in the calling thread, reused for all batches
+  std::vector<size_t> inline_terminal_nodeIDs;
   
   // Variable importance for all variables in forest
   std::vector<double> variable_importance;
 
+  // Sums of the variable importance and its square over the trees, see computeImportanceFromSums()
+  std::vector<double> importance_sums;
+  std::vector<double> importance_variance_sums;
+
   // Casewise variable importance for all variables in forest
   std::vector<double> variable_importance_casewise;
 
-  // Computation progress (finished trees)
+  // Phase times and counters, see getProfile()
+  Profile profile;
+
+  // Computation progress (finished trees), updated by threads and polled by showProgress()
+#ifdef OLD_WIN_R_BUILD
   size_t progress;
+#else
+  std::atomic<size_t> progress;
 #ifdef R_BUILD
-  size_t aborted_threads;
-  bool aborted;
+  std::atomic<size_t> aborted_threads;
+  std::atomic<bool> aborted;
+#endif
 #endif
 };
 
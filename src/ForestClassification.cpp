@@ -9,7 +9,6 @@
  R package "ranger" under GPL3 license.
  #-------------------------------------------------------------------------------*/
 
-#include <unordered_map>
 #include <algorithm>
 #include <iterator>
 #include <random>
@@ -41,8 +40,10 @@ void ForestClassification::loadForest(size_t num_trees,
             &this->class_values, &response_classIDs));
   }
 
-  // Create thread ranges
-  equalSplit(thread_ranges, 0, num_trees - 1, num_threads);
+  // Build prediction nodes
+  for (auto& tree : trees) {
+    tree->compilePredictionNodes(data.get());
+  }
 }
 
 void ForestClassification::initInternal() {
@@ -93,7 +94,7 @@ void ForestClassification::initInternal() {
 
   // Sort data if memory saving mode
   if (!memory_saving_splitting) {
-    data->sort();
+    sortData();
   }
 }
 
@@ -105,66 +106,98 @@ void ForestClassification::growInternal() {
   }
 }
 
-void ForestClassification::allocatePredictMemory() {
-  size_t num_prediction_samples = data->getNumRows();
+void ForestClassification::allocatePredictMemory(PredictionTensor& predictions,
+    size_t num_prediction_samples) const {
   if (predict_all || prediction_type == TERMINALNODES) {
-    predictions = std::vector<std::vector<std::vector<double>>>(1,
-        std::vector<std::vector<double>>(num_prediction_samples, std::vector<double>(num_trees)));
+    predictions.resize(1, num_prediction_samples, num_trees);
   } else {
-    predictions = std::vector<std::vector<std::vector<double>>>(1,
-        std::vector<std::vector<double>>(1, std::vector<double>(num_prediction_samples)));
+    predictions.resize(1, 1, num_prediction_samples);
   }
 }
 
-void ForestClassification::predictInternal(size_t sample_idx) {
+void ForestClassification::predictInternal(size_t sample_idx, const size_t* terminal_nodeIDs, size_t stride,
+    PredictionTensor& predictions, std::mt19937_64& random_number_generator) const {
   if (predict_all || prediction_type == TERMINALNODES) {
     // Get all tree predictions
     for (size_t tree_idx = 0; tree_idx < num_trees; ++tree_idx) {
+      size_t nodeID = terminal_nodeIDs[tree_idx * stride];
       if (prediction_type == TERMINALNODES) {
-        predictions[0][sample_idx][tree_idx] = getTreePredictionTerminalNodeID(tree_idx, sample_idx);
+        predictions[0][sample_idx][tree_idx] = nodeID;
       } else {
-        predictions[0][sample_idx][tree_idx] = getTreePrediction(tree_idx, sample_idx);
+        predictions[0][sample_idx][tree_idx] = getTreeNodePrediction(tree_idx, nodeID);
       }
     }
   } else {
     // Count classes over trees and save class with maximum count
-    std::unordered_map<double, size_t> class_count;
+    std::vector<uint> class_count(class_values.size(), 0);
     for (size_t tree_idx = 0; tree_idx < num_trees; ++tree_idx) {
-      ++class_count[getTreePrediction(tree_idx, sample_idx)];
+      ++class_count[getTreeNodeClassID(tree_idx, terminal_nodeIDs[tree_idx * stride])];
     }
-    predictions[0][0][sample_idx] = mostFrequentValue(class_count, random_number_generator);
+    predictions[0][0][sample_idx] = class_values[mostFrequentClass(class_count, random_number_generator)];
   }
 }
 
-void ForestClassification::computePredictionErrorInternal() {
+void ForestClassification::predictBlockInternal(size_t start, size_t end, const size_t* terminal_nodeIDs,
+    PredictionTensor& predictions, std::mt19937_64& random_number_generator) const {
+  if (predict_all || prediction_type == TERMINALNODES) {
+    Forest::predictBlockInternal(start, end, terminal_nodeIDs, predictions, random_number_generator);
+    return;
+  }
 
-  // Class counts for samples
-  std::vector<std::unordered_map<double, size_t>> class_counts;
-  class_counts.reserve(num_samples);
-  for (size_t i = 0; i < num_samples; ++i) {
-    class_counts.push_back(std::unordered_map<double, size_t>());
+  // Count classes tree by tree in the order of terminal_nodeIDs, num_classes counts per sample
+  size_t num_block_samples = end - start;
+  size_t num_classes = class_values.size();
+  std::vector<uint> class_counts(num_block_samples * num_classes, 0);
+  for (size_t tree_idx = 0; tree_idx < num_trees; ++tree_idx) {
+    const auto& tree = dynamic_cast<const TreeClassification&>(*trees[tree_idx]);
+    const size_t* tree_terminal_nodeIDs = terminal_nodeIDs + tree_idx * num_block_samples;
+    for (size_t i = 0; i < num_block_samples; ++i) {
+      ++class_counts[i * num_classes + tree.getNodeClassID(tree_terminal_nodeIDs[i])];
+    }
+  }
+
+  // Save class with maximum count
+  for (size_t i = 0; i < num_block_samples; ++i) {
+    size_t classID = mostFrequentClass(class_counts.data() + i * num_classes, num_classes, random_number_generator);
+    predictions[0][0][start + i] = class_values[classID];
   }
+}
+
+void ForestClassification::addOobSumsInternal(size_t tree_start, size_t tree_end) {
+
+  // Class counts for samples, num_classes counts per sample
+  size_t num_classes = class_values.size();
+  oob_sums.resize(num_samples * num_classes, 0);
+  oob_counts.resize(num_samples, 0);
 
   // For each tree loop over OOB samples and count classes
-  for (size_t tree_idx = 0; tree_idx < num_trees; ++tree_idx) {
-    for (size_t sample_idx = 0; sample_idx < trees[tree_idx]->getNumSamplesOob(); ++sample_idx) {
-      size_t sampleID = trees[tree_idx]->getOobSampleIDs()[sample_idx];
-      ++class_counts[sampleID][getTreePrediction(tree_idx, sample_idx)];
+  for (size_t tree_idx = tree_start; tree_idx < tree_end; ++tree_idx) {
+    const auto& tree = dynamic_cast<const TreeClassification&>(*trees[tree_idx]);
+    const std::vector<size_t>& oob_sampleIDs = tree.getOobSampleIDs();
+    for (size_t sample_idx = 0; sample_idx < tree.getNumSamplesOob(); ++sample_idx) {
+      size_t classID = tree.getNodeClassID(tree.getPredictionTerminalNodeID(sample_idx));
+      ++oob_sums[oob_sampleIDs[sample_idx] * num_classes + classID];
+      ++oob_counts[oob_sampleIDs[sample_idx]];
     }
   }
+}
+
+void ForestClassification::computePredictionErrorInternal() {
 
-  // Compute majority vote for each sample
-  predictions = std::vector<std::vector<std::vector<double>>>(1,
-      std::vector<std::vector<double>>(1, std::vector<double>(num_samples)));
+  // Compute majority vote for each sample, NaN if never OOB
+  size_t num_classes = class_values.size();
+  predictions.resize(1, 1, num_samples);
   for (size_t i = 0; i < num_samples; ++i) {
-    if (!class_counts[i].empty()) {
-      predictions[0][0][i] = mostFrequentValue(class_counts[i], random_number_generator);
+    size_t classID = mostFrequentClass(oob_sums.data() + i * num_classes, num_classes, random_number_generator);
+    if (classID < num_classes) {
+      predictions[0][0][i] = class_values[classID];
     } else {
       predictions[0][0][i] = NAN;
     }
   }
 
   // Compare predictions with true data
+  classification_table.clear();
   size_t num_missclassifications = 0;
   size_t num_predictions = 0;
   for (size_t i = 0; i < predictions[0][0].size(); ++i) {
@@ -232,27 +265,16 @@ void ForestClassification::writeConfusionFile() {
     *verbose_out << "Saved confusion matrix to file " << filename << "." << std::endl;
 }
 
-void ForestClassification::writePredictionFile() {
-
-  // Open prediction file for writing
-  std::string filename = output_prefix + ".prediction";
-  std::ofstream outfile;
-  outfile.open(filename, std::ios::out);
-  if (!outfile.good()) {
-    throw std::runtime_error("Could not write to prediction file: " + filename + ".");
-  }
-
-  // Write
+void ForestClassification::writePredictionHeader(std::ostream& outfile) {
   outfile << "Predictions: " << std::endl;
+}
+
+void ForestClassification::writePredictionSamples(std::ostream& outfile, size_t tree_idx) {
   if (predict_all) {
-    for (size_t k = 0; k < num_trees; ++k) {
-      outfile << "Tree " << k << ":" << std::endl;
-      for (size_t i = 0; i < predictions.size(); ++i) {
-        for (size_t j = 0; j < predictions[i].size(); ++j) {
-          outfile << predictions[i][j][k] << std::endl;
-        }
+    for (size_t i = 0; i < predictions.size(); ++i) {
+      for (size_t j = 0; j < predictions[i].size(); ++j) {
+        outfile << predictions[i][j][tree_idx] << std::endl;
       }
-      outfile << std::endl;
     }
   } else {
     for (size_t i = 0; i < predictions.size(); ++i) {
@@ -263,9 +285,6 @@ void ForestClassification::writePredictionFile() {
       }
     }
   }
-
-  if (verbose_out)
-    *verbose_out << "Saved predictions to file " << filename << "." << std::endl;
 }
 
 void ForestClassification::saveToFileInternal(std::ofstream& outfile) {
@@ -294,8 +313,13 @@ void ForestClassification::loadFromFileInternal(std::ifstream& infile) {
     throw std::runtime_error("Wrong treetype. Loaded file is not a classification forest.");
   }
 
-  // Read class_values
-  readVector1D(class_values, infile);
+  // Read class_values, which must match the class values of the data when merging forest shards
+  std::vector<double> loaded_class_values;
+  readVector1D(loaded_class_values, infile);
+  if (!prediction_mode && loaded_class_values != class_values) {
+    throw std::runtime_error("Class values of the loaded forest do not match the data.");
+  }
+  class_values = loaded_class_values;
 
   for (size_t i = 0; i < num_trees; ++i) {
 
@@ -318,14 +342,48 @@ void ForestClassification::loadFromFileInternal(std::ifstream& infile) {
   }
 }
 
-double ForestClassification::getTreePrediction(size_t tree_idx, size_t sample_idx) const {
+void ForestClassification::mergeTreesInternal(const Forest& other) {
+  const auto& other_forest = dynamic_cast<const ForestClassification&>(other);
+  if (other_forest.class_values != class_values) {
+    throw std::runtime_error("Classification forests with different class values can not be merged.");
+  }
+  for (auto& tree : other_forest.trees) {
+    std::vector<std::vector<size_t>> child_nodeIDs = tree->getChildNodeIDs();
+    std::vector<size_t> split_varIDs = tree->getSplitVarIDs();
+    std::vector<double> split_values = tree->getSplitValues();
+    trees.push_back(
+        make_unique<TreeClassification>(child_nodeIDs, split_varIDs, split_values, &class_values, &response_classIDs));
+  }
+}
+
+void ForestClassification::saveToBinaryFileInternal(BlockFileWriter& file) {
+  file.writeUint64(class_values.size());
+  file.writeArray(class_values.data(), class_values.size());
+}
+
+void ForestClassification::loadFromBinaryFileInternal(MappedFile& file) {
+  size_t num_classes = file.nextUint64();
+  const double* values = file.nextArray<double>(num_classes);
+  class_values.assign(values, values + num_classes);
+
+  std::vector<std::vector<size_t>> child_nodeIDs(2);
+  std::vector<size_t> split_varIDs;
+  std::vector<double> split_values;
+  for (size_t i = 0; i < num_trees; ++i) {
+    trees.push_back(
+        make_unique<TreeClassification>(child_nodeIDs, split_varIDs, split_values, &class_values, &response_classIDs));
+    trees.back()->loadFromBinaryFile(file);
+  }
+}
+
+double ForestClassification::getTreeNodePrediction(size_t tree_idx, size_t nodeID) const {
   const auto& tree = dynamic_cast<const TreeClassification&>(*trees[tree_idx]);
-  return tree.getPrediction(sample_idx);
+  return tree.getNodePrediction(nodeID);
 }
 
-size_t ForestClassification::getTreePredictionTerminalNodeID(size_t tree_idx, size_t sample_idx) const {
+uint ForestClassification::getTreeNodeClassID(size_t tree_idx, size_t nodeID) const {
   const auto& tree = dynamic_cast<const TreeClassification&>(*trees[tree_idx]);
-  return tree.getPredictionTerminalNodeID(sample_idx);
+  return tree.getNodeClassID(nodeID);
 }
 
 // #nocov end
@@ -46,14 +46,25 @@ public:
 protected:
   void initInternal() override;
   void growInternal() override;
-  void allocatePredictMemory() override;
-  void predictInternal(size_t sample_idx) override;
+  void allocatePredictMemory(PredictionTensor& predictions, size_t num_prediction_samples) const override;
+  void predictInternal(size_t sample_idx, const size_t* terminal_nodeIDs, size_t stride, PredictionTensor& predictions,
+      std::mt19937_64& random_number_generator) const override;
+  void predictBlockInternal(size_t start, size_t end, const size_t* terminal_nodeIDs, PredictionTensor& predictions,
+      std::mt19937_64& random_number_generator) const override;
   void computePredictionErrorInternal() override;
+  void addOobSumsInternal(size_t tree_start, size_t tree_end) override;
   void writeOutputInternal() override;
   void writeConfusionFile() override;
-  void writePredictionFile() override;
+  void writePredictionHeader(std::ostream& outfile) override;
+  void writePredictionSamples(std::ostream& outfile, size_t tree_idx) override;
   void saveToFileInternal(std::ofstream& outfile) override;
   void loadFromFileInternal(std::ifstream& infile) override;
+  void mergeTreesInternal(const Forest& other) override;
+  void saveToBinaryFileInternal(BlockFileWriter& file) override;
+  void loadFromBinaryFileInternal(MappedFile& file) override;
+  TreeType getTreeType() const override {
+    return TREE_CLASSIFICATION;
+  }
 
   // Classes of the dependent variable and classIDs for responses
   std::vector<double> class_values;
@@ -67,8 +78,8 @@ protected:
   std::map<std::pair<double, double>, size_t> classification_table;
 
 private:
-  double getTreePrediction(size_t tree_idx, size_t sample_idx) const;
-  size_t getTreePredictionTerminalNodeID(size_t tree_idx, size_t sample_idx) const;
+  double getTreeNodePrediction(size_t tree_idx, size_t nodeID) const;
+  uint getTreeNodeClassID(size_t tree_idx, size_t nodeID) const;
 };
 
 } // namespace ranger
@@ -36,8 +36,10 @@ void ForestProbability::loadForest(size_t num_trees,
             &this->class_values, &response_classIDs, forest_terminal_class_counts[i]));
   }
 
-  // Create thread ranges
-  equalSplit(thread_ranges, 0, num_trees - 1, num_threads);
+  // Build prediction nodes
+  for (auto& tree : trees) {
+    tree->compilePredictionNodes(data.get());
+  }
 }
 
 std::vector<std::vector<std::vector<double>>> ForestProbability::getTerminalClassCounts() const {
@@ -98,7 +100,7 @@ void ForestProbability::initInternal() {
 
   // Sort data if memory saving mode
   if (!memory_saving_splitting) {
-    data->sort();
+    sortData();
   }
 }
 
@@ -110,35 +112,33 @@ void ForestProbability::growInternal() {
   }
 }
 
-void ForestProbability::allocatePredictMemory() {
-  size_t num_prediction_samples = data->getNumRows();
+void ForestProbability::allocatePredictMemory(PredictionTensor& predictions, size_t num_prediction_samples) const {
   if (predict_all) {
-    predictions = std::vector<std::vector<std::vector<double>>>(num_prediction_samples,
-        std::vector<std::vector<double>>(class_values.size(), std::vector<double>(num_trees, 0)));
+    predictions.resize(num_prediction_samples, class_values.size(), num_trees);
   } else if (prediction_type == TERMINALNODES) {
-    predictions = std::vector<std::vector<std::vector<double>>>(1,
-        std::vector<std::vector<double>>(num_prediction_samples, std::vector<double>(num_trees, 0)));
+    predictions.resize(1, num_prediction_samples, num_trees);
   } else {
-    predictions = std::vector<std::vector<std::vector<double>>>(1,
-        std::vector<std::vector<double>>(num_prediction_samples, std::vector<double>(class_values.size(), 0)));
+    predictions.resize(1, num_prediction_samples, class_values.size());
   }
 }
 
-void ForestProbability::predictInternal(size_t sample_idx) {
+void ForestProbability::predictInternal(size_t sample_idx, const size_t* terminal_nodeIDs, size_t stride,
+    PredictionTensor& predictions, std::mt19937_64& random_number_generator) const {
   // For each sample compute proportions in each tree
   for (size_t tree_idx = 0; tree_idx < num_trees; ++tree_idx) {
+    size_t nodeID = terminal_nodeIDs[tree_idx * stride];
     if (predict_all) {
-      std::vector<double> counts = getTreePrediction(tree_idx, sample_idx);
+      const double* counts = getTreeNodePrediction(tree_idx, nodeID);
 
-      for (size_t class_idx = 0; class_idx < counts.size(); ++class_idx) {
+      for (size_t class_idx = 0; class_idx < class_values.size(); ++class_idx) {
         predictions[sample_idx][class_idx][tree_idx] += counts[class_idx];
       }
     } else if (prediction_type == TERMINALNODES) {
-      predictions[0][sample_idx][tree_idx] = getTreePredictionTerminalNodeID(tree_idx, sample_idx);
+      predictions[0][sample_idx][tree_idx] = nodeID;
     } else {
-      std::vector<double> counts = getTreePrediction(tree_idx, sample_idx);
+      const double* counts = getTreeNodePrediction(tree_idx, nodeID);
 
-      for (size_t class_idx = 0; class_idx < counts.size(); ++class_idx) {
+      for (size_t class_idx = 0; class_idx < class_values.size(); ++class_idx) {
         predictions[0][sample_idx][class_idx] += counts[class_idx];
       }
     }
@@ -152,34 +152,37 @@ void ForestProbability::predictInternal(size_t sample_idx) {
   }
 }
 
-void ForestProbability::computePredictionErrorInternal() {
-
-  // For each sample sum over trees where sample is OOB
-  std::vector<size_t> samples_oob_count;
-  samples_oob_count.resize(num_samples, 0);
-  predictions = std::vector<std::vector<std::vector<double>>>(1,
-      std::vector<std::vector<double>>(num_samples, std::vector<double>(class_values.size(), 0)));
+void ForestProbability::addOobSumsInternal(size_t tree_start, size_t tree_end) {
 
-  for (size_t tree_idx = 0; tree_idx < num_trees; ++tree_idx) {
+  // For each sample sum over trees where sample is OOB, num_classes sums per sample
+  size_t num_classes = class_values.size();
+  oob_sums.resize(num_samples * num_classes, 0);
+  oob_counts.resize(num_samples, 0);
+  for (size_t tree_idx = tree_start; tree_idx < tree_end; ++tree_idx) {
     for (size_t sample_idx = 0; sample_idx < trees[tree_idx]->getNumSamplesOob(); ++sample_idx) {
       size_t sampleID = trees[tree_idx]->getOobSampleIDs()[sample_idx];
-      std::vector<double> counts = getTreePrediction(tree_idx, sample_idx);
+      const double* counts = getTreePrediction(tree_idx, sample_idx);
 
-      for (size_t class_idx = 0; class_idx < counts.size(); ++class_idx) {
-        predictions[0][sampleID][class_idx] += counts[class_idx];
+      for (size_t class_idx = 0; class_idx < num_classes; ++class_idx) {
+        oob_sums[sampleID * num_classes + class_idx] += counts[class_idx];
       }
-      ++samples_oob_count[sampleID];
+      ++oob_counts[sampleID];
     }
   }
+}
+
+void ForestProbability::computePredictionErrorInternal() {
 
   // MSE with predicted probability and true data
+  size_t num_classes = class_values.size();
+  predictions.resize(1, num_samples, num_classes);
   size_t num_predictions = 0;
   overall_prediction_error = 0;
   for (size_t i = 0; i < predictions[0].size(); ++i) {
-    if (samples_oob_count[i] > 0) {
+    if (oob_counts[i] > 0) {
       ++num_predictions;
       for (size_t j = 0; j < predictions[0][i].size(); ++j) {
-        predictions[0][i][j] /= (double) samples_oob_count[i];
+        predictions[0][i][j] = oob_sums[i * num_classes + j] / (double) oob_counts[i];
       }
       size_t real_classID = response_classIDs[i];
       double predicted_value = predictions[0][i][real_classID];
@@ -219,31 +222,19 @@ void ForestProbability::writeConfusionFile() {
     *verbose_out << "Saved prediction error to file " << filename << "." << std::endl;
 }
 
-void ForestProbability::writePredictionFile() {
-
-  // Open prediction file for writing
-  std::string filename = output_prefix + ".prediction";
-  std::ofstream outfile;
-  outfile.open(filename, std::ios::out);
-  if (!outfile.good()) {
-    throw std::runtime_error("Could not write to prediction file: " + filename + ".");
-  }
-
-  // Write
+void ForestProbability::writePredictionHeader(std::ostream& outfile) {
   outfile << "Class predictions, one sample per row." << std::endl;
   for (auto& class_value : class_values) {
     outfile << class_value << " ";
   }
   outfile << std::endl << std::endl;
+}
 
+void ForestProbability::writePredictionSamples(std::ostream& outfile, size_t tree_idx) {
   if (predict_all) {
-    for (size_t k = 0; k < num_trees; ++k) {
-      outfile << "Tree " << k << ":" << std::endl;
-      for (size_t i = 0; i < predictions.size(); ++i) {
-        for (size_t j = 0; j < predictions[i].size(); ++j) {
-          outfile << predictions[i][j][k] << " ";
-        }
-        outfile << std::endl;
+    for (size_t i = 0; i < predictions.size(); ++i) {
+      for (size_t j = 0; j < predictions[i].size(); ++j) {
+        outfile << predictions[i][j][tree_idx] << " ";
       }
       outfile << std::endl;
     }
@@ -257,9 +248,6 @@ void ForestProbability::writePredictionFile() {
       }
     }
   }
-
-  if (verbose_out)
-    *verbose_out << "Saved predictions to file " << filename << "." << std::endl;
 }
 
 void ForestProbability::saveToFileInternal(std::ofstream& outfile) {
@@ -288,8 +276,13 @@ void ForestProbability::loadFromFileInternal(std::ifstream& infile) {
     throw std::runtime_error("Wrong treetype. Loaded file is not a probability estimation forest.");
   }
 
-  // Read class_values
-  readVector1D(class_values, infile);
+  // Read class_values, which must match the class values of the data when merging forest shards
+  std::vector<double> loaded_class_values;
+  readVector1D(loaded_class_values, infile);
+  if (!prediction_mode && loaded_class_values != class_values) {
+    throw std::runtime_error("Class values of the loaded forest do not match the data.");
+  }
+  class_values = loaded_class_values;
 
   for (size_t i = 0; i < num_trees; ++i) {
 
@@ -326,14 +319,53 @@ void ForestProbability::loadFromFileInternal(std::ifstream& infile) {
   }
 }
 
-const std::vector<double>& ForestProbability::getTreePrediction(size_t tree_idx, size_t sample_idx) const {
+void ForestProbability::mergeTreesInternal(const Forest& other) {
+  const auto& other_forest = dynamic_cast<const ForestProbability&>(other);
+  if (other_forest.class_values != class_values) {
+    throw std::runtime_error("Probability estimation forests with different class values can not be merged.");
+  }
+  for (auto& tree : other_forest.trees) {
+    std::vector<std::vector<size_t>> child_nodeIDs = tree->getChildNodeIDs();
+    std::vector<size_t> split_varIDs = tree->getSplitVarIDs();
+    std::vector<double> split_values = tree->getSplitValues();
+    std::vector<std::vector<double>> terminal_class_counts =
+        dynamic_cast<const TreeProbability&>(*tree).getTerminalClassCounts();
+    trees.push_back(
+        make_unique<TreeProbability>(child_nodeIDs, split_varIDs, split_values, &class_values, &response_classIDs,
+            terminal_class_counts));
+  }
+}
+
+void ForestProbability::saveToBinaryFileInternal(BlockFileWriter& file) {
+  file.writeUint64(class_values.size());
+  file.writeArray(class_values.data(), class_values.size());
+}
+
+void ForestProbability::loadFromBinaryFileInternal(MappedFile& file) {
+  size_t num_classes = file.nextUint64();
+  const double* values = file.nextArray<double>(num_classes);
+  class_values.assign(values, values + num_classes);
+
+  std::vector<std::vector<size_t>> child_nodeIDs(2);
+  std::vector<size_t> split_varIDs;
+  std::vector<double> split_values;
+  std::vector<std::vector<double>> terminal_class_counts;
+  for (size_t i = 0; i < num_trees; ++i) {
+    trees.push_back(
+        make_unique<TreeProbability>(child_nodeIDs, split_varIDs, split_values, &class_values, &response_classIDs,
+            terminal_class_counts));
+    trees.back()->loadFromBinaryFile(file);
+  }
+}
+
+const double* ForestProbability::getTreePrediction(size_t tree_idx, size_t sample_idx) const {
   const auto& tree = dynamic_cast<const TreeProbability&>(*trees[tree_idx]);
   return tree.getPrediction(sample_idx);
 }
 
-size_t ForestProbability::getTreePredictionTerminalNodeID(size_t tree_idx, size_t sample_idx) const {
+const double* ForestProbability::getTreeNodePrediction(size_t tree_idx, size_t nodeID) const {
   const auto& tree = dynamic_cast<const TreeProbability&>(*trees[tree_idx]);
-  return tree.getPredictionTerminalNodeID(sample_idx);
+  return tree.getNodePrediction(nodeID);
 }
 
 // #nocov end
@@ -49,14 +49,23 @@ public:
 protected:
   void initInternal() override;
   void growInternal() override;
-  void allocatePredictMemory() override;
-  void predictInternal(size_t sample_idx) override;
+  void allocatePredictMemory(PredictionTensor& predictions, size_t num_prediction_samples) const override;
+  void predictInternal(size_t sample_idx, const size_t* terminal_nodeIDs, size_t stride, PredictionTensor& predictions,
+      std::mt19937_64& random_number_generator) const override;
   void computePredictionErrorInternal() override;
+  void addOobSumsInternal(size_t tree_start, size_t tree_end) override;
   void writeOutputInternal() override;
   void writeConfusionFile() override;
-  void writePredictionFile() override;
+  void writePredictionHeader(std::ostream& outfile) override;
+  void writePredictionSamples(std::ostream& outfile, size_t tree_idx) override;
   void saveToFileInternal(std::ofstream& outfile) override;
   void loadFromFileInternal(std::ifstream& infile) override;
+  void mergeTreesInternal(const Forest& other) override;
+  void saveToBinaryFileInternal(BlockFileWriter& file) override;
+  void loadFromBinaryFileInternal(MappedFile& file) override;
+  TreeType getTreeType() const override {
+    return TREE_PROBABILITY;
+  }
 
   // Classes of the dependent variable and classIDs for responses
   std::vector<double> class_values;
@@ -67,8 +76,8 @@ protected:
   std::vector<double> class_weights;
 
 private:
-  const std::vector<double>& getTreePrediction(size_t tree_idx, size_t sample_idx) const;
-  size_t getTreePredictionTerminalNodeID(size_t tree_idx, size_t sample_idx) const;
+  const double* getTreePrediction(size_t tree_idx, size_t sample_idx) const;
+  const double* getTreeNodePrediction(size_t tree_idx, size_t nodeID) const;
 };
 
 } // namespace ranger
@@ -35,8 +35,10 @@ void ForestRegression::loadForest(size_t num_trees,
         make_unique<TreeRegression>(forest_child_nodeIDs[i], forest_split_varIDs[i], forest_split_values[i]));
   }
 
-  // Create thread ranges
-  equalSplit(thread_ranges, 0, num_trees - 1, num_threads);
+  // Build prediction nodes
+  for (auto& tree : trees) {
+    tree->compilePredictionNodes(data.get());
+  }
 }
 
 void ForestRegression::initInternal() {
@@ -64,7 +66,7 @@ void ForestRegression::initInternal() {
 
   // Sort data if memory saving mode
   if (!memory_saving_splitting) {
-    data->sort();
+    sortData();
   }
 }
 
@@ -75,61 +77,60 @@ void ForestRegression::growInternal() {
   }
 }
 
-void ForestRegression::allocatePredictMemory() {
-  size_t num_prediction_samples = data->getNumRows();
+void ForestRegression::allocatePredictMemory(PredictionTensor& predictions, size_t num_prediction_samples) const {
   if (predict_all || prediction_type == TERMINALNODES) {
-    predictions = std::vector<std::vector<std::vector<double>>>(1,
-        std::vector<std::vector<double>>(num_prediction_samples, std::vector<double>(num_trees)));
+    predictions.resize(1, num_prediction_samples, num_trees);
   } else {
-    predictions = std::vector<std::vector<std::vector<double>>>(1,
-        std::vector<std::vector<double>>(1, std::vector<double>(num_prediction_samples)));
+    predictions.resize(1, 1, num_prediction_samples);
   }
 }
 
-void ForestRegression::predictInternal(size_t sample_idx) {
+void ForestRegression::predictInternal(size_t sample_idx, const size_t* terminal_nodeIDs, size_t stride,
+    PredictionTensor& predictions, std::mt19937_64& random_number_generator) const {
   if (predict_all || prediction_type == TERMINALNODES) {
     // Get all tree predictions
     for (size_t tree_idx = 0; tree_idx < num_trees; ++tree_idx) {
+      size_t nodeID = terminal_nodeIDs[tree_idx * stride];
       if (prediction_type == TERMINALNODES) {
-        predictions[0][sample_idx][tree_idx] = getTreePredictionTerminalNodeID(tree_idx, sample_idx);
+        predictions[0][sample_idx][tree_idx] = nodeID;
       } else {
-        predictions[0][sample_idx][tree_idx] = getTreePrediction(tree_idx, sample_idx);
+        predictions[0][sample_idx][tree_idx] = getTreeNodePrediction(tree_idx, nodeID);
       }
     }
   } else {
     // Mean over trees
     double prediction_sum = 0;
     for (size_t tree_idx = 0; tree_idx < num_trees; ++tree_idx) {
-      prediction_sum += getTreePrediction(tree_idx, sample_idx);
+      prediction_sum += getTreeNodePrediction(tree_idx, terminal_nodeIDs[tree_idx * stride]);
     }
     predictions[0][0][sample_idx] = prediction_sum / num_trees;
   }
 }
 
-void ForestRegression::computePredictionErrorInternal() {
+void ForestRegression::addOobSumsInternal(size_t tree_start, size_t tree_end) {
 
   // For each sample sum over trees where sample is OOB
-  std::vector<size_t> samples_oob_count;
-  predictions = std::vector<std::vector<std::vector<double>>>(1,
-      std::vector<std::vector<double>>(1, std::vector<double>(num_samples, 0)));
-  samples_oob_count.resize(num_samples, 0);
-  for (size_t tree_idx = 0; tree_idx < num_trees; ++tree_idx) {
+  oob_sums.resize(num_samples, 0);
+  oob_counts.resize(num_samples, 0);
+  for (size_t tree_idx = tree_start; tree_idx < tree_end; ++tree_idx) {
     for (size_t sample_idx = 0; sample_idx < trees[tree_idx]->getNumSamplesOob(); ++sample_idx) {
       size_t sampleID = trees[tree_idx]->getOobSampleIDs()[sample_idx];
-      double value = getTreePrediction(tree_idx, sample_idx);
-
-      predictions[0][0][sampleID] += value;
-      ++samples_oob_count[sampleID];
+      oob_sums[sampleID] += getTreePrediction(tree_idx, sample_idx);
+      ++oob_counts[sampleID];
     }
   }
+}
+
+void ForestRegression::computePredictionErrorInternal() {
 
   // MSE with predictions and true data
+  predictions.resize(1, 1, num_samples);
   size_t num_predictions = 0;
   overall_prediction_error = 0;
   for (size_t i = 0; i < predictions[0][0].size(); ++i) {
-    if (samples_oob_count[i] > 0) {
+    if (oob_counts[i] > 0) {
       ++num_predictions;
-      predictions[0][0][i] /= (double) samples_oob_count[i];
+      predictions[0][0][i] = oob_sums[i] / (double) oob_counts[i];
       double predicted_value = predictions[0][0][i];
       double real_value = data->get_y(i, 0);
       overall_prediction_error += (predicted_value - real_value) * (predicted_value - real_value);
@@ -166,27 +167,16 @@ void ForestRegression::writeConfusionFile() {
     *verbose_out << "Saved prediction error to file " << filename << "." << std::endl;
 }
 
-void ForestRegression::writePredictionFile() {
-
-  // Open prediction file for writing
-  std::string filename = output_prefix + ".prediction";
-  std::ofstream outfile;
-  outfile.open(filename, std::ios::out);
-  if (!outfile.good()) {
-    throw std::runtime_error("Could not write to prediction file: " + filename + ".");
-  }
-
-  // Write
+void ForestRegression::writePredictionHeader(std::ostream& outfile) {
   outfile << "Predictions: " << std::endl;
+}
+
+void ForestRegression::writePredictionSamples(std::ostream& outfile, size_t tree_idx) {
   if (predict_all) {
-    for (size_t k = 0; k < num_trees; ++k) {
-      outfile << "Tree " << k << ":" << std::endl;
-      for (size_t i = 0; i < predictions.size(); ++i) {
-        for (size_t j = 0; j < predictions[i].size(); ++j) {
-          outfile << predictions[i][j][k] << std::endl;
-        }
+    for (size_t i = 0; i < predictions.size(); ++i) {
+      for (size_t j = 0; j < predictions[i].size(); ++j) {
+        outfile << predictions[i][j][tree_idx] << std::endl;
       }
-      outfile << std::endl;
     }
   } else {
     for (size_t i = 0; i < predictions.size(); ++i) {
@@ -197,9 +187,6 @@ void ForestRegression::writePredictionFile() {
       }
     }
   }
-
-  if (verbose_out)
-    *verbose_out << "Saved predictions to file " << filename << "." << std::endl;
 }
 
 void ForestRegression::saveToFileInternal(std::ofstream& outfile) {
@@ -245,14 +232,40 @@ void ForestRegression::loadFromFileInternal(std::ifstream& infile) {
   }
 }
 
+void ForestRegression::mergeTreesInternal(const Forest& other) {
+  const auto& other_forest = dynamic_cast<const ForestRegression&>(other);
+  for (auto& tree : other_forest.trees) {
+    std::vector<std::vector<size_t>> child_nodeIDs = tree->getChildNodeIDs();
+    std::vector<size_t> split_varIDs = tree->getSplitVarIDs();
+    std::vector<double> split_values = tree->getSplitValues();
+    trees.push_back(make_unique<TreeRegression>(child_nodeIDs, split_varIDs, split_values));
+  }
+}
+
+void ForestRegression::saveToBinaryFileInternal(BlockFileWriter& file) {
+  // No forest type section values
+  file.writeUint64(0);
+}
+
+void ForestRegression::loadFromBinaryFileInternal(MappedFile& file) {
+  file.nextUint64();
+  std::vector<std::vector<size_t>> child_nodeIDs(2);
+  std::vector<size_t> split_varIDs;
+  std::vector<double> split_values;
+  for (size_t i = 0; i < num_trees; ++i) {
+    trees.push_back(make_unique<TreeRegression>(child_nodeIDs, split_varIDs, split_values));
+    trees.back()->loadFromBinaryFile(file);
+  }
+}
+
 double ForestRegression::getTreePrediction(size_t tree_idx, size_t sample_idx) const {
   const auto& tree = dynamic_cast<const TreeRegression&>(*trees[tree_idx]);
   return tree.getPrediction(sample_idx);
 }
 
-size_t ForestRegression::getTreePredictionTerminalNodeID(size_t tree_idx, size_t sample_idx) const {
+double ForestRegression::getTreeNodePrediction(size_t tree_idx, size_t nodeID) const {
   const auto& tree = dynamic_cast<const TreeRegression&>(*trees[tree_idx]);
-  return tree.getPredictionTerminalNodeID(sample_idx);
+  return tree.getNodePrediction(nodeID);
 }
 
 // #nocov end
@@ -38,8 +38,10 @@ void ForestSurvival::loadForest(size_t num_trees, std::vector<std::vector<std::v
             forest_chf[i], &this->unique_timepoints, &response_timepointIDs));
   }
 
-  // Create thread ranges
-  equalSplit(thread_ranges, 0, num_trees - 1, num_threads);
+  // Build prediction nodes
+  for (auto& tree : trees) {
+    tree->compilePredictionNodes(data.get());
+  }
 }
 
 std::vector<std::vector<std::vector<double>>> ForestSurvival::getChf() const {
@@ -86,9 +88,9 @@ void ForestSurvival::initInternal() {
     }
   }
 
-  // Sort data if extratrees and not memory saving mode
-  if (splitrule == EXTRATREES && !memory_saving_splitting) {
-    data->sort();
+  // Sort data if not memory saving mode
+  if (!memory_saving_splitting) {
+    sortData();
   }
 }
 
@@ -99,76 +101,74 @@ void ForestSurvival::growInternal() {
   }
 }
 
-void ForestSurvival::allocatePredictMemory() {
-  size_t num_prediction_samples = data->getNumRows();
+void ForestSurvival::allocatePredictMemory(PredictionTensor& predictions, size_t num_prediction_samples) const {
   size_t num_timepoints = unique_timepoints.size();
   if (predict_all) {
-    predictions = std::vector<std::vector<std::vector<double>>>(num_prediction_samples,
-        std::vector<std::vector<double>>(num_timepoints, std::vector<double>(num_trees, 0)));
+    predictions.resize(num_prediction_samples, num_timepoints, num_trees);
   } else if (prediction_type == TERMINALNODES) {
-    predictions = std::vector<std::vector<std::vector<double>>>(1,
-        std::vector<std::vector<double>>(num_prediction_samples, std::vector<double>(num_trees, 0)));
+    predictions.resize(1, num_prediction_samples, num_trees);
   } else {
-    predictions = std::vector<std::vector<std::vector<double>>>(1,
-        std::vector<std::vector<double>>(num_prediction_samples, std::vector<double>(num_timepoints, 0)));
+    predictions.resize(1, num_prediction_samples, num_timepoints);
   }
 }
 
-void ForestSurvival::predictInternal(size_t sample_idx) {
-  // For each timepoint sum over trees
+void ForestSurvival::predictInternal(size_t sample_idx, const size_t* terminal_nodeIDs, size_t stride,
+    PredictionTensor& predictions, std::mt19937_64& random_number_generator) const {
   if (predict_all) {
-    for (size_t j = 0; j < unique_timepoints.size(); ++j) {
-      for (size_t k = 0; k < num_trees; ++k) {
-        predictions[sample_idx][j][k] = getTreePrediction(k, sample_idx)[j];
-      }
+    for (size_t k = 0; k < num_trees; ++k) {
+      getTreePrediction(k, terminal_nodeIDs[k * stride], predictions[sample_idx], k);
     }
   } else if (prediction_type == TERMINALNODES) {
     for (size_t k = 0; k < num_trees; ++k) {
-      predictions[0][sample_idx][k] = getTreePredictionTerminalNodeID(k, sample_idx);
+      predictions[0][sample_idx][k] = terminal_nodeIDs[k * stride];
     }
   } else {
+    // Add CHF changes of all trees at their steps, then sum over timepoints
+    auto sample_prediction = predictions[0][sample_idx];
+    for (size_t k = 0; k < num_trees; ++k) {
+      addTreePredictionSteps(k, terminal_nodeIDs[k * stride], sample_prediction);
+    }
+    double chf_value = 0;
     for (size_t j = 0; j < unique_timepoints.size(); ++j) {
-      double sample_time_prediction = 0;
-      for (size_t k = 0; k < num_trees; ++k) {
-        sample_time_prediction += getTreePrediction(k, sample_idx)[j];
-      }
-      predictions[0][sample_idx][j] = sample_time_prediction / num_trees;
+      chf_value += sample_prediction[j];
+      sample_prediction[j] = chf_value / num_trees;
     }
   }
 }
 
-void ForestSurvival::computePredictionErrorInternal() {
+void ForestSurvival::addOobSumsInternal(size_t tree_start, size_t tree_end) {
 
+  // For each sample add CHF changes of trees where sample is OOB, num_timepoints sums per sample
   size_t num_timepoints = unique_timepoints.size();
-
-  // For each sample sum over trees where sample is OOB
-  std::vector<size_t> samples_oob_count;
-  samples_oob_count.resize(num_samples, 0);
-  predictions = std::vector<std::vector<std::vector<double>>>(1,
-      std::vector<std::vector<double>>(num_samples, std::vector<double>(num_timepoints, 0)));
-
-  for (size_t tree_idx = 0; tree_idx < num_trees; ++tree_idx) {
+  oob_sums.resize(num_samples * num_timepoints, 0);
+  oob_counts.resize(num_samples, 0);
+  for (size_t tree_idx = tree_start; tree_idx < tree_end; ++tree_idx) {
     for (size_t sample_idx = 0; sample_idx < trees[tree_idx]->getNumSamplesOob(); ++sample_idx) {
       size_t sampleID = trees[tree_idx]->getOobSampleIDs()[sample_idx];
-      std::vector<double> tree_sample_chf = getTreePrediction(tree_idx, sample_idx);
-
-      for (size_t time_idx = 0; time_idx < tree_sample_chf.size(); ++time_idx) {
-        predictions[0][sampleID][time_idx] += tree_sample_chf[time_idx];
-      }
-      ++samples_oob_count[sampleID];
+      PredictionVectorView<double> chf_changes(oob_sums.data() + sampleID * num_timepoints, num_timepoints, 1);
+      addTreePredictionSteps(tree_idx, getTreePredictionTerminalNodeID(tree_idx, sample_idx), chf_changes);
+      ++oob_counts[sampleID];
     }
   }
+}
+
+void ForestSurvival::computePredictionErrorInternal() {
+
+  size_t num_timepoints = unique_timepoints.size();
+  predictions.resize(1, num_samples, num_timepoints);
 
-  // Divide sample predictions by number of trees where sample is oob and compute summed chf for samples
+  // Sum CHF changes over timepoints, divide by number of trees where sample is oob and compute summed chf for samples
   std::vector<double> sum_chf;
   sum_chf.reserve(predictions[0].size());
   std::vector<size_t> oob_sampleIDs;
   oob_sampleIDs.reserve(predictions[0].size());
   for (size_t i = 0; i < predictions[0].size(); ++i) {
-    if (samples_oob_count[i] > 0) {
+    if (oob_counts[i] > 0) {
       double sum = 0;
+      double chf_value = 0;
       for (size_t j = 0; j < predictions[0][i].size(); ++j) {
-        predictions[0][i][j] /= samples_oob_count[i];
+        chf_value += oob_sums[i * num_timepoints + j];
+        predictions[0][i][j] = chf_value / oob_counts[i];
         sum += predictions[0][i][j];
       }
       sum_chf.push_back(sum);
@@ -209,17 +209,7 @@ void ForestSurvival::writeConfusionFile() {
 
 }
 
-void ForestSurvival::writePredictionFile() {
-
-  // Open prediction file for writing
-  std::string filename = output_prefix + ".prediction";
-  std::ofstream outfile;
-  outfile.open(filename, std::ios::out);
-  if (!outfile.good()) {
-    throw std::runtime_error("Could not write to prediction file: " + filename + ".");
-  }
-
-  // Write
+void ForestSurvival::writePredictionHeader(std::ostream& outfile) {
   outfile << "Unique timepoints: " << std::endl;
   for (auto& timepoint : unique_timepoints) {
     outfile << timepoint << " ";
@@ -227,14 +217,13 @@ void ForestSurvival::writePredictionFile() {
   outfile << std::endl << std::endl;
 
   outfile << "Cumulative hazard function, one row per sample: " << std::endl;
+}
+
+void ForestSurvival::writePredictionSamples(std::ostream& outfile, size_t tree_idx) {
   if (predict_all) {
-    for (size_t k = 0; k < num_trees; ++k) {
-      outfile << "Tree " << k << ":" << std::endl;
-      for (size_t i = 0; i < predictions.size(); ++i) {
-        for (size_t j = 0; j < predictions[i].size(); ++j) {
-          outfile << predictions[i][j][k] << " ";
-        }
-        outfile << std::endl;
+    for (size_t i = 0; i < predictions.size(); ++i) {
+      for (size_t j = 0; j < predictions[i].size(); ++j) {
+        outfile << predictions[i][j][tree_idx] << " ";
       }
       outfile << std::endl;
     }
@@ -248,9 +237,6 @@ void ForestSurvival::writePredictionFile() {
       }
     }
   }
-
-  if (verbose_out)
-    *verbose_out << "Saved predictions to file " << filename << "." << std::endl;
 }
 
 void ForestSurvival::saveToFileInternal(std::ofstream& outfile) {
@@ -279,9 +265,13 @@ void ForestSurvival::loadFromFileInternal(std::ifstream& infile) {
     throw std::runtime_error("Wrong treetype. Loaded file is not a survival forest.");
   }
 
-  // Read unique timepoints
-  unique_timepoints.clear();
-  readVector1D(unique_timepoints, infile);
+  // Read unique timepoints, which must match the timepoints of the data when merging forest shards
+  std::vector<double> loaded_unique_timepoints;
+  readVector1D(loaded_unique_timepoints, infile);
+  if (!prediction_mode && loaded_unique_timepoints != unique_timepoints) {
+    throw std::runtime_error("Unique timepoints of the loaded forest do not match the data.");
+  }
+  unique_timepoints = loaded_unique_timepoints;
 
   for (size_t i = 0; i < num_trees; ++i) {
 
@@ -321,9 +311,67 @@ void ForestSurvival::loadFromFileInternal(std::ifstream& infile) {
   }
 }
 
-const std::vector<double>& ForestSurvival::getTreePrediction(size_t tree_idx, size_t sample_idx) const {
+void ForestSurvival::mergeTreesInternal(const Forest& other) {
+  const auto& other_forest = dynamic_cast<const ForestSurvival&>(other);
+  if (other_forest.unique_timepoints != unique_timepoints) {
+    throw std::runtime_error("Survival forests with different unique timepoints can not be merged.");
+  }
+  for (auto& tree : other_forest.trees) {
+    std::vector<std::vector<size_t>> child_nodeIDs = tree->getChildNodeIDs();
+    std::vector<size_t> split_varIDs = tree->getSplitVarIDs();
+    std::vector<double> split_values = tree->getSplitValues();
+    trees.push_back(
+        make_unique<TreeSurvival>(child_nodeIDs, split_varIDs, split_values,
+            dynamic_cast<const TreeSurvival&>(*tree).getChf(), &unique_timepoints, &response_timepointIDs));
+  }
+}
+
+void ForestSurvival::saveToBinaryFileInternal(BlockFileWriter& file) {
+  file.writeUint64(unique_timepoints.size());
+  file.writeArray(unique_timepoints.data(), unique_timepoints.size());
+}
+
+void ForestSurvival::loadFromBinaryFileInternal(MappedFile& file) {
+  size_t num_timepoints = file.nextUint64();
+  const double* timepoints = file.nextArray<double>(num_timepoints);
+  unique_timepoints.assign(timepoints, timepoints + num_timepoints);
+
+  std::vector<std::vector<size_t>> child_nodeIDs(2);
+  std::vector<size_t> split_varIDs;
+  std::vector<double> split_values;
+  std::vector<std::vector<double>> chf;
+  for (size_t i = 0; i < num_trees; ++i) {
+    trees.push_back(
+        make_unique<TreeSurvival>(child_nodeIDs, split_varIDs, split_values, chf, &unique_timepoints,
+            &response_timepointIDs));
+    trees.back()->loadFromBinaryFile(file);
+  }
+}
+
+void ForestSurvival::getTreePrediction(size_t tree_idx, size_t nodeID, PredictionMatrixView<double> chf,
+    size_t col) const {
   const auto& tree = dynamic_cast<const TreeSurvival&>(*trees[tree_idx]);
-  return tree.getPrediction(sample_idx);
+  size_t time_idx = 0;
+  double chf_value = 0;
+  for (size_t step = tree.getChfStepsBegin(nodeID); step < tree.getChfStepsEnd(nodeID); ++step) {
+    for (; time_idx < tree.getChfStepTimepointID(step); ++time_idx) {
+      chf[time_idx][col] = chf_value;
+    }
+    chf_value = tree.getChfStepValue(step);
+  }
+  for (; time_idx < unique_timepoints.size(); ++time_idx) {
+    chf[time_idx][col] = chf_value;
+  }
+}
+
+void ForestSurvival::addTreePredictionSteps(size_t tree_idx, size_t nodeID,
+    PredictionVectorView<double> chf_changes) const {
+  const auto& tree = dynamic_cast<const TreeSurvival&>(*trees[tree_idx]);
+  double chf_value = 0;
+  for (size_t step = tree.getChfStepsBegin(nodeID); step < tree.getChfStepsEnd(nodeID); ++step) {
+    chf_changes[tree.getChfStepTimepointID(step)] += tree.getChfStepValue(step) - chf_value;
+    chf_value = tree.getChfStepValue(step);
+  }
 }
 
 size_t ForestSurvival::getTreePredictionTerminalNodeID(size_t tree_idx, size_t sample_idx) const {
@@ -44,20 +44,33 @@ public:
 private:
   void initInternal() override;
   void growInternal() override;
-  void allocatePredictMemory() override;
-  void predictInternal(size_t sample_idx) override;
+  void allocatePredictMemory(PredictionTensor& predictions, size_t num_prediction_samples) const override;
+  void predictInternal(size_t sample_idx, const size_t* terminal_nodeIDs, size_t stride, PredictionTensor& predictions,
+      std::mt19937_64& random_number_generator) const override;
   void computePredictionErrorInternal() override;
+  void addOobSumsInternal(size_t tree_start, size_t tree_end) override;
   void writeOutputInternal() override;
   void writeConfusionFile() override;
-  void writePredictionFile() override;
+  void writePredictionHeader(std::ostream& outfile) override;
+  void writePredictionSamples(std::ostream& outfile, size_t tree_idx) override;
   void saveToFileInternal(std::ofstream& outfile) override;
   void loadFromFileInternal(std::ifstream& infile) override;
+  void mergeTreesInternal(const Forest& other) override;
+  void saveToBinaryFileInternal(BlockFileWriter& file) override;
+  void loadFromBinaryFileInternal(MappedFile& file) override;
+  TreeType getTreeType() const override {
+    return TREE_SURVIVAL;
+  }
 
   std::vector<double> unique_timepoints;
   std::vector<size_t> response_timepointIDs;
 
 private:
-  const std::vector<double>& getTreePrediction(size_t tree_idx, size_t sample_idx) const;
+  // Write CHF of terminal node of tree at all timepoints to column col of chf
+  void getTreePrediction(size_t tree_idx, size_t nodeID, PredictionMatrixView<double> chf, size_t col) const;
+
+  // Add the changes of the CHF of terminal node of tree at its steps to chf_changes
+  void addTreePredictionSteps(size_t tree_idx, size_t nodeID, PredictionVectorView<double> chf_changes) const;
   size_t getTreePredictionTerminalNodeID(size_t tree_idx, size_t sample_idx) const;
 };
 
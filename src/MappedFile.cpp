@@ -0,0 +1,118 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+// Ignore in coverage report (not used in R package)
+// #nocov start
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+#include "utility.h"
+
+namespace ranger {
+
+MappedFile::MappedFile() :
+    mapped_data(0), mapped_size(0), pos(0) {
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (mapped_data != 0) {
+    munmap(mapped_data, mapped_size);
+  }
+#endif
+}
+
+void MappedFile::map(const std::string& filename) {
+#ifdef _WIN32
+  throw std::runtime_error("Mapping binary files is not supported on Windows.");
+#else
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open input file: " + filename + ".");
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    throw std::runtime_error("Could not open input file: " + filename + ".");
+  }
+  mapped_size = file_stat.st_size;
+  void* mapping = mmap(0, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    mapped_size = 0;
+    throw std::runtime_error("Could not map input file: " + filename + ".");
+  }
+  mapped_data = mapping;
+  pos = 0;
+#endif
+}
+
+const char* MappedFile::nextBlock(size_t size) {
+  if (size > mapped_size || pos > mapped_size - size) {
+    throw std::runtime_error("Binary file is truncated.");
+  }
+  const char* block = static_cast<const char*>(mapped_data) + pos;
+  pos = roundToNextMultiple(pos + size, sizeof(uint64_t));
+  return block;
+}
+
+size_t MappedFile::nextUint64() {
+  uint64_t value;
+  std::memcpy(&value, nextBlock(sizeof(value)), sizeof(value));
+  return (size_t) value;
+}
+
+bool MappedFile::hasMagic(const std::string& filename, const char* magic, size_t magic_length) {
+  std::ifstream infile;
+  infile.open(filename, std::ios::binary);
+  std::string file_magic(magic_length, '\0');
+  infile.read(&file_magic[0], magic_length);
+  return infile.good() && std::memcmp(file_magic.data(), magic, magic_length) == 0;
+}
+
+BlockFileWriter::BlockFileWriter(const std::string& filename) :
+    filename(filename), pos(0) {
+  outfile.open(filename, std::ios::binary);
+  if (!outfile.good()) {
+    throw std::runtime_error("Could not write to output file: " + filename + ".");
+  }
+}
+
+void BlockFileWriter::writeBlock(const void* block, size_t size) {
+  const char padding[sizeof(uint64_t)] = { };
+  outfile.write(static_cast<const char*>(block), size);
+  size_t padded = roundToNextMultiple(pos + size, sizeof(uint64_t));
+  outfile.write(padding, padded - pos - size);
+  pos = padded;
+}
+
+void BlockFileWriter::writeUint64(size_t value) {
+  uint64_t v = value;
+  writeBlock(&v, sizeof(v));
+}
+
+void BlockFileWriter::close() {
+  if (!outfile.good()) {
+    throw std::runtime_error("Could not write to output file: " + filename + ".");
+  }
+  outfile.close();
+}
+
+} // namespace ranger
+// #nocov end
@@ -0,0 +1,82 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+// Ignore in coverage report (not used in R package)
+// #nocov start
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <fstream>
+#include <string>
+#include <cstdint>
+
+#include "globals.h"
+
+namespace ranger {
+
+// Binary file mapped into memory read-only and read in blocks. Each block starts at an 8 byte boundary.
+class MappedFile {
+public:
+  MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile();
+
+  void map(const std::string& filename);
+
+  // Pointer to next block of given size, advances to the next 8 byte boundary after the block
+  const char* nextBlock(size_t size);
+  size_t nextUint64();
+
+  template<typename T>
+  const T* nextArray(size_t length) {
+    return reinterpret_cast<const T*>(nextBlock(length * sizeof(T)));
+  }
+
+  // True if the file starts with the given magic string
+  static bool hasMagic(const std::string& filename, const char* magic, size_t magic_length);
+
+private:
+  void* mapped_data;
+  size_t mapped_size;
+  size_t pos;
+};
+
+// Binary file written in blocks, each block padded to the next 8 byte boundary
+class BlockFileWriter {
+public:
+  BlockFileWriter(const std::string& filename);
+
+  BlockFileWriter(const BlockFileWriter&) = delete;
+  BlockFileWriter& operator=(const BlockFileWriter&) = delete;
+
+  void writeBlock(const void* block, size_t size);
+  void writeUint64(size_t value);
+
+  template<typename T>
+  void writeArray(const T* values, size_t length) {
+    writeBlock(values, length * sizeof(T));
+  }
+
+  void close();
+
+private:
+  std::string filename;
+  std::ofstream outfile;
+  size_t pos;
+};
+
+} // namespace ranger
+
+#endif /* MAPPEDFILE_H_ */
+// #nocov end
@@ -0,0 +1,140 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdint>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#include "Numa.h"
+
+namespace ranger {
+
+#ifdef __linux__
+// From linux/mempolicy.h
+const int NUMA_MPOL_INTERLEAVE = 3;
+const unsigned NUMA_MPOL_MF_MOVE = 1 << 1;
+#endif
+
+std::vector<NumaNode> getNumaNodes() {
+  std::vector<NumaNode> nodes;
+#ifdef __linux__
+  cpu_set_t allowed_cpus;
+  if (sched_getaffinity(0, sizeof(allowed_cpus), &allowed_cpus) != 0) {
+    return nodes;
+  }
+
+  // Node IDs are not necessarily contiguous, e.g. "0,2-3"
+  std::ifstream online_file("/sys/devices/system/node/online");
+  std::string online;
+  if (!std::getline(online_file, online)) {
+    return nodes;
+  }
+  auto parse_list = [](const std::string& list) {
+    std::vector<uint> values;
+    std::stringstream list_stream(list);
+    std::string range;
+    while (std::getline(list_stream, range, ',')) {
+      size_t dash = range.find('-');
+      try {
+        uint first = std::stoul(range.substr(0, dash));
+        uint last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+        for (uint value = first; value <= last; ++value) {
+          values.push_back(value);
+        }
+      } catch (...) {
+        return std::vector<uint>();
+      }
+    }
+    return values;
+  };
+
+  for (auto& id : parse_list(online)) {
+    std::ifstream cpulist_file("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+    std::string cpulist;
+    std::getline(cpulist_file, cpulist);
+    NumaNode node;
+    node.id = id;
+    for (auto& cpu : parse_list(cpulist)) {
+      if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed_cpus)) {
+        node.cpus.push_back(cpu);
+      }
+    }
+
+    // Skip nodes with memory only
+    if (!node.cpus.empty()) {
+      nodes.push_back(node);
+    }
+  }
+#endif
+  return nodes;
+}
+
+void interleavePages(const void* data, size_t size, const std::vector<NumaNode>& nodes) {
+#ifdef __linux__
+  if (nodes.empty()) {
+    return;
+  }
+
+  // Only whole pages, partial pages at the ends are shared with other allocations
+  uintptr_t page_size = sysconf(_SC_PAGESIZE);
+  uintptr_t begin = ((uintptr_t) data + page_size - 1) / page_size * page_size;
+  uintptr_t end = ((uintptr_t) data + size) / page_size * page_size;
+  if (end <= begin) {
+    return;
+  }
+
+  const size_t bits_per_word = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> node_mask;
+  for (auto& node : nodes) {
+    if (node.id / bits_per_word >= node_mask.size()) {
+      node_mask.resize(node.id / bits_per_word + 1, 0);
+    }
+    node_mask[node.id / bits_per_word] |= 1UL << (node.id % bits_per_word);
+  }
+  syscall(SYS_mbind, begin, end - begin, NUMA_MPOL_INTERLEAVE, node_mask.data(), node_mask.size() * bits_per_word + 1,
+      NUMA_MPOL_MF_MOVE);
+#endif
+}
+
+NumaAffinity::NumaAffinity(const std::vector<NumaNode>& nodes, size_t thread_idx) :
+    node(0), pinned(false) {
+  if (nodes.empty()) {
+    return;
+  }
+  node = thread_idx % nodes.size();
+#ifdef __linux__
+  if (sched_getaffinity(0, sizeof(previous_cpus), &previous_cpus) != 0) {
+    return;
+  }
+  cpu_set_t node_cpus;
+  CPU_ZERO(&node_cpus);
+  for (auto& cpu : nodes[node].cpus) {
+    CPU_SET(cpu, &node_cpus);
+  }
+  pinned = sched_setaffinity(0, sizeof(node_cpus), &node_cpus) == 0;
+#endif
+}
+
+NumaAffinity::~NumaAffinity() {
+#ifdef __linux__
+  // Pool threads run other tasks afterwards
+  if (pinned) {
+    sched_setaffinity(0, sizeof(previous_cpus), &previous_cpus);
+  }
+#endif
+}
+
+} // namespace ranger
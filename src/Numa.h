@@ -0,0 +1,67 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+#ifndef NUMA_H_
+#define NUMA_H_
+
+#include <vector>
+#include <cstddef>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "globals.h"
+
+namespace ranger {
+
+struct NumaNode {
+  uint id;
+  std::vector<uint> cpus;
+};
+
+// NUMA nodes with CPUs this process may run on, empty if the topology is not available (Linux only)
+std::vector<NumaNode> getNumaNodes();
+
+// Interleave the pages of memory [data, data + size) over nodes, pages already touched are moved. Best effort, no
+// effect if not supported.
+void interleavePages(const void* data, size_t size, const std::vector<NumaNode>& nodes);
+
+template<typename T>
+inline void interleavePages(const std::vector<T>& vector, const std::vector<NumaNode>& nodes) {
+  interleavePages(vector.data(), vector.size() * sizeof(T), nodes);
+}
+
+// Run the calling thread on the CPUs of node thread_idx % nodes.size() while in scope, no effect if nodes is empty
+class NumaAffinity {
+public:
+  NumaAffinity(const std::vector<NumaNode>& nodes, size_t thread_idx);
+
+  NumaAffinity(const NumaAffinity&) = delete;
+  NumaAffinity& operator=(const NumaAffinity&) = delete;
+
+  ~NumaAffinity();
+
+  // Index of node in nodes, 0 if nodes is empty
+  uint getNode() const {
+    return node;
+  }
+
+private:
+  uint node;
+  bool pinned;
+#ifdef __linux__
+  cpu_set_t previous_cpus;
+#endif
+};
+
+} // namespace ranger
+
+#endif /* NUMA_H_ */
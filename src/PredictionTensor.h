@@ -0,0 +1,149 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+#ifndef PREDICTIONTENSOR_H_
+#define PREDICTIONTENSOR_H_
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include "globals.h"
+
+namespace ranger {
+
+// Strided views on a vector and a matrix of a prediction tensor, indexed like nested vectors
+template<typename T>
+class PredictionVectorView {
+public:
+  PredictionVectorView(T* values, size_t size, size_t stride) :
+      values(values), length(size), stride(stride) {
+  }
+
+  T& operator[](size_t k) const {
+    return values[k * stride];
+  }
+
+  size_t size() const {
+    return length;
+  }
+
+private:
+  T* values;
+  size_t length;
+  size_t stride;
+};
+
+template<typename T>
+class PredictionMatrixView {
+public:
+  PredictionMatrixView(T* values, size_t num_rows, size_t num_cols, size_t row_stride, size_t col_stride) :
+      values(values), num_rows(num_rows), num_cols(num_cols), row_stride(row_stride), col_stride(col_stride) {
+  }
+
+  PredictionVectorView<T> operator[](size_t j) const {
+    return PredictionVectorView<T>(values + j * row_stride, num_cols, col_stride);
+  }
+
+  size_t size() const {
+    return num_rows;
+  }
+
+private:
+  T* values;
+  size_t num_rows;
+  size_t num_cols;
+  size_t row_stride;
+  size_t col_stride;
+};
+
+// 3d array of predictions in one contiguous buffer. Row major in own memory or column major in memory of an
+// allocator, e.g. an R array which is then returned without copying.
+class PredictionTensor {
+public:
+  // Returns memory for dim0 x dim1 x dim2 values
+  typedef std::function<double*(size_t dim0, size_t dim1, size_t dim2)> Allocator;
+
+  PredictionTensor() :
+      values(0), dims { 0, 0, 0 }, strides { 0, 0, 0 } {
+  }
+
+  PredictionTensor(const PredictionTensor&) = delete;
+  PredictionTensor& operator=(const PredictionTensor&) = delete;
+
+  void setAllocator(Allocator allocator) {
+    this->allocator = allocator;
+  }
+
+  // Resize and set all values, own memory is reused
+  void resize(size_t dim0, size_t dim1, size_t dim2, double value = 0) {
+    size_t size = dim0 * dim1 * dim2;
+    dims[0] = dim0;
+    dims[1] = dim1;
+    dims[2] = dim2;
+    if (allocator) {
+      values = allocator(dim0, dim1, dim2);
+      std::fill(values, values + size, value);
+      strides[0] = 1;
+      strides[1] = dim0;
+      strides[2] = dim0 * dim1;
+    } else {
+      own_values.assign(size, value);
+      values = own_values.data();
+      strides[0] = dim1 * dim2;
+      strides[1] = dim2;
+      strides[2] = 1;
+    }
+  }
+
+  double& operator()(size_t i, size_t j, size_t k) {
+    return values[i * strides[0] + j * strides[1] + k * strides[2]];
+  }
+
+  double operator()(size_t i, size_t j, size_t k) const {
+    return values[i * strides[0] + j * strides[1] + k * strides[2]];
+  }
+
+  PredictionMatrixView<double> operator[](size_t i) {
+    return PredictionMatrixView<double>(values + i * strides[0], dims[1], dims[2], strides[1], strides[2]);
+  }
+
+  PredictionMatrixView<const double> operator[](size_t i) const {
+    return PredictionMatrixView<const double>(values + i * strides[0], dims[1], dims[2], strides[1], strides[2]);
+  }
+
+  size_t size() const {
+    return dims[0];
+  }
+
+  size_t dim(size_t d) const {
+    return dims[d];
+  }
+
+  bool empty() const {
+    return dims[0] * dims[1] * dims[2] == 0;
+  }
+
+  const double* data() const {
+    return values;
+  }
+
+private:
+  double* values;
+  std::vector<double> own_values;
+  size_t dims[3];
+  size_t strides[3];
+  Allocator allocator;
+};
+
+} // namespace ranger
+
+#endif /* PREDICTIONTENSOR_H_ */
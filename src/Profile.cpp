@@ -0,0 +1,72 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+#include "Profile.h"
+
+namespace ranger {
+
+const char* const SPLIT_METHOD_NAMES[NUM_SPLIT_METHODS] = { "small_q", "large_q", "histogram", "sparse", "unordered",
+    "snp", "other" };
+
+Profile::Profile() :
+    num_nodes(0), num_split_candidates(NUM_SPLIT_METHODS, 0) {
+}
+
+void Profile::addPhase(const std::string& name, double wall_seconds, double cpu_seconds) {
+  for (auto& phase : phases) {
+    if (phase.name == name) {
+      phase.wall_seconds += wall_seconds;
+      phase.cpu_seconds += cpu_seconds;
+      return;
+    }
+  }
+  phases.push_back( { name, wall_seconds, cpu_seconds });
+}
+
+// #nocov start
+static void writeJsonArray(std::ostream& output, const std::vector<double>& values) {
+  output << "[";
+  for (size_t i = 0; i < values.size(); ++i) {
+    output << (i > 0 ? ", " : "") << values[i];
+  }
+  output << "]";
+}
+
+void Profile::writeJson(std::ostream& output) const {
+  output << "{" << std::endl;
+  output << "  \"phases\": {";
+  for (size_t i = 0; i < phases.size(); ++i) {
+    output << (i > 0 ? "," : "") << std::endl << "    \"" << phases[i].name << "\": {\"wall_seconds\": "
+        << phases[i].wall_seconds << ", \"cpu_seconds\": " << phases[i].cpu_seconds << "}";
+  }
+  output << std::endl << "  }," << std::endl;
+  output << "  \"tree_grow_seconds\": ";
+  writeJsonArray(output, tree_grow_seconds);
+  output << "," << std::endl << "  \"thread_idle_seconds\": ";
+  writeJsonArray(output, thread_idle_seconds);
+  output << "," << std::endl << "  \"num_nodes\": " << num_nodes << "," << std::endl;
+  output << "  \"split_candidates\": {";
+  for (size_t i = 0; i < NUM_SPLIT_METHODS; ++i) {
+    output << (i > 0 ? ", " : "") << "\"" << SPLIT_METHOD_NAMES[i] << "\": " << num_split_candidates[i];
+  }
+  output << "}" << std::endl << "}" << std::endl;
+}
+// #nocov end
+
+PhaseTimer::PhaseTimer(Profile& profile, const std::string& phase) :
+    profile(profile), phase(phase), wall_start(std::chrono::steady_clock::now()), cpu_start(std::clock()) {
+}
+
+PhaseTimer::~PhaseTimer() {
+  profile.addPhase(phase, secondsSince(wall_start), (double) (std::clock() - cpu_start) / CLOCKS_PER_SEC);
+}
+
+} // namespace ranger
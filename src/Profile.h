@@ -0,0 +1,81 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <chrono>
+#include <ctime>
+
+#include "globals.h"
+
+namespace ranger {
+
+struct ProfilePhase {
+  std::string name;
+  double wall_seconds;
+
+  // Process CPU time of all threads, see std::clock()
+  double cpu_seconds;
+};
+
+// Times and counters of a forest, collected while running
+struct Profile {
+  Profile();
+
+  // Add time to phase, phases are kept in the order they are first added
+  void addPhase(const std::string& name, double wall_seconds, double cpu_seconds);
+
+  void writeJson(std::ostream& output) const;
+
+  std::vector<ProfilePhase> phases;
+
+  // Wall time of growing each tree
+  std::vector<double> tree_grow_seconds;
+
+  // Wall time each growing thread waited for its first tree or for the other threads
+  std::vector<double> thread_idle_seconds;
+
+  // Number of nodes in all trees and split candidates evaluated with each SplitMethod
+  size_t num_nodes;
+  std::vector<size_t> num_split_candidates;
+};
+
+// Names of SplitMethod values in profiles
+extern const char* const SPLIT_METHOD_NAMES[NUM_SPLIT_METHODS];
+
+inline double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Add wall and CPU time to a phase of profile while in scope
+class PhaseTimer {
+public:
+  PhaseTimer(Profile& profile, const std::string& phase);
+
+  PhaseTimer(const PhaseTimer&) = delete;
+  PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+  ~PhaseTimer();
+
+private:
+  Profile& profile;
+  std::string phase;
+  std::chrono::steady_clock::time_point wall_start;
+  std::clock_t cpu_start;
+};
+
+} // namespace ranger
+
+#endif /* PROFILE_H_ */
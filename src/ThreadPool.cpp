@@ -0,0 +1,142 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+#include "ThreadPool.h"
+
+#ifndef OLD_WIN_R_BUILD
+#include <algorithm>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace ranger {
+
+ThreadPool::ThreadPool() :
+    num_idle_threads(0) {
+#ifndef _WIN32
+  pid = getpid();
+#endif
+}
+
+ThreadPool& ThreadPool::getInstance() {
+  // Never deleted, the threads wait on it until exit. Only replaced in a forked child, before it starts any tasks.
+  static ThreadPool* instance = new ThreadPool();
+#ifndef _WIN32
+  if (instance->pid != getpid()) {
+    instance = new ThreadPool();
+  }
+#endif
+  return *instance;
+}
+
+void ThreadPool::start(TaskGroup* group, size_t num_workers) {
+  std::unique_lock<std::mutex> lock(mutex);
+  for (size_t i = 0; i < num_workers; ++i) {
+    queue.push_back(group);
+  }
+
+  // Start threads until a waiting thread is available for each queued worker
+  while (num_idle_threads < queue.size()) {
+    std::thread(&ThreadPool::work, this).detach();
+    ++num_idle_threads;
+  }
+  lock.unlock();
+  condition.notify_all();
+}
+
+void ThreadPool::remove(TaskGroup* group) {
+  std::lock_guard<std::mutex> lock(mutex);
+  queue.erase(std::remove(queue.begin(), queue.end(), group), queue.end());
+}
+
+void ThreadPool::work() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    condition.wait(lock, [this] {return !queue.empty();});
+    TaskGroup* group = queue.front();
+    queue.pop_front();
+    --num_idle_threads;
+    {
+      std::lock_guard<std::mutex> group_lock(group->mutex);
+      ++group->num_active_workers;
+    }
+    lock.unlock();
+
+    group->runTasks();
+    {
+      std::lock_guard<std::mutex> group_lock(group->mutex);
+      --group->num_active_workers;
+      group->condition.notify_all();
+    }
+
+    lock.lock();
+    ++num_idle_threads;
+  }
+}
+
+TaskGroup::TaskGroup(size_t num_tasks, std::function<void(size_t)> task) :
+    task(task), num_tasks(num_tasks), next_task(0), waited(false), pool(ThreadPool::getInstance()), num_active_workers(
+        0), num_finished_tasks(0) {
+  pool.start(this, num_tasks);
+}
+
+TaskGroup::~TaskGroup() {
+  if (!waited) {
+    try {
+      wait();
+    } catch (...) {
+      // Only rethrown by wait()
+    }
+  }
+}
+
+void TaskGroup::wait() {
+  runTasks();
+  pool.remove(this);
+  std::unique_lock<std::mutex> lock(mutex);
+  condition.wait(lock, [this] {return num_active_workers == 0;});
+  waited = true;
+  if (exception) {
+    std::exception_ptr first_exception = exception;
+    exception = 0;
+    std::rethrow_exception(first_exception);
+  }
+}
+
+bool TaskGroup::waitFor(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex);
+  return condition.wait_for(lock, timeout, [this] {return num_finished_tasks == num_tasks || exception;});
+}
+
+void TaskGroup::runTasks() {
+  for (size_t i = next_task++; i < num_tasks; i = next_task++) {
+    std::exception_ptr task_exception;
+    try {
+      task(i);
+    } catch (...) {
+      task_exception = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (task_exception && !exception) {
+      exception = task_exception;
+    }
+    ++num_finished_tasks;
+    if (num_finished_tasks == num_tasks || exception) {
+      condition.notify_all();
+    }
+  }
+}
+
+} // namespace ranger
+
+#endif
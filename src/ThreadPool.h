@@ -0,0 +1,104 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include "globals.h"
+
+#ifndef OLD_WIN_R_BUILD
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <exception>
+
+namespace ranger {
+
+class TaskGroup;
+
+// Threads shared by all forests and phases of the process. Threads are started when first needed, up to the largest
+// number of tasks started at the same time, and wait for new tasks until the process exits.
+class ThreadPool {
+public:
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Pool of the process, a new one after fork() since the threads are not copied
+  static ThreadPool& getInstance();
+
+private:
+  friend class TaskGroup;
+
+  ThreadPool();
+
+  // Queue group for num_workers threads, each runs tasks of the group until none are left
+  void start(TaskGroup* group, size_t num_workers);
+
+  // Remove group from queue, no other worker starts on it
+  void remove(TaskGroup* group);
+
+  void work();
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::deque<TaskGroup*> queue;
+  size_t num_idle_threads;
+#ifndef _WIN32
+  long pid;
+#endif
+};
+
+// Tasks task(0), ..., task(num_tasks - 1) run at the same time in pool threads. wait() runs the tasks not started yet
+// in the calling thread, so groups can be started and waited for from tasks of other groups.
+class TaskGroup {
+public:
+  TaskGroup(size_t num_tasks, std::function<void(size_t)> task);
+
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+
+  ~TaskGroup();
+
+  // Wait until all tasks are done and rethrow the first exception of a task
+  void wait();
+
+  // Wait at most timeout until all tasks are done or a task has thrown, true if so. Woken by the task that finishes
+  // last or throws. After a throw the other tasks still run until wait().
+  bool waitFor(std::chrono::milliseconds timeout);
+
+private:
+  friend class ThreadPool;
+
+  // Run tasks until none are left
+  void runTasks();
+
+  std::function<void(size_t)> task;
+  size_t num_tasks;
+  std::atomic<size_t> next_task;
+  bool waited;
+
+  ThreadPool& pool;
+  std::mutex mutex;
+  std::condition_variable condition;
+  size_t num_active_workers;
+  size_t num_finished_tasks;
+  std::exception_ptr exception;
+};
+
+} // namespace ranger
+
+#endif
+#endif /* THREADPOOL_H_ */
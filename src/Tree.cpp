@@ -9,7 +9,14 @@
  R package "ranger" under GPL3 license.
  #-------------------------------------------------------------------------------*/
 
+#include <algorithm>
 #include <iterator>
+#include <limits>
+#include <numeric>
+#include <cstddef>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 #include "Tree.h"
 #include "utility.h"
@@ -17,36 +24,50 @@
 namespace ranger {
 
 Tree::Tree() :
-    mtry(0), num_samples(0), num_samples_oob(0), min_node_size(0), deterministic_varIDs(0), split_select_weights(0), case_weights(
-        0), manual_inbag(0), oob_sampleIDs(0), holdout(false), keep_inbag(false), data(0), regularization_factor(0), regularization_usedepth(
-        false), split_varIDs_used(0), variable_importance(0), importance_mode(DEFAULT_IMPORTANCE_MODE), sample_with_replacement(
-        true), sample_fraction(0), memory_saving_splitting(false), splitrule(DEFAULT_SPLITRULE), alpha(DEFAULT_ALPHA), minprop(
-        DEFAULT_MINPROP), num_random_splits(DEFAULT_NUM_RANDOM_SPLITS), max_depth(DEFAULT_MAXDEPTH), depth(0), last_left_nodeID(
-        0) {
+    mtry(0), num_samples(0), num_samples_oob(0), min_node_size(0), deterministic_varIDs(0), split_select_alias_table(0), case_weights(
+        0), case_weights_alias_table(0), manual_inbag(0), prediction_nodes(0), num_prediction_nodes(0), ordered_prediction_nodes(false), oob_sampleIDs(0), holdout(false), keep_inbag(false), data(
+        0), responses(0), regularization_factor(0), regularization_usedepth(false), split_varIDs_used(0), variable_importance(0), importance_mode(
+        DEFAULT_IMPORTANCE_MODE), sample_with_replacement(true), sample_fraction(0), memory_saving_splitting(false), splitrule(
+        DEFAULT_SPLITRULE), alpha(DEFAULT_ALPHA), minprop(DEFAULT_MINPROP), num_random_splits(DEFAULT_NUM_RANDOM_SPLITS), max_depth(
+        DEFAULT_MAXDEPTH), depth(0), last_left_nodeID(0), num_split_threads(1), histogram_splitting(false), gather_columns(false), sort_levels(false), level_wise(false), level_start(0), fused_oob(false), snp_bitsets_nodeID(
+        0), snp_num_planes(0) {
+  for (auto& count : num_split_candidates) {
+    count = 0;
+  }
 }
 
 Tree::Tree(std::vector<std::vector<size_t>>& child_nodeIDs, std::vector<size_t>& split_varIDs,
     std::vector<double>& split_values) :
-    mtry(0), num_samples(0), num_samples_oob(0), min_node_size(0), deterministic_varIDs(0), split_select_weights(0), case_weights(
-        0), manual_inbag(0), split_varIDs(split_varIDs), split_values(split_values), child_nodeIDs(child_nodeIDs), oob_sampleIDs(
-        0), holdout(false), keep_inbag(false), data(0), regularization_factor(0), regularization_usedepth(false), split_varIDs_used(
-        0), variable_importance(0), importance_mode(DEFAULT_IMPORTANCE_MODE), sample_with_replacement(true), sample_fraction(
-        0), memory_saving_splitting(false), splitrule(DEFAULT_SPLITRULE), alpha(DEFAULT_ALPHA), minprop(
+    mtry(0), num_samples(0), num_samples_oob(0), min_node_size(0), deterministic_varIDs(0), split_select_alias_table(0), case_weights(
+        0), case_weights_alias_table(0), manual_inbag(0), split_varIDs(split_varIDs), split_values(split_values), child_nodeIDs(child_nodeIDs), prediction_nodes(0), num_prediction_nodes(0), ordered_prediction_nodes(
+        false), oob_sampleIDs(0), holdout(false), keep_inbag(false), data(0), responses(0), regularization_factor(0), regularization_usedepth(
+        false), split_varIDs_used(0), variable_importance(0), importance_mode(DEFAULT_IMPORTANCE_MODE), sample_with_replacement(
+        true), sample_fraction(0), memory_saving_splitting(false), splitrule(DEFAULT_SPLITRULE), alpha(DEFAULT_ALPHA), minprop(
         DEFAULT_MINPROP), num_random_splits(DEFAULT_NUM_RANDOM_SPLITS), max_depth(DEFAULT_MAXDEPTH), depth(0), last_left_nodeID(
-        0) {
+        0), num_split_threads(1), histogram_splitting(false), gather_columns(false), sort_levels(false), level_wise(false), level_start(0), fused_oob(false), snp_bitsets_nodeID(
+        0), snp_num_planes(0) {
+  for (auto& count : num_split_candidates) {
+    count = 0;
+  }
 }
 
 void Tree::init(const Data* data, uint mtry, size_t num_samples, uint seed, std::vector<size_t>* deterministic_varIDs,
-    std::vector<double>* split_select_weights, ImportanceMode importance_mode, uint min_node_size,
+    const AliasTable* split_select_alias_table, ImportanceMode importance_mode, uint min_node_size,
     bool sample_with_replacement, bool memory_saving_splitting, SplitRule splitrule, std::vector<double>* case_weights,
-    std::vector<size_t>* manual_inbag, bool keep_inbag, std::vector<double>* sample_fraction, double alpha,
+    const AliasTable* case_weights_alias_table, std::vector<size_t>* manual_inbag, bool keep_inbag, std::vector<double>* sample_fraction, double alpha,
     double minprop, bool holdout, uint num_random_splits, uint max_depth, std::vector<double>* regularization_factor,
-    bool regularization_usedepth, std::vector<bool>* split_varIDs_used) {
+    bool regularization_usedepth, std::vector<bool>* split_varIDs_used, uint num_split_threads,
+    bool histogram_splitting, bool gather_columns, bool sort_levels, bool level_wise, bool fused_oob) {
 
   this->data = data;
   this->mtry = mtry;
   this->num_samples = num_samples;
   this->memory_saving_splitting = memory_saving_splitting;
+  this->histogram_splitting = histogram_splitting;
+  this->gather_columns = gather_columns;
+  this->sort_levels = sort_levels;
+  this->level_wise = level_wise;
+  this->fused_oob = fused_oob;
 
   // Create root node, assign bootstrap sample and oob samples
   child_nodeIDs.push_back(std::vector<size_t>());
@@ -57,12 +78,13 @@ void Tree::init(const Data* data, uint mtry, size_t num_samples, uint seed, std:
   random_number_generator.seed(seed);
 
   this->deterministic_varIDs = deterministic_varIDs;
-  this->split_select_weights = split_select_weights;
+  this->split_select_alias_table = split_select_alias_table;
   this->importance_mode = importance_mode;
   this->min_node_size = min_node_size;
   this->sample_with_replacement = sample_with_replacement;
   this->splitrule = splitrule;
   this->case_weights = case_weights;
+  this->case_weights_alias_table = case_weights_alias_table;
   this->manual_inbag = manual_inbag;
   this->keep_inbag = keep_inbag;
   this->sample_fraction = sample_fraction;
@@ -74,6 +96,7 @@ void Tree::init(const Data* data, uint mtry, size_t num_samples, uint seed, std:
   this->regularization_factor = regularization_factor;
   this->regularization_usedepth = regularization_usedepth;
   this->split_varIDs_used = split_varIDs_used;
+  this->num_split_threads = num_split_threads;
 
   // Regularization
   if (regularization_factor->size() > 0) {
@@ -89,6 +112,9 @@ void Tree::grow(std::vector<double>* variable_importance) {
 
   this->variable_importance = variable_importance;
 
+  // Read responses from the raw column while growing, without virtual calls
+  responses = data->getRawY();
+
   // Bootstrap, dependent if weighted or not and with or without replacement
   if (!case_weights->empty()) {
     if (sample_with_replacement) {
@@ -115,12 +141,41 @@ void Tree::grow(std::vector<double>* variable_importance) {
   // Init start and end positions
   start_pos[0] = 0;
   end_pos[0] = sampleIDs.size();
+  gatherNodeBuffers();
+  if (fused_oob) {
+    // Route the OOB samples down with the bag to record their terminal nodes
+    oob_node_sampleIDs = oob_sampleIDs;
+    oob_right_sampleIDs.resize(num_samples_oob);
+    oob_sample_positions.resize(num_samples);
+    for (size_t i = 0; i < num_samples_oob; ++i) {
+      oob_sample_positions[oob_sampleIDs[i]] = i;
+    }
+    oob_start_pos[0] = 0;
+    oob_end_pos[0] = num_samples_oob;
+    prediction_terminal_nodeIDs.assign(num_samples_oob, 0);
+  }
+
+  // Reserve node storage for expected tree size, each terminal node has about min_node_size samples
+  size_t expected_num_nodes = 2 * sampleIDs.size() / std::max(min_node_size, (uint) 1) + 1;
+  split_varIDs.reserve(expected_num_nodes);
+  split_values.reserve(expected_num_nodes);
+  child_nodeIDs[0].reserve(expected_num_nodes);
+  child_nodeIDs[1].reserve(expected_num_nodes);
+  start_pos.reserve(expected_num_nodes);
+  end_pos.reserve(expected_num_nodes);
 
   // While not all nodes terminal, split next node
   size_t num_open_nodes = 1;
   size_t i = 0;
+  size_t level_end = 0;
   depth = 0;
   while (num_open_nodes > 0) {
+    // Nodes up to the last created node are the next level
+    if (level_wise && i == level_end) {
+      level_end = split_varIDs.size();
+      prepareLevel(i, level_end);
+    }
+
     // Split node
     bool is_terminal_node = splitNode(i);
     if (is_terminal_node) {
@@ -137,10 +192,55 @@ void Tree::grow(std::vector<double>* variable_importance) {
     ++i;
   }
 
-  // Delete sampleID vector to save memory
+  // Delete sampleID vector and growing memory, release unused node storage
   sampleIDs.clear();
   sampleIDs.shrink_to_fit();
+  sample_nodeIDs.clear();
+  sample_nodeIDs.shrink_to_fit();
+  sample_counts.clear();
+  sample_counts.shrink_to_fit();
+  snp_bitsets.clear();
+  snp_bitsets.shrink_to_fit();
+  node_responses.clear();
+  node_responses.shrink_to_fit();
+  node_index_columns.clear();
+  node_index_columns.shrink_to_fit();
+  start_pos.clear();
+  start_pos.shrink_to_fit();
+  end_pos.clear();
+  end_pos.shrink_to_fit();
+  possible_split_varIDs.clear();
+  possible_split_varIDs.shrink_to_fit();
+  split_varIDs.shrink_to_fit();
+  split_values.shrink_to_fit();
+  child_nodeIDs[0].shrink_to_fit();
+  child_nodeIDs[1].shrink_to_fit();
   cleanUpInternal();
+  parent_nodeIDs.clear();
+  parent_nodeIDs.shrink_to_fit();
+  histogram_varIDs.clear();
+  histogram_varIDs.shrink_to_fit();
+  histograms.clear();
+  histograms.shrink_to_fit();
+  level_split_varIDs.clear();
+  level_split_varIDs.shrink_to_fit();
+  level_histograms.clear();
+  level_histograms.shrink_to_fit();
+  level_sample_nodes.clear();
+  level_sample_nodes.shrink_to_fit();
+  level_start = 0;
+  oob_node_sampleIDs.clear();
+  oob_node_sampleIDs.shrink_to_fit();
+  oob_right_sampleIDs.clear();
+  oob_right_sampleIDs.shrink_to_fit();
+  oob_sample_positions.clear();
+  oob_sample_positions.shrink_to_fit();
+  oob_start_pos.clear();
+  oob_start_pos.shrink_to_fit();
+  oob_end_pos.clear();
+  oob_end_pos.shrink_to_fit();
+
+  compilePredictionNodes(data);
 }
 
 void Tree::predict(const Data* prediction_data, bool oob_prediction) {
@@ -152,57 +252,144 @@ void Tree::predict(const Data* prediction_data, bool oob_prediction) {
     num_samples_predict = prediction_data->getNumRows();
   }
 
+  allocatePredictMemory(num_samples_predict);
+  predictSamples(prediction_data, oob_prediction, 0, num_samples_predict);
+}
+
+void Tree::allocatePredictMemory(size_t num_samples_predict) {
   prediction_terminal_nodeIDs.resize(num_samples_predict, 0);
+}
+
+void Tree::predictSamples(const Data* prediction_data, bool oob_prediction, size_t start, size_t end) {
+  const size_t* sampleIDs = 0;
+  if (oob_prediction) {
+    sampleIDs = oob_sampleIDs.data();
+  }
+  dropDownSamples(prediction_data, sampleIDs, start, end, prediction_terminal_nodeIDs.data() + start);
+}
+
+void Tree::predictSamples(const Data* prediction_data, size_t start, size_t end, size_t* terminal_nodeIDs) const {
+  dropDownSamples(prediction_data, 0, start, end, terminal_nodeIDs);
+}
+
+void Tree::dropDownSamples(const Data* prediction_data, const size_t* sampleIDs, size_t start, size_t end,
+    size_t* terminal_nodeIDs) const {
+
+  // Use branchless kernel if only ordered variables and raw data available
+  const float* x_float = prediction_data->getRawXFloat();
+  if (!float_prediction_nodes.empty() && x_float) {
+    predictSamplesOrderedFloat(x_float, prediction_data->getNumRows(), prediction_data->getNumCols(), sampleIDs, start,
+        end, terminal_nodeIDs);
+    return;
+  }
+  const double* x = prediction_data->getRawX();
+  if (ordered_prediction_nodes && x) {
+    predictSamplesOrdered(x, prediction_data->getNumRows(), sampleIDs, start, end, terminal_nodeIDs);
+    return;
+  }
+
+  if (!prediction_nodes) {
+    throw std::runtime_error("Only float data can be predicted after the double prediction nodes were released.");
+  }
 
   // For each sample start in root, drop down the tree and return final value
-  for (size_t i = 0; i < num_samples_predict; ++i) {
+  for (size_t i = start; i < end; ++i) {
     size_t sample_idx;
-    if (oob_prediction) {
-      sample_idx = oob_sampleIDs[i];
+    if (sampleIDs) {
+      sample_idx = sampleIDs[i];
     } else {
       sample_idx = i;
     }
     size_t nodeID = 0;
-    while (1) {
-
-      // Break if terminal node
-      if (child_nodeIDs[0][nodeID] == 0 && child_nodeIDs[1][nodeID] == 0) {
-        break;
-      }
+    while (!prediction_nodes[nodeID].is_terminal) {
+      const PredictionNode& node = prediction_nodes[nodeID];
 
       // Move to child
-      size_t split_varID = split_varIDs[nodeID];
-
-      double value = prediction_data->get_x(sample_idx, split_varID);
-      if (prediction_data->isOrderedVariable(split_varID)) {
-        if (value <= split_values[nodeID]) {
-          // Move to left child
-          nodeID = child_nodeIDs[0][nodeID];
-        } else {
-          // Move to right child
-          nodeID = child_nodeIDs[1][nodeID];
-        }
-      } else {
-        size_t factorID = floor(value) - 1;
-        size_t splitID = floor(split_values[nodeID]);
-
-        // Left if 0 found at position factorID
-        if (!(splitID & (1ULL << factorID))) {
-          // Move to left child
-          nodeID = child_nodeIDs[0][nodeID];
-        } else {
-          // Move to right child
-          nodeID = child_nodeIDs[1][nodeID];
-        }
-      }
+      double value = prediction_data->get_x(sample_idx, node.split_varID);
+      nodeID = node.child_nodeIDs[getChildIndex(node, value)];
     }
 
-    prediction_terminal_nodeIDs[i] = nodeID;
+    terminal_nodeIDs[i - start] = nodeID;
   }
 }
 
+void Tree::compilePredictionNodes(const Data* data) {
+
+  size_t num_nodes = split_varIDs.size();
+  if (num_nodes > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("Too many nodes in tree for prediction.");
+  }
+
+  prediction_node_storage.clear();
+  prediction_node_storage.resize(num_nodes);
+  prediction_nodes = prediction_node_storage.data();
+  num_prediction_nodes = num_nodes;
+  ordered_prediction_nodes = true;
+  for (size_t i = 0; i < num_nodes; ++i) {
+    PredictionNode& node = prediction_node_storage[i];
+    node.split_value = split_values[i];
+    node.is_terminal = (child_nodeIDs[0][i] == 0 && child_nodeIDs[1][i] == 0);
+    if (node.is_terminal) {
+      node.split_varID = 0;
+      node.child_nodeIDs[0] = i;
+      node.child_nodeIDs[1] = i;
+      node.is_ordered = true;
+    } else {
+      node.split_varID = split_varIDs[i];
+      node.child_nodeIDs[0] = child_nodeIDs[0][i];
+      node.child_nodeIDs[1] = child_nodeIDs[1][i];
+      node.is_ordered = data->isOrderedVariable(split_varIDs[i]);
+    }
+    ordered_prediction_nodes = ordered_prediction_nodes && node.is_ordered;
+  }
+
+  if (data->getRawXFloat()) {
+    compileFloatPredictionNodes();
+  } else {
+    std::vector<PredictionNodeFloat>().swap(float_prediction_nodes);
+  }
+
+  compilePredictionNodesInternal();
+}
+
+void Tree::compileFloatPredictionNodes() {
+  std::vector<PredictionNodeFloat>().swap(float_prediction_nodes);
+  if (!ordered_prediction_nodes) {
+    return;
+  }
+
+  float_prediction_nodes.resize(num_prediction_nodes);
+  for (size_t i = 0; i < num_prediction_nodes; ++i) {
+    const PredictionNode& node = prediction_nodes[i];
+    PredictionNodeFloat& float_node = float_prediction_nodes[i];
+
+    float_node.split_value = roundDownToFloat(node.split_value);
+    float_node.split_varID = node.split_varID;
+    float_node.child_nodeIDs[0] = node.child_nodeIDs[0];
+    float_node.child_nodeIDs[1] = node.child_nodeIDs[1];
+  }
+}
+
+void Tree::releaseDoublePredictionNodes() {
+  if (float_prediction_nodes.empty() || prediction_node_storage.empty()) {
+    return;
+  }
+
+  std::vector<PredictionNode>().swap(prediction_node_storage);
+  prediction_nodes = 0;
+  for (auto& child_nodeIDs_side : child_nodeIDs) {
+    std::vector<size_t>().swap(child_nodeIDs_side);
+  }
+  std::vector<size_t>().swap(split_varIDs);
+}
+
+#ifdef OLD_WIN_R_BUILD
 void Tree::computePermutationImportance(std::vector<double>& forest_importance, std::vector<double>& forest_variance,
     std::vector<double>& forest_importance_casewise) {
+#else
+void Tree::computePermutationImportance(std::vector<double>& forest_importance, std::vector<double>& forest_variance,
+    std::vector<double>& forest_importance_casewise, std::vector<std::mutex>& casewise_mutexes) {
+#endif
 
   size_t num_independent_variables = data->getNumCols();
 
@@ -218,26 +405,86 @@ void Tree::computePermutationImportance(std::vector<double>& forest_importance,
     accuracy_normal = computePredictionAccuracyInternal(NULL);
   }
 
-  prediction_terminal_nodeIDs.clear();
-  prediction_terminal_nodeIDs.resize(num_samples_oob, 0);
+  // Only samples reaching a node splitting on the permuted variable can change, all others keep their unpermuted
+  // terminal node. Per variable, the topmost nodes splitting on it and the OOB samples in each node.
+  std::vector<size_t> terminal_nodeIDs(prediction_terminal_nodeIDs);
+  std::vector<std::vector<size_t>> permutation_nodeIDs(num_independent_variables);
+  std::vector<size_t> node_samples;
+  std::vector<size_t> node_start;
+  std::vector<size_t> node_end;
+  sortOobSamplesByNode(terminal_nodeIDs, permutation_nodeIDs, node_samples, node_start, node_end);
+
+  // With additive accuracy, sum of OOB sample errors of the unpermuted tree
+  bool additive = hasAdditiveAccuracy();
+  std::vector<double> sample_errors_normal;
+  double sum_errors_normal = 0;
+  if (additive) {
+    sample_errors_normal.reserve(num_samples_oob);
+    for (size_t j = 0; j < num_samples_oob; ++j) {
+      sample_errors_normal.push_back(computeOobSampleError(j, terminal_nodeIDs[j]));
+      sum_errors_normal += sample_errors_normal[j];
+    }
+  }
 
   // Reserve space for permutations, initialize with oob_sampleIDs
   std::vector<size_t> permutations(oob_sampleIDs);
+  std::vector<std::pair<size_t, double>> casewise_differences;
 
   // Randomly permute for all independent variables
   for (size_t i = 0; i < num_independent_variables; ++i) {
 
     // Permute and compute prediction accuracy again for this permutation and save difference
-    permuteAndPredictOobSamples(i, permutations);
+    std::shuffle(permutations.begin(), permutations.end(), random_number_generator);
+    if (permutation_nodeIDs[i].empty() && (additive || importance_mode != IMP_PERM_CASEWISE)) {
+      // Variable not used for splitting, accuracy difference is 0
+      continue;
+    }
+
     double accuracy_permuted;
-    if (importance_mode == IMP_PERM_CASEWISE) {
-      accuracy_permuted = computePredictionAccuracyInternal(&prederr_shuf_casewise);
-      for (size_t j = 0; j < num_samples_oob; ++j) {
-        size_t pos = i * num_samples + oob_sampleIDs[j];
-        forest_importance_casewise[pos] += prederr_shuf_casewise[j] - prederr_normal_casewise[j];
+    if (additive) {
+      // Fused: drop changed samples only and accumulate the error differences in the same pass
+      double sum_errors_permuted = sum_errors_normal;
+      for (auto& nodeID : permutation_nodeIDs[i]) {
+        for (size_t pos = node_start[nodeID]; pos < node_end[nodeID]; ++pos) {
+          size_t j = node_samples[pos];
+          size_t permuted_nodeID = dropDownSamplePermuted(nodeID, i, oob_sampleIDs[j], permutations[j]);
+          if (permuted_nodeID != terminal_nodeIDs[j]) {
+            double error_difference = computeOobSampleError(j, permuted_nodeID) - sample_errors_normal[j];
+            sum_errors_permuted += error_difference;
+            if (importance_mode == IMP_PERM_CASEWISE) {
+              casewise_differences.emplace_back(oob_sampleIDs[j], error_difference);
+            }
+          }
+        }
       }
+      accuracy_permuted = 1.0 - sum_errors_permuted / (double) num_samples_oob;
     } else {
-      accuracy_permuted = computePredictionAccuracyInternal(NULL);
+      permuteAndPredictOobSamples(i, permutations, permutation_nodeIDs[i], node_samples, node_start, node_end);
+      if (importance_mode == IMP_PERM_CASEWISE) {
+        accuracy_permuted = computePredictionAccuracyInternal(&prederr_shuf_casewise);
+        for (size_t j = 0; j < num_samples_oob; ++j) {
+          casewise_differences.emplace_back(oob_sampleIDs[j], prederr_shuf_casewise[j] - prederr_normal_casewise[j]);
+        }
+      } else {
+        accuracy_permuted = computePredictionAccuracyInternal(NULL);
+      }
+
+      // Restore unpermuted terminal nodes
+      for (auto& nodeID : permutation_nodeIDs[i]) {
+        for (size_t pos = node_start[nodeID]; pos < node_end[nodeID]; ++pos) {
+          size_t j = node_samples[pos];
+          prediction_terminal_nodeIDs[j] = terminal_nodeIDs[j];
+        }
+      }
+    }
+
+    // Add casewise importance, only one tree at a time per variable
+    if (!casewise_differences.empty()) {
+#ifndef OLD_WIN_R_BUILD
+      std::lock_guard<std::mutex> lock(casewise_mutexes[i % casewise_mutexes.size()]);
+#endif
+      addCasewiseImportance(i, casewise_differences, forest_importance_casewise);
+      casewise_differences.clear();
     }
 
     double accuracy_difference = accuracy_normal - accuracy_permuted;
@@ -252,6 +499,14 @@ void Tree::computePermutationImportance(std::vector<double>& forest_importance,
   }
 }
 
+void Tree::addCasewiseImportance(size_t varID, const std::vector<std::pair<size_t, double>>& differences,
+    std::vector<double>& forest_importance_casewise) const {
+  double* importance = forest_importance_casewise.data() + varID * num_samples;
+  for (auto& difference : differences) {
+    importance[difference.first] += difference.second;
+  }
+}
+
 // #nocov start
 void Tree::appendToFile(std::ofstream& file) {
 
@@ -263,6 +518,21 @@ void Tree::appendToFile(std::ofstream& file) {
   // Call special functions for subclasses to save special fields.
   appendToFileInternal(file);
 }
+
+void Tree::appendToBinaryFile(BlockFileWriter& file) const {
+  file.writeUint64(num_prediction_nodes);
+  file.writeUint64(ordered_prediction_nodes);
+  file.writeArray(prediction_nodes, num_prediction_nodes);
+  appendToBinaryFileInternal(file);
+}
+
+void Tree::loadFromBinaryFile(MappedFile& file) {
+  num_prediction_nodes = file.nextUint64();
+  ordered_prediction_nodes = file.nextUint64();
+  prediction_nodes = file.nextArray<PredictionNode>(num_prediction_nodes);
+  loadFromBinaryFileInternal(file);
+  compilePredictionNodesInternal();
+}
 // #nocov end
 
 void Tree::createPossibleSplitVarSubset(std::vector<size_t>& result) {
@@ -275,14 +545,15 @@ void Tree::createPossibleSplitVarSubset(std::vector<size_t>& result) {
   }
 
   // Randomly add non-deterministic variables (according to weights if needed)
-  if (split_select_weights->empty()) {
+  if (split_select_alias_table->empty()) {
     if (deterministic_varIDs->empty()) {
       drawWithoutReplacement(result, random_number_generator, num_vars, mtry);
     } else {
       drawWithoutReplacementSkip(result, random_number_generator, num_vars, (*deterministic_varIDs), mtry);
     }
   } else {
-    drawWithoutReplacementWeighted(result, random_number_generator, num_vars, mtry, *split_select_weights);
+    split_select_drawn.resize(split_select_alias_table->size(), false);
+    drawWithoutReplacementWeighted(result, random_number_generator, *split_select_alias_table, split_select_drawn, mtry);
   }
 
   // Always use deterministic variables
@@ -291,14 +562,37 @@ void Tree::createPossibleSplitVarSubset(std::vector<size_t>& result) {
 
 bool Tree::splitNode(size_t nodeID) {
 
-  // Select random subset of variables to possibly split at
-  std::vector<size_t> possible_split_varIDs;
-  createPossibleSplitVarSubset(possible_split_varIDs);
+  // Select random subset of variables to possibly split at, drawn for the level if level-wise
+  possible_split_varIDs.clear();
+  if (level_wise) {
+    possible_split_varIDs = level_split_varIDs[nodeID - level_start];
+  } else {
+    createPossibleSplitVarSubset(possible_split_varIDs);
+  }
 
   // Call subclass method, sets split_varIDs and split_values
   bool stop = splitNodeInternal(nodeID, possible_split_varIDs);
+  if (level_wise) {
+    std::vector<std::vector<double>>().swap(level_histograms[nodeID - level_start]);
+  }
+
+  // Parent histograms not needed anymore after right child, own histograms only for child nodes
+  if (histogram_splitting) {
+    if (nodeID > 0 && child_nodeIDs[1][parent_nodeIDs[nodeID]] == nodeID) {
+      freeHistograms(parent_nodeIDs[nodeID]);
+    }
+    if (stop) {
+      freeHistograms(nodeID);
+    }
+  }
+
   if (stop) {
     // Terminal node
+    if (fused_oob) {
+      for (size_t pos = oob_start_pos[nodeID]; pos < oob_end_pos[nodeID]; ++pos) {
+        prediction_terminal_nodeIDs[oob_sample_positions[oob_node_sampleIDs[pos]]] = nodeID;
+      }
+    }
     return true;
   }
 
@@ -319,8 +613,39 @@ bool Tree::splitNode(size_t nodeID) {
   createEmptyNode();
   start_pos[right_child_nodeID] = end_pos[nodeID];
 
+  if (histogram_splitting) {
+    parent_nodeIDs[left_child_nodeID] = nodeID;
+    parent_nodeIDs[right_child_nodeID] = nodeID;
+  }
+
   // For each sample in node, assign to left or right child
-  if (data->isOrderedVariable(split_varID)) {
+  const size_t* nonzero_rows;
+  const double* nonzero_values;
+  size_t num_nonzeros;
+  if (data->isOrderedVariable(split_varID) && !sample_nodeIDs.empty()
+      && data->getNonzeros(split_varID, nonzero_rows, nonzero_values, num_nonzeros)
+      && num_nonzeros < end_pos[nodeID] - start_pos[nodeID]) {
+    // Sparse: mark the samples with nonzeros on the other side than the zeros
+    bool zeros_right = 0 > split_value;
+    for (size_t i = 0; i < num_nonzeros; ++i) {
+      size_t sampleID = nonzero_rows[i];
+      if (sample_nodeIDs[sampleID] == nodeID && (nonzero_values[i] > split_value) != zeros_right) {
+        sample_nodeIDs[sampleID] = right_child_nodeID;
+      }
+    }
+    size_t pos = start_pos[nodeID];
+    while (pos < start_pos[right_child_nodeID]) {
+      bool marked = sample_nodeIDs[sampleIDs[pos]] == right_child_nodeID;
+      if (marked == zeros_right) {
+        // If going to left, do nothing
+        ++pos;
+      } else {
+        // If going to right, move to right end
+        --start_pos[right_child_nodeID];
+        swapSamples(pos, start_pos[right_child_nodeID]);
+      }
+    }
+  } else if (data->isOrderedVariable(split_varID)) {
     // Ordered: left is <= splitval and right is > splitval
     size_t pos = start_pos[nodeID];
     while (pos < start_pos[right_child_nodeID]) {
@@ -331,7 +656,7 @@ bool Tree::splitNode(size_t nodeID) {
       } else {
         // If going to right, move to right end
         --start_pos[right_child_nodeID];
-        std::swap(sampleIDs[pos], sampleIDs[start_pos[right_child_nodeID]]);
+        swapSamples(pos, start_pos[right_child_nodeID]);
       }
     }
   } else {
@@ -350,7 +675,7 @@ bool Tree::splitNode(size_t nodeID) {
       } else {
         // If going to right, move to right end
         --start_pos[right_child_nodeID];
-        std::swap(sampleIDs[pos], sampleIDs[start_pos[right_child_nodeID]]);
+        swapSamples(pos, start_pos[right_child_nodeID]);
       }
     }
   }
@@ -359,10 +684,357 @@ bool Tree::splitNode(size_t nodeID) {
   end_pos[left_child_nodeID] = start_pos[right_child_nodeID];
   end_pos[right_child_nodeID] = end_pos[nodeID];
 
+  if (!sample_nodeIDs.empty()) {
+    for (size_t pos = start_pos[left_child_nodeID]; pos < end_pos[left_child_nodeID]; ++pos) {
+      sample_nodeIDs[sampleIDs[pos]] = left_child_nodeID;
+    }
+    for (size_t pos = start_pos[right_child_nodeID]; pos < end_pos[right_child_nodeID]; ++pos) {
+      sample_nodeIDs[sampleIDs[pos]] = right_child_nodeID;
+    }
+  }
+
+  if (fused_oob) {
+    splitOobSamples(nodeID);
+  }
+
   // No terminal node
   return false;
 }
 
+void Tree::splitOobSamples(size_t nodeID) {
+
+  // Non-permuted split variable, as in prediction
+  PredictionNode node;
+  node.split_value = split_values[nodeID];
+  node.is_ordered = data->isOrderedVariable(split_varIDs[nodeID]);
+  size_t varID = split_varIDs[nodeID];
+  const double* x = data->getRawX();
+
+  // Stable partition, left samples moved down in place and right samples to the buffer. Samples stay in the order of
+  // oob_sampleIDs in each node, so that columns are read in row order.
+  size_t start = oob_start_pos[nodeID];
+  size_t end = oob_end_pos[nodeID];
+  size_t* node_sampleIDs = oob_node_sampleIDs.data();
+  size_t* right_sampleIDs = oob_right_sampleIDs.data();
+  size_t num_left = 0;
+  size_t num_right = 0;
+  if (x && node.is_ordered) {
+    // Ordered from raw column, rows prefetched ahead since they are spread over the column
+    const double* column = x + varID * data->getNumRows();
+    for (size_t pos = start; pos < end; ++pos) {
+      size_t sampleID = node_sampleIDs[pos];
+#if defined(__GNUC__)
+      if (pos + OOB_PREFETCH_DISTANCE < end) {
+        __builtin_prefetch(column + node_sampleIDs[pos + OOB_PREFETCH_DISTANCE]);
+      }
+#endif
+      size_t right = !(column[sampleID] <= node.split_value);
+      node_sampleIDs[start + num_left] = sampleID;
+      right_sampleIDs[num_right] = sampleID;
+      num_left += 1 - right;
+      num_right += right;
+    }
+  } else {
+    for (size_t pos = start; pos < end; ++pos) {
+      size_t sampleID = node_sampleIDs[pos];
+      size_t right = getChildIndex(node, data->get_x(sampleID, varID));
+      node_sampleIDs[start + num_left] = sampleID;
+      right_sampleIDs[num_right] = sampleID;
+      num_left += 1 - right;
+      num_right += right;
+    }
+  }
+  size_t right_start_pos = start + num_left;
+  std::copy(right_sampleIDs, right_sampleIDs + num_right, node_sampleIDs + right_start_pos);
+
+  size_t left_child_nodeID = child_nodeIDs[0][nodeID];
+  size_t right_child_nodeID = child_nodeIDs[1][nodeID];
+  oob_start_pos[left_child_nodeID] = start;
+  oob_end_pos[left_child_nodeID] = right_start_pos;
+  oob_start_pos[right_child_nodeID] = right_start_pos;
+  oob_end_pos[right_child_nodeID] = end;
+}
+
+void Tree::gatherNodeBuffers() {
+  size_t num_response_cols = getNumNodeResponseColumns();
+  size_t num_positions = sampleIDs.size();
+  node_responses.resize(num_response_cols * num_positions);
+  for (size_t col = 0; col < num_response_cols; ++col) {
+    for (size_t pos = 0; pos < num_positions; ++pos) {
+      node_responses[col * num_positions + pos] = getResponse(sampleIDs[pos], col);
+    }
+  }
+
+  bool has_snps = data->getNumColsNoSnp() < data->getNumCols();
+  if (data->isSparse() || has_snps || level_wise) {
+    sample_counts.assign(num_samples, 0);
+    for (auto& sampleID : sampleIDs) {
+      ++sample_counts[sampleID];
+    }
+  }
+  if (data->isSparse()) {
+    sample_nodeIDs.assign(num_samples, std::numeric_limits<size_t>::max());
+    for (auto& sampleID : sampleIDs) {
+      sample_nodeIDs[sampleID] = 0;
+    }
+  }
+  snp_bitsets_nodeID = std::numeric_limits<size_t>::max();
+  snp_num_planes = 0;
+  if (has_snps) {
+    uint max_count = *std::max_element(sample_counts.begin(), sample_counts.end());
+    for (; max_count > 0; max_count >>= 2) {
+      ++snp_num_planes;
+    }
+  }
+
+  // GWA and permuted columns are still read from data
+  if (gather_columns && data->isSorted()) {
+    node_index_columns.resize(data->getNumColsNoSnp());
+    for (size_t varID = 0; varID < node_index_columns.size(); ++varID) {
+      std::vector<uint32_t>& column = node_index_columns[varID];
+      column.resize(num_positions);
+      data->forEachIndex(varID, sampleIDs, 0, num_positions, [&](size_t pos, size_t index) {
+        column[pos] = index;
+      });
+    }
+  }
+}
+
+bool Tree::getNodeNonzeros(size_t nodeID, size_t varID, std::vector<std::pair<double, size_t>>& nonzeros) const {
+  const size_t* rows;
+  const double* values;
+  size_t num_nonzeros;
+  if (sample_nodeIDs.empty() || !data->getNonzeros(varID, rows, values, num_nonzeros)
+      || num_nonzeros >= end_pos[nodeID] - start_pos[nodeID]) {
+    return false;
+  }
+
+  nonzeros.clear();
+  for (size_t i = 0; i < num_nonzeros; ++i) {
+    if (sample_nodeIDs[rows[i]] == nodeID) {
+      nonzeros.emplace_back(values[i], rows[i]);
+    }
+  }
+  std::sort(nonzeros.begin(), nonzeros.end());
+  return true;
+}
+
+std::vector<size_t> Tree::orderFactorLevels(const std::vector<double>& factor_levels,
+    const std::vector<double>& scores) const {
+  std::vector<size_t> factorIDs;
+  factorIDs.reserve(factor_levels.size());
+  for (auto& level : factor_levels) {
+    factorIDs.push_back(floor(level) - 1);
+  }
+  std::stable_sort(factorIDs.begin(), factorIDs.end(), [&](size_t i1, size_t i2) {return scores[i1] < scores[i2];});
+  return factorIDs;
+}
+
+void Tree::buildSnpBitsets(size_t nodeID, const std::vector<size_t>& possible_split_varIDs, size_t num_sets,
+    const std::vector<uint>* classIDs) {
+  snp_bitsets_nodeID = std::numeric_limits<size_t>::max();
+  size_t num_words = data->getNumSnpWords() * num_sets * snp_num_planes;
+  size_t min_samples_per_word = classIDs == 0 ? SNP_SUM_MIN_SAMPLES_PER_WORD : SNP_COUNT_MIN_SAMPLES_PER_WORD;
+  if (memory_saving_splitting || num_words == 0
+      || end_pos[nodeID] - start_pos[nodeID] < num_words * min_samples_per_word
+      || std::none_of(possible_split_varIDs.begin(), possible_split_varIDs.end(), [&](size_t varID) {
+        return data->isSnpColumn(varID);
+      })) {
+    return;
+  }
+
+  // Copies of a sample are all in the node, set the digits of its count once per copy
+  snp_bitsets.assign(num_words, 0);
+  for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
+    size_t sampleID = sampleIDs[pos];
+    size_t set = classIDs == 0 ? 0 : (*classIDs)[sampleID];
+    uint64_t* digits = &snp_bitsets[((sampleID / 32) * num_sets + set) * snp_num_planes];
+    size_t bit = Data::getSnpWordBit(sampleID);
+    for (uint count = sample_counts[sampleID], plane = 0; count > 0; count >>= 2, ++plane) {
+      digits[plane] |= (uint64_t) (count & 3) << bit;
+    }
+  }
+  snp_bitsets_nodeID = nodeID;
+}
+
+void Tree::countSnpClasses(size_t varID, size_t num_classes, const std::vector<size_t>& class_counts,
+    std::vector<size_t>& counter_per_class, std::vector<size_t>& counter) const {
+  std::vector<size_t> genotype_counts(2 * num_classes);
+  data->countSnpGenotypes(varID, snp_bitsets.data(), num_classes, snp_num_planes, genotype_counts.data());
+
+  size_t index[3] = { data->getSnpIndex(varID, 0), data->getSnpIndex(varID, 1), data->getSnpIndex(varID, 2) };
+  for (size_t classID = 0; classID < num_classes; ++classID) {
+    size_t count1 = genotype_counts[2 * classID];
+    size_t count2 = genotype_counts[2 * classID + 1];
+    size_t count0 = class_counts[classID] - count1 - count2;
+    counter_per_class[index[0] * num_classes + classID] = count0;
+    counter_per_class[index[1] * num_classes + classID] = count1;
+    counter_per_class[index[2] * num_classes + classID] = count2;
+    counter[index[0]] += count0;
+    counter[index[1]] += count1;
+    counter[index[2]] += count2;
+  }
+}
+
+void Tree::sumSnpResponses(size_t varID, double sum_node, size_t num_samples_node, std::vector<size_t>& counter,
+    std::vector<double>& sums) const {
+  size_t genotype_counts[2] = { 0, 0 };
+  double genotype_sums[2] = { 0, 0 };
+  data->sumSnpGenotypes(varID, snp_bitsets.data(), snp_num_planes, sample_counts.data(), responses, genotype_counts,
+      genotype_sums);
+
+  size_t index[3] = { data->getSnpIndex(varID, 0), data->getSnpIndex(varID, 1), data->getSnpIndex(varID, 2) };
+  counter[index[0]] = num_samples_node - genotype_counts[0] - genotype_counts[1];
+  counter[index[1]] = genotype_counts[0];
+  counter[index[2]] = genotype_counts[1];
+  sums[index[0]] = sum_node - genotype_sums[0] - genotype_sums[1];
+  sums[index[1]] = genotype_sums[0];
+  sums[index[2]] = genotype_sums[1];
+}
+
+void Tree::swapSamples(size_t pos1, size_t pos2) {
+  std::swap(sampleIDs[pos1], sampleIDs[pos2]);
+  size_t num_positions = sampleIDs.size();
+  for (size_t offset = 0; offset < node_responses.size(); offset += num_positions) {
+    std::swap(node_responses[offset + pos1], node_responses[offset + pos2]);
+  }
+  for (auto& column : node_index_columns) {
+    std::swap(column[pos1], column[pos2]);
+  }
+}
+
+const std::vector<double>* Tree::findHistogram(size_t nodeID, size_t varID) const {
+  const std::vector<size_t>& varIDs = histogram_varIDs[nodeID];
+  auto it = std::find(varIDs.begin(), varIDs.end(), varID);
+  if (it == varIDs.end()) {
+    return 0;
+  }
+  return &histograms[nodeID][it - varIDs.begin()];
+}
+
+void Tree::prepareLevel(size_t level_start, size_t level_end) {
+  this->level_start = level_start;
+  size_t num_level_nodes = level_end - level_start;
+  level_split_varIDs.assign(num_level_nodes, std::vector<size_t>());
+  level_histograms.assign(num_level_nodes, std::vector<std::vector<double>>());
+  for (size_t i = 0; i < num_level_nodes; ++i) {
+    createPossibleSplitVarSubset(level_split_varIDs[i]);
+  }
+
+  // Nodes of the last level are not split
+  if (!histogram_splitting || (max_depth > 0 && depth >= max_depth)) {
+    return;
+  }
+
+  // Histograms of binned candidates of nodes large enough, per variable. Larger siblings are computed from the parent
+  // histogram when split, as in computeHistogram().
+  size_t num_vars = data->getNumCols();
+  if (importance_mode == IMP_GINI_CORRECTED) {
+    num_vars += data->getNumCols();
+  }
+  std::vector<std::vector<std::pair<size_t, size_t>>> requests(num_vars);
+  std::vector<size_t> num_requested_samples(num_vars);
+  size_t min_stream_node_size = MIN_HISTOGRAM_NODE_SIZE_PER_BIN * data->getMaxNumBins();
+  for (size_t i = 0; i < num_level_nodes; ++i) {
+    size_t nodeID = level_start + i;
+    size_t num_samples_node = end_pos[nodeID] - start_pos[nodeID];
+    if (num_samples_node <= min_node_size || num_samples_node < min_stream_node_size) {
+      continue;
+    }
+    size_t parent_nodeID = parent_nodeIDs[nodeID];
+    size_t sibling_nodeID = child_nodeIDs[0][parent_nodeID] == nodeID ?
+        child_nodeIDs[1][parent_nodeID] : child_nodeIDs[0][parent_nodeID];
+    bool larger_sibling = nodeID > 0 && end_pos[sibling_nodeID] - start_pos[sibling_nodeID] < num_samples_node;
+    const std::vector<size_t>& varIDs = level_split_varIDs[i];
+    for (size_t j = 0; j < varIDs.size(); ++j) {
+      if (larger_sibling && findHistogram(parent_nodeID, varIDs[j]) != 0) {
+        continue;
+      }
+      if (data->isOrderedVariable(varIDs[j]) && data->getNumBins(varIDs[j]) > 0) {
+        requests[varIDs[j]].push_back(std::make_pair(i, j));
+        num_requested_samples[varIDs[j]] += num_samples_node;
+      }
+    }
+  }
+
+  // Stream columns with enough requested samples, the others are computed per node when split
+  level_sample_nodes.clear();
+  for (size_t varID = 0; varID < num_vars; ++varID) {
+    if (!requests[varID].empty() && num_requested_samples[varID] * LEVEL_HISTOGRAM_ROWS_PER_SAMPLE >= num_samples) {
+      if (level_sample_nodes.empty()) {
+        assignLevelSampleNodes(requests);
+      }
+      for (auto& request : requests[varID]) {
+        level_histograms[request.first].resize(level_split_varIDs[request.first].size());
+      }
+      computeLevelHistogramsInternal(varID, requests[varID]);
+    }
+  }
+}
+
+void Tree::assignLevelSampleNodes(const std::vector<std::vector<std::pair<size_t, size_t>>>& requests) {
+  size_t num_level_nodes = level_split_varIDs.size();
+  std::vector<bool> requested(num_level_nodes, false);
+  for (auto& var_requests : requests) {
+    for (auto& request : var_requests) {
+      requested[request.first] = true;
+    }
+  }
+
+  // Samples of nodes without requests are added to the scratch histogram
+  level_sample_nodes.assign(num_samples, num_level_nodes);
+  for (size_t i = 0; i < num_level_nodes; ++i) {
+    if (requested[i]) {
+      for (size_t pos = start_pos[level_start + i]; pos < end_pos[level_start + i]; ++pos) {
+        level_sample_nodes[sampleIDs[pos]] = i;
+      }
+    }
+  }
+}
+
+const std::vector<double>* Tree::findLevelHistogram(size_t nodeID, size_t varID) const {
+  if (nodeID < level_start || nodeID >= level_start + level_histograms.size()) {
+    return 0;
+  }
+  const std::vector<std::vector<double>>& node_histograms = level_histograms[nodeID - level_start];
+  if (node_histograms.empty()) {
+    return 0;
+  }
+  const std::vector<size_t>& varIDs = level_split_varIDs[nodeID - level_start];
+  size_t i = std::find(varIDs.begin(), varIDs.end(), varID) - varIDs.begin();
+  if (i == varIDs.size() || node_histograms[i].empty()) {
+    return 0;
+  }
+  return &node_histograms[i];
+}
+
+void Tree::saveHistograms(size_t nodeID, const std::vector<size_t>& varIDs,
+    std::vector<std::vector<double>>& histograms) {
+  if (end_pos[nodeID] - start_pos[nodeID] >= MIN_HISTOGRAM_NODE_SIZE_PER_BIN * data->getMaxNumBins()) {
+    histogram_varIDs[nodeID] = varIDs;
+    this->histograms[nodeID].swap(histograms);
+  }
+}
+
+void Tree::freeHistograms(size_t nodeID) {
+  std::vector<size_t>().swap(histogram_varIDs[nodeID]);
+  std::vector<std::vector<double>>().swap(histograms[nodeID]);
+}
+
+std::vector<size_t> Tree::orderNodeSamples(size_t nodeID, size_t varID, const std::vector<double>& x) const {
+  if (!data->isSorted()) {
+    return order(x, false);
+  }
+
+  // Index in unique values (or GWA value) has the same order as the values
+  std::vector<size_t> keys;
+  keys.reserve(end_pos[nodeID] - start_pos[nodeID]);
+  forEachNodeIndex(nodeID, varID, [&](size_t pos, size_t index) {
+    keys.push_back(index);
+  });
+  return orderRadix(keys, data->getNumUniqueDataValues(varID));
+}
+
 void Tree::createEmptyNode() {
   split_varIDs.push_back(0);
   split_values.push_back(0);
@@ -370,61 +1042,319 @@ void Tree::createEmptyNode() {
   child_nodeIDs[1].push_back(0);
   start_pos.push_back(0);
   end_pos.push_back(0);
+  if (fused_oob) {
+    oob_start_pos.push_back(0);
+    oob_end_pos.push_back(0);
+  }
+  if (histogram_splitting) {
+    parent_nodeIDs.push_back(0);
+    histogram_varIDs.push_back(std::vector<size_t>());
+    histograms.push_back(std::vector<std::vector<double>>());
+  }
 
   createEmptyNodeInternal();
 }
 
-size_t Tree::dropDownSamplePermuted(size_t permuted_varID, size_t sampleID, size_t permuted_sampleID) {
+size_t Tree::dropDownSamplePermuted(size_t nodeID, size_t permuted_varID, size_t sampleID, size_t permuted_sampleID) {
 
-  // Start in root and drop down
-  size_t nodeID = 0;
-  while (child_nodeIDs[0][nodeID] != 0 || child_nodeIDs[1][nodeID] != 0) {
+  // Start in given node and drop down
+  while (!prediction_nodes[nodeID].is_terminal) {
+    const PredictionNode& node = prediction_nodes[nodeID];
 
     // Permute if variable is permutation variable
-    size_t split_varID = split_varIDs[nodeID];
     size_t sampleID_final = sampleID;
-    if (split_varID == permuted_varID) {
+    if (node.split_varID == permuted_varID) {
       sampleID_final = permuted_sampleID;
     }
 
     // Move to child
-    double value = data->get_x(sampleID_final, split_varID);
-    if (data->isOrderedVariable(split_varID)) {
-      if (value <= split_values[nodeID]) {
-        // Move to left child
-        nodeID = child_nodeIDs[0][nodeID];
+    double value = data->get_x(sampleID_final, node.split_varID);
+    nodeID = node.child_nodeIDs[getChildIndex(node, value)];
+  }
+  return nodeID;
+}
+
+void Tree::predictSamplesOrdered(const double* x, size_t num_rows, const size_t* sampleIDs, size_t start, size_t end,
+    size_t* terminal_nodeIDs) const {
+
+  size_t rows[PREDICTION_GROUP_SIZE];
+  size_t nodeIDs[PREDICTION_GROUP_SIZE];
+  size_t i = start;
+  for (; i + PREDICTION_GROUP_SIZE <= end; i += PREDICTION_GROUP_SIZE) {
+    for (size_t k = 0; k < PREDICTION_GROUP_SIZE; ++k) {
+      if (sampleIDs) {
+        rows[k] = sampleIDs[i + k];
       } else {
-        // Move to right child
-        nodeID = child_nodeIDs[1][nodeID];
+        rows[k] = i + k;
       }
-    } else {
-      size_t factorID = floor(value) - 1;
-      size_t splitID = floor(split_values[nodeID]);
+    }
 
-      // Left if 0 found at position factorID
-      if (!(splitID & (1ULL << factorID))) {
-        // Move to left child
-        nodeID = child_nodeIDs[0][nodeID];
+    dropDownGroupOrdered(x, num_rows, rows, nodeIDs);
+    for (size_t k = 0; k < PREDICTION_GROUP_SIZE; ++k) {
+      terminal_nodeIDs[i - start + k] = nodeIDs[k];
+    }
+  }
+
+  // Drop remaining samples one by one, e.g. for single sample prediction
+  for (; i < end; ++i) {
+    size_t row = sampleIDs ? sampleIDs[i] : i;
+    size_t nodeID = 0;
+    while (!prediction_nodes[nodeID].is_terminal) {
+      const PredictionNode& node = prediction_nodes[nodeID];
+      nodeID = node.child_nodeIDs[!(x[node.split_varID * num_rows + row] <= node.split_value)];
+    }
+    terminal_nodeIDs[i - start] = nodeID;
+  }
+}
+
+void Tree::dropDownGroupOrdered(const double* x, size_t num_rows, const size_t* rows, size_t* nodeIDs) const {
+#ifdef __AVX2__
+  static_assert(PREDICTION_GROUP_SIZE == 8, "AVX2 prediction kernel expects groups of 8 samples.");
+  static_assert(sizeof(PredictionNode) == 24 && offsetof(PredictionNode, split_varID) == 8
+      && offsetof(PredictionNode, child_nodeIDs) == 12, "Unexpected layout of prediction nodes.");
+
+  if (num_rows <= std::numeric_limits<uint32_t>::max()) {
+    // Gather node fields with 64 bit loads: value at 0, varID and left child at 8, right child at 16
+    const char* base = reinterpret_cast<const char*>(prediction_nodes);
+    const __m256i lower_mask = _mm256_set1_epi64x(0xFFFFFFFF);
+    const __m256i num_rows_vec = _mm256_set1_epi64x(num_rows);
+    __m256i row_vec[2];
+    __m256i node_vec[2];
+    for (size_t v = 0; v < 2; ++v) {
+      row_vec[v] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows + 4 * v));
+      node_vec[v] = _mm256_setzero_si256();
+    }
+
+    // Move all samples one level down until all in terminal nodes
+    bool moved = true;
+    while (moved) {
+      moved = false;
+      for (size_t v = 0; v < 2; ++v) {
+        __m256i idx = _mm256_add_epi64(node_vec[v], _mm256_slli_epi64(node_vec[v], 1));
+        __m256d split_value = _mm256_i64gather_pd(reinterpret_cast<const double*>(base), idx, 8);
+        __m256i var_left = _mm256_i64gather_epi64(reinterpret_cast<const long long*>(base + 8), idx, 8);
+        __m256i right = _mm256_i64gather_epi64(reinterpret_cast<const long long*>(base + 16), idx, 8);
+        __m256i varID = _mm256_and_si256(var_left, lower_mask);
+        __m256i left = _mm256_srli_epi64(var_left, 32);
+        right = _mm256_and_si256(right, lower_mask);
+
+        // Right if not value <= split value
+        __m256i pos = _mm256_add_epi64(_mm256_mul_epu32(varID, num_rows_vec), row_vec[v]);
+        __m256d value = _mm256_i64gather_pd(x, pos, 8);
+        __m256i go_right = _mm256_castpd_si256(_mm256_cmp_pd(value, split_value, _CMP_NLE_UQ));
+        __m256i next = _mm256_blendv_epi8(left, right, go_right);
+
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi64(next, node_vec[v])) != -1) {
+          moved = true;
+        }
+        node_vec[v] = next;
+      }
+    }
+
+    for (size_t v = 0; v < 2; ++v) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(nodeIDs + 4 * v), node_vec[v]);
+    }
+    return;
+  }
+#endif
+
+  // Move all samples one level down until all in terminal nodes
+  uint32_t group_nodeIDs[PREDICTION_GROUP_SIZE] = { };
+  bool moved = true;
+  while (moved) {
+    moved = false;
+    for (size_t k = 0; k < PREDICTION_GROUP_SIZE; ++k) {
+      const PredictionNode& node = prediction_nodes[group_nodeIDs[k]];
+      double value = x[node.split_varID * num_rows + rows[k]];
+      uint32_t next = node.child_nodeIDs[!(value <= node.split_value)];
+      moved = moved || next != group_nodeIDs[k];
+      group_nodeIDs[k] = next;
+    }
+  }
+  std::copy(group_nodeIDs, group_nodeIDs + PREDICTION_GROUP_SIZE, nodeIDs);
+}
+
+void Tree::predictSamplesOrderedFloat(const float* x, size_t num_rows, size_t num_cols, const size_t* sampleIDs,
+    size_t start, size_t end, size_t* terminal_nodeIDs) const {
+
+  const PredictionNodeFloat* nodes = float_prediction_nodes.data();
+  size_t rows[PREDICTION_GROUP_SIZE];
+  size_t nodeIDs[PREDICTION_GROUP_SIZE];
+  size_t i = start;
+  for (; i + PREDICTION_GROUP_SIZE <= end; i += PREDICTION_GROUP_SIZE) {
+    for (size_t k = 0; k < PREDICTION_GROUP_SIZE; ++k) {
+      if (sampleIDs) {
+        rows[k] = sampleIDs[i + k];
       } else {
-        // Move to right child
-        nodeID = child_nodeIDs[1][nodeID];
+        rows[k] = i + k;
       }
     }
 
+    dropDownGroupOrderedFloat(x, num_rows, num_cols, rows, nodeIDs);
+    for (size_t k = 0; k < PREDICTION_GROUP_SIZE; ++k) {
+      terminal_nodeIDs[i - start + k] = nodeIDs[k];
+    }
   }
-  return nodeID;
+
+  // Drop remaining samples one by one, terminal nodes point to themselves
+  for (; i < end; ++i) {
+    size_t row = sampleIDs ? sampleIDs[i] : i;
+    uint32_t nodeID = 0;
+    while (nodes[nodeID].child_nodeIDs[0] != nodeID) {
+      const PredictionNodeFloat& node = nodes[nodeID];
+      nodeID = node.child_nodeIDs[!(x[node.split_varID * num_rows + row] <= node.split_value)];
+    }
+    terminal_nodeIDs[i - start] = nodeID;
+  }
+}
+
+void Tree::dropDownGroupOrderedFloat(const float* x, size_t num_rows, size_t num_cols, const size_t* rows,
+    size_t* nodeIDs) const {
+  const PredictionNodeFloat* nodes = float_prediction_nodes.data();
+#ifdef __AVX2__
+  static_assert(PREDICTION_GROUP_SIZE == 8, "AVX2 prediction kernel expects groups of 8 samples.");
+  static_assert(sizeof(PredictionNodeFloat) == 16 && offsetof(PredictionNodeFloat, split_varID) == 4
+      && offsetof(PredictionNodeFloat, child_nodeIDs) == 8, "Unexpected layout of float prediction nodes.");
+
+  // All 8 samples in one register with 32 bit gather indices
+  size_t max_index = std::numeric_limits<int32_t>::max();
+  if (num_rows * num_cols <= max_index && float_prediction_nodes.size() <= max_index / 4) {
+    const int* base = reinterpret_cast<const int*>(nodes);
+    const __m256i num_rows_vec = _mm256_set1_epi32(num_rows);
+    alignas(32) int32_t row_values[PREDICTION_GROUP_SIZE];
+    for (size_t k = 0; k < PREDICTION_GROUP_SIZE; ++k) {
+      row_values[k] = rows[k];
+    }
+    const __m256i row_vec = _mm256_load_si256(reinterpret_cast<const __m256i*>(row_values));
+    __m256i node_vec = _mm256_setzero_si256();
+
+    // Move all samples one level down until all in terminal nodes
+    while (true) {
+      __m256i idx = _mm256_slli_epi32(node_vec, 2);
+      __m256 split_value = _mm256_i32gather_ps(reinterpret_cast<const float*>(base), idx, 4);
+      __m256i varID = _mm256_i32gather_epi32(base + 1, idx, 4);
+      __m256i left = _mm256_i32gather_epi32(base + 2, idx, 4);
+      __m256i right = _mm256_i32gather_epi32(base + 3, idx, 4);
+
+      // Right if not value <= split value
+      __m256i pos = _mm256_add_epi32(_mm256_mullo_epi32(varID, num_rows_vec), row_vec);
+      __m256 value = _mm256_i32gather_ps(x, pos, 4);
+      __m256i go_right = _mm256_castps_si256(_mm256_cmp_ps(value, split_value, _CMP_NLE_UQ));
+      __m256i next = _mm256_blendv_epi8(left, right, go_right);
+
+      bool moved = _mm256_movemask_epi8(_mm256_cmpeq_epi32(next, node_vec)) != -1;
+      node_vec = next;
+      if (!moved) {
+        break;
+      }
+    }
+
+    alignas(32) uint32_t group_nodeIDs[PREDICTION_GROUP_SIZE];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(group_nodeIDs), node_vec);
+    std::copy(group_nodeIDs, group_nodeIDs + PREDICTION_GROUP_SIZE, nodeIDs);
+    return;
+  }
+#endif
+
+  // Move all samples one level down until all in terminal nodes
+  uint32_t group_nodeIDs[PREDICTION_GROUP_SIZE] = { };
+  bool moved = true;
+  while (moved) {
+    moved = false;
+    for (size_t k = 0; k < PREDICTION_GROUP_SIZE; ++k) {
+      const PredictionNodeFloat& node = nodes[group_nodeIDs[k]];
+      float value = x[node.split_varID * num_rows + rows[k]];
+      uint32_t next = node.child_nodeIDs[!(value <= node.split_value)];
+      moved = moved || next != group_nodeIDs[k];
+      group_nodeIDs[k] = next;
+    }
+  }
+  std::copy(group_nodeIDs, group_nodeIDs + PREDICTION_GROUP_SIZE, nodeIDs);
 }
 
-void Tree::permuteAndPredictOobSamples(size_t permuted_varID, std::vector<size_t>& permutations) {
+void Tree::sortOobSamplesByNode(const std::vector<size_t>& terminal_nodeIDs,
+    std::vector<std::vector<size_t>>& permutation_nodeIDs, std::vector<size_t>& node_samples,
+    std::vector<size_t>& node_start, std::vector<size_t>& node_end) {
+
+  // Number nodes in depth-first order, the nodes of a subtree are then numbered consecutively
+  size_t num_nodes = num_prediction_nodes;
+  std::vector<size_t> node_order(num_nodes, 0);
+  std::vector<size_t> subtree_end(num_nodes, 0);
+  std::vector<size_t> parent_nodeIDs(num_nodes, 0);
+  std::vector<size_t> stack;
+  stack.push_back(0);
+  size_t next_order = 0;
+  while (!stack.empty()) {
+    size_t nodeID = stack.back();
+    stack.pop_back();
+    node_order[nodeID] = next_order++;
+    const PredictionNode& node = prediction_nodes[nodeID];
+    if (!node.is_terminal) {
+      for (size_t k = 2; k-- > 0;) {
+        parent_nodeIDs[node.child_nodeIDs[k]] = nodeID;
+        stack.push_back(node.child_nodeIDs[k]);
+      }
+    }
+  }
 
-  // Permute OOB sample
-  //std::vector<size_t> permutations(oob_sampleIDs);
-  std::shuffle(permutations.begin(), permutations.end(), random_number_generator);
+  // Subtree end is the largest order in the subtree plus one, children have larger order than their parents
+  std::vector<size_t> nodes_by_order(num_nodes);
+  for (size_t nodeID = 0; nodeID < num_nodes; ++nodeID) {
+    nodes_by_order[node_order[nodeID]] = nodeID;
+    subtree_end[nodeID] = node_order[nodeID] + 1;
+  }
+  for (size_t k = num_nodes; k-- > 1;) {
+    size_t nodeID = nodes_by_order[k];
+    size_t parentID = parent_nodeIDs[nodeID];
+    subtree_end[parentID] = std::max(subtree_end[parentID], subtree_end[nodeID]);
+  }
 
-  // For each sample, drop down the tree and add prediction
+  // Sort OOB samples by order of their terminal node, the samples reaching a node are then in one range
+  std::vector<size_t> num_before(num_nodes + 1, 0);
+  for (size_t i = 0; i < num_samples_oob; ++i) {
+    ++num_before[node_order[terminal_nodeIDs[i]] + 1];
+  }
+  std::partial_sum(num_before.begin(), num_before.end(), num_before.begin());
+  node_samples.resize(num_samples_oob);
+  std::vector<size_t> next_pos(num_before.begin(), num_before.end() - 1);
   for (size_t i = 0; i < num_samples_oob; ++i) {
-    size_t nodeID = dropDownSamplePermuted(permuted_varID, oob_sampleIDs[i], permutations[i]);
-    prediction_terminal_nodeIDs[i] = nodeID;
+    node_samples[next_pos[node_order[terminal_nodeIDs[i]]]++] = i;
+  }
+  node_start.resize(num_nodes);
+  node_end.resize(num_nodes);
+  for (size_t nodeID = 0; nodeID < num_nodes; ++nodeID) {
+    node_start[nodeID] = num_before[node_order[nodeID]];
+    node_end[nodeID] = num_before[subtree_end[nodeID]];
+  }
+
+  // Topmost nodes splitting on each variable, no need to start again in nodes below
+  for (size_t nodeID = 0; nodeID < num_nodes; ++nodeID) {
+    const PredictionNode& node = prediction_nodes[nodeID];
+    if (node.is_terminal || node_start[nodeID] == node_end[nodeID]) {
+      continue;
+    }
+    bool topmost = true;
+    for (size_t ancestorID = nodeID; ancestorID != 0 && topmost;) {
+      ancestorID = parent_nodeIDs[ancestorID];
+      topmost = prediction_nodes[ancestorID].split_varID != node.split_varID;
+    }
+    if (topmost) {
+      permutation_nodeIDs[node.split_varID].push_back(nodeID);
+    }
+  }
+}
+
+void Tree::permuteAndPredictOobSamples(size_t permuted_varID, const std::vector<size_t>& permutations,
+    const std::vector<size_t>& start_nodeIDs, const std::vector<size_t>& node_samples,
+    const std::vector<size_t>& node_start, const std::vector<size_t>& node_end) {
+
+  // For each sample in a node splitting on the permuted variable, drop down from there
+  for (auto& nodeID : start_nodeIDs) {
+    for (size_t pos = node_start[nodeID]; pos < node_end[nodeID]; ++pos) {
+      size_t i = node_samples[pos];
+      prediction_terminal_nodeIDs[i] = dropDownSamplePermuted(nodeID, permuted_varID, oob_sampleIDs[i],
+          permutations[i]);
+    }
   }
 }
 
@@ -472,14 +1402,12 @@ void Tree::bootstrapWeighted() {
   sampleIDs.reserve(num_samples_inbag);
   oob_sampleIDs.reserve(num_samples * (exp(-(*sample_fraction)[0]) + 0.1));
 
-  std::discrete_distribution<> weighted_dist(case_weights->begin(), case_weights->end());
-
   // Start with all samples OOB
   inbag_counts.resize(num_samples, 0);
 
   // Draw num_samples samples with replacement (n out of n) as inbag and mark as not OOB
   for (size_t s = 0; s < num_samples_inbag; ++s) {
-    size_t draw = weighted_dist(random_number_generator);
+    size_t draw = case_weights_alias_table->draw(random_number_generator);
     sampleIDs.push_back(draw);
     ++inbag_counts[draw];
   }
@@ -526,7 +1454,9 @@ void Tree::bootstrapWithoutReplacementWeighted() {
 
   // Use fraction (default 63.21%) of the samples
   size_t num_samples_inbag = (size_t) num_samples * (*sample_fraction)[0];
-  drawWithoutReplacementWeighted(sampleIDs, random_number_generator, num_samples - 1, num_samples_inbag, *case_weights);
+  std::vector<bool> drawn(num_samples, false);
+  drawWithoutReplacementWeighted(sampleIDs, random_number_generator, *case_weights_alias_table, drawn,
+      num_samples_inbag);
 
   // All observation are 0 or 1 times inbag
   inbag_counts.resize(num_samples, 0);
@@ -13,17 +13,45 @@
 #define TREE_H_
 
 #include <vector>
+#include <algorithm>
 #include <random>
 #include <iostream>
 #include <stdexcept>
+#include <cstdint>
+#include <cmath>
+#ifndef OLD_WIN_R_BUILD
+#include <mutex>
+#include <atomic>
+#endif
 
 #include "globals.h"
 #include "Data.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "AliasTable.h"
 
 namespace ranger {
 
 class Tree {
 public:
+  // Packed node record used for prediction, built from the node vectors by compilePredictionNodes()
+  // Terminal nodes point to themselves
+  struct PredictionNode {
+    double split_value;
+    uint32_t split_varID;
+    uint32_t child_nodeIDs[2];
+    bool is_terminal;
+    bool is_ordered;
+  };
+
+  // Float32 copy of a prediction node for float data, only for ordered split variables. The split value is rounded
+  // down to the next float, so that value <= split value is decided as with the double node for all float values.
+  struct PredictionNodeFloat {
+    float split_value;
+    uint32_t split_varID;
+    uint32_t child_nodeIDs[2];
+  };
+
   Tree();
 
   // Create from loaded forest
@@ -36,12 +64,14 @@ public:
   Tree& operator=(const Tree&) = delete;
 
   void init(const Data* data, uint mtry, size_t num_samples, uint seed, std::vector<size_t>* deterministic_varIDs,
-      std::vector<double>* split_select_weights, ImportanceMode importance_mode, uint min_node_size,
+      const AliasTable* split_select_alias_table, ImportanceMode importance_mode, uint min_node_size,
       bool sample_with_replacement, bool memory_saving_splitting, SplitRule splitrule,
-      std::vector<double>* case_weights, std::vector<size_t>* manual_inbag, bool keep_inbag,
+      std::vector<double>* case_weights, const AliasTable* case_weights_alias_table,
+      std::vector<size_t>* manual_inbag, bool keep_inbag,
       std::vector<double>* sample_fraction, double alpha, double minprop, bool holdout, uint num_random_splits,
       uint max_depth, std::vector<double>* regularization_factor, bool regularization_usedepth,
-      std::vector<bool>* split_varIDs_used);
+      std::vector<bool>* split_varIDs_used, uint num_split_threads, bool histogram_splitting, bool gather_columns,
+      bool sort_levels, bool level_wise, bool fused_oob);
 
   virtual void allocateMemory() = 0;
 
@@ -49,12 +79,49 @@ public:
 
   void predict(const Data* prediction_data, bool oob_prediction);
 
+  // Predict samples start..end-1 only, allocatePredictMemory() has to be called before
+  void allocatePredictMemory(size_t num_samples_predict);
+  void predictSamples(const Data* prediction_data, bool oob_prediction, size_t start, size_t end);
+
+  // Predict samples start..end-1 without changing the tree, the terminal node of sample i is written to
+  // terminal_nodeIDs[i - start]
+  void predictSamples(const Data* prediction_data, size_t start, size_t end, size_t* terminal_nodeIDs) const;
+
+  // Build packed prediction nodes, call after growing or loading the tree
+  void compilePredictionNodes(const Data* data);
+
+  // Build float32 prediction nodes from the prediction nodes, used for float data if all split variables are ordered
+  void compileFloatPredictionNodes();
+
+  // Free the prediction nodes built in memory and the node vectors except split_values (terminal predictions) if
+  // float32 prediction nodes were built. Afterwards only float data can be predicted.
+  void releaseDoublePredictionNodes();
+
+  // Called when the prediction nodes are built or mapped from a binary file
+  virtual void compilePredictionNodesInternal() {
+  }
+
+#ifdef OLD_WIN_R_BUILD
   void computePermutationImportance(std::vector<double>& forest_importance, std::vector<double>& forest_variance,
       std::vector<double>& forest_importance_casewise);
+#else
+  // Casewise importance of variable i is added to the shared buffer while holding casewise_mutexes[i % size]
+  void computePermutationImportance(std::vector<double>& forest_importance, std::vector<double>& forest_variance,
+      std::vector<double>& forest_importance_casewise, std::vector<std::mutex>& casewise_mutexes);
+#endif
 
   void appendToFile(std::ofstream& file);
   virtual void appendToFileInternal(std::ofstream& file) = 0;
 
+  // Binary forest file with the packed prediction nodes. Trees loaded from a mapped file point into the file and
+  // can only be used for prediction.
+  void appendToBinaryFile(BlockFileWriter& file) const;
+  virtual void appendToBinaryFileInternal(BlockFileWriter& file) const {
+  }
+  void loadFromBinaryFile(MappedFile& file);
+  virtual void loadFromBinaryFileInternal(MappedFile& file) {
+  }
+
   const std::vector<std::vector<size_t>>& getChildNodeIDs() const {
     return child_nodeIDs;
   }
@@ -75,20 +142,188 @@ public:
   const std::vector<size_t>& getInbagCounts() const {
     return inbag_counts;
   }
+  void setInbagCounts(const std::vector<size_t>& inbag_counts) {
+    this->inbag_counts = inbag_counts;
+  }
+
+  size_t getNumNodes() const {
+    return split_varIDs.size();
+  }
+
+  // Number of split candidates evaluated with method while growing
+  size_t getNumSplitCandidates(SplitMethod method) const {
+    return num_split_candidates[method];
+  }
 
 protected:
   void createPossibleSplitVarSubset(std::vector<size_t>& result);
 
+  void countSplitCandidates(SplitMethod method, size_t count = 1) {
+    num_split_candidates[method] += count;
+  }
+
+  // Response in column col of sampleID, only while growing. Same as data->get_y(sampleID, col).
+  double getResponse(size_t sampleID, size_t col = 0) const {
+    return responses[col * num_samples + sampleID];
+  }
+
+  // Number of response columns kept in the order of sampleIDs while growing, see getNodeResponse()
+  virtual size_t getNumNodeResponseColumns() const {
+    return 0;
+  }
+
+  // Response in column col of the sample at position pos of sampleIDs, only while growing. Gathered after
+  // bootstrapping and partitioned with sampleIDs, so scans over the samples of a node read it sequentially.
+  double getNodeResponse(size_t pos, size_t col = 0) const {
+    return node_responses[col * sampleIDs.size() + pos];
+  }
+
+  // Call f(pos, index) with the index of varID of the sample at each position pos of the node. Read sequentially from
+  // the gathered index columns if kept, see gather_columns.
+  template<typename Function>
+  void forEachNodeIndex(size_t nodeID, size_t varID, Function f) const {
+    if (varID < node_index_columns.size()) {
+      const uint32_t* index = node_index_columns[varID].data();
+      for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
+        f(pos, index[pos]);
+      }
+    } else {
+      data->forEachIndex(varID, sampleIDs, start_pos[nodeID], end_pos[nodeID], f);
+    }
+  }
+
+  // Nonzeros of varID of the samples in the node as pairs of value and sampleID, sorted by value. False if varID is not
+  // stored sparse or has more nonzeros than the node has samples, then the dense split search is faster.
+  bool getNodeNonzeros(size_t nodeID, size_t varID, std::vector<std::pair<double, size_t>>& nonzeros) const;
+
+  // FactorIDs of the present factor_levels of an unordered variable, in increasing order of their score per factorID
+  // and by level on ties. With levels sorted by a suitable score, the best 2-partition is a split of this order.
+  std::vector<size_t> orderFactorLevels(const std::vector<double>& factor_levels,
+      const std::vector<double>& scores) const;
+
+  // Split value of the partition with the levels of splitID right, flipped to keep the largest present level left as
+  // in the exhaustive search. Both then encode the same best partition in the same way.
+  double encodeFactorSplit(size_t splitID, size_t all_levels, size_t largest_level) const {
+    if (splitID & largest_level) {
+      return all_levels & ~splitID;
+    } else {
+      return splitID;
+    }
+  }
+
+  // Bitsets of the node samples for the SNP bitset kernel, num_sets sets of samples by classIDs or one set if 0. Only
+  // built if a candidate is a SNP and the node has enough samples for the kernel to be faster, see useSnpBitsets().
+  void buildSnpBitsets(size_t nodeID, const std::vector<size_t>& possible_split_varIDs, size_t num_sets,
+      const std::vector<uint>* classIDs);
+  bool useSnpBitsets(size_t nodeID, size_t varID) const {
+    return snp_bitsets_nodeID == nodeID && data->isSnpColumn(varID);
+  }
+
+  // Counters of the values of SNP varID in the node from the bitsets, as counted in the LargeQ split search. Genotype
+  // 0 is the rest of the node.
+  void countSnpClasses(size_t varID, size_t num_classes, const std::vector<size_t>& class_counts,
+      std::vector<size_t>& counter_per_class, std::vector<size_t>& counter) const;
+  void sumSnpResponses(size_t varID, double sum_node, size_t num_samples_node, std::vector<size_t>& counter,
+      std::vector<double>& sums) const;
+
+  // Call f(value, begin, end) for each value of varID in the node in increasing order, with the range [begin, end) of
+  // nonzeros with this value. The implicit zeros are a value with begin == end, if has_zeros.
+  template<typename Function>
+  void forEachSparseValue(const std::vector<std::pair<double, size_t>>& nonzeros, bool has_zeros, Function f) const {
+    size_t begin = 0;
+    while (begin < nonzeros.size()) {
+      double value = nonzeros[begin].first;
+      if (has_zeros && value > 0) {
+        f(0.0, begin, begin);
+        has_zeros = false;
+      }
+      size_t end = begin + 1;
+      while (end < nonzeros.size() && nonzeros[end].first == value) {
+        ++end;
+      }
+      f(value, begin, end);
+      begin = end;
+    }
+    if (has_zeros) {
+      f(0.0, begin, begin);
+    }
+  }
+
+  // Gather node responses and index columns in the order of sampleIDs
+  void gatherNodeBuffers();
+
+  // Swap the samples at positions pos1 and pos2 of sampleIDs, with their gathered responses and indices
+  void swapSamples(size_t pos1, size_t pos2);
+
+  // Partition the OOB samples of a split node to its children with the prediction rules, see fused_oob
+  void splitOobSamples(size_t nodeID);
+
   bool splitNode(size_t nodeID);
   virtual bool splitNodeInternal(size_t nodeID, std::vector<size_t>& possible_split_varIDs) = 0;
 
   void createEmptyNode();
   virtual void createEmptyNodeInternal() = 0;
 
-  size_t dropDownSamplePermuted(size_t permuted_varID, size_t sampleID, size_t permuted_sampleID);
-  void permuteAndPredictOobSamples(size_t permuted_varID, std::vector<size_t>& permutations);
+  size_t dropDownSamplePermuted(size_t nodeID, size_t permuted_varID, size_t sampleID, size_t permuted_sampleID);
+
+  // Drop samples start..end-1, or the samples sampleIDs[start..end-1] if given, and write terminal nodes from
+  // terminal_nodeIDs[0] on
+  void dropDownSamples(const Data* prediction_data, const size_t* sampleIDs, size_t start, size_t end,
+      size_t* terminal_nodeIDs) const;
+
+  // Branchless prediction of PREDICTION_GROUP_SIZE samples at the same time, only for ordered split variables
+  void predictSamplesOrdered(const double* x, size_t num_rows, const size_t* sampleIDs, size_t start, size_t end,
+      size_t* terminal_nodeIDs) const;
+  void dropDownGroupOrdered(const double* x, size_t num_rows, const size_t* rows, size_t* nodeIDs) const;
+
+  // Same with the float32 prediction nodes for float data
+  void predictSamplesOrderedFloat(const float* x, size_t num_rows, size_t num_cols, const size_t* sampleIDs,
+      size_t start, size_t end, size_t* terminal_nodeIDs) const;
+  void dropDownGroupOrderedFloat(const float* x, size_t num_rows, size_t num_cols, const size_t* rows,
+      size_t* nodeIDs) const;
+
+  // Child to move to from node with given value: 0 for left, 1 for right
+  static size_t getChildIndex(const PredictionNode& node, double value) {
+    if (node.is_ordered) {
+      // Left if value <= split value
+      return !(value <= node.split_value);
+    } else {
+      size_t factorID = floor(value) - 1;
+      size_t splitID = floor(node.split_value);
+
+      // Left if 0 found at position factorID
+      return (splitID & (1ULL << factorID)) != 0;
+    }
+  }
+
+  // Prediction value of a terminal node, from split_values if the prediction nodes were released
+  double getTerminalValue(size_t nodeID) const {
+    return prediction_nodes ? prediction_nodes[nodeID].split_value : split_values[nodeID];
+  }
+
+  // For permutation importance: OOB sample indices sorted such that the samples reaching a node are in
+  // node_samples[node_start[nodeID]..node_end[nodeID]-1] and the topmost nodes splitting on each variable
+  void sortOobSamplesByNode(const std::vector<size_t>& terminal_nodeIDs,
+      std::vector<std::vector<size_t>>& permutation_nodeIDs, std::vector<size_t>& node_samples,
+      std::vector<size_t>& node_start, std::vector<size_t>& node_end);
+  void permuteAndPredictOobSamples(size_t permuted_varID, const std::vector<size_t>& permutations,
+      const std::vector<size_t>& start_nodeIDs, const std::vector<size_t>& node_samples,
+      const std::vector<size_t>& node_start, const std::vector<size_t>& node_end);
+
+  // Add casewise importance differences of one variable, given as pairs of sample ID and difference
+  void addCasewiseImportance(size_t varID, const std::vector<std::pair<size_t, double>>& differences,
+      std::vector<double>& forest_importance_casewise) const;
 
   virtual double computePredictionAccuracyInternal(std::vector<double>* prediction_error_casewise) = 0;
+
+  // True if the prediction accuracy is 1 minus the mean of computeOobSampleError() over the OOB samples. Permutation
+  // importance is then computed from the samples with changed predictions only.
+  virtual bool hasAdditiveAccuracy() const {
+    return false;
+  }
+  virtual double computeOobSampleError(size_t oob_idx, size_t terminal_nodeID) const {
+    return 0;
+  }
   
   void bootstrap();
   void bootstrapWithoutReplacement();
@@ -103,6 +338,126 @@ protected:
 
   virtual void cleanUpInternal() = 0;
 
+  // Search split candidates possible_split_varIDs[start, end) with search(start, end, part, best_value,
+  // best_varID, best_decrease). Large nodes are split in contiguous parts searched in parallel by the thread pool,
+  // this thread helps. Parts are reduced in candidate order, so the result is the same as for the serial search.
+  template<typename SearchFunction>
+  void searchSplitCandidates(size_t num_samples_node, const std::vector<size_t>& possible_split_varIDs,
+      double& best_value, size_t& best_varID, double& best_decrease, SearchFunction search) {
+    size_t num_candidates = possible_split_varIDs.size();
+    size_t num_parts = std::min((size_t) num_split_threads, num_candidates);
+    if (num_parts < 2 || num_samples_node * num_candidates < MIN_PARALLEL_SPLIT_WORK) {
+      search(0, num_candidates, 0, best_value, best_varID, best_decrease);
+      return;
+    }
+
+#ifndef OLD_WIN_R_BUILD
+    std::vector<double> part_values(num_parts, best_value);
+    std::vector<size_t> part_varIDs(num_parts, best_varID);
+    std::vector<double> part_decreases(num_parts, best_decrease);
+    auto search_part = [&](size_t part) {
+      search(part * num_candidates / num_parts, (part + 1) * num_candidates / num_parts, part, part_values[part],
+          part_varIDs[part], part_decreases[part]);
+    };
+
+    TaskGroup tasks(num_parts, search_part);
+    tasks.wait();
+
+    // Keep first best split, as in serial search
+    for (size_t part = 0; part < num_parts; ++part) {
+      if (part_decreases[part] > best_decrease) {
+        best_value = part_values[part];
+        best_varID = part_varIDs[part];
+        best_decrease = part_decreases[part];
+      }
+    }
+#endif
+  }
+
+  // Histogram of bins of varID for samples in node, num_stats statistics per bin are added by add_sample(bin, pos) for
+  // the sample at position pos of sampleIDs.
+  // Computed as parent minus sibling histogram if the parent histogram was saved and the sibling is smaller.
+  template<typename AddSample>
+  void computeHistogram(std::vector<double>& histogram, size_t nodeID, size_t varID, size_t num_stats,
+      AddSample add_sample) const {
+    const std::vector<double>* level_histogram = findLevelHistogram(nodeID, varID);
+    if (level_histogram != 0) {
+      histogram = *level_histogram;
+      return;
+    }
+    histogram.assign(data->getNumBins(varID) * num_stats, 0);
+
+    const std::vector<double>* parent_histogram = 0;
+    size_t sibling_nodeID = 0;
+    if (nodeID > 0) {
+      size_t parent_nodeID = parent_nodeIDs[nodeID];
+      parent_histogram = findHistogram(parent_nodeID, varID);
+      sibling_nodeID = child_nodeIDs[0][parent_nodeID] == nodeID ?
+          child_nodeIDs[1][parent_nodeID] : child_nodeIDs[0][parent_nodeID];
+    }
+
+    if (parent_histogram != 0
+        && end_pos[sibling_nodeID] - start_pos[sibling_nodeID] < end_pos[nodeID] - start_pos[nodeID]) {
+      const std::vector<double>* sibling_histogram = findHistogram(sibling_nodeID, varID);
+      if (sibling_histogram == 0) {
+        sibling_histogram = findLevelHistogram(sibling_nodeID, varID);
+      }
+      if (sibling_histogram != 0) {
+        histogram = *sibling_histogram;
+      } else {
+        for (size_t pos = start_pos[sibling_nodeID]; pos < end_pos[sibling_nodeID]; ++pos) {
+          add_sample(&histogram[data->getBin(sampleIDs[pos], varID) * num_stats], pos);
+        }
+      }
+      for (size_t i = 0; i < histogram.size(); ++i) {
+        histogram[i] = (*parent_histogram)[i] - histogram[i];
+      }
+    } else {
+      for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
+        add_sample(&histogram[data->getBin(sampleIDs[pos], varID) * num_stats], pos);
+      }
+    }
+  }
+
+  const std::vector<double>* findHistogram(size_t nodeID, size_t varID) const;
+
+  // Draw the candidate variables of the open nodes level_start to level_end-1 and compute the histograms of the large
+  // nodes in one pass over each column in row order, see level_wise
+  void prepareLevel(size_t level_start, size_t level_end);
+  virtual void computeLevelHistogramsInternal(size_t varID,
+      const std::vector<std::pair<size_t, size_t>>& requests) {
+  }
+
+  // Histograms of varID for the level nodes and candidate indices in requests, num_stats statistics per bin are added
+  // by add_sample(bin, sampleID, count) for each bagged sample with count copies. Samples of other nodes are added to
+  // a scratch histogram, which avoids unpredictable branches in the pass.
+  template<typename AddSample>
+  void streamLevelHistograms(size_t varID, size_t num_stats, const std::vector<std::pair<size_t, size_t>>& requests,
+      AddSample add_sample) {
+    size_t histogram_size = data->getNumBins(varID) * num_stats;
+    std::vector<double> scratch(histogram_size);
+    std::vector<double*> node_histograms(level_histograms.size() + 1, scratch.data());
+    for (auto& request : requests) {
+      std::vector<double>& histogram = level_histograms[request.first][request.second];
+      histogram.assign(histogram_size, 0);
+      node_histograms[request.first] = histogram.data();
+    }
+    for (size_t sampleID = 0; sampleID < num_samples; ++sampleID) {
+      add_sample(node_histograms[level_sample_nodes[sampleID]] + data->getBin(sampleID, varID) * num_stats, sampleID,
+          sample_counts[sampleID]);
+    }
+  }
+  void assignLevelSampleNodes(const std::vector<std::vector<std::pair<size_t, size_t>>>& requests);
+  const std::vector<double>* findLevelHistogram(size_t nodeID, size_t varID) const;
+
+  // Keep histograms of varIDs for child nodes, only for nodes large enough to save work
+  void saveHistograms(size_t nodeID, const std::vector<size_t>& varIDs,
+      std::vector<std::vector<double>>& histograms);
+  void freeHistograms(size_t nodeID);
+
+  // Order of node samples by their values x of varID, in linear time from the presorted index if available
+  std::vector<size_t> orderNodeSamples(size_t nodeID, size_t varID, const std::vector<double>& x) const;
+
   void regularize(double& decrease, size_t varID) {
     if (regularization) {
       if (importance_mode == IMP_GINI_CORRECTED) {
@@ -158,13 +513,15 @@ protected:
   // Minimum node size to split, like in original RF nodes of smaller size can be produced
   uint min_node_size;
 
-  // Weight vector for selecting possible split variables, one weight between 0 (never select) and 1 (always select) for each variable
-  // Deterministic variables are always selected
+  // Alias table of the weights for selecting possible split variables, empty if not weighted, and marks of the
+  // variables drawn. Deterministic variables are always selected
   const std::vector<size_t>* deterministic_varIDs;
-  const std::vector<double>* split_select_weights;
+  const AliasTable* split_select_alias_table;
+  std::vector<bool> split_select_drawn;
 
-  // Bootstrap weights
+  // Bootstrap weights and their alias table
   const std::vector<double>* case_weights;
+  const AliasTable* case_weights_alias_table;
 
   // Pre-selected bootstrap samples
   const std::vector<size_t>* manual_inbag;
@@ -179,6 +536,17 @@ protected:
   // Vector of left and right child node IDs, 0 for no child
   std::vector<std::vector<size_t>> child_nodeIDs;
 
+  // Packed copy of the nodes for prediction, in prediction_node_storage or in a mapped forest file
+  const PredictionNode* prediction_nodes;
+  size_t num_prediction_nodes;
+  std::vector<PredictionNode> prediction_node_storage;
+
+  // True if all split variables are ordered
+  bool ordered_prediction_nodes;
+
+  // Float32 prediction nodes, empty if not built
+  std::vector<PredictionNodeFloat> float_prediction_nodes;
+
   // All sampleIDs in the tree, will be re-ordered while splitting
   std::vector<size_t> sampleIDs;
 
@@ -186,6 +554,9 @@ protected:
   std::vector<size_t> start_pos;
   std::vector<size_t> end_pos;
 
+  // Variables to possibly split at, reused for all nodes
+  std::vector<size_t> possible_split_varIDs;
+
   // IDs of OOB individuals, sorted
   std::vector<size_t> oob_sampleIDs;
 
@@ -202,6 +573,12 @@ protected:
   // Pointer to original data
   const Data* data;
 
+  // Column major responses of data while growing, see getResponse()
+  const double* responses;
+
+  // Responses in the order of sampleIDs, column major with stride sampleIDs.size(), see getNodeResponse()
+  std::vector<double> node_responses;
+
   // Regularization
   bool regularization;
   std::vector<double>* regularization_factor;
@@ -227,6 +604,64 @@ protected:
   uint max_depth;
   uint depth;
   size_t last_left_nodeID;
+
+  // Number of threads for split search in large nodes
+  uint num_split_threads;
+
+  // Histogram splitting on binned data, histograms of candidate variables saved per node until both children are split
+  bool histogram_splitting;
+  std::vector<size_t> parent_nodeIDs;
+  std::vector<std::vector<size_t>> histogram_varIDs;
+  std::vector<std::vector<std::vector<double>>> histograms;
+
+  // Keep copies of the index columns in the order of sampleIDs while growing, 4 bytes per sample and variable.
+  // Split search then scans them sequentially, at the cost of partitioning all columns at each split.
+  bool gather_columns;
+  std::vector<std::vector<uint32_t>> node_index_columns;
+
+  // Split unordered variables by scanning their levels in the order of a response score instead of trying all
+  // 2-partitions, see orderFactorLevels()
+  bool sort_levels;
+
+  // Grow level by level: the candidate variables of all open nodes in a level are drawn in node order before the
+  // first is split, and the histograms of the level are streamed from each column at once. Same trees as node-wise
+  // growing unless random numbers are drawn while splitting, e.g. for ties in terminal nodes.
+  bool level_wise;
+  size_t level_start;
+  std::vector<std::vector<size_t>> level_split_varIDs;
+  std::vector<std::vector<std::vector<double>>> level_histograms;
+  // Node of each sample relative to level_start, the number of level nodes if not in a node with streamed histograms
+  std::vector<uint32_t> level_sample_nodes;
+
+  // Route the OOB samples down with the bag while growing and save their terminal nodes in
+  // prediction_terminal_nodeIDs, so that no OOB prediction pass is needed. The OOB samples reaching a node are in
+  // oob_node_sampleIDs[oob_start_pos[nodeID]..oob_end_pos[nodeID]-1], oob_sample_positions maps them to their
+  // position in oob_sampleIDs.
+  bool fused_oob;
+  std::vector<size_t> oob_node_sampleIDs;
+  std::vector<size_t> oob_right_sampleIDs;
+  std::vector<size_t> oob_sample_positions;
+  std::vector<size_t> oob_start_pos;
+  std::vector<size_t> oob_end_pos;
+
+  // Node and number of bootstrap copies of each sample while growing on sparse data, the largest size_t if not in the
+  // bag. Nonzeros of a column are checked against it, see getNodeNonzeros(). Copies also counted for SNP data and for
+  // level-wise growing.
+  std::vector<size_t> sample_nodeIDs;
+  std::vector<uint> sample_counts;
+
+  // Node bitsets for SNP splitting in node snp_bitsets_nodeID, see Data::countSnpGenotypes(). One plane per base 4
+  // digit of the largest sample count, 0 if no SNP data.
+  size_t snp_bitsets_nodeID;
+  size_t snp_num_planes;
+  std::vector<uint64_t> snp_bitsets;
+
+  // Split candidates evaluated by each SplitMethod, counted from all split search threads
+#ifdef OLD_WIN_R_BUILD
+  size_t num_split_candidates[NUM_SPLIT_METHODS];
+#else
+  std::atomic<size_t> num_split_candidates[NUM_SPLIT_METHODS];
+#endif
 };
 
 } // namespace ranger
@@ -88,7 +88,7 @@ bool TreeClassification::splitNodeInternal(size_t nodeID, std::vector<size_t>& p
   double pure_value = 0;
   for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
     size_t sampleID = sampleIDs[pos];
-    double value = data->get_y(sampleID, 0);
+    double value = getResponse(sampleID);
     if (pos != start_pos[nodeID] && value != pure_value) {
       pure = false;
       break;
@@ -120,6 +120,19 @@ void TreeClassification::createEmptyNodeInternal() {
   // Empty on purpose
 }
 
+void TreeClassification::compilePredictionNodesInternal() {
+  node_classIDs.assign(num_prediction_nodes, 0);
+  for (size_t i = 0; i < num_prediction_nodes; ++i) {
+    if (prediction_nodes[i].is_terminal) {
+      auto it = std::find(class_values->cbegin(), class_values->cend(), prediction_nodes[i].split_value);
+      if (it == class_values->cend()) {
+        throw std::runtime_error("Prediction of terminal node is not a class value.");
+      }
+      node_classIDs[i] = std::distance(class_values->cbegin(), it);
+    }
+  }
+}
+
 double TreeClassification::computePredictionAccuracyInternal(std::vector<double>* prediction_error_casewise) {
 
   size_t num_predictions = prediction_terminal_nodeIDs.size();
@@ -142,6 +155,12 @@ double TreeClassification::computePredictionAccuracyInternal(std::vector<double>
   return (1.0 - (double) num_missclassifications / (double) num_predictions);
 }
 
+double TreeClassification::computeOobSampleError(size_t oob_idx, size_t terminal_nodeID) const {
+  double predicted_value = split_values[terminal_nodeID];
+  double real_value = data->get_y(oob_sampleIDs[oob_idx], 0);
+  return predicted_value != real_value;
+}
+
 bool TreeClassification::findBestSplit(size_t nodeID, std::vector<size_t>& possible_split_varIDs) {
 
   size_t num_samples_node = end_pos[nodeID] - start_pos[nodeID];
@@ -158,37 +177,40 @@ bool TreeClassification::findBestSplit(size_t nodeID, std::vector<size_t>& possi
     ++class_counts[sample_classID];
   }
 
-  // For all possible split variables
-  for (auto& varID : possible_split_varIDs) {
-    // Find best split value, if ordered consider all values as split values, else all 2-partitions
-    if (data->isOrderedVariable(varID)) {
+  // Histograms of candidate variables for histogram splitting
+  std::vector<std::vector<double>> candidate_histograms(histogram_splitting ? possible_split_varIDs.size() : 0);
 
-      // Use memory saving method if option set
-      if (memory_saving_splitting) {
-        findBestSplitValueSmallQ(nodeID, varID, num_classes, class_counts, num_samples_node, best_value, best_varID,
-            best_decrease);
-      } else {
-        // Use faster method for both cases
-        double q = (double) num_samples_node / (double) data->getNumUniqueDataValues(varID);
-        if (q < Q_THRESHOLD) {
-          findBestSplitValueSmallQ(nodeID, varID, num_classes, class_counts, num_samples_node, best_value, best_varID,
-              best_decrease);
+  // Bitsets of node samples if SNPs are split with the bitset kernel
+  buildSnpBitsets(nodeID, possible_split_varIDs, num_classes, response_classIDs);
+
+  // For all possible split variables, in parallel for large nodes with own counters per part
+  searchSplitCandidates(num_samples_node, possible_split_varIDs, best_value, best_varID, best_decrease,
+      [&](size_t start, size_t end, size_t part, double& part_value, size_t& part_varID, double& part_decrease) {
+        if (part == 0) {
+          findBestSplitCandidates(nodeID, possible_split_varIDs, start, end, num_classes, class_counts,
+              num_samples_node, part_value, part_varID, part_decrease, counter_per_class, counter,
+              possible_split_values, value_indices, candidate_histograms);
         } else {
-          findBestSplitValueLargeQ(nodeID, varID, num_classes, class_counts, num_samples_node, best_value, best_varID,
-              best_decrease);
+          std::vector<size_t> part_counter_per_class(counter_per_class.size());
+          std::vector<size_t> part_counter(counter.size());
+          std::vector<double> part_split_values;
+          std::vector<size_t> part_value_indices;
+          findBestSplitCandidates(nodeID, possible_split_varIDs, start, end, num_classes, class_counts,
+              num_samples_node, part_value, part_varID, part_decrease, part_counter_per_class, part_counter,
+              part_split_values, part_value_indices, candidate_histograms);
         }
-      }
-    } else {
-      findBestSplitValueUnordered(nodeID, varID, num_classes, class_counts, num_samples_node, best_value, best_varID,
-          best_decrease);
-    }
-  }
+      });
 
   // Stop if no good split found
   if (best_decrease < 0) {
     return true;
   }
 
+  // Keep histograms for child nodes
+  if (histogram_splitting) {
+    saveHistograms(nodeID, possible_split_varIDs, candidate_histograms);
+  }
+
   // Save best values
   split_varIDs[nodeID] = best_varID;
   split_values[nodeID] = best_value;
@@ -204,13 +226,67 @@ bool TreeClassification::findBestSplit(size_t nodeID, std::vector<size_t>& possi
   return false;
 }
 
+void TreeClassification::findBestSplitCandidates(size_t nodeID, const std::vector<size_t>& possible_split_varIDs,
+    size_t start, size_t end, size_t num_classes, const std::vector<size_t>& class_counts, size_t num_samples_node,
+    double& best_value, size_t& best_varID, double& best_decrease, std::vector<size_t>& counter_per_class,
+    std::vector<size_t>& counter, std::vector<double>& possible_split_values, std::vector<size_t>& value_indices,
+    std::vector<std::vector<double>>& candidate_histograms) {
+  std::vector<std::pair<double, size_t>> nonzeros;
+  for (size_t i = start; i < end; ++i) {
+    size_t varID = possible_split_varIDs[i];
+
+    // Find best split value, if ordered consider all values as split values, else all 2-partitions
+    if (data->isOrderedVariable(varID)) {
+
+      // Use histogram of bins if binned, nonzeros only if sparse, memory saving method if option set
+      if (histogram_splitting && data->getNumBins(varID) > 0) {
+        countSplitCandidates(SPLIT_HISTOGRAM);
+        findBestSplitValueHistogram(nodeID, varID, num_classes, class_counts, num_samples_node, best_value,
+            best_varID, best_decrease, candidate_histograms[i]);
+      } else if (getNodeNonzeros(nodeID, varID, nonzeros)) {
+        countSplitCandidates(SPLIT_SPARSE);
+        findBestSplitValueSparse(varID, num_classes, class_counts, num_samples_node, best_value, best_varID,
+            best_decrease, nonzeros);
+      } else if (useSnpBitsets(nodeID, varID)) {
+        countSplitCandidates(SPLIT_SNP);
+        findBestSplitValueLargeQ(nodeID, varID, num_classes, class_counts, num_samples_node, best_value, best_varID,
+            best_decrease, counter_per_class, counter);
+      } else if (memory_saving_splitting) {
+        countSplitCandidates(SPLIT_SMALL_Q);
+        findBestSplitValueSmallQ(nodeID, varID, num_classes, class_counts, num_samples_node, best_value, best_varID,
+            best_decrease, counter_per_class, counter, possible_split_values, value_indices);
+      } else {
+        // Use faster method for both cases
+        double q = (double) num_samples_node / (double) data->getNumUniqueDataValues(varID);
+        if (q < Q_THRESHOLD) {
+          countSplitCandidates(SPLIT_SMALL_Q);
+          findBestSplitValueSmallQ(nodeID, varID, num_classes, class_counts, num_samples_node, best_value, best_varID,
+              best_decrease, counter_per_class, counter, possible_split_values, value_indices);
+        } else {
+          countSplitCandidates(SPLIT_LARGE_Q);
+          findBestSplitValueLargeQ(nodeID, varID, num_classes, class_counts, num_samples_node, best_value, best_varID,
+              best_decrease, counter_per_class, counter);
+        }
+      }
+    } else if (sort_levels) {
+      countSplitCandidates(SPLIT_UNORDERED);
+      findBestSplitValueSortedLevels(nodeID, varID, num_classes, class_counts, num_samples_node, best_value, best_varID,
+          best_decrease);
+    } else {
+      countSplitCandidates(SPLIT_UNORDERED);
+      findBestSplitValueUnordered(nodeID, varID, num_classes, class_counts, num_samples_node, best_value, best_varID,
+          best_decrease);
+    }
+  }
+}
+
 void TreeClassification::findBestSplitValueSmallQ(size_t nodeID, size_t varID, size_t num_classes,
     const std::vector<size_t>& class_counts, size_t num_samples_node, double& best_value, size_t& best_varID,
-    double& best_decrease) {
+    double& best_decrease, std::vector<size_t>& counter_per_class, std::vector<size_t>& counter,
+    std::vector<double>& possible_split_values, std::vector<size_t>& value_indices) {
 
-  // Create possible split values
-  std::vector<double> possible_split_values;
-  data->getAllValues(possible_split_values, sampleIDs, varID, start_pos[nodeID], end_pos[nodeID]);
+  // Create possible split values and index of value for each sample
+  data->getAllValues(possible_split_values, value_indices, sampleIDs, varID, start_pos[nodeID], end_pos[nodeID]);
 
   // Try next variable if all equal for this
   if (possible_split_values.size() < 2) {
@@ -219,27 +295,26 @@ void TreeClassification::findBestSplitValueSmallQ(size_t nodeID, size_t varID, s
 
   const size_t num_splits = possible_split_values.size();
   if (memory_saving_splitting) {
-    std::vector<size_t> class_counts_right(num_splits * num_classes), n_right(num_splits);
-    findBestSplitValueSmallQ(nodeID, varID, num_classes, class_counts, num_samples_node, best_value, best_varID,
-        best_decrease, possible_split_values, class_counts_right, n_right);
+    // Counters only as large as needed, reused for all nodes
+    counter_per_class.assign(num_splits * num_classes, 0);
+    counter.assign(num_splits, 0);
   } else {
     std::fill_n(counter_per_class.begin(), num_splits * num_classes, 0);
     std::fill_n(counter.begin(), num_splits, 0);
-    findBestSplitValueSmallQ(nodeID, varID, num_classes, class_counts, num_samples_node, best_value, best_varID,
-        best_decrease, possible_split_values, counter_per_class, counter);
   }
+  findBestSplitValueSmallQ(nodeID, varID, num_classes, class_counts, num_samples_node, best_value, best_varID,
+      best_decrease, possible_split_values, value_indices, counter_per_class, counter);
 }
 
 void TreeClassification::findBestSplitValueSmallQ(size_t nodeID, size_t varID, size_t num_classes,
     const std::vector<size_t>& class_counts, size_t num_samples_node, double& best_value, size_t& best_varID,
-    double& best_decrease, const std::vector<double>& possible_split_values, std::vector<size_t>& counter_per_class,
-    std::vector<size_t>& counter) {
+    double& best_decrease, const std::vector<double>& possible_split_values, const std::vector<size_t>& value_indices,
+    std::vector<size_t>& counter_per_class, std::vector<size_t>& counter) {
 
   for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
     size_t sampleID = sampleIDs[pos];
     uint sample_classID = (*response_classIDs)[sampleID];
-    size_t idx = std::lower_bound(possible_split_values.begin(), possible_split_values.end(),
-        data->get_x(sampleID, varID)) - possible_split_values.begin();
+    size_t idx = value_indices[pos - start_pos[nodeID]];
 
     ++counter_per_class[idx * num_classes + sample_classID];
     ++counter[idx];
@@ -315,21 +390,23 @@ void TreeClassification::findBestSplitValueSmallQ(size_t nodeID, size_t varID, s
 
 void TreeClassification::findBestSplitValueLargeQ(size_t nodeID, size_t varID, size_t num_classes,
     const std::vector<size_t>& class_counts, size_t num_samples_node, double& best_value, size_t& best_varID,
-    double& best_decrease) {
+    double& best_decrease, std::vector<size_t>& counter_per_class, std::vector<size_t>& counter) {
 
   // Set counters to 0
   size_t num_unique = data->getNumUniqueDataValues(varID);
   std::fill_n(counter_per_class.begin(), num_unique * num_classes, 0);
   std::fill_n(counter.begin(), num_unique, 0);
 
-  // Count values
-  for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
-    size_t sampleID = sampleIDs[pos];
-    size_t index = data->getIndex(sampleID, varID);
-    size_t classID = (*response_classIDs)[sampleID];
+  // Count values, from the bitsets for SNPs
+  if (useSnpBitsets(nodeID, varID)) {
+    countSnpClasses(varID, num_classes, class_counts, counter_per_class, counter);
+  } else {
+    forEachNodeIndex(nodeID, varID, [&](size_t pos, size_t index) {
+      size_t classID = (*response_classIDs)[sampleIDs[pos]];
 
-    ++counter[index];
-    ++counter_per_class[index * num_classes + classID];
+      ++counter[index];
+      ++counter_per_class[index * num_classes + classID];
+    });
   }
 
   size_t n_left = 0;
@@ -406,6 +483,180 @@ void TreeClassification::findBestSplitValueLargeQ(size_t nodeID, size_t varID, s
   }
 }
 
+void TreeClassification::computeLevelHistogramsInternal(size_t varID,
+    const std::vector<std::pair<size_t, size_t>>& requests) {
+  streamLevelHistograms(varID, class_values->size() + 1, requests, [&](double* bin, size_t sampleID, uint count) {
+    bin[0] += count;
+    bin[1 + (*response_classIDs)[sampleID]] += count;
+  });
+}
+
+void TreeClassification::findBestSplitValueHistogram(size_t nodeID, size_t varID, size_t num_classes,
+    const std::vector<size_t>& class_counts, size_t num_samples_node, double& best_value, size_t& best_varID,
+    double& best_decrease, std::vector<double>& histogram) {
+
+  // Number of samples and of samples per class per bin
+  size_t num_stats = num_classes + 1;
+  computeHistogram(histogram, nodeID, varID, num_stats, [&](double* bin, size_t pos) {
+    ++bin[0];
+    ++bin[1 + (*response_classIDs)[sampleIDs[pos]]];
+  });
+
+  size_t num_bins = data->getNumBins(varID);
+  size_t n_left = 0;
+  std::vector<size_t> class_counts_left(num_classes);
+
+  // Compute decrease of impurity for each split between bins
+  for (size_t i = 0; i < num_bins - 1; ++i) {
+
+    // Stop if nothing here
+    size_t count = histogram[i * num_stats];
+    if (count == 0) {
+      continue;
+    }
+
+    n_left += count;
+
+    // Stop if right child empty
+    size_t n_right = num_samples_node - n_left;
+    if (n_right == 0) {
+      break;
+    }
+
+    double decrease;
+    if (splitrule == HELLINGER) {
+      for (size_t j = 0; j < num_classes; ++j) {
+        class_counts_left[j] += histogram[i * num_stats + 1 + j];
+      }
+
+      // TPR is number of outcome 1s in one node / total number of 1s
+      // FPR is number of outcome 0s in one node / total number of 0s
+      double tpr = (double) (class_counts[1] - class_counts_left[1]) / (double) class_counts[1];
+      double fpr = (double) (class_counts[0] - class_counts_left[0]) / (double) class_counts[0];
+
+      // Decrease of impurity
+      double a1 = sqrt(tpr) - sqrt(fpr);
+      double a2 = sqrt(1 - tpr) - sqrt(1 - fpr);
+      decrease = sqrt(a1 * a1 + a2 * a2);
+    } else {
+      // Sum of squares
+      double sum_left = 0;
+      double sum_right = 0;
+      for (size_t j = 0; j < num_classes; ++j) {
+        class_counts_left[j] += histogram[i * num_stats + 1 + j];
+        size_t class_count_right = class_counts[j] - class_counts_left[j];
+
+        sum_left += (*class_weights)[j] * class_counts_left[j] * class_counts_left[j];
+        sum_right += (*class_weights)[j] * class_count_right * class_count_right;
+      }
+
+      // Decrease of impurity
+      decrease = sum_right / (double) n_right + sum_left / (double) n_left;
+    }
+
+    // Regularization
+    regularize(decrease, varID);
+
+    // If better than before, use this
+    if (decrease > best_decrease) {
+      // Find next bin in this node
+      size_t j = i + 1;
+      while (j < num_bins && histogram[j * num_stats] == 0) {
+        ++j;
+      }
+
+      // Use mid-point split
+      best_value = (data->getBinMaxValue(varID, i) + data->getBinMinValue(varID, j)) / 2;
+      best_varID = varID;
+      best_decrease = decrease;
+
+      // Use smaller value if average is numerically the same as the larger value
+      if (best_value == data->getBinMinValue(varID, j)) {
+        best_value = data->getBinMaxValue(varID, i);
+      }
+    }
+  }
+}
+
+void TreeClassification::findBestSplitValueSparse(size_t varID, size_t num_classes,
+    const std::vector<size_t>& class_counts, size_t num_samples_node, double& best_value, size_t& best_varID,
+    double& best_decrease, const std::vector<std::pair<double, size_t>>& nonzeros) {
+
+  // Zeros are the samples of the node without nonzero
+  size_t num_zeros = num_samples_node;
+  std::vector<size_t> class_counts_zeros(class_counts);
+  for (auto& nonzero : nonzeros) {
+    size_t count = sample_counts[nonzero.second];
+    num_zeros -= count;
+    class_counts_zeros[(*response_classIDs)[nonzero.second]] -= count;
+  }
+
+  size_t n_left = 0;
+  std::vector<size_t> class_counts_left(num_classes);
+  double last_value = 0;
+
+  // Compute decrease of impurity for each split between consecutive values
+  forEachSparseValue(nonzeros, num_zeros > 0, [&](double value, size_t begin, size_t end) {
+    if (n_left > 0) {
+      size_t n_right = num_samples_node - n_left;
+      double decrease;
+      if (splitrule == HELLINGER) {
+        // TPR is number of outcome 1s in one node / total number of 1s
+        // FPR is number of outcome 0s in one node / total number of 0s
+        double tpr = (double) (class_counts[1] - class_counts_left[1]) / (double) class_counts[1];
+        double fpr = (double) (class_counts[0] - class_counts_left[0]) / (double) class_counts[0];
+
+        // Decrease of impurity
+        double a1 = sqrt(tpr) - sqrt(fpr);
+        double a2 = sqrt(1 - tpr) - sqrt(1 - fpr);
+        decrease = sqrt(a1 * a1 + a2 * a2);
+      } else {
+        // Sum of squares
+        double sum_left = 0;
+        double sum_right = 0;
+        for (size_t j = 0; j < num_classes; ++j) {
+          size_t class_count_right = class_counts[j] - class_counts_left[j];
+
+          sum_left += (*class_weights)[j] * class_counts_left[j] * class_counts_left[j];
+          sum_right += (*class_weights)[j] * class_count_right * class_count_right;
+        }
+
+        // Decrease of impurity
+        decrease = sum_right / (double) n_right + sum_left / (double) n_left;
+      }
+
+      // Regularization
+      regularize(decrease, varID);
+
+      // If better than before, use this
+      if (decrease > best_decrease) {
+        // Use mid-point split
+        best_value = (last_value + value) / 2;
+        best_varID = varID;
+        best_decrease = decrease;
+
+        // Use smaller value if average is numerically the same as the larger value
+        if (best_value == value) {
+          best_value = last_value;
+        }
+      }
+    }
+
+    if (begin == end) {
+      n_left += num_zeros;
+      for (size_t j = 0; j < num_classes; ++j) {
+        class_counts_left[j] += class_counts_zeros[j];
+      }
+    }
+    for (size_t i = begin; i < end; ++i) {
+      size_t count = sample_counts[nonzeros[i].second];
+      n_left += count;
+      class_counts_left[(*response_classIDs)[nonzeros[i].second]] += count;
+    }
+    last_value = value;
+  });
+}
+
 void TreeClassification::findBestSplitValueUnordered(size_t nodeID, size_t varID, size_t num_classes,
     const std::vector<size_t>& class_counts, size_t num_samples_node, double& best_value, size_t& best_varID,
     double& best_decrease) {
@@ -496,6 +747,117 @@ void TreeClassification::findBestSplitValueUnordered(size_t nodeID, size_t varID
   }
 }
 
+void TreeClassification::findBestSplitValueSortedLevels(size_t nodeID, size_t varID, size_t num_classes,
+    const std::vector<size_t>& class_counts, size_t num_samples_node, double& best_value, size_t& best_varID,
+    double& best_decrease) {
+
+  // Create possible split values
+  std::vector<double> factor_levels;
+  data->getAllValues(factor_levels, sampleIDs, varID, start_pos[nodeID], end_pos[nodeID]);
+
+  // Try next variable if all equal for this
+  if (factor_levels.size() < 2) {
+    return;
+  }
+
+  // Count classes per level
+  size_t num_factorIDs = floor(factor_levels.back());
+  std::vector<size_t> counter(num_factorIDs);
+  std::vector<size_t> counter_per_class(num_factorIDs * num_classes);
+  for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
+    size_t sampleID = sampleIDs[pos];
+    size_t factorID = floor(data->get_x(sampleID, varID)) - 1;
+    ++counter[factorID];
+    ++counter_per_class[factorID * num_classes + (*response_classIDs)[sampleID]];
+  }
+
+  // Order levels by proportion of the second class, the best Gini split is between two consecutive levels (Breiman
+  // et al. 1984). For more classes order by the first principal component of the class proportions, weighted as in
+  // the Gini index (Coppersmith et al. 1999).
+  std::vector<double> scores(num_factorIDs);
+  if (num_classes == 2) {
+    for (size_t j = 0; j < num_factorIDs; ++j) {
+      if (counter[j] > 0) {
+        scores[j] = (double) counter_per_class[j * num_classes + 1] / (double) counter[j];
+      }
+    }
+  } else {
+    std::vector<double> proportions;
+    std::vector<double> weights;
+    proportions.reserve(factor_levels.size() * num_classes);
+    weights.reserve(factor_levels.size());
+    for (auto& level : factor_levels) {
+      size_t factorID = floor(level) - 1;
+      for (size_t k = 0; k < num_classes; ++k) {
+        proportions.push_back(
+            sqrt((*class_weights)[k]) * counter_per_class[factorID * num_classes + k] / (double) counter[factorID]);
+      }
+      weights.push_back(counter[factorID]);
+    }
+    std::vector<double> level_scores = principalComponentScores(proportions, weights, num_classes);
+    for (size_t i = 0; i < factor_levels.size(); ++i) {
+      scores[floor(factor_levels[i]) - 1] = level_scores[i];
+    }
+  }
+  std::vector<size_t> factorIDs = orderFactorLevels(factor_levels, scores);
+
+  // Move levels to the left child in this order, the others are right
+  size_t all_levels = 0;
+  for (auto& factorID : factorIDs) {
+    all_levels = all_levels | (1ULL << factorID);
+  }
+  size_t largest_level = 1ULL << (num_factorIDs - 1);
+  size_t splitID = all_levels;
+  std::vector<size_t> class_counts_right(class_counts);
+  size_t n_right = num_samples_node;
+  for (size_t i = 0; i < factorIDs.size() - 1; ++i) {
+    size_t factorID = factorIDs[i];
+    n_right -= counter[factorID];
+    for (size_t k = 0; k < num_classes; ++k) {
+      class_counts_right[k] -= counter_per_class[factorID * num_classes + k];
+    }
+    splitID = splitID & ~(1ULL << factorID);
+    size_t n_left = num_samples_node - n_right;
+
+    double decrease;
+    if (splitrule == HELLINGER) {
+      // TPR is number of outcome 1s in one node / total number of 1s
+      // FPR is number of outcome 0s in one node / total number of 0s
+      double tpr = (double) class_counts_right[1] / (double) class_counts[1];
+      double fpr = (double) class_counts_right[0] / (double) class_counts[0];
+
+      // Decrease of impurity
+      double a1 = sqrt(tpr) - sqrt(fpr);
+      double a2 = sqrt(1 - tpr) - sqrt(1 - fpr);
+      decrease = sqrt(a1 * a1 + a2 * a2);
+    } else {
+      // Sum of squares
+      double sum_left = 0;
+      double sum_right = 0;
+      for (size_t j = 0; j < num_classes; ++j) {
+        size_t class_count_right = class_counts_right[j];
+        size_t class_count_left = class_counts[j] - class_count_right;
+
+        sum_right += (*class_weights)[j] * class_count_right * class_count_right;
+        sum_left += (*class_weights)[j] * class_count_left * class_count_left;
+      }
+
+      // Decrease of impurity
+      decrease = sum_left / (double) n_left + sum_right / (double) n_right;
+    }
+
+    // Regularization
+    regularize(decrease, varID);
+
+    // If better than before, use this
+    if (decrease > best_decrease) {
+      best_value = encodeFactorSplit(splitID, all_levels, largest_level);
+      best_varID = varID;
+      best_decrease = decrease;
+    }
+  }
+}
+
 bool TreeClassification::findBestSplitExtraTrees(size_t nodeID, std::vector<size_t>& possible_split_varIDs) {
 
   size_t num_samples_node = end_pos[nodeID] - start_pos[nodeID];
@@ -512,6 +874,8 @@ bool TreeClassification::findBestSplitExtraTrees(size_t nodeID, std::vector<size
     ++class_counts[sample_classID];
   }
 
+  countSplitCandidates(SPLIT_OTHER, possible_split_varIDs.size());
+
   // For all possible split variables
   for (auto& varID : possible_split_varIDs) {
     // Find best split value, if ordered consider all values as split values, else all 2-partitions
@@ -648,11 +1012,9 @@ void TreeClassification::findBestSplitValueExtraTreesUnordered(size_t nodeID, si
 
   // Get all factor indices in node
   std::vector<bool> factor_in_node(num_unique_values, false);
-  for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
-    size_t sampleID = sampleIDs[pos];
-    size_t index = data->getIndex(sampleID, varID);
+  forEachNodeIndex(nodeID, varID, [&](size_t pos, size_t index) {
     factor_in_node[index] = true;
-  }
+  });
 
   // Vector of indices in and out of node
   std::vector<size_t> indices_in_node;
@@ -40,10 +40,19 @@ public:
   void addToTerminalNodes(size_t nodeID);
   void computePermutationImportanceInternal(std::vector<std::vector<size_t>>* permutations);
   void appendToFileInternal(std::ofstream& file) override;
+  void appendToBinaryFileInternal(BlockFileWriter& file) const override;
+  void loadFromBinaryFileInternal(MappedFile& file) override;
 
-  const std::vector<double>& getPrediction(size_t sampleID) const {
-    size_t terminal_nodeID = prediction_terminal_nodeIDs[sampleID];
-    return terminal_class_counts[terminal_nodeID];
+  // Class counts of the terminal node, one for each class
+  const double* getPrediction(size_t sampleID) const {
+    return getNodePrediction(prediction_terminal_nodeIDs[sampleID]);
+  }
+
+  const double* getNodePrediction(size_t nodeID) const {
+    if (mapped_class_counts) {
+      return mapped_class_counts + mapped_class_count_offsets[nodeID];
+    }
+    return terminal_class_counts[nodeID].data();
   }
 
   size_t getPredictionTerminalNodeID(size_t sampleID) const {
@@ -57,24 +66,44 @@ public:
 private:
   bool splitNodeInternal(size_t nodeID, std::vector<size_t>& possible_split_varIDs) override;
   void createEmptyNodeInternal() override;
+  void computeLevelHistogramsInternal(size_t varID, const std::vector<std::pair<size_t, size_t>>& requests) override;
 
   double computePredictionAccuracyInternal(std::vector<double>* prediction_error_casewise) override;
+  bool hasAdditiveAccuracy() const override {
+    return true;
+  }
+  double computeOobSampleError(size_t oob_idx, size_t terminal_nodeID) const override;
   
   // Called by splitNodeInternal(). Sets split_varIDs and split_values.
   bool findBestSplit(size_t nodeID, std::vector<size_t>& possible_split_varIDs);
+  void findBestSplitCandidates(size_t nodeID, const std::vector<size_t>& possible_split_varIDs, size_t start,
+      size_t end, size_t num_classes, const std::vector<size_t>& class_counts, size_t num_samples_node,
+      double& best_value, size_t& best_varID, double& best_decrease, std::vector<size_t>& counter_per_class,
+      std::vector<size_t>& counter, std::vector<double>& possible_split_values, std::vector<size_t>& value_indices,
+      std::vector<std::vector<double>>& candidate_histograms);
   void findBestSplitValueSmallQ(size_t nodeID, size_t varID, size_t num_classes,
       const std::vector<size_t>& class_counts, size_t num_samples_node, double& best_value, size_t& best_varID,
-      double& best_decrease);
+      double& best_decrease, std::vector<size_t>& counter_per_class, std::vector<size_t>& counter,
+      std::vector<double>& possible_split_values, std::vector<size_t>& value_indices);
   void findBestSplitValueSmallQ(size_t nodeID, size_t varID, size_t num_classes,
       const std::vector<size_t>& class_counts, size_t num_samples_node, double& best_value, size_t& best_varID,
-      double& best_decrease, const std::vector<double>& possible_split_values, std::vector<size_t>& counter_per_class,
-      std::vector<size_t>& counter);
+      double& best_decrease, const std::vector<double>& possible_split_values, const std::vector<size_t>& value_indices,
+      std::vector<size_t>& counter_per_class, std::vector<size_t>& counter);
   void findBestSplitValueLargeQ(size_t nodeID, size_t varID, size_t num_classes,
       const std::vector<size_t>& class_counts, size_t num_samples_node, double& best_value, size_t& best_varID,
-      double& best_decrease);
+      double& best_decrease, std::vector<size_t>& counter_per_class, std::vector<size_t>& counter);
+  void findBestSplitValueHistogram(size_t nodeID, size_t varID, size_t num_classes,
+      const std::vector<size_t>& class_counts, size_t num_samples_node, double& best_value, size_t& best_varID,
+      double& best_decrease, std::vector<double>& histogram);
+  void findBestSplitValueSparse(size_t varID, size_t num_classes, const std::vector<size_t>& class_counts,
+      size_t num_samples_node, double& best_value, size_t& best_varID, double& best_decrease,
+      const std::vector<std::pair<double, size_t>>& nonzeros);
   void findBestSplitValueUnordered(size_t nodeID, size_t varID, size_t num_classes,
       const std::vector<size_t>& class_counts, size_t num_samples_node, double& best_value, size_t& best_varID,
       double& best_decrease);
+  void findBestSplitValueSortedLevels(size_t nodeID, size_t varID, size_t num_classes,
+      const std::vector<size_t>& class_counts, size_t num_samples_node, double& best_value, size_t& best_varID,
+      double& best_decrease);
 
   bool findBestSplitExtraTrees(size_t nodeID, std::vector<size_t>& possible_split_varIDs);
   void findBestSplitValueExtraTrees(size_t nodeID, size_t varID, size_t num_classes,
@@ -98,6 +127,10 @@ private:
     counter.shrink_to_fit();
     counter_per_class.clear();
     counter_per_class.shrink_to_fit();
+    possible_split_values.clear();
+    possible_split_values.shrink_to_fit();
+    value_indices.clear();
+    value_indices.shrink_to_fit();
   }
 
   // Classes of the dependent variable and classIDs for responses
@@ -108,11 +141,19 @@ private:
   // Class counts in terminal nodes. Empty for non-terminal nodes.
   std::vector<std::vector<double>> terminal_class_counts;
 
+  // Class counts in a mapped forest file, of node nodeID from mapped_class_counts[mapped_class_count_offsets[nodeID]]
+  const uint64_t* mapped_class_count_offsets;
+  const double* mapped_class_counts;
+
   // Splitting weights
   const std::vector<double>* class_weights;
 
   std::vector<size_t> counter;
   std::vector<size_t> counter_per_class;
+
+  // Split values of a variable and index of each sample's value, reused for all nodes
+  std::vector<double> possible_split_values;
+  std::vector<size_t> value_indices;
 };
 
 } // namespace ranger
@@ -47,8 +47,7 @@ double TreeRegression::estimate(size_t nodeID) {
   double sum_responses_in_node = 0;
   size_t num_samples_in_node = end_pos[nodeID] - start_pos[nodeID];
   for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
-    size_t sampleID = sampleIDs[pos];
-    sum_responses_in_node += data->get_y(sampleID, 0);
+    sum_responses_in_node += getNodeResponse(pos);
   }
   return (sum_responses_in_node / (double) num_samples_in_node);
 }
@@ -71,8 +70,7 @@ bool TreeRegression::splitNodeInternal(size_t nodeID, std::vector<size_t>& possi
   bool pure = true;
   double pure_value = 0;
   for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
-    size_t sampleID = sampleIDs[pos];
-    double value = data->get_y(sampleID, 0);
+    double value = getNodeResponse(pos);
     if (pos != start_pos[nodeID] && value != pure_value) {
       pure = false;
       break;
@@ -127,6 +125,15 @@ double TreeRegression::computePredictionAccuracyInternal(std::vector<double>* pr
   return (1.0 - sum_of_squares / (double) num_predictions);
 }
 
+double TreeRegression::computeOobSampleError(size_t oob_idx, size_t terminal_nodeID) const {
+  double predicted_value = split_values[terminal_nodeID];
+  double real_value = data->get_y(oob_sampleIDs[oob_idx], 0);
+  if (predicted_value != real_value) {
+    return (predicted_value - real_value) * (predicted_value - real_value);
+  }
+  return 0;
+}
+
 bool TreeRegression::findBestSplit(size_t nodeID, std::vector<size_t>& possible_split_varIDs) {
 
   size_t num_samples_node = end_pos[nodeID] - start_pos[nodeID];
@@ -137,38 +144,42 @@ bool TreeRegression::findBestSplit(size_t nodeID, std::vector<size_t>& possible_
   // Compute sum of responses in node
   double sum_node = 0;
   for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
-    size_t sampleID = sampleIDs[pos];
-    sum_node += data->get_y(sampleID, 0);
+    sum_node += getNodeResponse(pos);
   }
 
-  // For all possible split variables
-  for (auto& varID : possible_split_varIDs) {
+  // Histograms of candidate variables for histogram splitting
+  std::vector<std::vector<double>> candidate_histograms(histogram_splitting ? possible_split_varIDs.size() : 0);
 
-    // Find best split value, if ordered consider all values as split values, else all 2-partitions
-    if (data->isOrderedVariable(varID)) {
+  // Bitsets of node samples if SNPs are split with the bitset kernel
+  buildSnpBitsets(nodeID, possible_split_varIDs, 1, 0);
 
-      // Use memory saving method if option set
-      if (memory_saving_splitting) {
-        findBestSplitValueSmallQ(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease);
-      } else {
-        // Use faster method for both cases
-        double q = (double) num_samples_node / (double) data->getNumUniqueDataValues(varID);
-        if (q < Q_THRESHOLD) {
-          findBestSplitValueSmallQ(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease);
+  // For all possible split variables, in parallel for large nodes with own counters per part
+  searchSplitCandidates(num_samples_node, possible_split_varIDs, best_value, best_varID, best_decrease,
+      [&](size_t start, size_t end, size_t part, double& part_value, size_t& part_varID, double& part_decrease) {
+        if (part == 0) {
+          findBestSplitCandidates(nodeID, possible_split_varIDs, start, end, sum_node, num_samples_node, part_value,
+              part_varID, part_decrease, counter, sums, possible_split_values, value_indices, candidate_histograms);
         } else {
-          findBestSplitValueLargeQ(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease);
+          std::vector<size_t> part_counter(counter.size());
+          std::vector<double> part_sums(sums.size());
+          std::vector<double> part_split_values;
+          std::vector<size_t> part_value_indices;
+          findBestSplitCandidates(nodeID, possible_split_varIDs, start, end, sum_node, num_samples_node, part_value,
+              part_varID, part_decrease, part_counter, part_sums, part_split_values, part_value_indices,
+              candidate_histograms);
         }
-      }
-    } else {
-      findBestSplitValueUnordered(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease);
-    }
-  }
+      });
 
   // Stop if no good split found
   if (best_decrease < 0) {
     return true;
   }
 
+  // Keep histograms for child nodes
+  if (histogram_splitting) {
+    saveHistograms(nodeID, possible_split_varIDs, candidate_histograms);
+  }
+
   // Save best values
   split_varIDs[nodeID] = best_varID;
   split_values[nodeID] = best_value;
@@ -184,12 +195,63 @@ bool TreeRegression::findBestSplit(size_t nodeID, std::vector<size_t>& possible_
   return false;
 }
 
+void TreeRegression::findBestSplitCandidates(size_t nodeID, const std::vector<size_t>& possible_split_varIDs,
+    size_t start, size_t end, double sum_node, size_t num_samples_node, double& best_value, size_t& best_varID,
+    double& best_decrease, std::vector<size_t>& counter, std::vector<double>& sums,
+    std::vector<double>& possible_split_values, std::vector<size_t>& value_indices,
+    std::vector<std::vector<double>>& candidate_histograms) {
+  std::vector<std::pair<double, size_t>> nonzeros;
+  for (size_t i = start; i < end; ++i) {
+    size_t varID = possible_split_varIDs[i];
+
+    // Find best split value, if ordered consider all values as split values, else all 2-partitions
+    if (data->isOrderedVariable(varID)) {
+
+      // Use histogram of bins if binned, nonzeros only if sparse, memory saving method if option set
+      if (histogram_splitting && data->getNumBins(varID) > 0) {
+        countSplitCandidates(SPLIT_HISTOGRAM);
+        findBestSplitValueHistogram(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease,
+            candidate_histograms[i]);
+      } else if (getNodeNonzeros(nodeID, varID, nonzeros)) {
+        countSplitCandidates(SPLIT_SPARSE);
+        findBestSplitValueSparse(varID, sum_node, num_samples_node, best_value, best_varID, best_decrease, nonzeros);
+      } else if (useSnpBitsets(nodeID, varID)) {
+        countSplitCandidates(SPLIT_SNP);
+        findBestSplitValueLargeQ(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease,
+            counter, sums);
+      } else if (memory_saving_splitting) {
+        countSplitCandidates(SPLIT_SMALL_Q);
+        findBestSplitValueSmallQ(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease,
+            counter, sums, possible_split_values, value_indices);
+      } else {
+        // Use faster method for both cases
+        double q = (double) num_samples_node / (double) data->getNumUniqueDataValues(varID);
+        if (q < Q_THRESHOLD) {
+          countSplitCandidates(SPLIT_SMALL_Q);
+          findBestSplitValueSmallQ(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease,
+              counter, sums, possible_split_values, value_indices);
+        } else {
+          countSplitCandidates(SPLIT_LARGE_Q);
+          findBestSplitValueLargeQ(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease,
+              counter, sums);
+        }
+      }
+    } else if (sort_levels) {
+      countSplitCandidates(SPLIT_UNORDERED);
+      findBestSplitValueSortedLevels(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease);
+    } else {
+      countSplitCandidates(SPLIT_UNORDERED);
+      findBestSplitValueUnordered(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease);
+    }
+  }
+}
+
 void TreeRegression::findBestSplitValueSmallQ(size_t nodeID, size_t varID, double sum_node, size_t num_samples_node,
-    double& best_value, size_t& best_varID, double& best_decrease) {
+    double& best_value, size_t& best_varID, double& best_decrease, std::vector<size_t>& counter,
+    std::vector<double>& sums, std::vector<double>& possible_split_values, std::vector<size_t>& value_indices) {
 
-  // Create possible split values
-  std::vector<double> possible_split_values;
-  data->getAllValues(possible_split_values, sampleIDs, varID, start_pos[nodeID], end_pos[nodeID]);
+  // Create possible split values and index of value for each sample
+  data->getAllValues(possible_split_values, value_indices, sampleIDs, varID, start_pos[nodeID], end_pos[nodeID]);
 
   // Try next variable if all equal for this
   if (possible_split_values.size() < 2) {
@@ -198,28 +260,25 @@ void TreeRegression::findBestSplitValueSmallQ(size_t nodeID, size_t varID, doubl
 
   const size_t num_splits = possible_split_values.size();
   if (memory_saving_splitting) {
-    std::vector<double> sums_right(num_splits);
-    std::vector<size_t> n_right(num_splits);
-    findBestSplitValueSmallQ(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease,
-        possible_split_values, sums_right, n_right);
+    // Counters only as large as needed, reused for all nodes
+    sums.assign(num_splits, 0);
+    counter.assign(num_splits, 0);
   } else {
     std::fill_n(sums.begin(), num_splits, 0);
     std::fill_n(counter.begin(), num_splits, 0);
-    findBestSplitValueSmallQ(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease,
-        possible_split_values, sums, counter);
   }
+  findBestSplitValueSmallQ(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease,
+      possible_split_values, value_indices, sums, counter);
 }
 
 void TreeRegression::findBestSplitValueSmallQ(size_t nodeID, size_t varID, double sum_node, size_t num_samples_node,
-    double& best_value, size_t& best_varID, double& best_decrease, std::vector<double> possible_split_values,
-    std::vector<double>& sums, std::vector<size_t>& counter) {
+    double& best_value, size_t& best_varID, double& best_decrease, const std::vector<double>& possible_split_values,
+    const std::vector<size_t>& value_indices, std::vector<double>& sums, std::vector<size_t>& counter) {
 
   for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
-    size_t sampleID = sampleIDs[pos];
-    size_t idx = std::lower_bound(possible_split_values.begin(), possible_split_values.end(),
-        data->get_x(sampleID, varID)) - possible_split_values.begin();
+    size_t idx = value_indices[pos - start_pos[nodeID]];
 
-    sums[idx] += data->get_y(sampleID, 0);
+    sums[idx] += getNodeResponse(pos);
     ++counter[idx];
   }
 
@@ -265,19 +324,22 @@ void TreeRegression::findBestSplitValueSmallQ(size_t nodeID, size_t varID, doubl
 }
 
 void TreeRegression::findBestSplitValueLargeQ(size_t nodeID, size_t varID, double sum_node, size_t num_samples_node,
-    double& best_value, size_t& best_varID, double& best_decrease) {
+    double& best_value, size_t& best_varID, double& best_decrease, std::vector<size_t>& counter,
+    std::vector<double>& sums) {
 
   // Set counters to 0
   size_t num_unique = data->getNumUniqueDataValues(varID);
   std::fill_n(counter.begin(), num_unique, 0);
   std::fill_n(sums.begin(), num_unique, 0);
 
-  for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
-    size_t sampleID = sampleIDs[pos];
-    size_t index = data->getIndex(sampleID, varID);
-
-    sums[index] += data->get_y(sampleID, 0);
-    ++counter[index];
+  // Count values, from the bitsets for SNPs
+  if (useSnpBitsets(nodeID, varID)) {
+    sumSnpResponses(varID, sum_node, num_samples_node, counter, sums);
+  } else {
+    forEachNodeIndex(nodeID, varID, [&](size_t pos, size_t index) {
+      sums[index] += getNodeResponse(pos);
+      ++counter[index];
+    });
   }
 
   size_t n_left = 0;
@@ -327,6 +389,127 @@ void TreeRegression::findBestSplitValueLargeQ(size_t nodeID, size_t varID, doubl
   }
 }
 
+void TreeRegression::findBestSplitValueSparse(size_t varID, double sum_node, size_t num_samples_node,
+    double& best_value, size_t& best_varID, double& best_decrease,
+    const std::vector<std::pair<double, size_t>>& nonzeros) {
+
+  // Zeros are the samples of the node without nonzero
+  size_t num_zeros = num_samples_node;
+  double sum_zeros = sum_node;
+  for (auto& nonzero : nonzeros) {
+    size_t count = sample_counts[nonzero.second];
+    num_zeros -= count;
+    sum_zeros -= count * getResponse(nonzero.second);
+  }
+
+  size_t n_left = 0;
+  double sum_left = 0;
+  double last_value = 0;
+
+  // Compute decrease of impurity for each split between consecutive values
+  forEachSparseValue(nonzeros, num_zeros > 0, [&](double value, size_t begin, size_t end) {
+    if (n_left > 0) {
+      size_t n_right = num_samples_node - n_left;
+      double sum_right = sum_node - sum_left;
+      double decrease = sum_left * sum_left / (double) n_left + sum_right * sum_right / (double) n_right;
+
+      // Regularization
+      regularize(decrease, varID);
+
+      // If better than before, use this
+      if (decrease > best_decrease) {
+        // Use mid-point split
+        best_value = (last_value + value) / 2;
+        best_varID = varID;
+        best_decrease = decrease;
+
+        // Use smaller value if average is numerically the same as the larger value
+        if (best_value == value) {
+          best_value = last_value;
+        }
+      }
+    }
+
+    if (begin == end) {
+      n_left += num_zeros;
+      sum_left += sum_zeros;
+    }
+    for (size_t i = begin; i < end; ++i) {
+      size_t count = sample_counts[nonzeros[i].second];
+      n_left += count;
+      sum_left += count * getResponse(nonzeros[i].second);
+    }
+    last_value = value;
+  });
+}
+
+void TreeRegression::computeLevelHistogramsInternal(size_t varID,
+    const std::vector<std::pair<size_t, size_t>>& requests) {
+  streamLevelHistograms(varID, 2, requests, [&](double* bin, size_t sampleID, uint count) {
+    bin[0] += count;
+    bin[1] += count * getResponse(sampleID);
+  });
+}
+
+void TreeRegression::findBestSplitValueHistogram(size_t nodeID, size_t varID, double sum_node,
+    size_t num_samples_node, double& best_value, size_t& best_varID, double& best_decrease,
+    std::vector<double>& histogram) {
+
+  // Number of samples and sum of responses per bin
+  computeHistogram(histogram, nodeID, varID, 2, [&](double* bin, size_t pos) {
+    ++bin[0];
+    bin[1] += getNodeResponse(pos);
+  });
+
+  size_t num_bins = data->getNumBins(varID);
+  size_t n_left = 0;
+  double sum_left = 0;
+
+  // Compute decrease of impurity for each split between bins
+  for (size_t i = 0; i < num_bins - 1; ++i) {
+
+    // Stop if nothing here
+    size_t count = histogram[2 * i];
+    if (count == 0) {
+      continue;
+    }
+
+    n_left += count;
+    sum_left += histogram[2 * i + 1];
+
+    // Stop if right child empty
+    size_t n_right = num_samples_node - n_left;
+    if (n_right == 0) {
+      break;
+    }
+
+    double sum_right = sum_node - sum_left;
+    double decrease = sum_left * sum_left / (double) n_left + sum_right * sum_right / (double) n_right;
+
+    // Regularization
+    regularize(decrease, varID);
+
+    // If better than before, use this
+    if (decrease > best_decrease) {
+      // Find next bin in this node
+      size_t j = i + 1;
+      while (j < num_bins && histogram[2 * j] == 0) {
+        ++j;
+      }
+
+      // Use mid-point split
+      best_value = (data->getBinMaxValue(varID, i) + data->getBinMinValue(varID, j)) / 2;
+      best_varID = varID;
+      best_decrease = decrease;
+
+      // Use smaller value if average is numerically the same as the larger value
+      if (best_value == data->getBinMinValue(varID, j)) {
+        best_value = data->getBinMaxValue(varID, i);
+      }
+    }
+  }
+}
+
 void TreeRegression::findBestSplitValueUnordered(size_t nodeID, size_t varID, double sum_node, size_t num_samples_node,
     double& best_value, size_t& best_varID, double& best_decrease) {
 
@@ -364,7 +547,7 @@ void TreeRegression::findBestSplitValueUnordered(size_t nodeID, size_t varID, do
     // Sum in right child
     for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
       size_t sampleID = sampleIDs[pos];
-      double response = data->get_y(sampleID, 0);
+      double response = getNodeResponse(pos);
       double value = data->get_x(sampleID, varID);
       size_t factorID = floor(value) - 1;
 
@@ -393,6 +576,69 @@ void TreeRegression::findBestSplitValueUnordered(size_t nodeID, size_t varID, do
   }
 }
 
+void TreeRegression::findBestSplitValueSortedLevels(size_t nodeID, size_t varID, double sum_node,
+    size_t num_samples_node, double& best_value, size_t& best_varID, double& best_decrease) {
+
+  // Create possible split values
+  std::vector<double> factor_levels;
+  data->getAllValues(factor_levels, sampleIDs, varID, start_pos[nodeID], end_pos[nodeID]);
+
+  // Try next variable if all equal for this
+  if (factor_levels.size() < 2) {
+    return;
+  }
+
+  // Count samples and sum responses per level
+  size_t num_factorIDs = floor(factor_levels.back());
+  std::vector<size_t> counter(num_factorIDs);
+  std::vector<double> sums(num_factorIDs);
+  for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
+    size_t factorID = floor(data->get_x(sampleIDs[pos], varID)) - 1;
+    ++counter[factorID];
+    sums[factorID] += getNodeResponse(pos);
+  }
+
+  // Order levels by mean response, the best split is between two consecutive levels (Fisher 1958)
+  std::vector<double> means(num_factorIDs);
+  for (size_t j = 0; j < num_factorIDs; ++j) {
+    if (counter[j] > 0) {
+      means[j] = sums[j] / (double) counter[j];
+    }
+  }
+  std::vector<size_t> factorIDs = orderFactorLevels(factor_levels, means);
+
+  // Move levels to the left child in this order, the others are right
+  size_t all_levels = 0;
+  for (auto& factorID : factorIDs) {
+    all_levels = all_levels | (1ULL << factorID);
+  }
+  size_t largest_level = 1ULL << (num_factorIDs - 1);
+  size_t splitID = all_levels;
+  double sum_left = 0;
+  size_t n_left = 0;
+  for (size_t i = 0; i < factorIDs.size() - 1; ++i) {
+    size_t factorID = factorIDs[i];
+    sum_left += sums[factorID];
+    n_left += counter[factorID];
+    splitID = splitID & ~(1ULL << factorID);
+    size_t n_right = num_samples_node - n_left;
+
+    // Sum of squares
+    double sum_right = sum_node - sum_left;
+    double decrease = sum_left * sum_left / (double) n_left + sum_right * sum_right / (double) n_right;
+
+    // Regularization
+    regularize(decrease, varID);
+
+    // If better than before, use this
+    if (decrease > best_decrease) {
+      best_value = encodeFactorSplit(splitID, all_levels, largest_level);
+      best_varID = varID;
+      best_decrease = decrease;
+    }
+  }
+}
+
 bool TreeRegression::findBestSplitMaxstat(size_t nodeID, std::vector<size_t>& possible_split_varIDs) {
 
   size_t num_samples_node = end_pos[nodeID] - start_pos[nodeID];
@@ -401,8 +647,7 @@ bool TreeRegression::findBestSplitMaxstat(size_t nodeID, std::vector<size_t>& po
   std::vector<double> response;
   response.reserve(num_samples_node);
   for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
-    size_t sampleID = sampleIDs[pos];
-    response.push_back(data->get_y(sampleID, 0));
+    response.push_back(getNodeResponse(pos));
   }
   std::vector<double> ranks = rank(response);
 
@@ -416,6 +661,8 @@ bool TreeRegression::findBestSplitMaxstat(size_t nodeID, std::vector<size_t>& po
   std::vector<double> test_statistics;
   test_statistics.reserve(possible_split_varIDs.size());
 
+  countSplitCandidates(SPLIT_OTHER, possible_split_varIDs.size());
+
   // Compute p-values
   for (auto& varID : possible_split_varIDs) {
 
@@ -428,7 +675,7 @@ bool TreeRegression::findBestSplitMaxstat(size_t nodeID, std::vector<size_t>& po
     }
 
     // Order by x
-    std::vector<size_t> indices = order(x, false);
+    std::vector<size_t> indices = orderNodeSamples(nodeID, varID, x);
     //std::vector<size_t> indices = orderInData(data, sampleIDs[nodeID], varID, false);
 
     // Compute maximally selected rank statistics
@@ -506,10 +753,11 @@ bool TreeRegression::findBestSplitExtraTrees(size_t nodeID, std::vector<size_t>&
   // Compute sum of responses in node
   double sum_node = 0;
   for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
-    size_t sampleID = sampleIDs[pos];
-    sum_node += data->get_y(sampleID, 0);
+    sum_node += getNodeResponse(pos);
   }
 
+  countSplitCandidates(SPLIT_OTHER, possible_split_varIDs.size());
+
   // For all possible split variables
   for (auto& varID : possible_split_varIDs) {
 
@@ -589,7 +837,7 @@ void TreeRegression::findBestSplitValueExtraTrees(size_t nodeID, size_t varID, d
   for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
     size_t sampleID = sampleIDs[pos];
     double value = data->get_x(sampleID, varID);
-    double response = data->get_y(sampleID, 0);
+    double response = getNodeResponse(pos);
 
     // Count samples until split_value reached
     for (size_t i = 0; i < num_splits; ++i) {
@@ -634,11 +882,9 @@ void TreeRegression::findBestSplitValueExtraTreesUnordered(size_t nodeID, size_t
 
   // Get all factor indices in node
   std::vector<bool> factor_in_node(num_unique_values, false);
-  for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
-    size_t sampleID = sampleIDs[pos];
-    size_t index = data->getIndex(sampleID, varID);
+  forEachNodeIndex(nodeID, varID, [&](size_t pos, size_t index) {
     factor_in_node[index] = true;
-  }
+  });
 
   // Vector of indices in and out of node
   std::vector<size_t> indices_in_node;
@@ -693,7 +939,7 @@ void TreeRegression::findBestSplitValueExtraTreesUnordered(size_t nodeID, size_t
     // Sum in right child
     for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
       size_t sampleID = sampleIDs[pos];
-      double response = data->get_y(sampleID, 0);
+      double response = getNodeResponse(pos);
       double value = data->get_x(sampleID, varID);
       size_t factorID = floor(value) - 1;
 
@@ -732,10 +978,11 @@ bool TreeRegression::findBestSplitBeta(size_t nodeID, std::vector<size_t>& possi
   // Compute sum of responses in node
   double sum_node = 0;
   for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
-    size_t sampleID = sampleIDs[pos];
-    sum_node += data->get_y(sampleID, 0);
+    sum_node += getNodeResponse(pos);
   }
 
+  countSplitCandidates(SPLIT_OTHER, possible_split_varIDs.size());
+
   // For all possible split variables find best split value
   for (auto& varID : possible_split_varIDs) {
     findBestSplitValueBeta(nodeID, varID, sum_node, num_samples_node, best_value, best_varID, best_decrease);
@@ -798,7 +1045,7 @@ void TreeRegression::findBestSplitValueBeta(size_t nodeID, size_t varID, double
   for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
     size_t sampleID = sampleIDs[pos];
     double value = data->get_x(sampleID, varID);
-    double response = data->get_y(sampleID, 0);
+    double response = getNodeResponse(pos);
 
     // Count samples until split_value reached
     for (size_t i = 0; i < num_splits; ++i) {
@@ -832,7 +1079,7 @@ void TreeRegression::findBestSplitValueBeta(size_t nodeID, size_t varID, double
     for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
       size_t sampleID = sampleIDs[pos];
       double value = data->get_x(sampleID, varID);
-      double response = data->get_y(sampleID, 0);
+      double response = getNodeResponse(pos);
 
       if (value > possible_split_values[i]) {
         var_right += (response - mean_right) * (response - mean_right);
@@ -858,7 +1105,7 @@ void TreeRegression::findBestSplitValueBeta(size_t nodeID, size_t varID, double
     for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
       size_t sampleID = sampleIDs[pos];
       double value = data->get_x(sampleID, varID);
-      double response = data->get_y(sampleID, 0);
+      double response = getNodeResponse(pos);
 
       if (value > possible_split_values[i]) {
         beta_loglik_right += betaLogLik(response, mean_right, phi_right);
@@ -900,8 +1147,7 @@ void TreeRegression::addImpurityImportance(size_t nodeID, size_t varID, double d
   if (splitrule != MAXSTAT) {
     double sum_node = 0;
     for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
-      size_t sampleID = sampleIDs[pos];
-      sum_node += data->get_y(sampleID, 0);
+      sum_node += getNodeResponse(pos);
     }
 
     double impurity_node = (sum_node * sum_node / (double) num_samples_node);
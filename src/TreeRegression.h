@@ -39,8 +39,11 @@ public:
   void appendToFileInternal(std::ofstream& file) override;
 
   double getPrediction(size_t sampleID) const {
-    size_t terminal_nodeID = prediction_terminal_nodeIDs[sampleID];
-    return (split_values[terminal_nodeID]);
+    return getNodePrediction(prediction_terminal_nodeIDs[sampleID]);
+  }
+
+  double getNodePrediction(size_t nodeID) const {
+    return getTerminalValue(nodeID);
   }
 
   size_t getPredictionTerminalNodeID(size_t sampleID) const {
@@ -50,20 +53,38 @@ public:
 private:
   bool splitNodeInternal(size_t nodeID, std::vector<size_t>& possible_split_varIDs) override;
   void createEmptyNodeInternal() override;
+  void computeLevelHistogramsInternal(size_t varID, const std::vector<std::pair<size_t, size_t>>& requests) override;
 
   double computePredictionAccuracyInternal(std::vector<double>* prediction_error_casewise) override;
+  bool hasAdditiveAccuracy() const override {
+    return true;
+  }
+  double computeOobSampleError(size_t oob_idx, size_t terminal_nodeID) const override;
   
   // Called by splitNodeInternal(). Sets split_varIDs and split_values.
   bool findBestSplit(size_t nodeID, std::vector<size_t>& possible_split_varIDs);
+  void findBestSplitCandidates(size_t nodeID, const std::vector<size_t>& possible_split_varIDs, size_t start,
+      size_t end, double sum_node, size_t num_samples_node, double& best_value, size_t& best_varID,
+      double& best_decrease, std::vector<size_t>& counter, std::vector<double>& sums,
+      std::vector<double>& possible_split_values, std::vector<size_t>& value_indices,
+      std::vector<std::vector<double>>& candidate_histograms);
   void findBestSplitValueSmallQ(size_t nodeID, size_t varID, double sum_node, size_t num_samples_node,
-      double& best_value, size_t& best_varID, double& best_decrease);
+      double& best_value, size_t& best_varID, double& best_decrease, std::vector<size_t>& counter,
+      std::vector<double>& sums, std::vector<double>& possible_split_values, std::vector<size_t>& value_indices);
   void findBestSplitValueSmallQ(size_t nodeID, size_t varID, double sum_node, size_t num_samples_node,
-      double& best_value, size_t& best_varID, double& best_decrease, std::vector<double> possible_split_values,
-      std::vector<double>& sums, std::vector<size_t>& counter);
+      double& best_value, size_t& best_varID, double& best_decrease, const std::vector<double>& possible_split_values,
+      const std::vector<size_t>& value_indices, std::vector<double>& sums, std::vector<size_t>& counter);
   void findBestSplitValueLargeQ(size_t nodeID, size_t varID, double sum_node, size_t num_samples_node,
-      double& best_value, size_t& best_varID, double& best_decrease);
+      double& best_value, size_t& best_varID, double& best_decrease, std::vector<size_t>& counter,
+      std::vector<double>& sums);
+  void findBestSplitValueHistogram(size_t nodeID, size_t varID, double sum_node, size_t num_samples_node,
+      double& best_value, size_t& best_varID, double& best_decrease, std::vector<double>& histogram);
+  void findBestSplitValueSparse(size_t varID, double sum_node, size_t num_samples_node, double& best_value,
+      size_t& best_varID, double& best_decrease, const std::vector<std::pair<double, size_t>>& nonzeros);
   void findBestSplitValueUnordered(size_t nodeID, size_t varID, double sum_node, size_t num_samples_node,
       double& best_value, size_t& best_varID, double& best_decrease);
+  void findBestSplitValueSortedLevels(size_t nodeID, size_t varID, double sum_node, size_t num_samples_node,
+      double& best_value, size_t& best_varID, double& best_decrease);
 
   bool findBestSplitMaxstat(size_t nodeID, std::vector<size_t>& possible_split_varIDs);
 
@@ -87,15 +108,27 @@ private:
 
   double computePredictionMSE();
 
+  size_t getNumNodeResponseColumns() const override {
+    return 1;
+  }
+
   void cleanUpInternal() override {
     counter.clear();
     counter.shrink_to_fit();
     sums.clear();
     sums.shrink_to_fit();
+    possible_split_values.clear();
+    possible_split_values.shrink_to_fit();
+    value_indices.clear();
+    value_indices.shrink_to_fit();
   }
 
   std::vector<size_t> counter;
   std::vector<double> sums;
+
+  // Split values of a variable and index of each sample's value, reused for all nodes
+  std::vector<double> possible_split_values;
+  std::vector<size_t> value_indices;
 };
 
 } // namespace ranger
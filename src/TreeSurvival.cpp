@@ -13,6 +13,7 @@
 #include <cmath>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <numeric>
 
 #include "utility.h"
@@ -22,8 +23,8 @@
 namespace ranger {
 
 TreeSurvival::TreeSurvival(std::vector<double>* unique_timepoints, std::vector<size_t>* response_timepointIDs) :
-    unique_timepoints(unique_timepoints), response_timepointIDs(response_timepointIDs), num_deaths(0), num_samples_at_risk(
-        0) {
+    unique_timepoints(unique_timepoints), response_timepointIDs(response_timepointIDs), mapped_chf_steps_begin(0), mapped_chf_step_timepointIDs(
+        0), mapped_chf_step_values(0), num_deaths(0), num_samples_at_risk(0) {
   this->num_timepoints = unique_timepoints->size();
 }
 
@@ -31,8 +32,20 @@ TreeSurvival::TreeSurvival(std::vector<std::vector<size_t>>& child_nodeIDs, std:
     std::vector<double>& split_values, std::vector<std::vector<double>> chf, std::vector<double>* unique_timepoints,
     std::vector<size_t>* response_timepointIDs) :
     Tree(child_nodeIDs, split_varIDs, split_values), unique_timepoints(unique_timepoints), response_timepointIDs(
-        response_timepointIDs), chf(chf), num_deaths(0), num_samples_at_risk(0) {
+        response_timepointIDs), mapped_chf_steps_begin(0), mapped_chf_step_timepointIDs(0), mapped_chf_step_values(0), num_deaths(
+        0), num_samples_at_risk(0) {
   this->num_timepoints = unique_timepoints->size();
+
+  // Convert to steps
+  size_t num_nodes = chf.size();
+  chf_steps_begin.resize(num_nodes, 0);
+  chf_steps_end.resize(num_nodes, 0);
+  chf_sums.resize(num_nodes, 0);
+  for (size_t i = 0; i < num_nodes; ++i) {
+    if (!chf[i].empty()) {
+      setChf(i, chf[i]);
+    }
+  }
 }
 
 void TreeSurvival::allocateMemory() {
@@ -46,6 +59,7 @@ void TreeSurvival::appendToFileInternal(std::ofstream& file) {  // #nocov start
   // Convert to vector without empty elements and save
   std::vector<size_t> terminal_nodes;
   std::vector<std::vector<double>> chf_vector;
+  std::vector<std::vector<double>> chf = getChf();
   for (size_t i = 0; i < chf.size(); ++i) {
     if (!chf[i].empty()) {
       terminal_nodes.push_back(i);
@@ -56,30 +70,94 @@ void TreeSurvival::appendToFileInternal(std::ofstream& file) {  // #nocov start
   saveVector2D(chf_vector, file);
 } // #nocov end
 
+// #nocov start
+void TreeSurvival::appendToBinaryFileInternal(BlockFileWriter& file) const {
+
+  // Steps of all nodes one after another
+  std::vector<uint64_t> steps_begin(num_prediction_nodes + 1, 0);
+  std::vector<uint32_t> step_timepointIDs;
+  std::vector<double> step_values;
+  for (size_t i = 0; i < num_prediction_nodes; ++i) {
+    for (size_t step = chf_steps_begin[i]; step < chf_steps_end[i]; ++step) {
+      step_timepointIDs.push_back(chf_step_timepointIDs[step]);
+      step_values.push_back(chf_step_values[step]);
+    }
+    steps_begin[i + 1] = step_values.size();
+  }
+  file.writeArray(steps_begin.data(), steps_begin.size());
+  file.writeArray(step_timepointIDs.data(), step_timepointIDs.size());
+  file.writeArray(step_values.data(), step_values.size());
+}
+
+void TreeSurvival::loadFromBinaryFileInternal(MappedFile& file) {
+  mapped_chf_steps_begin = file.nextArray<uint64_t>(num_prediction_nodes + 1);
+  size_t num_steps = mapped_chf_steps_begin[num_prediction_nodes];
+  mapped_chf_step_timepointIDs = file.nextArray<uint32_t>(num_steps);
+  mapped_chf_step_values = file.nextArray<double>(num_steps);
+}
+// #nocov end
+
+std::vector<std::vector<double>> TreeSurvival::getChf() const {
+  std::vector<std::vector<double>> result(chf_steps_begin.size());
+  for (size_t nodeID = 0; nodeID < result.size(); ++nodeID) {
+    if (child_nodeIDs[0][nodeID] == 0 && child_nodeIDs[1][nodeID] == 0) {
+      result[nodeID].resize(num_timepoints, 0);
+      for (size_t step = chf_steps_begin[nodeID]; step < chf_steps_end[nodeID]; ++step) {
+        size_t next_timepointID =
+            step + 1 < chf_steps_end[nodeID] ? chf_step_timepointIDs[step + 1] : num_timepoints;
+        std::fill(result[nodeID].begin() + chf_step_timepointIDs[step], result[nodeID].begin() + next_timepointID,
+            chf_step_values[step]);
+      }
+    }
+  }
+  return result;
+}
+
 void TreeSurvival::createEmptyNodeInternal() {
-  chf.push_back(std::vector<double>());
+  chf_steps_begin.push_back(0);
+  chf_steps_end.push_back(0);
+  chf_sums.push_back(0);
 }
 
 void TreeSurvival::computeSurvival(size_t nodeID) {
-  std::vector<double> chf_temp;
-  chf_temp.reserve(num_timepoints);
+  chf_steps_begin[nodeID] = chf_step_timepointIDs.size();
   double chf_value = 0;
+  double chf_sum = 0;
   for (size_t i = 0; i < num_timepoints; ++i) {
-    if (num_samples_at_risk[i] != 0) {
+    if (num_samples_at_risk[i] != 0 && num_deaths[i] != 0) {
       chf_value += (double) num_deaths[i] / (double) num_samples_at_risk[i];
+      chf_step_timepointIDs.push_back(i);
+      chf_step_values.push_back(chf_value);
+    }
+    chf_sum += chf_value;
+  }
+  chf_steps_end[nodeID] = chf_step_timepointIDs.size();
+  chf_sums[nodeID] = chf_sum;
+}
+
+void TreeSurvival::setChf(size_t nodeID, const std::vector<double>& node_chf) {
+  chf_steps_begin[nodeID] = chf_step_timepointIDs.size();
+  double chf_value = 0;
+  double chf_sum = 0;
+  for (size_t i = 0; i < node_chf.size(); ++i) {
+    if (node_chf[i] != chf_value) {
+      chf_value = node_chf[i];
+      chf_step_timepointIDs.push_back(i);
+      chf_step_values.push_back(chf_value);
     }
-    chf_temp.push_back(chf_value);
+    chf_sum += chf_value;
   }
-  chf[nodeID] = chf_temp;
+  chf_steps_end[nodeID] = chf_step_timepointIDs.size();
+  chf_sums[nodeID] = chf_sum;
 }
 
 double TreeSurvival::computePredictionAccuracyInternal(std::vector<double>* prediction_error_casewise) {
 
   // Compute summed chf for samples
   std::vector<double> sum_chf;
+  sum_chf.reserve(prediction_terminal_nodeIDs.size());
   for (size_t i = 0; i < prediction_terminal_nodeIDs.size(); ++i) {
-    size_t terminal_nodeID = prediction_terminal_nodeIDs[i];
-    sum_chf.push_back(std::accumulate(chf[terminal_nodeID].begin(), chf[terminal_nodeID].end(), 0.0));
+    sum_chf.push_back(chf_sums[prediction_terminal_nodeIDs[i]]);
   }
 
   // Return concordance index
@@ -93,9 +171,8 @@ bool TreeSurvival::splitNodeInternal(size_t nodeID, std::vector<size_t>& possibl
   double pure_time = 0;
   double pure_status = 0;
   for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
-    size_t sampleID = sampleIDs[pos];
-    double time = data->get_y(sampleID, 0);
-    double status = data->get_y(sampleID, 1);
+    double time = getNodeResponse(pos);
+    double status = getNodeResponse(pos, 1);
     if (pos != start_pos[nodeID] && (time != pure_time || status != pure_status)) {
       pure = false;
       break;
@@ -136,21 +213,31 @@ bool TreeSurvival::findBestSplit(size_t nodeID, std::vector<size_t>& possible_sp
   // Stop early if no split posssible
   if (num_samples_node >= 2 * min_node_size) {
 
-    // For all possible split variables
-    for (auto& varID : possible_split_varIDs) {
-
-      // Find best split value, if ordered consider all values as split values, else all 2-partitions
-      if (data->isOrderedVariable(varID)) {
-        if (splitrule == LOGRANK) {
-          findBestSplitValueLogRank(nodeID, varID, best_value, best_varID, best_decrease);
-        } else if (splitrule == AUC || splitrule == AUC_IGNORE_TIES) {
-          findBestSplitValueAUC(nodeID, varID, best_value, best_varID, best_decrease);
-        }
-      } else {
-        findBestSplitValueLogRankUnordered(nodeID, varID, best_value, best_varID, best_decrease);
-      }
-
-    }
+    // For all possible split variables, in parallel for large nodes
+    searchSplitCandidates(num_samples_node, possible_split_varIDs, best_value, best_varID, best_decrease,
+        [&](size_t start, size_t end, size_t part, double& part_value, size_t& part_varID, double& part_decrease) {
+          LogrankBuffers part_buffers;
+          LogrankBuffers& buffers = (part == 0) ? logrank_buffers : part_buffers;
+          for (size_t i = start; i < end; ++i) {
+            size_t varID = possible_split_varIDs[i];
+
+            // Find best split value, if ordered consider all values as split values, else all 2-partitions
+            if (data->isOrderedVariable(varID)) {
+              countSplitCandidates(SPLIT_OTHER);
+              if (splitrule == LOGRANK) {
+                findBestSplitValueLogRank(nodeID, varID, part_value, part_varID, part_decrease, buffers);
+              } else if (splitrule == AUC || splitrule == AUC_IGNORE_TIES) {
+                findBestSplitValueAUC(nodeID, varID, part_value, part_varID, part_decrease);
+              }
+            } else if (sort_levels) {
+              countSplitCandidates(SPLIT_UNORDERED);
+              findBestSplitValueLogRankSortedLevels(nodeID, varID, part_value, part_varID, part_decrease);
+            } else {
+              countSplitCandidates(SPLIT_UNORDERED);
+              findBestSplitValueLogRankUnordered(nodeID, varID, part_value, part_varID, part_decrease);
+            }
+          }
+        });
   }
 
   // Stop and save CHF if no good split found (this is terminal node).
@@ -185,17 +272,20 @@ bool TreeSurvival::findBestSplitMaxstat(size_t nodeID, std::vector<size_t>& poss
     return true;
   }
 
-  // Compute scores
+  // Compute scores, timepoint IDs have the same order as the times
   std::vector<double> time;
   time.reserve(num_samples_node);
   std::vector<double> status;
   status.reserve(num_samples_node);
+  std::vector<size_t> timepointIDs;
+  timepointIDs.reserve(num_samples_node);
   for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
     size_t sampleID = sampleIDs[pos];
-    time.push_back(data->get_y(sampleID, 0));
-    status.push_back(data->get_y(sampleID, 1));
+    time.push_back(getNodeResponse(pos));
+    status.push_back(getNodeResponse(pos, 1));
+    timepointIDs.push_back((*response_timepointIDs)[sampleID]);
   }
-  std::vector<double> scores = logrankScores(time, status);
+  std::vector<double> scores = logrankScores(time, status, orderRadix(timepointIDs, unique_timepoints->size()));
 
   // Save split stats
   std::vector<double> pvalues;
@@ -207,6 +297,8 @@ bool TreeSurvival::findBestSplitMaxstat(size_t nodeID, std::vector<size_t>& poss
   std::vector<double> test_statistics;
   test_statistics.reserve(possible_split_varIDs.size());
 
+  countSplitCandidates(SPLIT_OTHER, possible_split_varIDs.size());
+
   // Compute p-values
   for (auto& varID : possible_split_varIDs) {
 
@@ -219,7 +311,7 @@ bool TreeSurvival::findBestSplitMaxstat(size_t nodeID, std::vector<size_t>& poss
     }
 
     // Order by x
-    std::vector<size_t> indices = order(x, false);
+    std::vector<size_t> indices = orderNodeSamples(nodeID, varID, x);
     //std::vector<size_t> indices = orderInData(data, sampleIDs[nodeID], varID, false);
 
     // Compute maximally selected rank statistics
@@ -306,23 +398,19 @@ void TreeSurvival::computeDeathCounts(size_t nodeID) {
     num_samples_at_risk[i] = 0;
   }
 
+  // Count samples and deaths at their survival time
   for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
     size_t sampleID = sampleIDs[pos];
-    double survival_time = data->get_y(sampleID, 0);
-
-    size_t t = 0;
-    while (t < num_timepoints && (*unique_timepoints)[t] < survival_time) {
-      ++num_samples_at_risk[t];
-      ++t;
+    size_t survival_timeID = (*response_timepointIDs)[sampleID];
+    ++num_samples_at_risk[survival_timeID];
+    if (getNodeResponse(pos, 1) == 1) {
+      ++num_deaths[survival_timeID];
     }
+  }
 
-    // Now t is the survival time, add to at risk and to death if death
-    if (t < num_timepoints) {
-      ++num_samples_at_risk[t];
-      if (data->get_y(sampleID, 1) == 1) {
-        ++num_deaths[t];
-      }
-    }
+  // Samples are at risk until their survival time
+  for (size_t t = num_timepoints; t-- > 1;) {
+    num_samples_at_risk[t - 1] += num_samples_at_risk[t];
   }
 }
 
@@ -342,7 +430,7 @@ void TreeSurvival::computeChildDeathCounts(size_t nodeID, size_t varID, std::vec
       if (value > possible_split_values[i]) {
         ++num_samples_right_child[i];
         ++delta_samples_at_risk_right_child[i * num_timepoints + survival_timeID];
-        if (data->get_y(sampleID, 1) == 1) {
+        if (getNodeResponse(pos, 1) == 1) {
           ++num_deaths_right_child[i * num_timepoints + survival_timeID];
         }
       } else {
@@ -353,13 +441,14 @@ void TreeSurvival::computeChildDeathCounts(size_t nodeID, size_t varID, std::vec
 }
 
 void TreeSurvival::findBestSplitValueLogRank(size_t nodeID, size_t varID, double& best_value, size_t& best_varID,
-    double& best_logrank) {
+    double& best_logrank, LogrankBuffers& buffers) {
 
   size_t num_samples_node = end_pos[nodeID] - start_pos[nodeID];
 
-  // Create possible split values
-  std::vector<double> possible_split_values;
-  data->getAllValues(possible_split_values, sampleIDs, varID, start_pos[nodeID], end_pos[nodeID]);
+  // Create possible split values and index of value for each sample
+  std::vector<double>& possible_split_values = buffers.possible_split_values;
+  std::vector<size_t>& value_indices = buffers.value_indices;
+  data->getAllValues(possible_split_values, value_indices, sampleIDs, varID, start_pos[nodeID], end_pos[nodeID]);
 
   // Try next variable if all equal for this
   if (possible_split_values.size() < 2) {
@@ -369,27 +458,50 @@ void TreeSurvival::findBestSplitValueLogRank(size_t nodeID, size_t varID, double
   // -1 because no split possible at largest value
   size_t num_splits = possible_split_values.size() - 1;
 
-  // Initialize
-  std::vector<size_t> num_deaths_right_child(num_splits * num_timepoints);
-  std::vector<size_t> delta_samples_at_risk_right_child(num_splits * num_timepoints);
-  std::vector<size_t> num_samples_right_child(num_splits);
-
-  computeChildDeathCounts(nodeID, varID, possible_split_values, num_samples_right_child,
-      delta_samples_at_risk_right_child, num_deaths_right_child, num_splits);
+  // Group samples by value index, afterwards samples with value index v are in [value_starts[v-1], value_starts[v])
+  std::vector<size_t>& value_starts = buffers.value_starts;
+  std::vector<size_t>& sorted_sampleIDs = buffers.sorted_sampleIDs;
+  value_starts.assign(num_splits + 2, 0);
+  for (auto& value_index : value_indices) {
+    ++value_starts[value_index + 1];
+  }
+  for (size_t v = 1; v < value_starts.size(); ++v) {
+    value_starts[v] += value_starts[v - 1];
+  }
+  sorted_sampleIDs.resize(num_samples_node);
+  for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
+    sorted_sampleIDs[value_starts[value_indices[pos - start_pos[nodeID]]]++] = sampleIDs[pos];
+  }
 
-  // Compute logrank test for all splits and use best
-  for (size_t i = 0; i < num_splits; ++i) {
-    double numerator = 0;
-    double denominator_squared = 0;
+  // Sweep splits from largest value, a sample is in the right child of all splits below its value index
+  std::vector<size_t>& num_deaths_right_child = buffers.num_deaths_right_child;
+  std::vector<size_t>& delta_samples_at_risk_right_child = buffers.delta_samples_at_risk_right_child;
+  std::vector<double>& logranks = buffers.logranks;
+  num_deaths_right_child.assign(num_timepoints, 0);
+  delta_samples_at_risk_right_child.assign(num_timepoints, 0);
+  logranks.assign(num_splits, -std::numeric_limits<double>::infinity());
+  size_t num_samples_right_child = 0;
+  for (size_t i = num_splits; i-- > 0;) {
+    for (size_t j = value_starts[i]; j < value_starts[i + 1]; ++j) {
+      size_t sampleID = sorted_sampleIDs[j];
+      size_t survival_timeID = (*response_timepointIDs)[sampleID];
+      ++num_samples_right_child;
+      ++delta_samples_at_risk_right_child[survival_timeID];
+      if (getResponse(sampleID, 1) == 1) {
+        ++num_deaths_right_child[survival_timeID];
+      }
+    }
 
     // Stop if minimal node size reached
-    size_t num_samples_left_child = num_samples_node - num_samples_right_child[i];
-    if (num_samples_right_child[i] < min_node_size || num_samples_left_child < min_node_size) {
+    size_t num_samples_left_child = num_samples_node - num_samples_right_child;
+    if (num_samples_right_child < min_node_size || num_samples_left_child < min_node_size) {
       continue;
     }
 
     // Compute logrank test statistic for this split
-    size_t num_samples_at_risk_right_child = num_samples_right_child[i];
+    double numerator = 0;
+    double denominator_squared = 0;
+    size_t num_samples_at_risk_right_child = num_samples_right_child;
     for (size_t t = 0; t < num_timepoints; ++t) {
       if (num_samples_at_risk[t] < 2 || num_samples_at_risk_right_child < 1) {
         break;
@@ -398,7 +510,7 @@ void TreeSurvival::findBestSplitValueLogRank(size_t nodeID, size_t varID, double
       if (num_deaths[t] > 0) {
         // Numerator and demoninator for log-rank test, notation from Ishwaran et al.
         double di = (double) num_deaths[t];
-        double di1 = (double) num_deaths_right_child[i * num_timepoints + t];
+        double di1 = (double) num_deaths_right_child[t];
         double Yi = (double) num_samples_at_risk[t];
         double Yi1 = (double) num_samples_at_risk_right_child;
         numerator += di1 - Yi1 * (di / Yi);
@@ -406,7 +518,7 @@ void TreeSurvival::findBestSplitValueLogRank(size_t nodeID, size_t varID, double
       }
 
       // Reduce number of samples at risk for next timepoint
-      num_samples_at_risk_right_child -= delta_samples_at_risk_right_child[i * num_timepoints + t];
+      num_samples_at_risk_right_child -= delta_samples_at_risk_right_child[t];
 
     }
     double logrank = -1;
@@ -416,11 +528,15 @@ void TreeSurvival::findBestSplitValueLogRank(size_t nodeID, size_t varID, double
 
     // Regularization
     regularize(logrank, varID);
+    logranks[i] = logrank;
+  }
 
-    if (logrank > best_logrank) {
+  // Use best split, smallest split value on ties
+  for (size_t i = 0; i < num_splits; ++i) {
+    if (logranks[i] > best_logrank) {
       best_value = (possible_split_values[i] + possible_split_values[i + 1]) / 2;
       best_varID = varID;
-      best_logrank = logrank;
+      best_logrank = logranks[i];
 
       // Use smaller value if average is numerically the same as the larger value
       if (best_value == possible_split_values[i + 1]) {
@@ -481,7 +597,7 @@ void TreeSurvival::findBestSplitValueLogRankUnordered(size_t nodeID, size_t varI
       if ((splitID & (1ULL << factorID))) {
         ++num_samples_right_child;
         ++delta_samples_at_risk_right_child[survival_timeID];
-        if (data->get_y(sampleID, 1) == 1) {
+        if (getNodeResponse(pos, 1) == 1) {
           ++num_deaths_right_child[survival_timeID];
         }
       }
@@ -530,12 +646,139 @@ void TreeSurvival::findBestSplitValueLogRankUnordered(size_t nodeID, size_t varI
   }
 }
 
+void TreeSurvival::findBestSplitValueLogRankSortedLevels(size_t nodeID, size_t varID, double& best_value,
+    size_t& best_varID, double& best_logrank) {
+
+  size_t num_samples_node = end_pos[nodeID] - start_pos[nodeID];
+
+  // Create possible split values
+  std::vector<double> factor_levels;
+  data->getAllValues(factor_levels, sampleIDs, varID, start_pos[nodeID], end_pos[nodeID]);
+
+  // Try next variable if all equal for this
+  if (factor_levels.size() < 2) {
+    return;
+  }
+
+  // Nelson-Aalen estimate of the node at each timepoint
+  std::vector<double> chf(num_timepoints);
+  double cumulative_hazard = 0;
+  for (size_t t = 0; t < num_timepoints; ++t) {
+    if (num_deaths[t] > 0) {
+      cumulative_hazard += (double) num_deaths[t] / (double) num_samples_at_risk[t];
+    }
+    chf[t] = cumulative_hazard;
+  }
+
+  // Sum martingale residuals per level
+  size_t num_factorIDs = floor(factor_levels.back());
+  std::vector<size_t> counter(num_factorIDs);
+  std::vector<double> residuals(num_factorIDs);
+  std::vector<size_t> value_factorIDs(num_samples_node);
+  for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
+    size_t sampleID = sampleIDs[pos];
+    size_t factorID = floor(data->get_x(sampleID, varID)) - 1;
+    value_factorIDs[pos - start_pos[nodeID]] = factorID;
+    ++counter[factorID];
+    residuals[factorID] += getNodeResponse(pos, 1) - chf[(*response_timepointIDs)[sampleID]];
+  }
+
+  // Order levels by mean martingale residual, i.e. by observed minus expected deaths per sample
+  for (size_t j = 0; j < num_factorIDs; ++j) {
+    if (counter[j] > 0) {
+      residuals[j] /= (double) counter[j];
+    }
+  }
+  std::vector<size_t> factorIDs = orderFactorLevels(factor_levels, residuals);
+
+  // Group the node positions by level in this order
+  std::vector<size_t> level_starts(num_factorIDs);
+  size_t sum = 0;
+  for (auto& factorID : factorIDs) {
+    level_starts[factorID] = sum;
+    sum += counter[factorID];
+  }
+  std::vector<size_t> level_positions(num_samples_node);
+  for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
+    level_positions[level_starts[value_factorIDs[pos - start_pos[nodeID]]]++] = pos;
+  }
+
+  // Move levels to the right child in this order, the others are left
+  std::vector<size_t> num_deaths_right_child(num_timepoints);
+  std::vector<size_t> delta_samples_at_risk_right_child(num_timepoints);
+  size_t num_samples_right_child = 0;
+  size_t all_levels = 0;
+  for (auto& factorID : factorIDs) {
+    all_levels = all_levels | (1ULL << factorID);
+  }
+  size_t largest_level = 1ULL << (num_factorIDs - 1);
+  size_t splitID = 0;
+  for (size_t i = 0; i < factorIDs.size() - 1; ++i) {
+    size_t factorID = factorIDs[i];
+    splitID = splitID | (1ULL << factorID);
+
+    // Count deaths of this level in right child per timepoint
+    size_t level_end = num_samples_right_child + counter[factorID];
+    for (; num_samples_right_child < level_end; ++num_samples_right_child) {
+      size_t pos = level_positions[num_samples_right_child];
+      size_t survival_timeID = (*response_timepointIDs)[sampleIDs[pos]];
+      ++delta_samples_at_risk_right_child[survival_timeID];
+      if (getNodeResponse(pos, 1) == 1) {
+        ++num_deaths_right_child[survival_timeID];
+      }
+    }
+
+    // Stop if minimal node size reached
+    size_t num_samples_left_child = num_samples_node - num_samples_right_child;
+    if (num_samples_right_child < min_node_size || num_samples_left_child < min_node_size) {
+      continue;
+    }
+
+    // Compute logrank test statistic for this split
+    double numerator = 0;
+    double denominator_squared = 0;
+    size_t num_samples_at_risk_right_child = num_samples_right_child;
+    for (size_t t = 0; t < num_timepoints; ++t) {
+      if (num_samples_at_risk[t] < 2 || num_samples_at_risk_right_child < 1) {
+        break;
+      }
+
+      if (num_deaths[t] > 0) {
+        // Numerator and demoninator for log-rank test, notation from Ishwaran et al.
+        double di = (double) num_deaths[t];
+        double di1 = (double) num_deaths_right_child[t];
+        double Yi = (double) num_samples_at_risk[t];
+        double Yi1 = (double) num_samples_at_risk_right_child;
+        numerator += di1 - Yi1 * (di / Yi);
+        denominator_squared += (Yi1 / Yi) * (1.0 - Yi1 / Yi) * ((Yi - di) / (Yi - 1)) * di;
+      }
+
+      // Reduce number of samples at risk for next timepoint
+      num_samples_at_risk_right_child -= delta_samples_at_risk_right_child[t];
+    }
+    double logrank = -1;
+    if (denominator_squared != 0) {
+      logrank = fabs(numerator / sqrt(denominator_squared));
+    }
+
+    // Regularization
+    regularize(logrank, varID);
+
+    if (logrank > best_logrank) {
+      best_value = encodeFactorSplit(splitID, all_levels, largest_level);
+      best_varID = varID;
+      best_logrank = logrank;
+    }
+  }
+}
+
 void TreeSurvival::findBestSplitValueAUC(size_t nodeID, size_t varID, double& best_value, size_t& best_varID,
     double& best_auc) {
 
-  // Create possible split values
+  // Create possible split values and index of value for each sample
   std::vector<double> possible_split_values;
-  data->getAllValues(possible_split_values, sampleIDs, varID, start_pos[nodeID], end_pos[nodeID]);
+  std::vector<size_t> value_indices;
+  data->getAllValues(possible_split_values, value_indices, sampleIDs, varID, start_pos[nodeID], end_pos[nodeID]);
 
   // Try next variable if all equal for this
   if (possible_split_values.size() < 2) {
@@ -554,22 +797,19 @@ void TreeSurvival::findBestSplitValueAUC(size_t nodeID, size_t varID, double& be
   // For all pairs
   for (size_t k = start_pos[nodeID]; k < end_pos[nodeID]; ++k) {
     size_t sample_k = sampleIDs[k];
-    double time_k = data->get_y(sample_k, 0);
-    double status_k = data->get_y(sample_k, 1);
+    double time_k = getNodeResponse(k);
+    double status_k = getNodeResponse(k, 1);
     double value_k = data->get_x(sample_k, varID);
 
-    // Count samples in left node
-    for (size_t i = 0; i < num_splits; ++i) {
-      double split_value = possible_split_values[i];
-      if (value_k <= split_value) {
-        ++num_samples_left_child[i];
-      }
+    // Count samples in left node, all splits from value index on
+    for (size_t i = value_indices[k - start_pos[nodeID]]; i < num_splits; ++i) {
+      ++num_samples_left_child[i];
     }
 
     for (size_t l = k + 1; l < end_pos[nodeID]; ++l) {
       size_t sample_l = sampleIDs[l];
-      double time_l = data->get_y(sample_l, 0);
-      double status_l = data->get_y(sample_l, 1);
+      double time_l = getNodeResponse(l);
+      double status_l = getNodeResponse(l, 1);
       double value_l = data->get_x(sample_l, varID);
 
       // Compute split
@@ -687,6 +927,8 @@ bool TreeSurvival::findBestSplitExtraTrees(size_t nodeID, std::vector<size_t>& p
   // Stop early if no split posssible
   if (num_samples_node >= 2 * min_node_size) {
 
+    countSplitCandidates(SPLIT_OTHER, possible_split_varIDs.size());
+
     // For all possible split variables
     for (auto& varID : possible_split_varIDs) {
 
@@ -813,11 +1055,9 @@ void TreeSurvival::findBestSplitValueExtraTreesUnordered(size_t nodeID, size_t v
 
   // Get all factor indices in node
   std::vector<bool> factor_in_node(num_unique_values, false);
-  for (size_t pos = start_pos[nodeID]; pos < end_pos[nodeID]; ++pos) {
-    size_t sampleID = sampleIDs[pos];
-    size_t index = data->getIndex(sampleID, varID);
+  forEachNodeIndex(nodeID, varID, [&](size_t pos, size_t index) {
     factor_in_node[index] = true;
-  }
+  });
 
   // Vector of indices in and out of node
   std::vector<size_t> indices_in_node;
@@ -884,7 +1124,7 @@ void TreeSurvival::findBestSplitValueExtraTreesUnordered(size_t nodeID, size_t v
       if ((splitID & (1ULL << factorID))) {
         ++num_samples_right_child;
         ++delta_samples_at_risk_right_child[survival_timeID];
-        if (data->get_y(sampleID, 1) == 1) {
+        if (getNodeResponse(pos, 1) == 1) {
           ++num_deaths_right_child[survival_timeID];
         }
       }
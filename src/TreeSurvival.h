@@ -36,25 +36,63 @@ public:
   void allocateMemory() override;
 
   void appendToFileInternal(std::ofstream& file) override;
+  void appendToBinaryFileInternal(BlockFileWriter& file) const override;
+  void loadFromBinaryFileInternal(MappedFile& file) override;
   void computePermutationImportanceInternal(std::vector<std::vector<size_t>>* permutations);
 
-  const std::vector<std::vector<double>>& getChf() const {
-    return chf;
+  // CHF at all unique timepoints for terminal nodes, empty vector for other nodes
+  std::vector<std::vector<double>> getChf() const;
+
+  size_t getPredictionTerminalNodeID(size_t sampleID) const {
+    return prediction_terminal_nodeIDs[sampleID];
   }
 
-  const std::vector<double>& getPrediction(size_t sampleID) const {
-    size_t terminal_nodeID = prediction_terminal_nodeIDs[sampleID];
-    return chf[terminal_nodeID];
+  // CHF of a terminal node as steps: from timepoint getChfStepTimepointID(step) on, the CHF is getChfStepValue(step)
+  // for the steps getChfStepsBegin(nodeID) to getChfStepsEnd(nodeID) - 1. Before the first step, the CHF is 0.
+  size_t getChfStepsBegin(size_t nodeID) const {
+    if (mapped_chf_steps_begin) {
+      return mapped_chf_steps_begin[nodeID];
+    }
+    return chf_steps_begin[nodeID];
   }
 
-  size_t getPredictionTerminalNodeID(size_t sampleID) const {
-    return prediction_terminal_nodeIDs[sampleID];
+  size_t getChfStepsEnd(size_t nodeID) const {
+    if (mapped_chf_steps_begin) {
+      return mapped_chf_steps_begin[nodeID + 1];
+    }
+    return chf_steps_end[nodeID];
+  }
+
+  size_t getChfStepTimepointID(size_t step) const {
+    if (mapped_chf_steps_begin) {
+      return mapped_chf_step_timepointIDs[step];
+    }
+    return chf_step_timepointIDs[step];
+  }
+
+  double getChfStepValue(size_t step) const {
+    if (mapped_chf_steps_begin) {
+      return mapped_chf_step_values[step];
+    }
+    return chf_step_values[step];
   }
 
 private:
 
+  // Scratch buffers for logrank split search
+  struct LogrankBuffers {
+    std::vector<double> possible_split_values;
+    std::vector<size_t> value_indices;
+    std::vector<size_t> num_deaths_right_child;
+    std::vector<size_t> delta_samples_at_risk_right_child;
+    std::vector<size_t> value_starts;
+    std::vector<size_t> sorted_sampleIDs;
+    std::vector<double> logranks;
+  };
+
   void createEmptyNodeInternal() override;
   void computeSurvival(size_t nodeID);
+  void setChf(size_t nodeID, const std::vector<double>& node_chf);
   double computePredictionAccuracyInternal(std::vector<double>* prediction_error_casewise) override;
   
   bool splitNodeInternal(size_t nodeID, std::vector<size_t>& possible_split_varIDs) override;
@@ -78,9 +116,11 @@ private:
       std::vector<double>& num_total);
 
   void findBestSplitValueLogRank(size_t nodeID, size_t varID, double& best_value, size_t& best_varID,
-      double& best_logrank);
+      double& best_logrank, LogrankBuffers& buffers);
   void findBestSplitValueLogRankUnordered(size_t nodeID, size_t varID, double& best_value, size_t& best_varID,
       double& best_logrank);
+  void findBestSplitValueLogRankSortedLevels(size_t nodeID, size_t varID, double& best_value, size_t& best_varID,
+      double& best_logrank);
 
   bool findBestSplitExtraTrees(size_t nodeID, std::vector<size_t>& possible_split_varIDs);
   void findBestSplitValueExtraTrees(size_t nodeID, size_t varID, double& best_value, size_t& best_varID,
@@ -90,11 +130,17 @@ private:
 
   void addImpurityImportance(size_t nodeID, size_t varID, double decrease);
 
+  // Time and status
+  size_t getNumNodeResponseColumns() const override {
+    return 2;
+  }
+
   void cleanUpInternal() override {
     num_deaths.clear();
     num_deaths.shrink_to_fit();
     num_samples_at_risk.clear();
     num_samples_at_risk.shrink_to_fit();
+    logrank_buffers = LogrankBuffers();
   }
 
   // Unique time points for all individuals (not only this bootstrap), sorted
@@ -102,12 +148,25 @@ private:
   size_t num_timepoints;
   const std::vector<size_t>* response_timepointIDs;
 
-  // For all terminal nodes CHF for all unique timepoints. For other nodes empty vector.
-  std::vector<std::vector<double>> chf;
+  // CHF of terminal nodes, stored only at the timepoints with deaths in the node. No steps for other nodes.
+  std::vector<size_t> chf_steps_begin;
+  std::vector<size_t> chf_steps_end;
+  std::vector<size_t> chf_step_timepointIDs;
+  std::vector<double> chf_step_values;
+
+  // Sum of CHF over all unique timepoints for each node
+  std::vector<double> chf_sums;
+
+  // CHF steps in a mapped forest file, steps of node nodeID from mapped_chf_steps_begin[nodeID] to
+  // mapped_chf_steps_begin[nodeID + 1] - 1
+  const uint64_t* mapped_chf_steps_begin;
+  const uint32_t* mapped_chf_step_timepointIDs;
+  const double* mapped_chf_step_values;
 
   // Fields to save to while tree growing
   std::vector<size_t> num_deaths;
   std::vector<size_t> num_samples_at_risk;
+  LogrankBuffers logrank_buffers;
 };
 
 } // namespace ranger
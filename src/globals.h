@@ -37,13 +37,19 @@ enum TreeType {
   TREE_PROBABILITY = 9
 };
 
+// First bytes of binary forest files
+const char BINARY_FOREST_MAGIC[] = "RNGRFOR1";
+const uint BINARY_FOREST_MAGIC_LENGTH = 8;
+
 // Memory modes
 enum MemoryMode {
   MEM_DOUBLE = 0,
   MEM_FLOAT = 1,
-  MEM_CHAR = 2
+  MEM_CHAR = 2,
+  MEM_INDEX = 3,
+  MEM_SPARSE = 4
 };
-const uint MAX_MEM_MODE = 2;
+const uint MAX_MEM_MODE = 4;
 
 // Mask and Offset to store 2 bit values in bytes
 static const int mask[4] = {192,48,12,3};
@@ -72,6 +78,18 @@ enum SplitRule {
   HELLINGER = 7
 };
 
+// Split search method, counted for profiling
+enum SplitMethod {
+  SPLIT_SMALL_Q = 0,
+  SPLIT_LARGE_Q = 1,
+  SPLIT_HISTOGRAM = 2,
+  SPLIT_SPARSE = 3,
+  SPLIT_UNORDERED = 4,
+  SPLIT_SNP = 5,
+  SPLIT_OTHER = 6
+};
+const uint NUM_SPLIT_METHODS = 7;
+
 // Prediction type
 enum PredictionType {
   RESPONSE = 1,
@@ -80,6 +98,7 @@ enum PredictionType {
 
 // Default values
 const uint DEFAULT_NUM_TREE = 500;
+const uint DEFAULT_OOB_STOP_WINDOW = 50;
 const uint DEFAULT_NUM_THREADS = 0;
 const ImportanceMode DEFAULT_IMPORTANCE_MODE = IMP_NONE;
 
@@ -102,6 +121,42 @@ const double DEFAULT_SAMPLE_FRACTION_NOREPLACE = 0.632;
 // Interval to print progress in seconds
 const double STATUS_INTERVAL = 30.0;
 
+// Bytes of prediction data per block of samples in blocked prediction, about the size of L2 cache
+const uint PREDICTION_BLOCK_BYTES = 262144;
+
+// Number of samples dropped down a tree together in ordered prediction
+const uint PREDICTION_GROUP_SIZE = 8;
+
+// Maximum number of samples predicted in the calling thread, without starting threads
+const uint PREDICTION_INLINE_MAX_SAMPLES = 64;
+
+// Minimum number of node samples times split candidates to search split candidates in parallel
+const uint MIN_PARALLEL_SPLIT_WORK = 50000;
+
+// Minimum number of node samples per word of node bitsets to count SNP genotypes by class or to sum their responses
+// with the bitset kernel, below the samples are faster read one by one
+const uint SNP_COUNT_MIN_SAMPLES_PER_WORD = 2;
+const uint SNP_SUM_MIN_SAMPLES_PER_WORD = 8;
+
+// Size of blocks read from text input files in bytes
+const uint TEXT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+// Minimum number of keys for radix sort, std::sort below
+const uint RADIX_SORT_MIN_KEYS = 128;
+
+// Minimum number of node samples per bin to keep histograms of a node for histogram subtraction
+const uint MIN_HISTOGRAM_NODE_SIZE_PER_BIN = 8;
+
+// Stream a column in row order for the histograms of a level if the requesting nodes have at least one sample per
+// this many rows, else compute the histograms of each node from its samples
+const uint LEVEL_HISTOGRAM_ROWS_PER_SAMPLE = 4;
+
+// Number of OOB samples to prefetch ahead when routing them down a split while growing
+const uint OOB_PREFETCH_DISTANCE = 16;
+
+// Maximum number of bins per variable for histogram splitting
+const uint MAX_NUM_BINS = 255;
+
 // Threshold for q value split method switch
 const double Q_THRESHOLD = 0.02;
 
@@ -193,6 +193,18 @@ Rcpp::List rangerCpp(uint treetype, Rcpp::NumericMatrix& input_x, Rcpp::NumericM
       }
     }
 
+    // Write predictions straight into R memory, use first non-empty dimension
+    Rcpp::NumericVector predictions;
+    forest->setPredictionAllocator([&predictions](size_t dim0, size_t dim1, size_t dim2) {
+      predictions = Rcpp::NumericVector(dim0 * dim1 * dim2);
+      if (dim0 > 1) {
+        predictions.attr("dim") = Rcpp::Dimension(dim0, dim1, dim2);
+      } else if (dim1 > 1) {
+        predictions.attr("dim") = Rcpp::Dimension(dim1, dim2);
+      }
+      return predictions.begin();
+    });
+
     // Run Ranger
     forest->run(false, oob_error);
 
@@ -204,17 +216,7 @@ Rcpp::List rangerCpp(uint treetype, Rcpp::NumericMatrix& input_x, Rcpp::NumericM
       }
     }
 
-    // Use first non-empty dimension of predictions
-    const std::vector<std::vector<std::vector<double>>>& predictions = forest->getPredictions();
-    if (predictions.size() == 1) {
-      if (predictions[0].size() == 1) {
-        result.push_back(forest->getPredictions()[0][0], "predictions");
-      } else {
-        result.push_back(forest->getPredictions()[0], "predictions");
-      }
-    } else {
-      result.push_back(forest->getPredictions(), "predictions");
-    }
+    result.push_back(predictions, "predictions");
 
     // Return output
     result.push_back(forest->getNumTrees(), "num.trees");
@@ -239,6 +241,24 @@ Rcpp::List rangerCpp(uint treetype, Rcpp::NumericMatrix& input_x, Rcpp::NumericM
       result.push_back(forest->getInbagCounts(), "inbag.counts");
     }
 
+    // Phase times and counters
+    const Profile& profile = forest->getProfile();
+    Rcpp::List profile_phases;
+    for (auto& phase : profile.phases) {
+      profile_phases.push_back(
+          Rcpp::NumericVector::create(Rcpp::Named("wall.seconds") = phase.wall_seconds,
+              Rcpp::Named("cpu.seconds") = phase.cpu_seconds), phase.name);
+    }
+    Rcpp::NumericVector split_candidates(profile.num_split_candidates.begin(), profile.num_split_candidates.end());
+    split_candidates.names() = std::vector<std::string>(SPLIT_METHOD_NAMES, SPLIT_METHOD_NAMES + NUM_SPLIT_METHODS);
+    Rcpp::List profile_object;
+    profile_object.push_back(profile_phases, "phases");
+    profile_object.push_back(profile.tree_grow_seconds, "tree.grow.seconds");
+    profile_object.push_back(profile.thread_idle_seconds, "thread.idle.seconds");
+    profile_object.push_back((double) profile.num_nodes, "num.nodes");
+    profile_object.push_back(split_candidates, "split.candidates");
+    result.push_back(profile_object, "profile");
+
     // Save forest if needed
     if (write_forest) {
       Rcpp::List forest_object;
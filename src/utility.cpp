@@ -10,11 +10,15 @@
  #-------------------------------------------------------------------------------*/
 
 #include <math.h>
+#include <cmath>
+#include <limits>
 #include <iostream>
 #include <sstream>
 #include <unordered_set>
 #include <unordered_map>
 #include <algorithm>
+#include <functional>
+#include <numeric>
 #include <random>
 #include <stdexcept>
 #include <string>
@@ -186,23 +190,23 @@ void drawWithoutReplacementFisherYates(std::vector<size_t>& result, std::mt19937
 }
 
 void drawWithoutReplacementWeighted(std::vector<size_t>& result, std::mt19937_64& random_number_generator,
-    size_t max_index, size_t num_samples, const std::vector<double>& weights) {
+    const AliasTable& alias_table, std::vector<bool>& drawn, size_t num_samples) {
 
-  result.reserve(num_samples);
-
-  // Set all to not selected
-  std::vector<bool> temp;
-  temp.resize(max_index + 1, false);
-
-  std::discrete_distribution<> weighted_dist(weights.begin(), weights.end());
+  size_t start = result.size();
+  result.reserve(start + num_samples);
   for (size_t i = 0; i < num_samples; ++i) {
     size_t draw;
     do {
-      draw = weighted_dist(random_number_generator);
-    } while (temp[draw]);
-    temp[draw] = true;
+      draw = alias_table.draw(random_number_generator);
+    } while (drawn[draw]);
+    drawn[draw] = true;
     result.push_back(draw);
   }
+
+  // Only reset the marks of the numbers drawn
+  for (size_t i = start; i < result.size(); ++i) {
+    drawn[result[i]] = false;
+  }
 }
 
 double mostFrequentValue(const std::unordered_map<double, size_t>& class_count,
@@ -233,86 +237,162 @@ double mostFrequentValue(const std::unordered_map<double, size_t>& class_count,
 double computeConcordanceIndex(const Data& data, const std::vector<double>& sum_chf,
     const std::vector<size_t>& sample_IDs, std::vector<double>* prediction_error_casewise) {
 
-  // Compute concordance index
-  double concordance = 0;
-  double permissible = 0;
-  
+  // Compute concordance index in O(n log n): Pairs of an event and a sample with later time are counted with a
+  // Fenwick tree over the ranks of sum_chf, pairs with equal times and different status within each group of ties
+  size_t num_samples = sum_chf.size();
+  std::vector<double> times(num_samples);
+  std::vector<double> status(num_samples);
+  for (size_t i = 0; i < num_samples; ++i) {
+    size_t sample_i = i;
+    if (!sample_IDs.empty()) {
+      sample_i = sample_IDs[i];
+    }
+    times[i] = data.get_y(sample_i, 0);
+    status[i] = data.get_y(sample_i, 1);
+  }
+
+  // Ranks of sum_chf starting at 1, equal values get equal ranks
+  std::vector<double> unique_chf(sum_chf);
+  std::sort(unique_chf.begin(), unique_chf.end());
+  unique_chf.erase(std::unique(unique_chf.begin(), unique_chf.end()), unique_chf.end());
+  std::vector<size_t> chf_ranks(num_samples);
+  for (size_t i = 0; i < num_samples; ++i) {
+    chf_ranks[i] = std::lower_bound(unique_chf.begin(), unique_chf.end(), sum_chf[i]) - unique_chf.begin() + 1;
+  }
+
+  // Order by time and find groups of equal times
+  std::vector<size_t> order(num_samples);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](size_t i, size_t j) {return times[i] < times[j];});
+  std::vector<size_t> group_starts;
+  for (size_t pos = 0; pos < num_samples; ++pos) {
+    if (pos == 0 || times[order[pos]] != times[order[pos - 1]]) {
+      group_starts.push_back(pos);
+    }
+  }
+  group_starts.push_back(num_samples);
+  size_t num_groups = group_starts.size() - 1;
+
   std::vector<double> concordance_casewise;
   std::vector<double> permissible_casewise;
   if (prediction_error_casewise) {
     concordance_casewise.resize(prediction_error_casewise->size(), 0);
     permissible_casewise.resize(prediction_error_casewise->size(), 0);
   }
-  
-  for (size_t i = 0; i < sum_chf.size(); ++i) {
-    size_t sample_i = i;
-    if (!sample_IDs.empty()) {
-      sample_i = sample_IDs[i];
+
+  // Fenwick tree with counts per rank
+  std::vector<size_t> rank_counts(unique_chf.size() + 1);
+  size_t num_inserted = 0;
+  auto insert = [&](size_t rank) {
+    for (; rank < rank_counts.size(); rank += rank & (~rank + 1)) {
+      ++rank_counts[rank];
+    }
+    ++num_inserted;
+  };
+  auto count_up_to = [&](size_t rank) {
+    size_t count = 0;
+    for (; rank > 0; rank -= rank & (~rank + 1)) {
+      count += rank_counts[rank];
     }
-    double time_i = data.get_y(sample_i, 0);
-    double status_i = data.get_y(sample_i, 1);
+    return count;
+  };
 
-    double conc, perm;
-    if (prediction_error_casewise) {
-      conc = concordance_casewise[i];
-      perm = permissible_casewise[i];
-    } else {
-      conc = 0;
-      perm = 0;
-    }
-    
-    for (size_t j = i + 1; j < sum_chf.size(); ++j) {
-      size_t sample_j = j;
-      if (!sample_IDs.empty()) {
-        sample_j = sample_IDs[j];
+  // Each sample with all events at earlier times: concordant if event has larger sum_chf
+  double concordance = 0;
+  double permissible = 0;
+  for (size_t group = 0; group < num_groups; ++group) {
+    for (size_t pos = group_starts[group]; pos < group_starts[group + 1]; ++pos) {
+      size_t i = order[pos];
+      size_t num_less_equal = count_up_to(chf_ranks[i]);
+      size_t num_equal = num_less_equal - count_up_to(chf_ranks[i] - 1);
+      double conc = (num_inserted - num_less_equal) + 0.5 * num_equal;
+      concordance += conc;
+      permissible += num_inserted;
+      if (prediction_error_casewise) {
+        concordance_casewise[i] += conc;
+        permissible_casewise[i] += num_inserted;
       }
-      double time_j = data.get_y(sample_j, 0);
-      double status_j = data.get_y(sample_j, 1);
-
-      if (time_i < time_j && status_i == 0) {
-        continue;
+    }
+    for (size_t pos = group_starts[group]; pos < group_starts[group + 1]; ++pos) {
+      if (status[order[pos]] != 0) {
+        insert(chf_ranks[order[pos]]);
       }
-      if (time_j < time_i && status_j == 0) {
-        continue;
+    }
+  }
+
+  // Same pairs for the events, with all samples at later times
+  if (prediction_error_casewise) {
+    std::fill(rank_counts.begin(), rank_counts.end(), 0);
+    num_inserted = 0;
+    for (size_t group = num_groups; group > 0; --group) {
+      for (size_t pos = group_starts[group - 1]; pos < group_starts[group]; ++pos) {
+        size_t i = order[pos];
+        if (status[i] != 0) {
+          size_t num_less = count_up_to(chf_ranks[i] - 1);
+          size_t num_equal = count_up_to(chf_ranks[i]) - num_less;
+          concordance_casewise[i] += num_less + 0.5 * num_equal;
+          permissible_casewise[i] += num_inserted;
+        }
       }
-      if (time_i == time_j && status_i == status_j) {
-        continue;
+      for (size_t pos = group_starts[group - 1]; pos < group_starts[group]; ++pos) {
+        insert(chf_ranks[order[pos]]);
       }
+    }
+  }
 
-      double co;
-      if (time_i < time_j && sum_chf[i] > sum_chf[j]) {
-        co = 1;
-      } else if (time_j < time_i && sum_chf[j] > sum_chf[i]) {
-        co = 1;
-      } else if (sum_chf[i] == sum_chf[j]) {
-        co = 0.5;
-      } else {
-        co = 0;
+  // Pairs with equal times and different status: 0.5 if sum_chf equal, 0 otherwise
+  std::vector<size_t> tied;
+  for (size_t group = 0; group < num_groups; ++group) {
+    size_t group_size = group_starts[group + 1] - group_starts[group];
+    if (group_size < 2) {
+      continue;
+    }
+    tied.assign(order.begin() + group_starts[group], order.begin() + group_starts[group + 1]);
+
+    // For each sample number of samples with same status, same sum_chf and both
+    std::vector<size_t> same_status(group_size);
+    std::vector<size_t> same_chf(group_size);
+    std::vector<size_t> same_both(group_size);
+    auto count_runs = [&](std::vector<size_t>& counts, std::function<bool(size_t, size_t)> less) {
+      std::vector<size_t> idx(group_size);
+      std::iota(idx.begin(), idx.end(), 0);
+      std::sort(idx.begin(), idx.end(), [&](size_t k, size_t l) {return less(tied[k], tied[l]);});
+      size_t start = 0;
+      for (size_t pos = 1; pos <= group_size; ++pos) {
+        if (pos == group_size || less(tied[idx[start]], tied[idx[pos]])) {
+          for (size_t k = start; k < pos; ++k) {
+            counts[idx[k]] = pos - start;
+          }
+          start = pos;
+        }
       }
-      
-      conc += co;
-      perm += 1;
-      
+    };
+    count_runs(same_status, [&](size_t i, size_t j) {return status[i] < status[j];});
+    count_runs(same_chf, [&](size_t i, size_t j) {return chf_ranks[i] < chf_ranks[j];});
+    count_runs(same_both, [&](size_t i, size_t j) {
+      return chf_ranks[i] < chf_ranks[j] || (chf_ranks[i] == chf_ranks[j] && status[i] < status[j]);
+    });
+
+    for (size_t k = 0; k < group_size; ++k) {
+      double perm = group_size - same_status[k];
+      double conc = 0.5 * (same_chf[k] - same_both[k]);
+
+      // Each pair is seen from both samples
+      concordance += 0.5 * conc;
+      permissible += 0.5 * perm;
       if (prediction_error_casewise) {
-        concordance_casewise[j] += co;
-        permissible_casewise[j] += 1;
+        concordance_casewise[tied[k]] += conc;
+        permissible_casewise[tied[k]] += perm;
       }
     }
-    
-    concordance += conc;
-    permissible += perm;
-    if (prediction_error_casewise) {
-      concordance_casewise[i] = conc;
-      permissible_casewise[i] = perm;
-    }
   }
-  
+
   if (prediction_error_casewise) {
     for (size_t i = 0; i < prediction_error_casewise->size(); ++i) {
       (*prediction_error_casewise)[i] = 1 - concordance_casewise[i] / permissible_casewise[i];
     }
   }
-  
+
   return (concordance / permissible);
 }
 
@@ -373,6 +453,21 @@ size_t roundToNextMultiple(size_t value, uint multiple) {
 
   return value + multiple - remainder;
 }
+
+float roundDownToFloat(double value) {
+  const float max_float = std::numeric_limits<float>::max();
+  if (value > max_float) {
+    return std::isinf(value) ? std::numeric_limits<float>::infinity() : max_float;
+  } else if (value < -max_float) {
+    return -std::numeric_limits<float>::infinity();
+  }
+
+  float result = (float) value;
+  if (result > value) {
+    result = std::nextafter(result, -max_float);
+  }
+  return result;
+}
 // #nocov end
 
 void splitString(std::vector<std::string>& result, const std::string& input, char split_char) { // #nocov start
@@ -540,13 +635,122 @@ std::vector<double> adjustPvalues(std::vector<double>& unadjusted_pvalues) {
   return adjusted_pvalues;
 }
 
+std::vector<size_t> orderRadix(const std::vector<size_t>& keys, size_t max_key) {
+  std::vector<size_t> indices(keys.size());
+  std::iota(indices.begin(), indices.end(), 0);
+
+  // Comparison sort is faster than the bucket passes for few keys
+  if (keys.size() < RADIX_SORT_MIN_KEYS) {
+    std::stable_sort(indices.begin(), indices.end(), [&](size_t i1, size_t i2) {return keys[i1] < keys[i2];});
+    return indices;
+  }
+
+  // Least significant digit first, one counting pass per byte of max_key
+  std::vector<size_t> buffer(keys.size());
+  std::vector<size_t> bucket_starts(256);
+  for (size_t shift = 0; shift < 8 * sizeof(size_t) && (max_key - 1) >> shift > 0; shift += 8) {
+    std::fill(bucket_starts.begin(), bucket_starts.end(), 0);
+    for (auto& key : keys) {
+      ++bucket_starts[(key >> shift) & 0xFF];
+    }
+    size_t sum = 0;
+    for (auto& bucket_start : bucket_starts) {
+      size_t count = bucket_start;
+      bucket_start = sum;
+      sum += count;
+    }
+    for (auto& index : indices) {
+      buffer[bucket_starts[(keys[index] >> shift) & 0xFF]++] = index;
+    }
+    indices.swap(buffer);
+  }
+  return indices;
+}
+
+std::vector<double> principalComponentScores(const std::vector<double>& x, const std::vector<double>& weights,
+    size_t num_cols) {
+  size_t num_rows = weights.size();
+
+  // Center rows on their weighted mean
+  double sum_weights = 0;
+  std::vector<double> mean(num_cols);
+  for (size_t i = 0; i < num_rows; ++i) {
+    sum_weights += weights[i];
+    for (size_t j = 0; j < num_cols; ++j) {
+      mean[j] += weights[i] * x[i * num_cols + j];
+    }
+  }
+  std::vector<double> centered(x.size());
+  for (size_t i = 0; i < num_rows; ++i) {
+    for (size_t j = 0; j < num_cols; ++j) {
+      centered[i * num_cols + j] = x[i * num_cols + j] - mean[j] / sum_weights;
+    }
+  }
+
+  // Start from the row farthest from the mean, the ones vector may be orthogonal to the component
+  std::vector<double> component(num_cols);
+  double max_norm = 0;
+  for (size_t i = 0; i < num_rows; ++i) {
+    double norm = 0;
+    for (size_t j = 0; j < num_cols; ++j) {
+      norm += centered[i * num_cols + j] * centered[i * num_cols + j];
+    }
+    if (norm > max_norm) {
+      max_norm = norm;
+      std::copy(centered.begin() + i * num_cols, centered.begin() + (i + 1) * num_cols, component.begin());
+    }
+  }
+
+  // Power iteration with the weighted covariance matrix, applied as sum of w_i * c_i * (c_i' v)
+  std::vector<double> scores(num_rows);
+  std::vector<double> next(num_cols);
+  for (size_t iteration = 0; max_norm > 0 && iteration < 100; ++iteration) {
+    std::fill(next.begin(), next.end(), 0);
+    for (size_t i = 0; i < num_rows; ++i) {
+      double score = 0;
+      for (size_t j = 0; j < num_cols; ++j) {
+        score += centered[i * num_cols + j] * component[j];
+      }
+      for (size_t j = 0; j < num_cols; ++j) {
+        next[j] += weights[i] * score * centered[i * num_cols + j];
+      }
+    }
+    double norm = 0;
+    for (auto& value : next) {
+      norm += value * value;
+    }
+    if (norm == 0) {
+      break;
+    }
+    norm = sqrt(norm);
+    double change = 0;
+    for (size_t j = 0; j < num_cols; ++j) {
+      next[j] /= norm;
+      change += fabs(next[j] - component[j]);
+    }
+    component.swap(next);
+    if (change < 1e-12) {
+      break;
+    }
+  }
+
+  for (size_t i = 0; max_norm > 0 && i < num_rows; ++i) {
+    for (size_t j = 0; j < num_cols; ++j) {
+      scores[i] += centered[i * num_cols + j] * component[j];
+    }
+  }
+  return scores;
+}
+
 std::vector<double> logrankScores(const std::vector<double>& time, const std::vector<double>& status) {
+  return logrankScores(time, status, order(time, false));
+}
+
+std::vector<double> logrankScores(const std::vector<double>& time, const std::vector<double>& status,
+    const std::vector<size_t>& indices) {
   size_t n = time.size();
   std::vector<double> scores(n);
 
-  // Get order of timepoints
-  std::vector<size_t> indices = order(time, false);
-
   // Compute scores
   double cumsum = 0;
   size_t last_unique = -1;
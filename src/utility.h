@@ -30,6 +30,7 @@
 
 #include "globals.h"
 #include "Data.h"
+#include "AliasTable.h"
 
 namespace ranger {
 
@@ -212,15 +213,16 @@ void drawWithoutReplacementFisherYates(std::vector<size_t>& result, std::mt19937
     size_t max, const std::vector<size_t>& skip, size_t num_samples);
 
 /**
- * Draw random numers without replacement and with weighted probabilites from 0..n-1.
+ * Draw random numers without replacement and with weighted probabilites from 0..n-1. Numbers already drawn are
+ * rejected, in constant expected time per draw if the weights are not concentrated on few numbers.
  * @param result Vector to add results to. Will not be cleaned before filling.
  * @param random_number_generator Random number generator
- * @param max_index Maximum index to draw
+ * @param alias_table Alias table of the weights, one for each number
+ * @param drawn Marks of the numbers drawn, size at least n and all false before and after the call
  * @param num_samples Number of samples to draw
- * @param weights A weight for each element of indices
  */
 void drawWithoutReplacementWeighted(std::vector<size_t>& result, std::mt19937_64& random_number_generator,
-    size_t max_index, size_t num_samples, const std::vector<double>& weights);
+    const AliasTable& alias_table, std::vector<bool>& drawn, size_t num_samples);
 
 /**
  * Draw random numbers of a vector without replacement.
@@ -246,37 +248,51 @@ void drawWithoutReplacementFromVector(std::vector<T>& result, const std::vector<
 }
 
 /**
- * Returns the most frequent class index of a vector with counts for the classes. Returns a random class if counts are equal.
- * @param class_count Vector with class counts
+ * Returns the most frequent class index of an array with counts for the classes. Returns a random class if counts are equal.
+ * @param class_count Array with num_classes class counts
+ * @param num_classes Number of classes
  * @param random_number_generator Random number generator
  * @return Most frequent class index. Out of range index if all 0.
  */
 template<typename T>
-size_t mostFrequentClass(const std::vector<T>& class_count, std::mt19937_64 random_number_generator) {
-  std::vector<size_t> major_classes;
+size_t mostFrequentClass(const T* class_count, size_t num_classes, std::mt19937_64 random_number_generator) {
 
-// Find maximum count
+  // Find maximum count, without branches to allow vectorization
   T max_count = 0;
-  for (size_t i = 0; i < class_count.size(); ++i) {
-    T count = class_count[i];
-    if (count > max_count) {
-      max_count = count;
-      major_classes.clear();
-      major_classes.push_back(i);
-    } else if (count == max_count) {
-      major_classes.push_back(i);
-    }
+  for (size_t i = 0; i < num_classes; ++i) {
+    max_count = class_count[i] > max_count ? class_count[i] : max_count;
   }
-
   if (max_count == 0) {
-    return class_count.size();
-  } else if (major_classes.size() == 1) {
-    return major_classes[0];
-  } else {
-    // Choose randomly
-    std::uniform_int_distribution<size_t> unif_dist(0, major_classes.size() - 1);
-    return major_classes[unif_dist(random_number_generator)];
+    return num_classes;
+  }
+
+  // Choose randomly between the classes with maximum count, in class order
+  size_t num_major_classes = std::count(class_count, class_count + num_classes, max_count);
+  size_t major_idx = 0;
+  if (num_major_classes > 1) {
+    std::uniform_int_distribution<size_t> unif_dist(0, num_major_classes - 1);
+    major_idx = unif_dist(random_number_generator);
+  }
+  for (size_t i = 0; i < num_classes; ++i) {
+    if (class_count[i] == max_count) {
+      if (major_idx == 0) {
+        return i;
+      }
+      --major_idx;
+    }
   }
+  return num_classes;
+}
+
+/**
+ * Returns the most frequent class index of a vector with counts for the classes. Returns a random class if counts are equal.
+ * @param class_count Vector with class counts
+ * @param random_number_generator Random number generator
+ * @return Most frequent class index. Out of range index if all 0.
+ */
+template<typename T>
+size_t mostFrequentClass(const std::vector<T>& class_count, std::mt19937_64 random_number_generator) {
+  return mostFrequentClass(class_count.data(), class_count.size(), random_number_generator);
 }
 
 /**
@@ -322,6 +338,14 @@ std::string beautifyTime(uint seconds);
  */
 size_t roundToNextMultiple(size_t value, uint multiple);
 
+/**
+ * Round down to the largest float not greater than a number. For all floats x, x <= value is then the same as
+ * x <= result.
+ * @param value Value to be rounded down.
+ * @return Rounded number
+ */
+float roundDownToFloat(double value);
+
 /**
  * Split string in string parts separated by character.
  * @param result Splitted string
@@ -426,6 +450,24 @@ double pstdnorm(double x);
  */
 std::vector<double> adjustPvalues(std::vector<double>& unadjusted_pvalues);
 
+/**
+ * Get indices of sorted integer keys with a stable radix sort. Uses std::sort for few keys.
+ * @param keys Keys to sort, all smaller than max_key
+ * @param max_key Upper bound of keys
+ * @return Indices of sorted keys
+ */
+std::vector<size_t> orderRadix(const std::vector<size_t>& keys, size_t max_key);
+
+/**
+ * Project weighted rows on their first principal component, computed by power iteration.
+ * @param x Row major matrix with num_cols columns
+ * @param weights Weight of each row
+ * @param num_cols Number of columns of x
+ * @return Score of each centered row on the first principal component, all 0 if the rows are equal
+ */
+std::vector<double> principalComponentScores(const std::vector<double>& x, const std::vector<double>& weights,
+    size_t num_cols);
+
 /**
  * Get indices of sorted values
  * @param values Values to sort
@@ -486,6 +528,16 @@ std::vector<double> rank(const std::vector<T>& values) {
  */
 std::vector<double> logrankScores(const std::vector<double>& time, const std::vector<double>& status);
 
+/**
+ * Compute Logrank scores for survival times
+ * @param time Survival time
+ * @param status Censoring indicator
+ * @param indices Ordering of time values
+ * @return Logrank scores
+ */
+std::vector<double> logrankScores(const std::vector<double>& time, const std::vector<double>& status,
+    const std::vector<size_t>& indices);
+
 /**
  * Compute maximally selected rank statistics
  * @param scores Scores for dependent variable (y)